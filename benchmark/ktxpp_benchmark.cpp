@@ -0,0 +1,521 @@
+// Google Benchmark suite for ktxpp
+//
+// Run from the repository root, or define KTXPP_TEST_DIRECTORY, so the test/*.ktx corpus can be found. Corpus
+// benchmarks are registered per file, synthetic ones sweep dimensions from 4x4 up to 16K. Throughput is reported
+// as bytes of texture data processed so numbers are comparable across formats and sizes
+
+#include "../ktxpp_convert.h"
+#include "../ktxpp_dispatch.h"
+#include "../ktxpp_metrics.h"
+#include "../ktxpp_pack.h"
+#include "../ktxpp_upload.h"
+#include "../ktxpp_residency.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+
+#if !defined(KTXPP_TEST_DIRECTORY)
+#define KTXPP_TEST_DIRECTORY "test"
+#endif
+
+namespace
+{
+	const char* CorpusFiles[] =
+	{
+		"test_r8u.ktx", "test_rg8u.ktx", "test_rgb8u.ktx", "test_RGBE9995.ktx",
+		"test_BC1.ktx", "test_BC2.ktx", "test_BC3.ktx",
+		"test_ETC1.ktx", "test_ETC2_RGB.ktx", "test_ETC2_RGBA.ktx", "test_EAC_R11.ktx", "test_EAC_RG11.ktx",
+		"test_PVRTC1_2.ktx", "test_PVRTC1_4.ktx", "test_PVRTC2_2.ktx", "test_PVRTC2_4.ktx",
+		"test_ASTC_4x4.ktx", "test_ASTC_6x6.ktx", "test_ASTC_8x8.ktx", "test_ASTC_12x12.ktx",
+	};
+
+	std::vector<unsigned char> read_file(const std::string& path)
+	{
+		std::vector<unsigned char> data;
+		FILE* fh = fopen(path.c_str(), "rb");
+
+		if (fh)
+		{
+			fseek(fh, 0, SEEK_END);
+			long size = ftell(fh);
+			rewind(fh);
+
+			data.resize(size > 0 ? (size_t)size : 0);
+
+			if (fread(data.data(), 1, data.size(), fh) != data.size())
+			{
+				data.clear();
+			}
+
+			fclose(fh);
+		}
+
+		return data;
+	}
+
+	ktxpp::internal::HeaderKTX get_header(const std::vector<unsigned char>& file)
+	{
+		ktxpp::internal::HeaderKTX header;
+		memcpy(&header, file.data(), sizeof(header));
+		return header;
+	}
+
+	// Builds a 2D texture with a full mip chain filled with a deterministic pattern
+	std::vector<unsigned char> build_texture(ktxpp::GLInternalFormat glInternalFormat, ktxpp::GLType glType, ktxpp::GLFormat glFormat, uint32_t size)
+	{
+		uint32_t mipCount = 1;
+		while (size >> mipCount) { mipCount++; }
+
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(glInternalFormat, glType, glFormat, glFormat, size, size, 0, ktxpp::Texture2D, mipCount, 0, header);
+
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> subresources(mipCount);
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, subresources.data()));
+		ktxpp::write_texture_layout(header, desc, subresources.data(), file.data());
+
+		for (const ktxpp::Subresource& subresource : subresources)
+		{
+			for (uint64_t i = 0; i < subresource.size; ++i)
+			{
+				file[(size_t)(subresource.offset + i)] = (unsigned char)((i * 2654435761u) >> 13);
+			}
+		}
+
+		return file;
+	}
+
+	void set_file_counters(benchmark::State& state, int64_t bytesPerIteration)
+	{
+		state.SetBytesProcessed(state.iterations() * bytesPerIteration);
+		state.counters["files/s"] = benchmark::Counter((double)state.iterations(), benchmark::Counter::kIsRate);
+	}
+
+	// Corpus benchmarks
+
+	void BM_decode_header(benchmark::State& state, std::vector<unsigned char> file)
+	{
+		for (auto _ : state)
+		{
+			ktxpp::Descriptor desc;
+			benchmark::DoNotOptimize(ktxpp::decode_header(file.data(), desc));
+			benchmark::ClobberMemory();
+		}
+
+		set_file_counters(state, sizeof(ktxpp::internal::HeaderKTX));
+	}
+
+	void BM_validate_header(benchmark::State& state, std::vector<unsigned char> file)
+	{
+		for (auto _ : state)
+		{
+			ktxpp::Descriptor desc;
+			benchmark::DoNotOptimize(ktxpp::validate_header(file.data(), file.size(), desc));
+			benchmark::ClobberMemory();
+		}
+
+		set_file_counters(state, (int64_t)file.size());
+	}
+
+	void BM_subresource_layout(benchmark::State& state, std::vector<unsigned char> file)
+	{
+		ktxpp::Descriptor desc;
+		ktxpp::decode_header(file.data(), desc);
+		std::vector<ktxpp::Subresource> subresources(ktxpp::get_subresource_count(desc));
+		uint64_t imageDataOffset = ktxpp::get_image_data_offset(get_header(file));
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(ktxpp::compute_subresource_layout(desc, imageDataOffset, subresources.data()));
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations() * (int64_t)subresources.size());
+	}
+
+	void BM_convert_ktx2(benchmark::State& state, std::vector<unsigned char> file, ktxpp::SupercompressionScheme scheme)
+	{
+		ktxpp::ConvertOptions options;
+		options.supercompression = scheme;
+		std::vector<unsigned char> destination;
+
+		for (auto _ : state)
+		{
+			if (ktxpp::convert_ktx1_to_ktx2(file.data(), file.size(), options, destination) != ktxpp::ConvertSuccess)
+			{
+				state.SkipWithError("conversion failed");
+				break;
+			}
+
+			benchmark::DoNotOptimize(destination.data());
+		}
+
+		set_file_counters(state, (int64_t)file.size());
+	}
+
+	// Synthetic benchmarks. The argument is the width and height in pixels
+
+	void BM_build_texture(benchmark::State& state, ktxpp::GLInternalFormat glInternalFormat, ktxpp::GLType glType, ktxpp::GLFormat glFormat)
+	{
+		uint32_t size = (uint32_t)state.range(0);
+		std::vector<unsigned char> reference = build_texture(glInternalFormat, glType, glFormat, size);
+
+		ktxpp::internal::HeaderKTX header = get_header(reference);
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> subresources(header.numberOfMipmapLevels);
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, subresources.data()));
+		uint64_t imageBytes = 0;
+
+		// Tightly packed source images, as an encoder would produce them
+		std::vector<std::vector<unsigned char> > images;
+
+		for (const ktxpp::Subresource& subresource : subresources)
+		{
+			uint32_t widthInBlocks, heightInBlocks;
+			ktxpp::get_mip_size_in_blocks(desc, subresource.mip, widthInBlocks, heightInBlocks);
+			images.push_back(std::vector<unsigned char>((size_t)widthInBlocks * heightInBlocks * desc.bitsPerPixelOrBlock / 8, 0x5a));
+			imageBytes += images.back().size();
+		}
+
+		for (auto _ : state)
+		{
+			ktxpp::write_texture_layout(header, desc, subresources.data(), file.data());
+
+			for (size_t i = 0; i < subresources.size(); ++i)
+			{
+				uint32_t widthInBlocks, heightInBlocks;
+				ktxpp::get_mip_size_in_blocks(desc, subresources[i].mip, widthInBlocks, heightInBlocks);
+				ktxpp::write_subresource(desc, subresources[i], images[i].data(), widthInBlocks * desc.bitsPerPixelOrBlock / 8, file.data());
+			}
+
+			benchmark::ClobberMemory();
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)imageBytes);
+	}
+
+	void BM_convert_synthetic(benchmark::State& state, ktxpp::GLInternalFormat glInternalFormat, ktxpp::GLType glType, ktxpp::GLFormat glFormat)
+	{
+		std::vector<unsigned char> file = build_texture(glInternalFormat, glType, glFormat, (uint32_t)state.range(0));
+		std::vector<unsigned char> destination;
+		ktxpp::ConvertOptions options;
+
+		for (auto _ : state)
+		{
+			ktxpp::convert_ktx1_to_ktx2(file.data(), file.size(), options, destination);
+			benchmark::DoNotOptimize(destination.data());
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)file.size());
+	}
+
+	// Swizzle kernels work on blocks. 8 bytes per block matches BC1/ETC and 4 bytes matches RGBA8
+	template<uint32_t BytesPerBlock, bool Morton, bool Swizzle>
+	void BM_swizzle(benchmark::State& state)
+	{
+		uint32_t blocks = (uint32_t)state.range(0) / (BytesPerBlock == 8 ? 4 : 1);
+		uint32_t rowPitch = blocks * BytesPerBlock;
+		uint64_t swizzledSize = Morton ? ktxpp::get_morton_size(blocks, blocks, BytesPerBlock) : ktxpp::get_tiled_size(blocks, blocks, BytesPerBlock, 8, 8);
+
+		std::vector<unsigned char> linear((size_t)rowPitch * blocks, 1);
+		std::vector<unsigned char> swizzled((size_t)swizzledSize, 2);
+
+		for (auto _ : state)
+		{
+			if (Morton && Swizzle)   { ktxpp::swizzle_morton(linear.data(), rowPitch, swizzled.data(), blocks, blocks, BytesPerBlock); }
+			if (Morton && !Swizzle)  { ktxpp::deswizzle_morton(swizzled.data(), linear.data(), rowPitch, blocks, blocks, BytesPerBlock); }
+			if (!Morton && Swizzle)  { ktxpp::swizzle_tiled(linear.data(), rowPitch, swizzled.data(), blocks, blocks, BytesPerBlock, 8, 8); }
+			if (!Morton && !Swizzle) { ktxpp::deswizzle_tiled(swizzled.data(), linear.data(), rowPitch, blocks, blocks, BytesPerBlock, 8, 8); }
+			benchmark::ClobberMemory();
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)linear.size());
+	}
+
+	void BM_supercompress(benchmark::State& state, ktxpp::SupercompressionScheme scheme, bool decompress)
+	{
+		std::vector<unsigned char> file = build_texture(ktxpp::GL_COMPRESSED_RGB_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, (uint32_t)state.range(0));
+		std::vector<unsigned char> compressed((size_t)ktxpp::get_supercompression_bound(scheme, file.size()));
+		uint64_t compressedSize = ktxpp::supercompress(scheme, 0, file.data(), file.size(), compressed.data(), compressed.size());
+		std::vector<unsigned char> decompressed(file.size());
+
+		for (auto _ : state)
+		{
+			if (decompress)
+			{
+				benchmark::DoNotOptimize(ktxpp::decompress(scheme, compressed.data(), compressedSize, decompressed.data(), decompressed.size()));
+			}
+			else
+			{
+				benchmark::DoNotOptimize(ktxpp::supercompress(scheme, 0, file.data(), file.size(), compressed.data(), compressed.size()));
+			}
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)file.size());
+		state.counters["ratio"] = compressedSize > 0 ? (double)file.size() / (double)compressedSize : 0.0;
+	}
+
+	// Dispatched kernels at every level this machine supports, over 1 MiB of source data. 4:2:2, RGBG and GRGB write
+	// twice that, 1 bit per pixel fills the same 2 MiB from 64 KiB, squared_error8 reads it against a second 1 MiB. The
+	// sRGB kernels convert 256K pixels each way, counted as the bytes on the 8-bit side
+	void BM_kernel(benchmark::State& state, ktxpp::SimdLevel level, int kernel)
+	{
+		ktxpp::Kernels kernels = ktxpp::get_kernels(level);
+		ktxpp::YuvConversion conversion = ktxpp::get_yuv_conversion(ktxpp::YuvUYVY, ktxpp::YuvBT709, ktxpp::YuvLimitedRange);
+		std::vector<unsigned char> source(1 << 20, 0x5a), destination(source.size() * 2);
+		std::vector<float> linear(source.size());
+
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			linear[i] = (float)(i % 1021) / 1020.0f;
+		}
+
+		uint64_t sums[ktxpp::internal::ERROR_LANES] = {};
+		unsigned char maxima[ktxpp::internal::ERROR_LANES] = {}, minima[ktxpp::internal::ERROR_LANES] = {};
+		uint64_t partials[ktxpp::internal::ERROR_LANES] = {};
+		std::vector<uint32_t> ssimSums(source.size() / 4 * 5); // Four rows a quarter of the source long
+
+		for (auto _ : state)
+		{
+			if (kernel == 0) { kernels.byteswap16(source.data(), destination.data(), source.size() / 2); }
+			if (kernel == 1) { kernels.byteswap32(source.data(), destination.data(), source.size() / 4); }
+			if (kernel == 2) { kernels.swap_red_blue(source.data(), destination.data(), source.size() / 4); }
+			if (kernel == 3) { kernels.yuv422_to_rgba8(source.data(), destination.data(), source.size() / 2, conversion); }
+			if (kernel == 4) { kernels.rgbg_to_rgba8(source.data(), destination.data(), source.size() / 2); }
+			if (kernel == 5) { kernels.grgb_to_rgba8(source.data(), destination.data(), source.size() / 2); }
+			if (kernel == 6) { kernels.bw1bpp_to_rgba8(source.data(), destination.data(), destination.size() / 4); }
+			if (kernel == 7) { kernels.squared_error8(source.data(), destination.data(), source.size(), sums, maxima); }
+			if (kernel == 8) { kernels.srgb8_to_linear(source.data(), linear.data(), source.size() / 4); }
+			if (kernel == 9) { kernels.linear_to_srgb8(linear.data(), destination.data(), source.size() / 4); }
+			if (kernel == 10) { kernels.channel_stats8(source.data(), source.size(), sums, partials, minima, maxima); }
+			if (kernel == 11) { kernels.ssim_sums8(source.data(), source.size() / 4, destination.data(), source.size() / 4, source.size() / 4, 4, ssimSums.data()); }
+			benchmark::ClobberMemory();
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)(kernel == 6 ? destination.size() / 32 : source.size()));
+	}
+
+	// All metrics between two 2048x2048 RGBA8 images, the argument is the thread count
+	void BM_compare_images(benchmark::State& state, bool ssim)
+	{
+		const uint32_t size = 2048;
+		std::vector<unsigned char> a((size_t)size * size * 4), b(a.size());
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			a[i] = (unsigned char)(i * 7 >> 3);
+			b[i] = (unsigned char)(a[i] + (i % 5));
+		}
+
+		ktxpp::ImageView viewA = { a.data(), size, size, 1, size * 4, 4, 1 }, viewB = viewA;
+		viewB.data = b.data();
+
+		ktxpp::MetricsOptions options;
+		options.threadCount = (uint32_t)state.range(0);
+		options.ssim = ssim;
+		ktxpp::ImageMetrics metrics;
+
+		for (auto _ : state)
+		{
+			ktxpp::compare_images(viewA, viewB, options, metrics);
+			benchmark::DoNotOptimize(metrics);
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)a.size() * 2);
+	}
+
+	// Filling a D3D12 staging buffer from a mipmapped 4095x4095 RGB8 texture, whose rows are padded to 4 bytes in the
+	// file and to 256 in the buffer so each is copied on its own. The argument is the thread count
+	void BM_fill_staging_buffer(benchmark::State& state)
+	{
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, ktxpp::GL_RGB, 4095, 4095, 0, ktxpp::Texture2D, 12, 0, header);
+
+		ktxpp::Descriptor desc;
+		ktxpp::decode_header(header, desc);
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, layout.data()), 0x5a);
+
+		ktxpp::UploadPlan plan;
+		ktxpp::plan_upload(desc, layout.data(), ktxpp::get_d3d12_upload_alignment(), plan);
+		std::vector<unsigned char> staging((size_t)plan.size);
+
+		for (auto _ : state)
+		{
+			ktxpp::fill_staging_buffer(plan, layout.data(), file.data(), staging.data(), (uint32_t)state.range(0));
+			benchmark::ClobberMemory();
+		}
+
+		state.SetBytesProcessed(state.iterations() * (int64_t)plan.size);
+	}
+
+	// Planning residency for the argument's number of textures, half the size they want, under a budget of a quarter
+	// of what they want, as a streamer does every frame
+	void BM_plan_residency(benchmark::State& state)
+	{
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, (ktxpp::GLFormat)0, 2048, 2048, 0, ktxpp::Texture2D, 12, 0, header);
+
+		ktxpp::Descriptor desc;
+		ktxpp::decode_header(header, desc);
+		ktxpp::ResidencyCosts costs;
+		ktxpp::compute_residency_costs(desc, costs);
+
+		std::vector<ktxpp::ResidencyRequest> requests((size_t)state.range(0));
+		std::vector<uint32_t> topMips(requests.size());
+		uint64_t budget = 0, residentBytes;
+
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			requests[i].costs = &costs;
+			requests[i].priority = (float)(i * 2654435761u % 1000 + 1);
+			requests[i].wantedMip = i % 2;
+			budget += costs.tailCosts[requests[i].wantedMip] / 4;
+		}
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(ktxpp::plan_residency(requests.data(), (uint32_t)requests.size(), budget, topMips.data(), residentBytes));
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+
+	// Content hashing as used by pack deduplication, the argument is the size in bytes
+	void BM_hash(benchmark::State& state)
+	{
+		std::vector<unsigned char> data((size_t)state.range(0), 0x5a);
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(ktxpp::hash_data(data.data(), data.size()));
+		}
+
+		state.SetBytesProcessed(state.iterations() * state.range(0));
+	}
+
+	// Name lookups in a pack holding the argument's number of textures
+	void BM_pack_find(benchmark::State& state)
+	{
+		std::vector<unsigned char> texture = build_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 4);
+		std::vector<std::string> names;
+		ktxpp::PackBuilder builder;
+		builder.pageSize = 256;
+
+		for (int64_t i = 0; i < state.range(0); ++i)
+		{
+			names.push_back("textures/environment/texture_" + std::to_string(i) + ".ktx");
+			ktxpp::add_pack_texture(builder, names.back().c_str(), texture.data(), texture.size());
+		}
+
+		std::vector<unsigned char> data;
+		ktxpp::Pack pack;
+
+		if (ktxpp::build_pack(builder, data) != ktxpp::PackSuccess || ktxpp::open_pack(pack, data.data(), data.size()) != ktxpp::PackSuccess)
+		{
+			state.SkipWithError("pack not built");
+			return;
+		}
+
+		size_t i = 0;
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(ktxpp::find_pack_texture(pack, names[i].c_str()));
+			i = i + 1 < names.size() ? i + 1 : 0;
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	void register_benchmarks()
+	{
+		for (const char* name : CorpusFiles)
+		{
+			std::vector<unsigned char> file = read_file(std::string(KTXPP_TEST_DIRECTORY) + "/" + name);
+			ktxpp::Descriptor desc;
+
+			if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess)
+			{
+				fprintf(stderr, "Skipping %s, not found or not valid\n", name);
+				continue;
+			}
+
+			std::string suffix = std::string("/") + name;
+			benchmark::RegisterBenchmark(("decode_header" + suffix).c_str(), BM_decode_header, file);
+			benchmark::RegisterBenchmark(("validate_header" + suffix).c_str(), BM_validate_header, file);
+			benchmark::RegisterBenchmark(("subresource_layout" + suffix).c_str(), BM_subresource_layout, file);
+			benchmark::RegisterBenchmark(("convert_ktx2" + suffix).c_str(), BM_convert_ktx2, file, ktxpp::SupercompressionNone);
+
+			if (ktxpp::is_supercompression_supported(ktxpp::SupercompressionZstd))
+			{
+				benchmark::RegisterBenchmark(("convert_ktx2_zstd" + suffix).c_str(), BM_convert_ktx2, file, ktxpp::SupercompressionZstd);
+			}
+		}
+
+		// RGBA8 stops at 8K to keep the working set within a few hundred megabytes
+		benchmark::RegisterBenchmark("build_texture/RGBA8", BM_build_texture, ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("build_texture/BC1", BM_build_texture, ktxpp::GL_COMPRESSED_RGB_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0)->RangeMultiplier(4)->Range(4, 16384);
+		benchmark::RegisterBenchmark("convert_synthetic/RGBA8", BM_convert_synthetic, ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("convert_synthetic/BC1", BM_convert_synthetic, ktxpp::GL_COMPRESSED_RGB_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0)->RangeMultiplier(4)->Range(4, 16384);
+
+		benchmark::RegisterBenchmark("swizzle_morton/RGBA8", BM_swizzle<4, true, true>)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("deswizzle_morton/RGBA8", BM_swizzle<4, true, false>)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("swizzle_morton/BC1", BM_swizzle<8, true, true>)->RangeMultiplier(4)->Range(16, 16384);
+		benchmark::RegisterBenchmark("deswizzle_morton/BC1", BM_swizzle<8, true, false>)->RangeMultiplier(4)->Range(16, 16384);
+		benchmark::RegisterBenchmark("swizzle_tiled/RGBA8", BM_swizzle<4, false, true>)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("deswizzle_tiled/RGBA8", BM_swizzle<4, false, false>)->RangeMultiplier(4)->Range(4, 8192);
+		benchmark::RegisterBenchmark("swizzle_tiled/BC1", BM_swizzle<8, false, true>)->RangeMultiplier(4)->Range(16, 16384);
+		benchmark::RegisterBenchmark("deswizzle_tiled/BC1", BM_swizzle<8, false, false>)->RangeMultiplier(4)->Range(16, 16384);
+
+		const ktxpp::SimdLevel levels[] = { ktxpp::SimdScalar, ktxpp::SimdSSE2, ktxpp::SimdAVX2, ktxpp::SimdAVX512, ktxpp::SimdNEON };
+		const char* kernelNames[] = { "byteswap16", "byteswap32", "swap_red_blue", "yuv422_to_rgba8", "rgbg_to_rgba8", "grgb_to_rgba8", "bw1bpp_to_rgba8", "squared_error8", "srgb8_to_linear", "linear_to_srgb8", "channel_stats8", "ssim_sums8" };
+
+		for (ktxpp::SimdLevel level : levels)
+		{
+			for (int kernel = 0; kernel < 12; ++kernel)
+			{
+				if (ktxpp::is_simd_level_supported(level))
+				{
+					benchmark::RegisterBenchmark((std::string(kernelNames[kernel]) + "/" + ktxpp::get_simd_level_name(level)).c_str(), BM_kernel, level, kernel);
+				}
+			}
+		}
+
+		benchmark::RegisterBenchmark("compare_images", BM_compare_images, true)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+		benchmark::RegisterBenchmark("compare_images_no_ssim", BM_compare_images, false)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+		benchmark::RegisterBenchmark("fill_staging_buffer", BM_fill_staging_buffer)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+		benchmark::RegisterBenchmark("plan_residency", BM_plan_residency)->RangeMultiplier(8)->Range(64, 32768);
+		benchmark::RegisterBenchmark("hash", BM_hash)->RangeMultiplier(16)->Range(16, 1 << 20);
+		benchmark::RegisterBenchmark("pack_find", BM_pack_find)->RangeMultiplier(8)->Range(8, 32768);
+
+		const ktxpp::SupercompressionScheme schemes[] = { ktxpp::SupercompressionZstd, ktxpp::SupercompressionZLIB, ktxpp::SupercompressionLZ4 };
+		const char* schemeNames[] = { "zstd", "zlib", "lz4" };
+
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			if (ktxpp::is_supercompression_supported(schemes[i]))
+			{
+				benchmark::RegisterBenchmark((std::string("supercompress/") + schemeNames[i]).c_str(), BM_supercompress, schemes[i], false)->RangeMultiplier(4)->Range(64, 4096);
+				benchmark::RegisterBenchmark((std::string("decompress/") + schemeNames[i]).c_str(), BM_supercompress, schemes[i], true)->RangeMultiplier(4)->Range(64, 4096);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+
+	register_benchmarks();
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <assert.h>
 
 #if (__cpp_constexpr == 201304) || (_MSC_VER > 1900)
@@ -9,6 +13,208 @@
 #define ktxpp_constexpr const
 #endif
 
+// BMI2 provides single instruction bit deposit/extract (pdep/pext) used by the Morton swizzle
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define ktxpp_bmi2
+#include <immintrin.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+
+// Define ktxpp_instrument to time the stages below and count the work they do. Without it the macros expand to
+// nothing, and the counters and trace hooks stay at zero
+#if defined(ktxpp_instrument)
+#define ktxpp_stage(stage, name) ktxpp::internal::StageScope ktxpp_stage_scope(ktxpp::stage, name)
+#define ktxpp_stage_work(bytes, texels) ktxpp_stage_scope.add((uint64_t)(bytes), (uint64_t)(texels))
+#define ktxpp_count_cache(hit) ktxpp::internal::count_cache(hit)
+#else
+#define ktxpp_stage(stage, name)
+#define ktxpp_stage_work(bytes, texels)
+#define ktxpp_count_cache(hit)
+#endif
+
+namespace ktxpp
+{
+	enum Stage
+	{
+		StageIO,      // File reads, from being queued to landing in memory
+		StageParse,   // Headers, key/value data and pack directories
+		StageLayout,  // Subresource tables
+		StageDecode,  // Decompression and unpacking to RGBA8
+		StageConvert, // KTX to KTX2 conversion, including supercompression
+		StageCount,
+	};
+
+	struct StageCounters
+	{
+		uint64_t calls;
+		uint64_t nanoseconds; // A stage nested in another stage is counted in both, one nested in the same stage only once
+		uint64_t bytes;
+		uint64_t texels;
+	};
+
+	struct InstrumentCounters
+	{
+		StageCounters stages[StageCount];
+		uint64_t cacheHits;
+		uint64_t cacheMisses;
+	};
+
+	struct StageEvent
+	{
+		Stage stage;
+		const char* name; // Of the function, a string literal
+		uint64_t start; // get_instrument_time when the stage began
+		uint64_t nanoseconds;
+		uint64_t bytes;
+		uint64_t texels;
+	};
+
+	// Called at the end of every stage on the thread that ran it, except for StageIO which reports on the thread that
+	// saw the read complete. Runs concurrently from as many threads as use ktxpp
+	struct TraceHooks
+	{
+		void* userData;
+		void (*stage)(void* userData, const StageEvent& event);
+	};
+
+	namespace internal
+	{
+		struct InstrumentState
+		{
+			std::atomic<uint64_t> stages[StageCount][4];
+			std::atomic<uint64_t> cacheHits;
+			std::atomic<uint64_t> cacheMisses;
+			std::atomic<const TraceHooks*> hooks;
+		};
+
+		// Zero initialized before any dynamic initialization runs
+		inline InstrumentState& get_instrument_state()
+		{
+			static InstrumentState state;
+			return state;
+		}
+	}
+
+	// Steady clock in nanoseconds, the time base of StageEvent
+	inline uint64_t get_instrument_time()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// hooks must stay alive until replaced. nullptr removes them
+	inline void set_trace_hooks(const TraceHooks* hooks)
+	{
+		internal::get_instrument_state().hooks.store(hooks, std::memory_order_release);
+	}
+
+	inline InstrumentCounters get_instrument_counters()
+	{
+		internal::InstrumentState& state = internal::get_instrument_state();
+		InstrumentCounters counters;
+
+		for (uint32_t stage = 0; stage < StageCount; ++stage)
+		{
+			counters.stages[stage].calls       = state.stages[stage][0].load(std::memory_order_relaxed);
+			counters.stages[stage].nanoseconds = state.stages[stage][1].load(std::memory_order_relaxed);
+			counters.stages[stage].bytes       = state.stages[stage][2].load(std::memory_order_relaxed);
+			counters.stages[stage].texels      = state.stages[stage][3].load(std::memory_order_relaxed);
+		}
+
+		counters.cacheHits   = state.cacheHits.load(std::memory_order_relaxed);
+		counters.cacheMisses = state.cacheMisses.load(std::memory_order_relaxed);
+		return counters;
+	}
+
+	inline void reset_instrument_counters()
+	{
+		internal::InstrumentState& state = internal::get_instrument_state();
+
+		for (uint32_t stage = 0; stage < StageCount; ++stage)
+		{
+			for (uint32_t counter = 0; counter < 4; ++counter)
+			{
+				state.stages[stage][counter].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		state.cacheHits.store(0, std::memory_order_relaxed);
+		state.cacheMisses.store(0, std::memory_order_relaxed);
+	}
+
+	namespace internal
+	{
+		inline void record_stage(Stage stage, const char* name, uint64_t start, uint64_t bytes, uint64_t texels)
+		{
+			InstrumentState& state = get_instrument_state();
+			uint64_t nanoseconds = get_instrument_time() - start;
+
+			state.stages[stage][0].fetch_add(1, std::memory_order_relaxed);
+			state.stages[stage][1].fetch_add(nanoseconds, std::memory_order_relaxed);
+			state.stages[stage][2].fetch_add(bytes, std::memory_order_relaxed);
+			state.stages[stage][3].fetch_add(texels, std::memory_order_relaxed);
+
+			if (const TraceHooks* hooks = state.hooks.load(std::memory_order_acquire))
+			{
+				StageEvent event = { stage, name, start, nanoseconds, bytes, texels };
+				hooks->stage(hooks->userData, event);
+			}
+		}
+
+		inline void count_cache(bool hit)
+		{
+			(hit ? get_instrument_state().cacheHits : get_instrument_state().cacheMisses).fetch_add(1, std::memory_order_relaxed);
+		}
+
+		struct StageScope;
+
+		// The outermost scope of each stage open on this thread
+		inline StageScope*& get_outer_stage_scope(Stage stage)
+		{
+			static thread_local StageScope* scopes[StageCount];
+			return scopes[stage];
+		}
+
+		// Times the enclosing scope, see ktxpp_stage. A scope inside another of the same stage, e.g. a conversion
+		// supercompressing, adds its work to the outer one and isn't recorded itself, so nothing is counted twice
+		struct StageScope
+		{
+			Stage stage;
+			const char* name;
+			uint64_t start;
+			uint64_t bytes;
+			uint64_t texels;
+			StageScope* outer;
+
+			StageScope(Stage stage_, const char* name_) : stage(stage_), name(name_), start(0), bytes(0), texels(0), outer(get_outer_stage_scope(stage_))
+			{
+				if (!outer)
+				{
+					get_outer_stage_scope(stage) = this;
+					start = get_instrument_time();
+				}
+			}
+
+			~StageScope()
+			{
+				if (!outer)
+				{
+					get_outer_stage_scope(stage) = nullptr;
+					record_stage(stage, name, start, bytes, texels);
+				}
+			}
+
+			void add(uint64_t moreBytes, uint64_t moreTexels)
+			{
+				StageScope& scope = outer ? *outer : *this;
+				scope.bytes += moreBytes;
+				scope.texels += moreTexels;
+			}
+		};
+	}
+}
+
 namespace ktxpp
 {
 	namespace internal
@@ -124,6 +330,9 @@ namespace ktxpp
 		GL_RGB10_A2UI                                  = 0x906F,
 		GL_R11F_G11F_B10F                              = 0x8C3A,
 		GL_RGB9_E5                                     = 0x8C3D,
+
+		// Packed 4:2:2 YCbCr, two pixels in each 32-bit block. glType gives the byte order
+		GL_RGB_RAW_422_APPLE                           = 0x8A51,
 		
 		// S3TX/DXT/BC
 		GL_COMPRESSED_RGB_S3TC_DXT1                    = 0x83F0,
@@ -207,6 +416,12 @@ namespace ktxpp
 		GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10          = 0x93DC,
 		GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12          = 0x93DD,
 
+		// Legacy formats GL has no enum for. ktxpp numbers them from a range GL doesn't use, and like KTX 1.1 block
+		// formats they are stored with glFormat and glType zero
+		GL_RGBG8888_KTXPP                              = 0xFF01, // R G0 B G1, two pixels sharing red and blue
+		GL_GRGB8888_KTXPP                              = 0xFF02, // G0 R G1 B
+		GL_BW1BPP_KTXPP                                = 0xFF03, // Black and white, 1 bit per pixel, first pixel in the top bit
+
 		FORCE_UINT                                     = 0xffffffff
 	};
 
@@ -240,7 +455,9 @@ namespace ktxpp
 		GL_UNSIGNED_INT_10F_11F_11F_REV   = 0x8C3B,
 		GL_UNSIGNED_INT_5_9_9_9_REV       = 0x8C3E,
 		GL_UNSIGNED_INT_24_8              = 0x84FA,
-		GL_FLOAT_32_UNSIGNED_INT_24_8_REV = 0x8DAD
+		GL_FLOAT_32_UNSIGNED_INT_24_8_REV = 0x8DAD,
+		GL_UNSIGNED_SHORT_8_8_APPLE       = 0x85BA, // 4:2:2 as Y0 Cb Y1 Cr in memory (YUY2)
+		GL_UNSIGNED_SHORT_8_8_REV_APPLE   = 0x85BB  // 4:2:2 as Cb Y0 Cr Y1 in memory (UYVY)
 	};
 
 	// Table 8.3 of spec
@@ -274,7 +491,8 @@ namespace ktxpp
 		GL_COLOR_INDEX             = 0x1900,
 		GL_STENCIL_INDEX           = 0x1901,
 		GL_DEPTH_COMPONENT         = 0x1902,
-		GL_DEPTH_STENCIL           = 0x84F9
+		GL_DEPTH_STENCIL           = 0x84F9,
+		GL_RGB_422_APPLE           = 0x8A1F
 	};
 
 	enum VkFormat
@@ -547,11 +765,12 @@ namespace ktxpp
 		uint32_t arraySize;
 		uint32_t rowPitch; // Row pitch for mip 0
 		uint32_t depthPitch; // Size of mip 0
-		uint32_t bitsPerPixelOrBlock; // If compressed bits per block, else bits per pixel
+		uint32_t bitsPerPixelOrBlock; // Bits per block. Uncompressed blocks are one pixel, except 4:2:2 which pairs two
 		uint32_t blockWidth;
 		uint32_t blockHeight;
 		bool compressed;
 		bool srgb;
+		bool array; // The file gave an array size. Only cubemaps that aren't arrays pad their faces
 	};
 
 	inline ktxpp_constexpr bool is_compressed(GLInternalFormat format)
@@ -567,6 +786,17 @@ namespace ktxpp
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5:
+			case GL_COMPRESSED_LUMINANCE_LATC1:
+			case GL_COMPRESSED_LUMINANCE_ALPHA_LATC2:
+			case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1:
+			case GL_COMPRESSED_SIGNED_LUMINANCE_ALPHA_LATC2:
+			case GL_COMPRESSED_RED_RGTC1:
+			case GL_COMPRESSED_RG_RGTC2:
+			case GL_COMPRESSED_SIGNED_RED_RGTC1:
+			case GL_COMPRESSED_SIGNED_RG_RGTC2:
+			case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+			case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+			case GL_COMPRESSED_RGBA_BPTC_UNORM:
 			case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 
 			// ETC
@@ -626,6 +856,11 @@ namespace ktxpp
 			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10:
 			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10:
 			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12:
+
+			// Legacy
+			case GL_RGBG8888_KTXPP:
+			case GL_GRGB8888_KTXPP:
+			case GL_BW1BPP_KTXPP:
 				return true;
 			default:
 				return false;
@@ -636,11 +871,18 @@ namespace ktxpp
 	{
 		switch (format)
 		{
+			// 8 bits per component
+			case GL_SR8:
+			case GL_SRG8:
+			case GL_SRGB8:
+			case GL_SRGB8_ALPHA8:
+
 			// BCn
 			case GL_COMPRESSED_SRGB_S3TC_DXT1:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5:
+			case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 
 			// ETC
 			case GL_COMPRESSED_SRGB8_ETC2:
@@ -806,6 +1048,10 @@ namespace ktxpp
 			case GL_R11F_G11F_B10F: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
 			case GL_RGB9_E5:        return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
 
+			// 4:2:2
+			case GL_RGB_RAW_422_APPLE:
+				return glType == GL_UNSIGNED_SHORT_8_8_REV_APPLE ? VK_FORMAT_B8G8R8G8_422_UNORM : VK_FORMAT_G8B8G8R8_422_UNORM;
+
 			// S3TX/DXT/BC
 			case GL_COMPRESSED_RGB_S3TC_DXT1:           return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
 			case GL_COMPRESSED_RGBA_S3TC_DXT1:          return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
@@ -905,6 +1151,163 @@ namespace ktxpp
 		return VK_FORMAT_UNDEFINED;
 	}
 
+	// Inverse of get_vkformat_from_glformat. glFormat and glType are zero for compressed formats, as in KTX 1.1
+	inline GLInternalFormat get_glformat_from_vkformat(VkFormat vkFormat, GLFormat& glFormat, GLType& glType)
+	{
+		glFormat = (GLFormat)0;
+		glType   = (GLType)0;
+
+		switch (vkFormat)
+		{
+			// 8 bits per component
+			case VK_FORMAT_R8_UNORM:                 glFormat = GL_RED; glType = GL_UNSIGNED_BYTE; return GL_R8;
+			case VK_FORMAT_R8_SNORM:                 glFormat = GL_RED; glType = GL_BYTE; return GL_R8_SNORM;
+			case VK_FORMAT_R8_UINT:                  glFormat = GL_RED_INTEGER; glType = GL_UNSIGNED_BYTE; return GL_R8UI;
+			case VK_FORMAT_R8_SINT:                  glFormat = GL_RED_INTEGER; glType = GL_BYTE; return GL_R8I;
+			case VK_FORMAT_R8_SRGB:                  glFormat = GL_RED; glType = GL_UNSIGNED_BYTE; return GL_SR8;
+			case VK_FORMAT_R8G8_UNORM:               glFormat = GL_RG; glType = GL_UNSIGNED_BYTE; return GL_RG8;
+			case VK_FORMAT_R8G8_SNORM:               glFormat = GL_RG; glType = GL_BYTE; return GL_RG8_SNORM;
+			case VK_FORMAT_R8G8_UINT:                glFormat = GL_RG_INTEGER; glType = GL_UNSIGNED_BYTE; return GL_RG8UI;
+			case VK_FORMAT_R8G8_SINT:                glFormat = GL_RG_INTEGER; glType = GL_BYTE; return GL_RG8I;
+			case VK_FORMAT_R8G8_SRGB:                glFormat = GL_RG; glType = GL_UNSIGNED_BYTE; return GL_SRG8;
+			case VK_FORMAT_R8G8B8_UNORM:             glFormat = GL_RGB; glType = GL_UNSIGNED_BYTE; return GL_RGB8;
+			case VK_FORMAT_R8G8B8_SNORM:             glFormat = GL_RGB; glType = GL_BYTE; return GL_RGB8_SNORM;
+			case VK_FORMAT_R8G8B8_UINT:              glFormat = GL_RGB_INTEGER; glType = GL_UNSIGNED_BYTE; return GL_RGB8UI;
+			case VK_FORMAT_R8G8B8_SINT:              glFormat = GL_RGB_INTEGER; glType = GL_BYTE; return GL_RGB8I;
+			case VK_FORMAT_R8G8B8_SRGB:              glFormat = GL_RGB; glType = GL_UNSIGNED_BYTE; return GL_SRGB8;
+			case VK_FORMAT_R8G8B8A8_UNORM:           glFormat = GL_RGBA; glType = GL_UNSIGNED_BYTE; return GL_RGBA8;
+			case VK_FORMAT_R8G8B8A8_SNORM:           glFormat = GL_RGBA; glType = GL_BYTE; return GL_RGBA8_SNORM;
+			case VK_FORMAT_R8G8B8A8_UINT:            glFormat = GL_RGBA_INTEGER; glType = GL_UNSIGNED_BYTE; return GL_RGBA8UI;
+			case VK_FORMAT_R8G8B8A8_SINT:            glFormat = GL_RGBA_INTEGER; glType = GL_BYTE; return GL_RGBA8I;
+			case VK_FORMAT_R8G8B8A8_SRGB:            glFormat = GL_RGBA; glType = GL_UNSIGNED_BYTE; return GL_SRGB8_ALPHA8;
+			case VK_FORMAT_B8G8R8_UNORM:             glFormat = GL_BGR; glType = GL_UNSIGNED_BYTE; return GL_RGB8;
+			case VK_FORMAT_B8G8R8_SRGB:              glFormat = GL_BGR; glType = GL_UNSIGNED_BYTE; return GL_SRGB8;
+			case VK_FORMAT_B8G8R8A8_UNORM:           glFormat = GL_BGRA; glType = GL_UNSIGNED_BYTE; return GL_RGBA8;
+			case VK_FORMAT_B8G8R8A8_SRGB:            glFormat = GL_BGRA; glType = GL_UNSIGNED_BYTE; return GL_SRGB8_ALPHA8;
+
+			// 16 bits per component
+			case VK_FORMAT_R16_UNORM:                glFormat = GL_RED; glType = GL_UNSIGNED_SHORT; return GL_R16;
+			case VK_FORMAT_R16_SNORM:                glFormat = GL_RED; glType = GL_SHORT; return GL_R16_SNORM;
+			case VK_FORMAT_R16_UINT:                 glFormat = GL_RED_INTEGER; glType = GL_UNSIGNED_SHORT; return GL_R16UI;
+			case VK_FORMAT_R16_SINT:                 glFormat = GL_RED_INTEGER; glType = GL_SHORT; return GL_R16I;
+			case VK_FORMAT_R16_SFLOAT:               glFormat = GL_RED; glType = GL_HALF_FLOAT; return GL_R16F;
+			case VK_FORMAT_R16G16_UNORM:             glFormat = GL_RG; glType = GL_UNSIGNED_SHORT; return GL_RG16;
+			case VK_FORMAT_R16G16_SNORM:             glFormat = GL_RG; glType = GL_SHORT; return GL_RG16_SNORM;
+			case VK_FORMAT_R16G16_UINT:              glFormat = GL_RG_INTEGER; glType = GL_UNSIGNED_SHORT; return GL_RG16UI;
+			case VK_FORMAT_R16G16_SINT:              glFormat = GL_RG_INTEGER; glType = GL_SHORT; return GL_RG16I;
+			case VK_FORMAT_R16G16_SFLOAT:            glFormat = GL_RG; glType = GL_HALF_FLOAT; return GL_RG16F;
+			case VK_FORMAT_R16G16B16_UNORM:          glFormat = GL_RGB; glType = GL_UNSIGNED_SHORT; return GL_RGB16;
+			case VK_FORMAT_R16G16B16_SNORM:          glFormat = GL_RGB; glType = GL_SHORT; return GL_RGB16_SNORM;
+			case VK_FORMAT_R16G16B16_UINT:           glFormat = GL_RGB_INTEGER; glType = GL_UNSIGNED_SHORT; return GL_RGB16UI;
+			case VK_FORMAT_R16G16B16_SINT:           glFormat = GL_RGB_INTEGER; glType = GL_SHORT; return GL_RGB16I;
+			case VK_FORMAT_R16G16B16_SFLOAT:         glFormat = GL_RGB; glType = GL_HALF_FLOAT; return GL_RGB16F;
+			case VK_FORMAT_R16G16B16A16_UNORM:       glFormat = GL_RGBA; glType = GL_UNSIGNED_SHORT; return GL_RGBA16;
+			case VK_FORMAT_R16G16B16A16_SNORM:       glFormat = GL_RGBA; glType = GL_SHORT; return GL_RGBA16_SNORM;
+			case VK_FORMAT_R16G16B16A16_UINT:        glFormat = GL_RGBA_INTEGER; glType = GL_UNSIGNED_SHORT; return GL_RGBA16UI;
+			case VK_FORMAT_R16G16B16A16_SINT:        glFormat = GL_RGBA_INTEGER; glType = GL_SHORT; return GL_RGBA16I;
+			case VK_FORMAT_R16G16B16A16_SFLOAT:      glFormat = GL_RGBA; glType = GL_HALF_FLOAT; return GL_RGBA16F;
+
+			// 32 bits per component
+			case VK_FORMAT_R32_UINT:                 glFormat = GL_RED_INTEGER; glType = GL_UNSIGNED_INT; return GL_R32UI;
+			case VK_FORMAT_R32_SINT:                 glFormat = GL_RED_INTEGER; glType = GL_INT; return GL_R32I;
+			case VK_FORMAT_R32_SFLOAT:               glFormat = GL_RED; glType = GL_FLOAT; return GL_R32F;
+			case VK_FORMAT_R32G32_UINT:              glFormat = GL_RG_INTEGER; glType = GL_UNSIGNED_INT; return GL_RG32UI;
+			case VK_FORMAT_R32G32_SINT:              glFormat = GL_RG_INTEGER; glType = GL_INT; return GL_RG32I;
+			case VK_FORMAT_R32G32_SFLOAT:            glFormat = GL_RG; glType = GL_FLOAT; return GL_RG32F;
+			case VK_FORMAT_R32G32B32_UINT:           glFormat = GL_RGB_INTEGER; glType = GL_UNSIGNED_INT; return GL_RGB32UI;
+			case VK_FORMAT_R32G32B32_SINT:           glFormat = GL_RGB_INTEGER; glType = GL_INT; return GL_RGB32I;
+			case VK_FORMAT_R32G32B32_SFLOAT:         glFormat = GL_RGB; glType = GL_FLOAT; return GL_RGB32F;
+			case VK_FORMAT_R32G32B32A32_UINT:        glFormat = GL_RGBA_INTEGER; glType = GL_UNSIGNED_INT; return GL_RGBA32UI;
+			case VK_FORMAT_R32G32B32A32_SINT:        glFormat = GL_RGBA_INTEGER; glType = GL_INT; return GL_RGBA32I;
+			case VK_FORMAT_R32G32B32A32_SFLOAT:      glFormat = GL_RGBA; glType = GL_FLOAT; return GL_RGBA32F;
+
+			// Packed
+			case VK_FORMAT_R5G6B5_UNORM_PACK16:      glFormat = GL_RGB; glType = GL_UNSIGNED_SHORT_5_6_5; return GL_RGB565;
+			case VK_FORMAT_R4G4B4A4_UNORM_PACK16:    glFormat = GL_RGBA; glType = GL_UNSIGNED_SHORT_4_4_4_4; return GL_RGBA4;
+			case VK_FORMAT_R5G5B5A1_UNORM_PACK16:    glFormat = GL_RGBA; glType = GL_UNSIGNED_SHORT_5_5_5_1; return GL_RGB5_A1;
+			case VK_FORMAT_A2B10G10R10_UNORM_PACK32: glFormat = GL_RGBA; glType = GL_UNSIGNED_INT_2_10_10_10_REV; return GL_RGB10_A2;
+			case VK_FORMAT_A2R10G10B10_UINT_PACK32:  glFormat = GL_RGBA_INTEGER; glType = GL_UNSIGNED_INT_2_10_10_10_REV; return GL_RGB10_A2UI;
+			case VK_FORMAT_B10G11R11_UFLOAT_PACK32:  glFormat = GL_RGB; glType = GL_UNSIGNED_INT_10F_11F_11F_REV; return GL_R11F_G11F_B10F;
+			case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:   glFormat = GL_RGB; glType = GL_UNSIGNED_INT_5_9_9_9_REV; return GL_RGB9_E5;
+
+			// 4:2:2
+			case VK_FORMAT_G8B8G8R8_422_UNORM:       glFormat = GL_RGB_422_APPLE; glType = GL_UNSIGNED_SHORT_8_8_APPLE; return GL_RGB_RAW_422_APPLE;
+			case VK_FORMAT_B8G8R8G8_422_UNORM:       glFormat = GL_RGB_422_APPLE; glType = GL_UNSIGNED_SHORT_8_8_REV_APPLE; return GL_RGB_RAW_422_APPLE;
+
+			// S3TX/DXT/BC
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:         return GL_COMPRESSED_RGB_S3TC_DXT1;
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_S3TC_DXT1;
+			case VK_FORMAT_BC2_UNORM_BLOCK:             return GL_COMPRESSED_RGBA_S3TC_DXT3;
+			case VK_FORMAT_BC3_UNORM_BLOCK:             return GL_COMPRESSED_RGBA_S3TC_DXT5;
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:          return GL_COMPRESSED_SRGB_S3TC_DXT1;
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:         return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1;
+			case VK_FORMAT_BC2_SRGB_BLOCK:              return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3;
+			case VK_FORMAT_BC3_SRGB_BLOCK:              return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5;
+			case VK_FORMAT_BC4_UNORM_BLOCK:             return GL_COMPRESSED_RED_RGTC1;
+			case VK_FORMAT_BC5_UNORM_BLOCK:             return GL_COMPRESSED_RG_RGTC2;
+			case VK_FORMAT_BC4_SNORM_BLOCK:             return GL_COMPRESSED_SIGNED_RED_RGTC1;
+			case VK_FORMAT_BC5_SNORM_BLOCK:             return GL_COMPRESSED_SIGNED_RG_RGTC2;
+			case VK_FORMAT_BC6H_SFLOAT_BLOCK:           return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+			case VK_FORMAT_BC6H_UFLOAT_BLOCK:           return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+			case VK_FORMAT_BC7_UNORM_BLOCK:             return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			case VK_FORMAT_BC7_SRGB_BLOCK:              return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+
+			// ETC
+			case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:     return GL_COMPRESSED_RGB8_ETC2;
+			case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:   return GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+			case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:   return GL_COMPRESSED_RGBA8_ETC2_EAC;
+			case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:      return GL_COMPRESSED_SRGB8_ETC2;
+			case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:    return GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+			case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:    return GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+			case VK_FORMAT_EAC_R11_UNORM_BLOCK:         return GL_COMPRESSED_R11_EAC;
+			case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:      return GL_COMPRESSED_RG11_EAC;
+			case VK_FORMAT_EAC_R11_SNORM_BLOCK:         return GL_COMPRESSED_SIGNED_R11_EAC;
+			case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:      return GL_COMPRESSED_SIGNED_RG11_EAC;
+
+			// PVRTC
+			case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG: return GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG;
+			case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG: return GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG;
+			case VK_FORMAT_PVRTC2_2BPP_UNORM_BLOCK_IMG: return GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG;
+			case VK_FORMAT_PVRTC2_4BPP_UNORM_BLOCK_IMG: return GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG;
+			case VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG:  return GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV1;
+			case VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG:  return GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV1;
+			case VK_FORMAT_PVRTC2_2BPP_SRGB_BLOCK_IMG:  return GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV2_IMG;
+			case VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG:  return GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV2_IMG;
+
+			// ASTC
+			case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_4x4;
+			case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_5x4;
+			case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_5x5;
+			case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_6x5;
+			case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_6x6;
+			case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_8x5;
+			case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_8x6;
+			case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:        return GL_COMPRESSED_RGBA_ASTC_8x8;
+			case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:       return GL_COMPRESSED_RGBA_ASTC_10x5;
+			case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:       return GL_COMPRESSED_RGBA_ASTC_10x6;
+			case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:       return GL_COMPRESSED_RGBA_ASTC_10x8;
+			case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:      return GL_COMPRESSED_RGBA_ASTC_10x10;
+			case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:      return GL_COMPRESSED_RGBA_ASTC_12x10;
+			case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:      return GL_COMPRESSED_RGBA_ASTC_12x12;
+
+			case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4;
+			case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x4;
+			case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5;
+			case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x5;
+			case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6;
+			case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x5;
+			case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x6;
+			case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:         return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8;
+			case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:        return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5;
+			case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:        return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x6;
+			case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:        return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x8;
+			case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:       return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10;
+			case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:       return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10;
+			case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:       return GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12;
+			default: return UNKNOWN;
+		}
+	}
+
 	using namespace internal;
 
 	inline ktxpp_constexpr uint32_t get_bits_per_pixel_or_block(GLInternalFormat format)
@@ -917,6 +1320,7 @@ namespace ktxpp
 			case GL_R8I:
 			case GL_SR8:
 			case GL_R3_G3_B2:
+			case GL_BW1BPP_KTXPP: // Per 8x1 block
 				return 8;
 			case GL_RG8:
 			case GL_RG8_SNORM:
@@ -952,6 +1356,9 @@ namespace ktxpp
 			case GL_RGB10_A2UI:
 			case GL_R11F_G11F_B10F:
 			case GL_RGB9_E5:
+			case GL_RGB_RAW_422_APPLE: // Per 2x1 block
+			case GL_RGBG8888_KTXPP:
+			case GL_GRGB8888_KTXPP:
 				return 32;
 			case GL_RGB16:
 			case GL_RGB16_SNORM:
@@ -969,6 +1376,8 @@ namespace ktxpp
 			case GL_RG32F:
 			case GL_COMPRESSED_RGB_S3TC_DXT1:
 			case GL_COMPRESSED_RGBA_S3TC_DXT1:
+			case GL_COMPRESSED_SRGB_S3TC_DXT1:
+			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1:
 			case GL_ETC1_RGB8_OES:
 			case GL_COMPRESSED_R11_EAC:
 			case GL_COMPRESSED_SIGNED_R11_EAC:
@@ -988,6 +1397,10 @@ namespace ktxpp
 			case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV1:
 			case GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV2_IMG:
 			case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV2_IMG:
+			case GL_COMPRESSED_LUMINANCE_LATC1:
+			case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1:
+			case GL_COMPRESSED_RED_RGTC1:
+			case GL_COMPRESSED_SIGNED_RED_RGTC1:
 				return 64;
 			case GL_RGB32UI:
 			case GL_RGB32I:
@@ -998,8 +1411,6 @@ namespace ktxpp
 			case GL_RGBA32F:
 			case GL_COMPRESSED_RGBA_S3TC_DXT3:
 			case GL_COMPRESSED_RGBA_S3TC_DXT5:
-			case GL_COMPRESSED_SRGB_S3TC_DXT1:
-			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3:
 			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5:
 			case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
@@ -1007,6 +1418,42 @@ namespace ktxpp
 			case GL_COMPRESSED_SIGNED_RG11_EAC:
 			case GL_COMPRESSED_RGBA8_ETC2_EAC:
 			case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+			case GL_COMPRESSED_LUMINANCE_ALPHA_LATC2:
+			case GL_COMPRESSED_SIGNED_LUMINANCE_ALPHA_LATC2:
+			case GL_COMPRESSED_RG_RGTC2:
+			case GL_COMPRESSED_SIGNED_RG_RGTC2:
+			case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+			case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+			case GL_COMPRESSED_RGBA_BPTC_UNORM:
+				return 128;
+			case GL_COMPRESSED_RGBA_ASTC_4x4:
+			case GL_COMPRESSED_RGBA_ASTC_5x4:
+			case GL_COMPRESSED_RGBA_ASTC_5x5:
+			case GL_COMPRESSED_RGBA_ASTC_6x5:
+			case GL_COMPRESSED_RGBA_ASTC_6x6:
+			case GL_COMPRESSED_RGBA_ASTC_8x5:
+			case GL_COMPRESSED_RGBA_ASTC_8x6:
+			case GL_COMPRESSED_RGBA_ASTC_8x8:
+			case GL_COMPRESSED_RGBA_ASTC_10x5:
+			case GL_COMPRESSED_RGBA_ASTC_10x6:
+			case GL_COMPRESSED_RGBA_ASTC_10x8:
+			case GL_COMPRESSED_RGBA_ASTC_10x10:
+			case GL_COMPRESSED_RGBA_ASTC_12x10:
+			case GL_COMPRESSED_RGBA_ASTC_12x12:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x4:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x5:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x5:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x6:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x6:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x8:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12:
 				return 128;
 			default:
 				return 32; // Most formats are 32 bits per pixel
@@ -1129,6 +1576,14 @@ namespace ktxpp
 			case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12:
 				blockWidth = 12; blockHeight = 12;
 				break;
+			case GL_RGB_RAW_422_APPLE:
+			case GL_RGBG8888_KTXPP:
+			case GL_GRGB8888_KTXPP:
+				blockWidth = 2; blockHeight = 1;
+				break;
+			case GL_BW1BPP_KTXPP:
+				blockWidth = 8; blockHeight = 1;
+				break;
 			default:
 				blockWidth = 1; blockHeight = 1;
 				break;
@@ -1137,28 +1592,9 @@ namespace ktxpp
 		return;
 	}
 
-	inline unsigned char* decode_header(unsigned char* sourceData, Descriptor& desc)
+	// Fills in the descriptor from an already validated header
+	inline void decode_header(const HeaderKTX& header, Descriptor& desc)
 	{
-		const HeaderKTX& header = *reinterpret_cast<const HeaderKTX*>(sourceData); // First 12 bytes are the magic KTX sequence
-
-		bool isKTXFile = (header.identifier[0] == '') &&
-		                 (header.identifier[1] == 'K') &&
-		                 (header.identifier[2] == 'T') &&
-		                 (header.identifier[3] == 'X') &&
-		                 (header.identifier[4] == ' ') &&
-		                 (header.identifier[5] == '1') &&
-		                 (header.identifier[6] == '1') &&
-		                 (header.identifier[7] == '') &&
-		                 (header.identifier[8] == '\r') &&
-		                 (header.identifier[9] == '\n') &&
-		                 (header.identifier[10] == '\x1A') &&
-		                 (header.identifier[11] == '\n');
-
-		if(!isKTXFile)
-		{
-			return nullptr;
-		}
-
 		bool isHeaderLittleEndian = header.endianness == 0x04030201;
 
 		// For compressed formats, glFormat and glType must be set to zero
@@ -1170,6 +1606,7 @@ namespace ktxpp
 		desc.numMips              = header.numberOfMipmapLevels > 0 ? header.numberOfMipmapLevels : 1;
 		desc.compressed           = isCompressed;
 		desc.arraySize            = header.numberOfArrayElements > 0 ? header.numberOfArrayElements : 1;
+		desc.array                = header.numberOfArrayElements > 0;
 		
 		// If numberOfMipmapLevels equals 0, it indicates that a full mipmap pyramid should be generated from level 0 at load time
 		desc.numMips              = header.numberOfMipmapLevels;
@@ -1203,6 +1640,35 @@ namespace ktxpp
 
 		desc.rowPitch   = desc.width * desc.bitsPerPixelOrBlock / (8 * desc.blockWidth);
 		desc.depthPitch = desc.rowPitch * desc.height / desc.blockHeight;
+	}
+
+	// Trusts the header completely, use validate_header for data that comes from outside
+	inline unsigned char* decode_header(unsigned char* sourceData, Descriptor& desc)
+	{
+		ktxpp_stage(StageParse, "decode_header");
+		ktxpp_stage_work(sizeof(HeaderKTX), 0);
+
+		const HeaderKTX& header = *reinterpret_cast<const HeaderKTX*>(sourceData); // First 12 bytes are the magic KTX sequence
+
+		bool isKTXFile = (header.identifier[0] == '') &&
+		                 (header.identifier[1] == 'K') &&
+		                 (header.identifier[2] == 'T') &&
+		                 (header.identifier[3] == 'X') &&
+		                 (header.identifier[4] == ' ') &&
+		                 (header.identifier[5] == '1') &&
+		                 (header.identifier[6] == '1') &&
+		                 (header.identifier[7] == '') &&
+		                 (header.identifier[8] == '\r') &&
+		                 (header.identifier[9] == '\n') &&
+		                 (header.identifier[10] == '\x1A') &&
+		                 (header.identifier[11] == '\n');
+
+		if(!isKTXFile)
+		{
+			return nullptr;
+		}
+
+		decode_header(header, desc);
 		
 		// Depth pitch should match dataSize
 		// uint32_t dataSize = *((uint32_t*)(sourceData + sizeof(HeaderKTX) + header.bytesOfKeyValueData));
@@ -1248,6 +1714,1555 @@ namespace ktxpp
 		header.pixelDepth = depth;
 		header.numberOfMipmapLevels = mipCount;
 		header.numberOfFaces = type == Cubemap ? 6 : 1;
-		header.numberOfArrayElements = type != Cubemap ? arraySize : 0;
+		header.numberOfArrayElements = arraySize; // 0 when the texture isn't an array, which for cubemaps pads each face
+		header.bytesOfKeyValueData = 0;
+	}
+
+	// Returns the dimensions of a mip level in blocks. For most uncompressed formats a block is a single pixel
+	inline void get_mip_size_in_blocks(const Descriptor& desc, uint32_t mip, uint32_t& widthInBlocks, uint32_t& heightInBlocks)
+	{
+		uint32_t mipWidth  = (desc.width  >> mip) > 0 ? (desc.width  >> mip) : 1;
+		uint32_t mipHeight = (desc.height >> mip) > 0 ? (desc.height >> mip) : 1;
+
+		// Rounds up without overflowing for dimensions close to 2^32
+		widthInBlocks  = mipWidth  / desc.blockWidth  + (mipWidth  % desc.blockWidth  != 0);
+		heightInBlocks = mipHeight / desc.blockHeight + (mipHeight % desc.blockHeight != 0);
 	}
+
+	namespace internal
+	{
+		inline uint32_t next_power_of_two_log2(uint32_t value)
+		{
+			uint32_t log2 = 0;
+			while ((1u << log2) < value) { log2++; }
+			return log2;
+		}
+
+		// Scatters the low bits of value into the set bits of mask
+		inline uint32_t deposit_bits(uint32_t value, uint32_t mask)
+		{
+#if defined(ktxpp_bmi2)
+			return _pdep_u32(value, mask);
+#else
+			uint32_t result = 0;
+			for (uint32_t bit = 1; mask != 0; bit <<= 1)
+			{
+				uint32_t lowestMaskBit = mask & (~mask + 1);
+				if (value & bit) { result |= lowestMaskBit; }
+				mask &= mask - 1;
+			}
+			return result;
+#endif
+		}
+
+		// Gathers the bits of value selected by mask into the low bits of the result
+		inline uint32_t extract_bits(uint32_t value, uint32_t mask)
+		{
+#if defined(ktxpp_bmi2)
+			return _pext_u32(value, mask);
+#else
+			uint32_t result = 0;
+			for (uint32_t bit = 1; mask != 0; bit <<= 1)
+			{
+				uint32_t lowestMaskBit = mask & (~mask + 1);
+				if (value & lowestMaskBit) { result |= bit; }
+				mask &= mask - 1;
+			}
+			return result;
+#endif
+		}
+
+		// Computes which Morton index bits belong to x and y. Both dimensions are rounded up to a power of two.
+		// The low bits are interleaved (x in even bits, y in odd bits) and the remaining bits of the larger
+		// dimension are appended on top, which is the same twiddling used by PVRTC for rectangular textures
+		inline void get_morton_masks(uint32_t width, uint32_t height, uint32_t& xMask, uint32_t& yMask)
+		{
+			uint32_t widthLog2  = next_power_of_two_log2(width);
+			uint32_t heightLog2 = next_power_of_two_log2(height);
+			uint32_t maxLog2    = widthLog2 > heightLog2 ? widthLog2 : heightLog2;
+
+			xMask = 0;
+			yMask = 0;
+
+			uint32_t bit = 0;
+			for (uint32_t i = 0; i < maxLog2; ++i)
+			{
+				if (i < widthLog2)  { xMask |= 1u << bit; bit++; }
+				if (i < heightLog2) { yMask |= 1u << bit; bit++; }
+			}
+		}
+
+		// Copying through a compile-time size lets the compiler turn the memcpy into plain loads and stores
+		template<uint32_t BytesPerBlock>
+		inline void copy_block(unsigned char* dst, const unsigned char* src, uint32_t)
+		{
+			memcpy(dst, src, BytesPerBlock);
+		}
+
+		template<>
+		inline void copy_block<0>(unsigned char* dst, const unsigned char* src, uint32_t bytesPerBlock)
+		{
+			memcpy(dst, src, bytesPerBlock);
+		}
+
+		template<uint32_t BytesPerBlock, bool Swizzle>
+		inline void morton_copy(unsigned char* linear, uint32_t rowPitch, unsigned char* morton, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+		{
+			uint32_t xMask, yMask;
+			get_morton_masks(widthInBlocks, heightInBlocks, xMask, yMask);
+
+			for (uint32_t y = 0; y < heightInBlocks; ++y)
+			{
+				unsigned char* linearRow = linear + (uint64_t)y * rowPitch;
+				uint32_t yBits = deposit_bits(y, yMask);
+				uint32_t xBits = 0;
+
+				for (uint32_t x = 0; x < widthInBlocks; ++x)
+				{
+					unsigned char* mortonBlock = morton + (uint64_t)(xBits | yBits) * bytesPerBlock;
+					unsigned char* linearBlock = linearRow + (uint64_t)x * bytesPerBlock;
+
+					if (Swizzle)
+					{
+						copy_block<BytesPerBlock>(mortonBlock, linearBlock, bytesPerBlock);
+					}
+					else
+					{
+						copy_block<BytesPerBlock>(linearBlock, mortonBlock, bytesPerBlock);
+					}
+
+					// Masked increment: carries skip over the bits that belong to y
+					xBits = (xBits - xMask) & xMask;
+				}
+			}
+		}
+
+		template<bool Swizzle>
+		inline void morton_copy(unsigned char* linear, uint32_t rowPitch, unsigned char* morton, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+		{
+			switch (bytesPerBlock)
+			{
+				case 1:  morton_copy<1, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+				case 2:  morton_copy<2, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+				case 4:  morton_copy<4, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+				case 8:  morton_copy<8, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+				case 16: morton_copy<16, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+				default: morton_copy<0, Swizzle>(linear, rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock); break;
+			}
+		}
+
+		template<bool Swizzle>
+		inline void tiled_copy(unsigned char* linear, uint32_t rowPitch, unsigned char* tiled, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, uint32_t tileWidth, uint32_t tileHeight)
+		{
+			uint32_t tilesX = (widthInBlocks + tileWidth - 1) / tileWidth;
+			uint64_t tileSize = (uint64_t)tileWidth * tileHeight * bytesPerBlock;
+			uint32_t tileRowSize = tileWidth * bytesPerBlock;
+
+			for (uint32_t y = 0; y < heightInBlocks; ++y)
+			{
+				unsigned char* linearRow = linear + (uint64_t)y * rowPitch;
+				unsigned char* tiledRow = tiled + (uint64_t)(y / tileHeight) * tilesX * tileSize + (uint64_t)(y % tileHeight) * tileRowSize;
+
+				// Each row of a tile is contiguous in both layouts so we can copy whole tile rows at once
+				for (uint32_t tx = 0; tx < tilesX; ++tx)
+				{
+					uint32_t x = tx * tileWidth;
+					uint32_t blockCount = (widthInBlocks - x) < tileWidth ? (widthInBlocks - x) : tileWidth;
+
+					if (Swizzle)
+					{
+						memcpy(tiledRow + tx * tileSize, linearRow + (uint64_t)x * bytesPerBlock, blockCount * bytesPerBlock);
+					}
+					else
+					{
+						memcpy(linearRow + (uint64_t)x * bytesPerBlock, tiledRow + tx * tileSize, blockCount * bytesPerBlock);
+					}
+				}
+			}
+		}
+	}
+
+	// Morton (Z-order) index of a block. Use get_morton_size to know how big the swizzled image is
+	inline uint32_t morton_encode(uint32_t x, uint32_t y, uint32_t widthInBlocks, uint32_t heightInBlocks)
+	{
+		uint32_t xMask, yMask;
+		get_morton_masks(widthInBlocks, heightInBlocks, xMask, yMask);
+		return deposit_bits(x, xMask) | deposit_bits(y, yMask);
+	}
+
+	inline void morton_decode(uint32_t index, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t& x, uint32_t& y)
+	{
+		uint32_t xMask, yMask;
+		get_morton_masks(widthInBlocks, heightInBlocks, xMask, yMask);
+		x = extract_bits(index, xMask);
+		y = extract_bits(index, yMask);
+	}
+
+	// Size in bytes of a Morton ordered image. Dimensions are padded to the next power of two
+	inline uint64_t get_morton_size(uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+	{
+		return ((uint64_t)1 << next_power_of_two_log2(widthInBlocks)) * ((uint64_t)1 << next_power_of_two_log2(heightInBlocks)) * bytesPerBlock;
+	}
+
+	// Size in bytes of a tiled image. Dimensions are padded to a whole number of tiles
+	inline uint64_t get_tiled_size(uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, uint32_t tileWidth, uint32_t tileHeight)
+	{
+		uint64_t tilesX = (widthInBlocks + tileWidth - 1) / tileWidth;
+		uint64_t tilesY = (heightInBlocks + tileHeight - 1) / tileHeight;
+		return tilesX * tilesY * tileWidth * tileHeight * bytesPerBlock;
+	}
+
+	// Converts a row-linear 2D image into Morton order. Units are blocks for compressed formats and pixels otherwise,
+	// so bytesPerBlock is bitsPerPixelOrBlock / 8. Padding in the destination is left untouched
+	inline void swizzle_morton(const unsigned char* linear, uint32_t rowPitch, unsigned char* morton, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+	{
+		morton_copy<true>(const_cast<unsigned char*>(linear), rowPitch, morton, widthInBlocks, heightInBlocks, bytesPerBlock);
+	}
+
+	inline void deswizzle_morton(const unsigned char* morton, unsigned char* linear, uint32_t rowPitch, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+	{
+		morton_copy<false>(linear, rowPitch, const_cast<unsigned char*>(morton), widthInBlocks, heightInBlocks, bytesPerBlock);
+	}
+
+	// Converts a row-linear 2D image into tiles of tileWidth x tileHeight blocks. Tiles are stored in row order and
+	// blocks inside a tile are also in row order
+	inline void swizzle_tiled(const unsigned char* linear, uint32_t rowPitch, unsigned char* tiled, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, uint32_t tileWidth, uint32_t tileHeight)
+	{
+		tiled_copy<true>(const_cast<unsigned char*>(linear), rowPitch, tiled, widthInBlocks, heightInBlocks, bytesPerBlock, tileWidth, tileHeight);
+	}
+
+	inline void deswizzle_tiled(const unsigned char* tiled, unsigned char* linear, uint32_t rowPitch, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, uint32_t tileWidth, uint32_t tileHeight)
+	{
+		tiled_copy<false>(linear, rowPitch, const_cast<unsigned char*>(tiled), widthInBlocks, heightInBlocks, bytesPerBlock, tileWidth, tileHeight);
+	}
+
+	// Location of a single image (mip, array layer and face) inside a KTX file
+	struct Subresource
+	{
+		uint64_t offset; // Offset from the start of the file
+		uint64_t size; // Size of the image in bytes, excluding padding
+		uint32_t width; // In pixels
+		uint32_t height;
+		uint32_t depth;
+		uint32_t rowPitch; // Bytes between rows of pixels or blocks, including KTX row padding
+		uint32_t mip;
+		uint32_t layer;
+		uint32_t face;
+	};
+
+	inline uint32_t get_face_count(const Descriptor& desc)
+	{
+		return desc.type == Cubemap ? 6 : 1;
+	}
+
+	inline uint32_t get_mip_count(const Descriptor& desc)
+	{
+		return desc.numMips > 0 ? desc.numMips : 1;
+	}
+
+	inline uint32_t get_subresource_count(const Descriptor& desc)
+	{
+		return get_mip_count(desc) * desc.arraySize * get_face_count(desc);
+	}
+
+	// Subresources are ordered like the KTX file: mips, then array layers, then faces
+	inline uint32_t get_subresource_index(const Descriptor& desc, uint32_t mip, uint32_t layer, uint32_t face)
+	{
+		return (mip * desc.arraySize + layer) * get_face_count(desc) + face;
+	}
+
+	// Offset of the first imageSize field, i.e. the end of the key/value data
+	inline uint64_t get_image_data_offset(const HeaderKTX& header)
+	{
+		return sizeof(HeaderKTX) + header.bytesOfKeyValueData;
+	}
+
+	// Computes where every subresource lives given the offset of the first imageSize field. The subresource array
+	// needs get_subresource_count entries. Returns the total size of the file
+	inline uint64_t compute_subresource_layout(const Descriptor& desc, uint64_t imageDataOffset, Subresource* subresources)
+	{
+		ktxpp_stage(StageLayout, "compute_subresource_layout");
+
+		uint32_t numMips  = get_mip_count(desc);
+		uint32_t numFaces = get_face_count(desc);
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+
+		// Only non-array cubemaps pad each face, and imageSize then refers to a single face
+		bool isCubemapNonArray = desc.type == Cubemap && !desc.array;
+
+		uint64_t offset = imageDataOffset;
+
+		for (uint32_t mip = 0; mip < numMips; ++mip)
+		{
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+			uint32_t mipWidth  = (desc.width  >> mip) > 0 ? (desc.width  >> mip) : 1;
+			uint32_t mipHeight = (desc.height >> mip) > 0 ? (desc.height >> mip) : 1;
+			uint32_t mipDepth  = (desc.depth  >> mip) > 0 ? (desc.depth  >> mip) : 1;
+
+			// Uncompressed rows are aligned to 4 bytes (GL_UNPACK_ALIGNMENT)
+			uint32_t rowPitch = widthInBlocks * bytesPerBlock;
+
+			if (!desc.compressed)
+			{
+				rowPitch = (rowPitch + 3) & ~3u;
+			}
+
+			uint64_t imageSize = (uint64_t)rowPitch * heightInBlocks * mipDepth;
+			uint64_t faceStride = isCubemapNonArray ? ((imageSize + 3) & ~(uint64_t)3) : imageSize;
+
+			offset += sizeof(uint32_t); // imageSize
+
+			for (uint32_t layer = 0; layer < desc.arraySize; ++layer)
+			{
+				for (uint32_t face = 0; face < numFaces; ++face)
+				{
+					Subresource& subresource = subresources[get_subresource_index(desc, mip, layer, face)];
+					subresource.offset   = offset;
+					subresource.size     = imageSize;
+					subresource.width    = mipWidth;
+					subresource.height   = mipHeight;
+					subresource.depth    = mipDepth;
+					subresource.rowPitch = rowPitch;
+					subresource.mip      = mip;
+					subresource.layer    = layer;
+					subresource.face     = face;
+
+					offset += faceStride;
+				}
+			}
+
+			offset = (offset + 3) & ~(uint64_t)3; // mipPadding
+		}
+
+		return offset;
+	}
+
+	// First step of building a KTX file. Encode the header with encode_header, then call this to get the descriptor,
+	// the subresource table (get_subresource_count entries) and the size of the buffer to allocate
+	inline uint64_t prepare_texture(const HeaderKTX& header, Descriptor& desc, Subresource* subresources)
+	{
+		decode_header(header, desc);
+		return compute_subresource_layout(desc, get_image_data_offset(header), subresources);
+	}
+
+	// Writes the header, the imageSize fields and clears any padding. Key/value data, if any, is left for the caller.
+	// After this every subresource can be written independently from any thread since their ranges never overlap
+	inline void write_texture_layout(const HeaderKTX& header, const Descriptor& desc, const Subresource* subresources, unsigned char* destination)
+	{
+		memcpy(destination, &header, sizeof(HeaderKTX));
+
+		uint32_t numMips = get_mip_count(desc);
+		bool isCubemapNonArray = desc.type == Cubemap && !desc.array;
+		uint32_t imagesPerMip = desc.arraySize * get_face_count(desc);
+
+		for (uint32_t mip = 0; mip < numMips; ++mip)
+		{
+			const Subresource& first = subresources[get_subresource_index(desc, mip, 0, 0)];
+			const Subresource& last  = subresources[get_subresource_index(desc, mip, desc.arraySize - 1, get_face_count(desc) - 1)];
+
+			uint64_t levelEnd = last.offset + last.size;
+			uint64_t nextLevel = mip + 1 < numMips ? subresources[get_subresource_index(desc, mip + 1, 0, 0)].offset - sizeof(uint32_t) : ((levelEnd + 3) & ~(uint64_t)3);
+
+			uint32_t imageSize = (uint32_t)(isCubemapNonArray ? first.size : levelEnd - first.offset);
+			memcpy(destination + first.offset - sizeof(uint32_t), &imageSize, sizeof(uint32_t));
+
+			// Padding between faces and at the end of the level
+			for (uint32_t i = 0; i < imagesPerMip; ++i)
+			{
+				const Subresource& subresource = subresources[get_subresource_index(desc, mip, 0, 0) + i];
+				uint64_t imageEnd = subresource.offset + subresource.size;
+				uint64_t nextImage = i + 1 < imagesPerMip ? subresources[get_subresource_index(desc, mip, 0, 0) + i + 1].offset : nextLevel;
+				memset(destination + imageEnd, 0, (size_t)(nextImage - imageEnd));
+			}
+		}
+	}
+
+	// Copies an image into its place in the file, adding row padding. Compressed sources are rows of blocks.
+	// Different subresources can be written concurrently without any synchronization
+	inline void write_subresource(const Descriptor& desc, const Subresource& subresource, const unsigned char* source, uint32_t sourceRowPitch, unsigned char* destination)
+	{
+		uint32_t heightInBlocks = (subresource.height + desc.blockHeight - 1) / desc.blockHeight;
+		uint32_t widthInBlocks  = (subresource.width + desc.blockWidth - 1) / desc.blockWidth;
+		uint32_t rowSize = widthInBlocks * (desc.bitsPerPixelOrBlock / 8);
+		uint32_t rowCount = heightInBlocks * subresource.depth;
+
+		unsigned char* destinationImage = destination + subresource.offset;
+
+		if (sourceRowPitch == subresource.rowPitch)
+		{
+			memcpy(destinationImage, source, (size_t)subresource.size);
+			return;
+		}
+
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			unsigned char* destinationRow = destinationImage + (uint64_t)row * subresource.rowPitch;
+			memcpy(destinationRow, source + (uint64_t)row * sourceRowPitch, rowSize);
+			memset(destinationRow + rowSize, 0, subresource.rowPitch - rowSize);
+		}
+	}
+
+	namespace internal
+	{
+		// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+		struct HeaderKTX2
+		{
+			char identifier[12];
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+
+		// The level index follows the header, one entry per mip starting with mip 0
+		struct LevelIndexKTX2
+		{
+			uint64_t byteOffset; // From the start of the file
+			uint64_t byteLength; // Supercompressed size
+			uint64_t uncompressedByteLength;
+		};
+
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC1A    = 128; // First of the block compressed color models
+		static ktxpp_constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+	}
+
+	// Basic descriptor block of the Khronos Data Format Descriptor, which is what KTX2 uses to describe texel layout
+	struct DataFormatDescriptor
+	{
+		uint32_t vendorId;
+		uint32_t descriptorType;
+		uint32_t versionNumber;
+		uint32_t colorModel;
+		uint32_t colorPrimaries;
+		uint32_t transferFunction;
+		uint32_t flags;
+		uint32_t texelBlockDimensions[4]; // Already incremented, i.e. 4 for a 4x4 block
+		uint32_t bytesPlane[8];
+		uint32_t sampleCount;
+	};
+
+	// An entry of the key/value data. Keys are null terminated UTF-8 and values are arbitrary bytes
+	struct KeyValue
+	{
+		const char* key;
+		const unsigned char* value;
+		uint32_t valueSize;
+	};
+
+	inline bool is_ktx2_file(const unsigned char* sourceData)
+	{
+		static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', '\x1A', '\n' };
+		return memcmp(sourceData, identifier, sizeof(identifier)) == 0;
+	}
+
+	// Parses the basic descriptor block of a DFD, starting at the dfdTotalSize field. Returns false if the
+	// first block is not a Khronos basic descriptor
+	inline bool decode_dfd(const unsigned char* dfdData, uint32_t dfdByteLength, DataFormatDescriptor& dfd)
+	{
+		// dfdTotalSize plus the 24 byte block header
+		if (dfdByteLength < 4 + 24)
+		{
+			return false;
+		}
+
+		uint32_t words[6];
+		memcpy(words, dfdData + 4, sizeof(words));
+
+		dfd.vendorId         = words[0] & 0x1ffff;
+		dfd.descriptorType   = words[0] >> 17;
+		dfd.versionNumber    = words[1] & 0xffff;
+		uint32_t blockSize   = words[1] >> 16;
+		dfd.colorModel       = words[2] & 0xff;
+		dfd.colorPrimaries   = (words[2] >> 8) & 0xff;
+		dfd.transferFunction = (words[2] >> 16) & 0xff;
+		dfd.flags            = words[2] >> 24;
+
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			dfd.texelBlockDimensions[i] = ((words[3] >> (i * 8)) & 0xff) + 1;
+		}
+
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			dfd.bytesPlane[i] = (words[4 + i / 4] >> ((i % 4) * 8)) & 0xff;
+		}
+
+		// Each sample is 16 bytes after the 24 byte block header
+		dfd.sampleCount = blockSize >= 24 ? (blockSize - 24) / 16 : 0;
+
+		return dfd.vendorId == 0 && dfd.descriptorType == 0 && blockSize + 4 <= dfdByteLength;
+	}
+
+	// Walks the key/value data of either KTX 1.1 or KTX2. Start with cursor at the beginning of the block and call
+	// until it returns false
+	inline bool next_key_value(const unsigned char*& cursor, const unsigned char* end, KeyValue& keyValue)
+	{
+		if (end - cursor < 4)
+		{
+			return false;
+		}
+
+		uint32_t keyAndValueByteSize;
+		memcpy(&keyAndValueByteSize, cursor, sizeof(uint32_t));
+
+		const unsigned char* keyAndValue = cursor + sizeof(uint32_t);
+
+		if (keyAndValueByteSize > (uint64_t)(end - keyAndValue))
+		{
+			return false;
+		}
+
+		uint32_t keySize = 0;
+		while (keySize < keyAndValueByteSize && keyAndValue[keySize] != 0) { keySize++; }
+
+		if (keySize == keyAndValueByteSize)
+		{
+			return false; // Key is not null terminated
+		}
+
+		keyValue.key       = reinterpret_cast<const char*>(keyAndValue);
+		keyValue.value     = keyAndValue + keySize + 1;
+		keyValue.valueSize = keyAndValueByteSize - keySize - 1;
+
+		uint64_t paddedSize = (keyAndValueByteSize + 3) & ~3u;
+		cursor = (uint64_t)(end - keyAndValue) < paddedSize ? end : keyAndValue + paddedSize;
+
+		return true;
+	}
+
+	// Fills in the descriptor from a KTX2 file and returns its level index, or nullptr if this isn't a KTX2 file.
+	// The vkFormat comes straight from the header and the GL formats are derived from it. Formats unknown to ktxpp
+	// (e.g. VK_FORMAT_UNDEFINED for Basis Universal) take their block size and dimensions from the DFD instead
+	inline const LevelIndexKTX2* decode_header_ktx2(const unsigned char* sourceData, Descriptor& desc)
+	{
+		ktxpp_stage(StageParse, "decode_header_ktx2");
+		ktxpp_stage_work(sizeof(HeaderKTX2), 0);
+
+		if (!is_ktx2_file(sourceData))
+		{
+			return nullptr;
+		}
+
+		HeaderKTX2 header;
+		memcpy(&header, sourceData, sizeof(HeaderKTX2));
+
+		desc.vkFormat             = (VkFormat)header.vkFormat;
+		desc.glInternalFormat     = get_glformat_from_vkformat(desc.vkFormat, desc.glFormat, desc.glType);
+		desc.glBaseInternalFormat = desc.glFormat;
+
+		desc.width                = header.pixelWidth  > 0 ? header.pixelWidth  : 1;
+		desc.height               = header.pixelHeight > 0 ? header.pixelHeight : 1;
+		desc.depth                = header.pixelDepth  > 0 ? header.pixelDepth  : 1;
+		desc.arraySize            = header.layerCount  > 0 ? header.layerCount  : 1;
+		desc.array                = header.layerCount  > 0;
+
+		// As with KTX 1.1, a levelCount of 0 asks the loader to generate the mip chain
+		desc.numMips              = header.levelCount;
+
+		desc.compressed           = is_compressed(desc.glInternalFormat);
+		desc.srgb                 = is_srgb(desc.glInternalFormat);
+		desc.bitsPerPixelOrBlock  = get_bits_per_pixel_or_block(desc.glInternalFormat);
+		get_block_size(desc.glInternalFormat, desc.blockWidth, desc.blockHeight);
+
+		DataFormatDescriptor dfd;
+
+		if (desc.glInternalFormat == UNKNOWN && decode_dfd(sourceData + header.dfdByteOffset, header.dfdByteLength, dfd))
+		{
+			desc.compressed          = dfd.colorModel >= KHR_DF_MODEL_BC1A;
+			desc.srgb                = dfd.transferFunction == KHR_DF_TRANSFER_SRGB;
+			desc.bitsPerPixelOrBlock = dfd.bytesPlane[0] * 8;
+			desc.blockWidth          = dfd.texelBlockDimensions[0];
+			desc.blockHeight         = dfd.texelBlockDimensions[1];
+		}
+
+		if (header.faceCount == 6)
+		{
+			desc.type = Cubemap;
+		}
+		else if (header.pixelDepth > 1)
+		{
+			desc.type = Texture3D;
+		}
+		else if (header.pixelHeight > 1)
+		{
+			desc.type = Texture2D;
+		}
+		else
+		{
+			desc.type = Texture1D;
+		}
+
+		// KTX2 rows are tightly packed
+		uint32_t widthInBlocks, heightInBlocks;
+		get_mip_size_in_blocks(desc, 0, widthInBlocks, heightInBlocks);
+		desc.rowPitch   = widthInBlocks * (desc.bitsPerPixelOrBlock / 8);
+		desc.depthPitch = desc.rowPitch * heightInBlocks;
+
+		return reinterpret_cast<const LevelIndexKTX2*>(sourceData + sizeof(HeaderKTX2));
+	}
+
+	// Random access to a single subresource of a KTX2 file through its level index. If the file is supercompressed
+	// the offsets are relative to the start of the decompressed level instead of the start of the file
+	inline void compute_subresource_layout_ktx2(const Descriptor& desc, const LevelIndexKTX2* levels, bool supercompressed, Subresource* subresources)
+	{
+		ktxpp_stage(StageLayout, "compute_subresource_layout_ktx2");
+
+		uint32_t numMips  = get_mip_count(desc);
+		uint32_t numFaces = get_face_count(desc);
+
+		for (uint32_t mip = 0; mip < numMips; ++mip)
+		{
+			LevelIndexKTX2 level;
+			memcpy(&level, levels + mip, sizeof(LevelIndexKTX2));
+
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+			uint32_t mipWidth  = (desc.width  >> mip) > 0 ? (desc.width  >> mip) : 1;
+			uint32_t mipHeight = (desc.height >> mip) > 0 ? (desc.height >> mip) : 1;
+			uint32_t mipDepth  = (desc.depth  >> mip) > 0 ? (desc.depth  >> mip) : 1;
+
+			uint32_t rowPitch = widthInBlocks * (desc.bitsPerPixelOrBlock / 8);
+			uint64_t imageSize = (uint64_t)rowPitch * heightInBlocks * mipDepth;
+
+			uint64_t offset = supercompressed ? 0 : level.byteOffset;
+
+			for (uint32_t layer = 0; layer < desc.arraySize; ++layer)
+			{
+				for (uint32_t face = 0; face < numFaces; ++face)
+				{
+					Subresource& subresource = subresources[get_subresource_index(desc, mip, layer, face)];
+					subresource.offset   = offset;
+					subresource.size     = imageSize;
+					subresource.width    = mipWidth;
+					subresource.height   = mipHeight;
+					subresource.depth    = mipDepth;
+					subresource.rowPitch = rowPitch;
+					subresource.mip      = mip;
+					subresource.layer    = layer;
+					subresource.face     = face;
+
+					offset += imageSize;
+				}
+			}
+		}
+	}
+
+	enum ValidationResult
+	{
+		ValidationSuccess,
+		ValidationTruncated,               // The buffer ends before the data the header describes
+		ValidationInvalidIdentifier,
+		ValidationUnsupportedEndianness,   // Big endian files are not supported
+		ValidationInvalidHeader,           // Inconsistent dimensions, face, array or mip counts
+		ValidationUnsupportedFormat,       // ktxpp doesn't know the size of this format
+		ValidationInvalidKeyValueData,
+		ValidationImageSizeMismatch,       // An imageSize field disagrees with the dimensions and format
+	};
+
+	inline bool is_ktx_file(const unsigned char* sourceData)
+	{
+		static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', '\x1A', '\n' };
+		return memcmp(sourceData, identifier, sizeof(identifier)) == 0;
+	}
+
+	// Size the imageSize field of a mip must hold, and how many bytes the level occupies after that field including
+	// cubePadding but not mipPadding. Computed in 64 bits, clamping each product, so it returns false instead of
+	// overflowing when imageSize doesn't fit its 32 bits
+	inline bool get_level_size(const Descriptor& desc, uint32_t mip, uint64_t& imageSize, uint64_t& levelSize)
+	{
+		uint32_t widthInBlocks, heightInBlocks;
+		get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+		uint64_t mipDepth = (desc.depth >> mip) > 0 ? (desc.depth >> mip) : 1;
+		uint64_t numFaces = get_face_count(desc);
+		bool isCubemapNonArray = desc.type == Cubemap && !desc.array;
+
+		// Row pitch is stored in 32 bits
+		uint64_t rowPitch = (uint64_t)widthInBlocks * (desc.bitsPerPixelOrBlock / 8);
+		rowPitch = desc.compressed ? rowPitch : ((rowPitch + 3) & ~(uint64_t)3);
+
+		if (rowPitch > 0xffffffffu)
+		{
+			return false;
+		}
+
+		// Checking each product against the limit before multiplying by the next factor keeps everything in 64 bits
+		imageSize = rowPitch * heightInBlocks;
+		imageSize = imageSize <= 0xffffffffu ? imageSize * mipDepth : imageSize;
+
+		if (!isCubemapNonArray)
+		{
+			imageSize = imageSize <= 0xffffffffu ? imageSize * desc.arraySize : imageSize;
+			imageSize = imageSize <= 0xffffffffu ? imageSize * numFaces : imageSize;
+		}
+
+		// For non-array cubemaps imageSize is a single face and each face is padded to 4 bytes
+		levelSize = isCubemapNonArray ? ((imageSize + 3) & ~(uint64_t)3) * numFaces : imageSize;
+
+		return imageSize <= 0xffffffffu;
+	}
+
+	// Checks a header on its own, e.g. as soon as its 64 bytes have been read, and fills in desc. On success every size
+	// compute_subresource_layout produces fits its type. The key/value data and imageSize fields still need checking
+	// once they are available, which is what the overload that takes the whole file does
+	inline ValidationResult validate_header(const HeaderKTX& header, Descriptor& desc)
+	{
+		if (!is_ktx_file(reinterpret_cast<const unsigned char*>(header.identifier)))
+		{
+			return ValidationInvalidIdentifier;
+		}
+
+		if (header.endianness != 0x04030201)
+		{
+			return ValidationUnsupportedEndianness;
+		}
+
+		// GL enums are 16-bit, anything larger can't be stored in the descriptor
+		if ((header.glType | header.glFormat | header.glInternalFormat | header.glBaseInternalFormat) > 0xffff)
+		{
+			return ValidationUnsupportedFormat;
+		}
+
+		// Dimensions are given from the lowest upwards, and cubemap faces are square 2D images
+		bool isCubemap = header.numberOfFaces == 6;
+
+		if (header.pixelWidth == 0 ||
+			(header.pixelDepth > 0 && header.pixelHeight == 0) ||
+			(header.numberOfFaces != 1 && !isCubemap) ||
+			(isCubemap && (header.pixelWidth != header.pixelHeight || header.pixelDepth > 0)))
+		{
+			return ValidationInvalidHeader;
+		}
+
+		uint32_t maxDimension = header.pixelWidth > header.pixelHeight ? header.pixelWidth : header.pixelHeight;
+		maxDimension = maxDimension > header.pixelDepth ? maxDimension : header.pixelDepth;
+
+		uint32_t maxMips = 1;
+		while (maxMips < 32 && (maxDimension >> maxMips)) { maxMips++; }
+
+		if (header.numberOfMipmapLevels > maxMips)
+		{
+			return ValidationInvalidHeader;
+		}
+
+		if (header.bytesOfKeyValueData % 4 != 0)
+		{
+			return ValidationInvalidKeyValueData;
+		}
+
+		decode_header(header, desc);
+
+		if (desc.bitsPerPixelOrBlock == 0 || desc.bitsPerPixelOrBlock % 8 != 0)
+		{
+			return ValidationUnsupportedFormat;
+		}
+
+		if (desc.compressed != is_compressed(desc.glInternalFormat) || (desc.compressed && desc.depth > 1))
+		{
+			return ValidationInvalidHeader;
+		}
+
+		// The subresource table is indexed with 32 bits
+		if ((uint64_t)get_mip_count(desc) * desc.arraySize * get_face_count(desc) > 0xffffffffu)
+		{
+			return ValidationInvalidHeader;
+		}
+
+		for (uint32_t mip = 0; mip < get_mip_count(desc); ++mip)
+		{
+			uint64_t imageSize, levelSize;
+
+			if (!get_level_size(desc, mip, imageSize, levelSize))
+			{
+				return ValidationInvalidHeader;
+			}
+		}
+
+		return ValidationSuccess;
+	}
+
+	// Safe counterpart to decode_header for untrusted data. Every field is checked against sourceSize before it is used
+	// and every imageSize is compared with the size implied by the dimensions, block size and padding, in 64-bit
+	// arithmetic that cannot overflow. Only the header, key/value data and the mipCount imageSize fields are read so
+	// the cost doesn't depend on the size of the image data. On success desc is filled in and the file can be walked
+	// with compute_subresource_layout without further checks
+	inline ValidationResult validate_header(const unsigned char* sourceData, uint64_t sourceSize, Descriptor& desc)
+	{
+		ktxpp_stage(StageParse, "validate_header");
+
+		if (sourceSize < sizeof(HeaderKTX))
+		{
+			return ValidationTruncated;
+		}
+
+		HeaderKTX header;
+		memcpy(&header, sourceData, sizeof(HeaderKTX));
+
+		ValidationResult result = validate_header(header, desc);
+
+		if (result != ValidationSuccess)
+		{
+			return result;
+		}
+
+		if (get_image_data_offset(header) > sourceSize)
+		{
+			return ValidationTruncated;
+		}
+
+		// Every entry must fit inside the key/value data
+		const unsigned char* cursor = sourceData + sizeof(HeaderKTX);
+		const unsigned char* keyValueEnd = cursor + header.bytesOfKeyValueData;
+		KeyValue keyValue;
+
+		while (next_key_value(cursor, keyValueEnd, keyValue)) {}
+
+		if (cursor != keyValueEnd)
+		{
+			return ValidationInvalidKeyValueData;
+		}
+
+		ktxpp_stage_work(get_image_data_offset(header), 0);
+
+		uint64_t offset = get_image_data_offset(header);
+
+		for (uint32_t mip = 0; mip < get_mip_count(desc); ++mip)
+		{
+			uint64_t expectedSize, levelSize;
+
+			if (!get_level_size(desc, mip, expectedSize, levelSize))
+			{
+				return ValidationInvalidHeader;
+			}
+
+			if (sourceSize - offset < sizeof(uint32_t))
+			{
+				return ValidationTruncated;
+			}
+
+			uint32_t imageSize;
+			memcpy(&imageSize, sourceData + offset, sizeof(uint32_t));
+
+			if (imageSize != expectedSize)
+			{
+				return ValidationImageSizeMismatch;
+			}
+
+			offset += sizeof(uint32_t);
+
+			if (sourceSize - offset < levelSize)
+			{
+				return ValidationTruncated;
+			}
+
+			// mipPadding may be missing after the last level
+			offset = (offset + levelSize + 3) & ~(uint64_t)3;
+			offset = offset < sourceSize ? offset : sourceSize;
+		}
+
+		return ValidationSuccess;
+	}
+
+	// Size of a KTX2 level before supercompression, every layer and face with tightly packed rows. Returns false when
+	// it doesn't fit 64 bits or the row pitch doesn't fit the 32 bits of Subresource
+	inline bool get_level_size_ktx2(const Descriptor& desc, uint32_t mip, uint64_t& levelSize)
+	{
+		uint32_t widthInBlocks, heightInBlocks;
+		get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+		uint64_t rowPitch = (uint64_t)widthInBlocks * (desc.bitsPerPixelOrBlock / 8);
+
+		if (rowPitch > 0xffffffffu)
+		{
+			return false;
+		}
+
+		const uint64_t factors[4] = { heightInBlocks, (desc.depth >> mip) > 0 ? (desc.depth >> mip) : 1, desc.arraySize, get_face_count(desc) };
+		levelSize = rowPitch;
+
+		for (uint64_t factor : factors)
+		{
+			if (factor > 0 && levelSize > ~(uint64_t)0 / factor)
+			{
+				return false;
+			}
+
+			levelSize *= factor;
+		}
+
+		return true;
+	}
+
+	// Safe counterpart to decode_header_ktx2 for untrusted data. The DFD, key/value data, supercompression global data
+	// and every level must lie inside sourceSize, and each level must hold as many bytes as its dimensions and format
+	// imply, all compared in 64-bit arithmetic that cannot overflow. Only the header, level index and key/value data
+	// are read. On success desc is filled in and the file can be walked with decode_header_ktx2 and
+	// compute_subresource_layout_ktx2 without further checks. Formats whose blocks ktxpp can't size, e.g. Basis
+	// Universal, return ValidationUnsupportedFormat once their ranges have been checked
+	inline ValidationResult validate_header_ktx2(const unsigned char* sourceData, uint64_t sourceSize, Descriptor& desc)
+	{
+		ktxpp_stage(StageParse, "validate_header_ktx2");
+
+		if (sourceSize < sizeof(HeaderKTX2))
+		{
+			return ValidationTruncated;
+		}
+
+		if (!is_ktx2_file(sourceData))
+		{
+			return ValidationInvalidIdentifier;
+		}
+
+		HeaderKTX2 header;
+		memcpy(&header, sourceData, sizeof(HeaderKTX2));
+
+		// Vulkan enums are positive 32-bit ints, anything larger can't be stored in the descriptor
+		if (header.vkFormat > 0x7fffffffu)
+		{
+			return ValidationUnsupportedFormat;
+		}
+
+		// Same rules as KTX 1.1: dimensions are given from the lowest upwards and cubemap faces are square 2D images
+		bool isCubemap = header.faceCount == 6;
+
+		if (header.pixelWidth == 0 ||
+			(header.pixelDepth > 0 && header.pixelHeight == 0) ||
+			(header.faceCount != 1 && !isCubemap) ||
+			(isCubemap && (header.pixelWidth != header.pixelHeight || header.pixelDepth > 0)))
+		{
+			return ValidationInvalidHeader;
+		}
+
+		uint32_t maxDimension = header.pixelWidth > header.pixelHeight ? header.pixelWidth : header.pixelHeight;
+		maxDimension = maxDimension > header.pixelDepth ? maxDimension : header.pixelDepth;
+
+		uint32_t maxMips = 1;
+		while (maxMips < 32 && (maxDimension >> maxMips)) { maxMips++; }
+
+		if (header.levelCount > maxMips)
+		{
+			return ValidationInvalidHeader;
+		}
+
+		// The level index has an entry even when levelCount is 0. The 32-bit ranges can't overflow in 64 bits, the
+		// 64-bit one is compared against what's left after its offset
+		uint32_t levelCount = header.levelCount > 0 ? header.levelCount : 1;
+
+		if (sizeof(HeaderKTX2) + (uint64_t)levelCount * sizeof(LevelIndexKTX2) > sourceSize ||
+			(uint64_t)header.dfdByteOffset + header.dfdByteLength > sourceSize ||
+			(uint64_t)header.kvdByteOffset + header.kvdByteLength > sourceSize ||
+			header.sgdByteLength > sourceSize || header.sgdByteOffset > sourceSize - header.sgdByteLength)
+		{
+			return ValidationTruncated;
+		}
+
+		const unsigned char* cursor = sourceData + header.kvdByteOffset;
+		const unsigned char* keyValueEnd = cursor + header.kvdByteLength;
+		KeyValue keyValue;
+
+		while (next_key_value(cursor, keyValueEnd, keyValue)) {}
+
+		if (cursor != keyValueEnd)
+		{
+			return ValidationInvalidKeyValueData;
+		}
+
+		const LevelIndexKTX2* levels = decode_header_ktx2(sourceData, desc);
+
+		for (uint32_t mip = 0; mip < levelCount; ++mip)
+		{
+			LevelIndexKTX2 level;
+			memcpy(&level, levels + mip, sizeof(LevelIndexKTX2));
+
+			if (level.byteLength > sourceSize || level.byteOffset > sourceSize - level.byteLength)
+			{
+				return ValidationTruncated;
+			}
+
+			// Without supercompression a level is stored as is
+			if (header.supercompressionScheme == 0 && level.byteLength != level.uncompressedByteLength)
+			{
+				return ValidationImageSizeMismatch;
+			}
+		}
+
+		ktxpp_stage_work(sizeof(HeaderKTX2) + (uint64_t)levelCount * sizeof(LevelIndexKTX2) + header.kvdByteLength, 0);
+
+		if (desc.bitsPerPixelOrBlock == 0 || desc.bitsPerPixelOrBlock % 8 != 0 || desc.blockWidth == 0 || desc.blockHeight == 0)
+		{
+			return ValidationUnsupportedFormat;
+		}
+
+		// The subresource table is indexed with 32 bits
+		if ((uint64_t)get_mip_count(desc) * desc.arraySize * get_face_count(desc) > 0xffffffffu)
+		{
+			return ValidationInvalidHeader;
+		}
+
+		for (uint32_t mip = 0; mip < levelCount; ++mip)
+		{
+			LevelIndexKTX2 level;
+			memcpy(&level, levels + mip, sizeof(LevelIndexKTX2));
+
+			uint64_t levelSize;
+
+			if (!get_level_size_ktx2(desc, mip, levelSize))
+			{
+				return ValidationInvalidHeader;
+			}
+
+			if (level.uncompressedByteLength != levelSize)
+			{
+				return ValidationImageSizeMismatch;
+			}
+		}
+
+		return ValidationSuccess;
+	}
+
+	namespace internal
+	{
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_RGBSDA      = 1;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC2         = 129;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC3         = 130;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC4         = 131;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC5         = 132;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC6H        = 133;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_BC7         = 134;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_ETC1        = 160;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_ETC2        = 161;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_ASTC        = 162;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_PVRTC       = 164;
+		static ktxpp_constexpr uint32_t KHR_DF_MODEL_PVRTC2      = 165;
+
+		static ktxpp_constexpr uint32_t KHR_DF_PRIMARIES_BT709   = 1;
+		static ktxpp_constexpr uint32_t KHR_DF_TRANSFER_LINEAR   = 1;
+
+		static ktxpp_constexpr uint32_t KHR_DF_SAMPLE_LINEAR     = 0x10;
+		static ktxpp_constexpr uint32_t KHR_DF_SAMPLE_SIGNED     = 0x40;
+		static ktxpp_constexpr uint32_t KHR_DF_SAMPLE_FLOAT      = 0x80;
+
+		static ktxpp_constexpr uint32_t KHR_DF_CHANNEL_RED       = 0;
+		static ktxpp_constexpr uint32_t KHR_DF_CHANNEL_GREEN     = 1;
+		static ktxpp_constexpr uint32_t KHR_DF_CHANNEL_BLUE      = 2;
+		static ktxpp_constexpr uint32_t KHR_DF_CHANNEL_ALPHA     = 15;
+
+		struct SampleDFD
+		{
+			uint32_t bitOffset;
+			uint32_t bitLength;
+			uint32_t channelType; // Channel id and qualifiers
+			uint32_t lower;
+			uint32_t upper;
+		};
+
+		inline void set_sample(SampleDFD& sample, uint32_t bitOffset, uint32_t bitLength, uint32_t channelType)
+		{
+			sample.bitOffset   = bitOffset;
+			sample.bitLength   = bitLength;
+			sample.channelType = channelType;
+		}
+
+		// Samples of a block compressed format. Returns the color model, or 0 if ktxpp can't describe it
+		inline uint32_t get_compressed_samples(GLInternalFormat glInternalFormat, SampleDFD* samples, uint32_t& sampleCount)
+		{
+			sampleCount = 1;
+			set_sample(samples[0], 0, 64, 0);
+
+			switch (glInternalFormat)
+			{
+				case GL_COMPRESSED_RGB_S3TC_DXT1:
+				case GL_COMPRESSED_SRGB_S3TC_DXT1:
+					return KHR_DF_MODEL_BC1A;
+				case GL_COMPRESSED_RGBA_S3TC_DXT1:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1:
+					samples[0].channelType = 1; // Alpha present
+					return KHR_DF_MODEL_BC1A;
+				case GL_COMPRESSED_RGBA_S3TC_DXT3:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3:
+				case GL_COMPRESSED_RGBA_S3TC_DXT5:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5:
+					sampleCount = 2;
+					set_sample(samples[0], 0, 64, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_LINEAR);
+					set_sample(samples[1], 64, 64, 0);
+					return (glInternalFormat == GL_COMPRESSED_RGBA_S3TC_DXT3 || glInternalFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3) ? KHR_DF_MODEL_BC2 : KHR_DF_MODEL_BC3;
+				case GL_COMPRESSED_RED_RGTC1:
+				case GL_COMPRESSED_LUMINANCE_LATC1:
+					return KHR_DF_MODEL_BC4;
+				case GL_COMPRESSED_SIGNED_RED_RGTC1:
+				case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1:
+					samples[0].channelType = KHR_DF_SAMPLE_SIGNED;
+					return KHR_DF_MODEL_BC4;
+				case GL_COMPRESSED_RG_RGTC2:
+				case GL_COMPRESSED_LUMINANCE_ALPHA_LATC2:
+				case GL_COMPRESSED_SIGNED_RG_RGTC2:
+				case GL_COMPRESSED_SIGNED_LUMINANCE_ALPHA_LATC2:
+				{
+					uint32_t sign = (glInternalFormat == GL_COMPRESSED_SIGNED_RG_RGTC2 || glInternalFormat == GL_COMPRESSED_SIGNED_LUMINANCE_ALPHA_LATC2) ? KHR_DF_SAMPLE_SIGNED : 0;
+					sampleCount = 2;
+					set_sample(samples[0], 0, 64, KHR_DF_CHANNEL_RED | sign);
+					set_sample(samples[1], 64, 64, KHR_DF_CHANNEL_GREEN | sign);
+					return KHR_DF_MODEL_BC5;
+				}
+				case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+					set_sample(samples[0], 0, 128, KHR_DF_SAMPLE_FLOAT);
+					return KHR_DF_MODEL_BC6H;
+				case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+					set_sample(samples[0], 0, 128, KHR_DF_SAMPLE_FLOAT | KHR_DF_SAMPLE_SIGNED);
+					return KHR_DF_MODEL_BC6H;
+				case GL_COMPRESSED_RGBA_BPTC_UNORM:
+				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+					set_sample(samples[0], 0, 128, 0);
+					return KHR_DF_MODEL_BC7;
+				case GL_ETC1_RGB8_OES:
+					return KHR_DF_MODEL_ETC1;
+				case GL_COMPRESSED_RGB8_ETC2:
+				case GL_COMPRESSED_SRGB8_ETC2:
+				case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+				case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+					samples[0].channelType = 2; // ETC2 color
+					return KHR_DF_MODEL_ETC2;
+				case GL_COMPRESSED_RGBA8_ETC2_EAC:
+				case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+					sampleCount = 2;
+					set_sample(samples[0], 0, 64, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_LINEAR);
+					set_sample(samples[1], 64, 64, 2);
+					return KHR_DF_MODEL_ETC2;
+				case GL_COMPRESSED_R11_EAC:
+				case GL_COMPRESSED_SIGNED_R11_EAC:
+					samples[0].channelType = KHR_DF_CHANNEL_RED | (glInternalFormat == GL_COMPRESSED_SIGNED_R11_EAC ? KHR_DF_SAMPLE_SIGNED : 0);
+					return KHR_DF_MODEL_ETC2;
+				case GL_COMPRESSED_RG11_EAC:
+				case GL_COMPRESSED_SIGNED_RG11_EAC:
+				{
+					uint32_t sign = glInternalFormat == GL_COMPRESSED_SIGNED_RG11_EAC ? KHR_DF_SAMPLE_SIGNED : 0;
+					sampleCount = 2;
+					set_sample(samples[0], 0, 64, KHR_DF_CHANNEL_RED | sign);
+					set_sample(samples[1], 64, 64, KHR_DF_CHANNEL_GREEN | sign);
+					return KHR_DF_MODEL_ETC2;
+				}
+				case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG:
+				case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
+				case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG:
+				case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
+				case GL_COMPRESSED_SRGB_PVRTC_2BPPV1:
+				case GL_COMPRESSED_SRGB_PVRTC_4BPPV1:
+				case GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV1:
+				case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV1:
+					return KHR_DF_MODEL_PVRTC;
+				case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG:
+				case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
+				case GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV2_IMG:
+				case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV2_IMG:
+					return KHR_DF_MODEL_PVRTC2;
+				default:
+					// All ASTC formats are 128 bits per block
+					if (get_bits_per_pixel_or_block(glInternalFormat) == 128 && is_compressed(glInternalFormat))
+					{
+						set_sample(samples[0], 0, 128, 0);
+						return KHR_DF_MODEL_ASTC;
+					}
+					return 0;
+			}
+		}
+
+		// Samples of an uncompressed format, in increasing bit order. Returns false if ktxpp can't describe it
+		inline bool get_uncompressed_samples(GLFormat glFormat, GLType glType, SampleDFD* samples, uint32_t& sampleCount)
+		{
+			// Packed formats list their channels from the least significant bit
+			switch (glType)
+			{
+				case GL_UNSIGNED_SHORT_5_6_5:
+					sampleCount = 3;
+					set_sample(samples[0], 0, 5, KHR_DF_CHANNEL_BLUE);
+					set_sample(samples[1], 5, 6, KHR_DF_CHANNEL_GREEN);
+					set_sample(samples[2], 11, 5, KHR_DF_CHANNEL_RED);
+					return true;
+				case GL_UNSIGNED_SHORT_4_4_4_4:
+					sampleCount = 4;
+					set_sample(samples[0], 0, 4, KHR_DF_CHANNEL_ALPHA);
+					set_sample(samples[1], 4, 4, KHR_DF_CHANNEL_BLUE);
+					set_sample(samples[2], 8, 4, KHR_DF_CHANNEL_GREEN);
+					set_sample(samples[3], 12, 4, KHR_DF_CHANNEL_RED);
+					return true;
+				case GL_UNSIGNED_SHORT_5_5_5_1:
+					sampleCount = 4;
+					set_sample(samples[0], 0, 1, KHR_DF_CHANNEL_ALPHA);
+					set_sample(samples[1], 1, 5, KHR_DF_CHANNEL_BLUE);
+					set_sample(samples[2], 6, 5, KHR_DF_CHANNEL_GREEN);
+					set_sample(samples[3], 11, 5, KHR_DF_CHANNEL_RED);
+					return true;
+				case GL_UNSIGNED_INT_2_10_10_10_REV:
+					sampleCount = 4;
+					set_sample(samples[0], 0, 10, KHR_DF_CHANNEL_RED);
+					set_sample(samples[1], 10, 10, KHR_DF_CHANNEL_GREEN);
+					set_sample(samples[2], 20, 10, KHR_DF_CHANNEL_BLUE);
+					set_sample(samples[3], 30, 2, KHR_DF_CHANNEL_ALPHA);
+					return true;
+				default:
+					break;
+			}
+
+			uint32_t bits = 0;
+			uint32_t qualifiers = 0;
+
+			switch (glType)
+			{
+				case GL_UNSIGNED_BYTE:  bits = 8;  break;
+				case GL_BYTE:           bits = 8;  qualifiers = KHR_DF_SAMPLE_SIGNED; break;
+				case GL_UNSIGNED_SHORT: bits = 16; break;
+				case GL_SHORT:          bits = 16; qualifiers = KHR_DF_SAMPLE_SIGNED; break;
+				case GL_UNSIGNED_INT:   bits = 32; break;
+				case GL_INT:            bits = 32; qualifiers = KHR_DF_SAMPLE_SIGNED; break;
+				case GL_HALF_FLOAT:
+				case GL_HALF_FLOAT_OES: bits = 16; qualifiers = KHR_DF_SAMPLE_SIGNED | KHR_DF_SAMPLE_FLOAT; break;
+				case GL_FLOAT:          bits = 32; qualifiers = KHR_DF_SAMPLE_SIGNED | KHR_DF_SAMPLE_FLOAT; break;
+				default: return false;
+			}
+
+			static const uint32_t rgba[4] = { KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_GREEN, KHR_DF_CHANNEL_BLUE, KHR_DF_CHANNEL_ALPHA };
+			static const uint32_t bgra[4] = { KHR_DF_CHANNEL_BLUE, KHR_DF_CHANNEL_GREEN, KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_ALPHA };
+			const uint32_t* channels = rgba;
+
+			switch (glFormat)
+			{
+				case GL_RED:  case GL_RED_INTEGER:  sampleCount = 1; break;
+				case GL_RG:   case GL_RG_INTEGER:   sampleCount = 2; break;
+				case GL_RGB:  case GL_RGB_INTEGER:  sampleCount = 3; break;
+				case GL_RGBA: case GL_RGBA_INTEGER: sampleCount = 4; break;
+				case GL_BGR:  case GL_BGR_INTEGER:  sampleCount = 3; channels = bgra; break;
+				case GL_BGRA: case GL_BGRA_INTEGER: sampleCount = 4; channels = bgra; break;
+				default: return false;
+			}
+
+			for (uint32_t i = 0; i < sampleCount; ++i)
+			{
+				set_sample(samples[i], i * bits, bits, channels[i] | qualifiers);
+			}
+
+			return true;
+		}
+	}
+
+	// Builds the Data Format Descriptor for a KTX2 file, including the leading dfdTotalSize. Pass nullptr to only
+	// query the size, which is never more than 92 bytes. Returns 0 for formats ktxpp can't describe
+	inline uint32_t encode_dfd(const Descriptor& desc, unsigned char* dfdData)
+	{
+		SampleDFD samples[4];
+		uint32_t sampleCount = 0;
+		uint32_t colorModel = KHR_DF_MODEL_RGBSDA;
+
+		if (desc.compressed)
+		{
+			colorModel = get_compressed_samples(desc.glInternalFormat, samples, sampleCount);
+
+			if (colorModel == 0)
+			{
+				return 0;
+			}
+		}
+		else if (!get_uncompressed_samples(desc.glFormat, desc.glType, samples, sampleCount))
+		{
+			return 0;
+		}
+
+		uint32_t blockSize = 24 + 16 * sampleCount;
+		uint32_t totalSize = 4 + blockSize;
+
+		if (dfdData == nullptr)
+		{
+			return totalSize;
+		}
+
+		bool isInteger = desc.glFormat == GL_RED_INTEGER || desc.glFormat == GL_RG_INTEGER || desc.glFormat == GL_RGB_INTEGER || desc.glFormat == GL_RGBA_INTEGER ||
+		                 desc.glFormat == GL_BGR_INTEGER || desc.glFormat == GL_BGRA_INTEGER;
+
+		uint32_t words[4 + 24 / 4 + 4 * 4] = {};
+		words[0] = totalSize;
+		words[1] = 0; // Khronos vendor, basic descriptor type
+		words[2] = 2 | (blockSize << 16); // Version 1.3
+		words[3] = colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | ((desc.srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16);
+		words[4] = (desc.blockWidth - 1) | ((desc.blockHeight - 1) << 8);
+		words[5] = desc.bitsPerPixelOrBlock / 8;
+
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			const SampleDFD& sample = samples[i];
+			uint32_t* sampleWords = &words[7 + i * 4];
+
+			bool isSigned = (sample.channelType & KHR_DF_SAMPLE_SIGNED) != 0;
+			bool isFloat = (sample.channelType & KHR_DF_SAMPLE_FLOAT) != 0;
+			uint32_t channelType = sample.channelType;
+
+			// Alpha is always linear even in sRGB formats
+			if (desc.srgb && (channelType & 0xf) == KHR_DF_CHANNEL_ALPHA)
+			{
+				channelType |= KHR_DF_SAMPLE_LINEAR;
+			}
+
+			sampleWords[0] = sample.bitOffset | ((sample.bitLength - 1) << 16) | (channelType << 24);
+			sampleWords[1] = 0; // Sample position
+
+			if (isFloat)
+			{
+				sampleWords[2] = 0xBF800000; // -1.0f
+				sampleWords[3] = 0x3F800000; // 1.0f
+			}
+			else if (isInteger)
+			{
+				sampleWords[2] = isSigned ? 0xFFFFFFFF : 0;
+				sampleWords[3] = 1;
+			}
+			else if (desc.compressed || sample.bitLength >= 32)
+			{
+				sampleWords[2] = isSigned ? 0x80000000 : 0;
+				sampleWords[3] = isSigned ? 0x7FFFFFFF : 0xFFFFFFFF;
+			}
+			else
+			{
+				uint32_t maxValue = (1u << sample.bitLength) - 1;
+				sampleWords[2] = isSigned ? (uint32_t)(-(int32_t)(maxValue >> 1)) : 0;
+				sampleWords[3] = isSigned ? (maxValue >> 1) : maxValue;
+			}
+		}
+
+		memcpy(dfdData, words, totalSize);
+
+		return totalSize;
+	}
+
+	// Every buffer ktxpp allocates (file buffers, decoded images, scratch) goes through one of these. userData is
+	// passed back to both functions. deallocate may be null for allocators that free everything at once
+	struct Allocator
+	{
+		void* (*allocate)(void* userData, size_t size, size_t alignment);
+		void  (*deallocate)(void* userData, void* pointer, size_t size);
+		void* userData;
+	};
+
+	namespace internal
+	{
+		// Over-allocates and stores the original pointer right before the aligned one
+		inline void* default_allocate(void*, size_t size, size_t alignment)
+		{
+			if (alignment < sizeof(void*)) { alignment = sizeof(void*); }
+
+			unsigned char* memory = static_cast<unsigned char*>(malloc(size + alignment + sizeof(void*)));
+
+			if (memory == nullptr)
+			{
+				return nullptr;
+			}
+
+			uintptr_t aligned = ((uintptr_t)(memory + sizeof(void*)) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			memcpy((void*)(aligned - sizeof(void*)), &memory, sizeof(void*));
+			return (void*)aligned;
+		}
+
+		inline void default_deallocate(void*, void* pointer, size_t)
+		{
+			if (pointer != nullptr)
+			{
+				void* memory;
+				memcpy(&memory, static_cast<unsigned char*>(pointer) - sizeof(void*), sizeof(void*));
+				free(memory);
+			}
+		}
+	}
+
+	inline Allocator get_default_allocator()
+	{
+		Allocator allocator = { default_allocate, default_deallocate, nullptr };
+		return allocator;
+	}
+
+	inline void* allocate(const Allocator& allocator, size_t size, size_t alignment = 16)
+	{
+		return allocator.allocate(allocator.userData, size, alignment);
+	}
+
+	inline void deallocate(const Allocator& allocator, void* pointer, size_t size)
+	{
+		if (allocator.deallocate != nullptr)
+		{
+			allocator.deallocate(allocator.userData, pointer, size);
+		}
+	}
+
+	// Bump allocator for frame or batch scoped memory. Individual deallocations are ignored and reset_arena releases
+	// everything in O(1) while keeping the chunks around for the next frame. It either grows by requesting chunks from
+	// a parent allocator or works inside a fixed slab supplied by the caller. Not thread safe, use one arena per thread
+	struct ArenaAllocator
+	{
+		struct Chunk
+		{
+			Chunk* next;
+			size_t size; // Including this header
+		};
+
+		Allocator parent; // parent.allocate is null for a fixed slab
+		size_t chunkSize;
+		Chunk* first;
+		Chunk* current;
+		unsigned char* cursor;
+		unsigned char* end;
+	};
+
+	inline void initialize_arena(ArenaAllocator& arena, const Allocator& parent, size_t chunkSize)
+	{
+		arena.parent    = parent;
+		arena.chunkSize = chunkSize;
+		arena.first     = nullptr;
+		arena.current   = nullptr;
+		arena.cursor    = nullptr;
+		arena.end       = nullptr;
+	}
+
+	// The arena lives entirely inside memory and never grows. Allocations fail once it is full
+	inline void initialize_arena(ArenaAllocator& arena, void* memory, size_t size)
+	{
+		Allocator noParent = { nullptr, nullptr, nullptr };
+		initialize_arena(arena, noParent, size);
+
+		if (size >= sizeof(ArenaAllocator::Chunk))
+		{
+			arena.first = static_cast<ArenaAllocator::Chunk*>(memory);
+			arena.first->next = nullptr;
+			arena.first->size = size;
+			arena.current = arena.first;
+			arena.cursor  = reinterpret_cast<unsigned char*>(arena.first + 1);
+			arena.end     = static_cast<unsigned char*>(memory) + size;
+		}
+	}
+
+	inline void* arena_allocate(ArenaAllocator& arena, size_t size, size_t alignment)
+	{
+		uintptr_t aligned = ((uintptr_t)arena.cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+		if (arena.cursor != nullptr && aligned + size <= (uintptr_t)arena.end)
+		{
+			arena.cursor = (unsigned char*)(aligned + size);
+			return (void*)aligned;
+		}
+
+		typedef ArenaAllocator::Chunk Chunk;
+		size_t requiredSize = sizeof(Chunk) + size + alignment;
+
+		// Reuse the chunks left over from before the last reset if the allocation fits
+		Chunk* next = arena.current != nullptr ? arena.current->next : arena.first;
+
+		if (next == nullptr || next->size < requiredSize)
+		{
+			if (arena.parent.allocate == nullptr)
+			{
+				return nullptr;
+			}
+
+			size_t newSize = requiredSize > arena.chunkSize ? requiredSize : arena.chunkSize;
+			Chunk* chunk = static_cast<Chunk*>(arena.parent.allocate(arena.parent.userData, newSize, 16));
+
+			if (chunk == nullptr)
+			{
+				return nullptr;
+			}
+
+			chunk->size = newSize;
+			chunk->next = next;
+
+			if (arena.current != nullptr) { arena.current->next = chunk; }
+			else                          { arena.first = chunk; }
+
+			next = chunk;
+		}
+
+		arena.current = next;
+		arena.cursor  = reinterpret_cast<unsigned char*>(next + 1);
+		arena.end     = reinterpret_cast<unsigned char*>(next) + next->size;
+
+		return arena_allocate(arena, size, alignment);
+	}
+
+	// Frees every allocation at once. Chunks are kept and reused
+	inline void reset_arena(ArenaAllocator& arena)
+	{
+		arena.current = arena.first;
+		arena.cursor  = arena.first != nullptr ? reinterpret_cast<unsigned char*>(arena.first + 1) : nullptr;
+		arena.end     = arena.first != nullptr ? reinterpret_cast<unsigned char*>(arena.first) + arena.first->size : nullptr;
+	}
+
+	// Returns all chunks to the parent allocator. A caller supplied slab is simply reset
+	inline void release_arena(ArenaAllocator& arena)
+	{
+		if (arena.parent.allocate != nullptr)
+		{
+			ArenaAllocator::Chunk* chunk = arena.first;
+
+			while (chunk != nullptr)
+			{
+				ArenaAllocator::Chunk* next = chunk->next;
+				deallocate(arena.parent, chunk, chunk->size);
+				chunk = next;
+			}
+
+			initialize_arena(arena, arena.parent, arena.chunkSize);
+		}
+		else
+		{
+			reset_arena(arena);
+		}
+	}
+
+	namespace internal
+	{
+		inline void* arena_allocate_callback(void* userData, size_t size, size_t alignment)
+		{
+			return arena_allocate(*static_cast<ArenaAllocator*>(userData), size, alignment);
+		}
+	}
+
+	inline Allocator get_arena_allocator(ArenaAllocator& arena)
+	{
+		Allocator allocator = { arena_allocate_callback, nullptr, &arena };
+		return allocator;
+	}
+
+	// Adapter so standard containers can use a ktxpp allocator
+	template<typename T>
+	struct StlAllocator
+	{
+		typedef T value_type;
+
+		Allocator allocator;
+
+		StlAllocator() : allocator(get_default_allocator()) {}
+		StlAllocator(const Allocator& allocator) : allocator(allocator) {}
+		template<typename U> StlAllocator(const StlAllocator<U>& other) : allocator(other.allocator) {}
+
+		T* allocate(size_t count)
+		{
+			void* pointer = ktxpp::allocate(allocator, count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+			if (pointer == nullptr) { throw std::bad_alloc(); }
+			return static_cast<T*>(pointer);
+		}
+
+		void deallocate(T* pointer, size_t count) { ktxpp::deallocate(allocator, pointer, count * sizeof(T)); }
+
+		template<typename U> bool operator == (const StlAllocator<U>& other) const { return allocator.allocate == other.allocator.allocate && allocator.userData == other.allocator.userData; }
+		template<typename U> bool operator != (const StlAllocator<U>& other) const { return !(*this == other); }
+	};
 }
\ No newline at end of file
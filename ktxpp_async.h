@@ -0,0 +1,850 @@
+#pragma once
+
+// Asynchronous texture loader. A texture is opened by reading its 64-byte header, which is validated and turned into
+// a subresource layout the moment it lands. Mip levels (and optionally the key/value data) are then read on demand
+// straight into their place in a buffer laid out like the file, so decode or upload of one level can overlap the
+// reads of the next ones.
+//
+// On Linux reads go through io_uring, talking to the kernel directly so liburing isn't needed. Where io_uring is
+// unavailable (older kernels, seccomp filters, other platforms, or ktxpp_no_io_uring defined) a small thread pool
+// issues positional reads instead. Either way every callback runs on the thread that calls process_async_loader
+
+#include "ktxpp.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(ktxpp_no_io_uring)
+	#define ktxpp_io_uring
+	#include <linux/io_uring.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <sys/uio.h>
+#endif
+
+namespace ktxpp
+{
+	enum AsyncStatus
+	{
+		AsyncSuccess,
+		AsyncOpenFailed,
+		AsyncReadFailed,
+		AsyncInvalidFile,     // See AsyncTexture::validation
+		AsyncOutOfMemory,
+	};
+
+	enum AsyncBackend
+	{
+		AsyncBackendIoUring,
+		AsyncBackendThreadPool,
+	};
+
+	// Passed as the mip of callbacks that aren't about a mip level
+	static ktxpp_constexpr uint32_t AsyncHeader       = 0xffffffffu;
+	static ktxpp_constexpr uint32_t AsyncKeyValueData = 0xfffffffeu;
+
+	struct AsyncTexture;
+
+	// mip is a level index, AsyncHeader or AsyncKeyValueData
+	typedef void (*AsyncCallback)(void* userData, AsyncTexture& texture, uint32_t mip, AsyncStatus status);
+
+	struct AsyncTexture
+	{
+		AsyncStatus status; // Of the header read
+		ValidationResult validation;
+
+		// Valid once the header callback reports AsyncSuccess
+		internal::HeaderKTX header;
+		Descriptor desc;
+		Subresource* subresources; // get_subresource_count(desc) entries
+		unsigned char* data; // Laid out like the file, levels land at their subresource offsets
+		uint64_t dataSize;
+		uint64_t fileSize;
+
+		void* userData; // Free for the caller
+
+#if defined(_WIN32)
+		HANDLE file;
+#else
+		int file;
+#endif
+		uint32_t pendingReads;
+	};
+
+	struct AsyncLoaderOptions
+	{
+		uint32_t queueDepth = 64; // Reads in flight at once
+		uint32_t threadCount = 4; // Threads of the fallback backend
+		bool allowIoUring = true;
+		Allocator allocator = get_default_allocator(); // Texture buffers and bookkeeping
+	};
+
+	namespace internal
+	{
+		enum AsyncReadKind
+		{
+			AsyncReadHeader,
+			AsyncReadKeyValueData,
+			AsyncReadMip,
+		};
+
+		struct AsyncRead
+		{
+			AsyncTexture* texture;
+			AsyncReadKind kind;
+			uint32_t mip;
+			AsyncCallback callback;
+			void* callbackUserData;
+
+			unsigned char* destination;
+			uint64_t offset;
+			uint64_t remaining;
+			int64_t result; // Bytes read by the last request, negative on error
+			// get_instrument_time when the read was queued, and its size, for StageIO. There without ktxpp_instrument
+			// too, so translation units built with and without it agree on the layout
+			uint64_t queued;
+			uint64_t size;
+#if defined(ktxpp_io_uring)
+			struct iovec iov;
+#endif
+		};
+
+#if defined(ktxpp_io_uring)
+
+		// Minimal io_uring driver over the raw system calls. Only one thread submits and reaps
+		struct IoUring
+		{
+			int fd = -1;
+			unsigned entries = 0;
+			unsigned* sqHead = nullptr; unsigned* sqTail = nullptr; unsigned* sqMask = nullptr; unsigned* sqArray = nullptr;
+			unsigned* cqHead = nullptr; unsigned* cqTail = nullptr; unsigned* cqMask = nullptr;
+			io_uring_sqe* sqes = nullptr;
+			io_uring_cqe* cqes = nullptr;
+			void* sqRing = nullptr; size_t sqRingSize = 0;
+			void* cqRing = nullptr; size_t cqRingSize = 0;
+			size_t sqesSize = 0;
+			unsigned toSubmit = 0;
+		};
+
+		inline void release_io_uring(IoUring& ring)
+		{
+			if (ring.sqes != nullptr && ring.sqesSize > 0) { munmap(ring.sqes, ring.sqesSize); }
+			if (ring.cqRing != nullptr && ring.cqRing != ring.sqRing) { munmap(ring.cqRing, ring.cqRingSize); }
+			if (ring.sqRing != nullptr) { munmap(ring.sqRing, ring.sqRingSize); }
+			if (ring.fd >= 0) { close(ring.fd); }
+			ring = IoUring();
+		}
+
+		inline bool initialize_io_uring(IoUring& ring, unsigned entries)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+
+			ring.fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+
+			if (ring.fd < 0)
+			{
+				return false;
+			}
+
+			ring.entries = params.sq_entries;
+			ring.sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			ring.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+			// Since 5.4 both rings share one mapping
+			bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+			if (singleMap)
+			{
+				ring.sqRingSize = ring.sqRingSize > ring.cqRingSize ? ring.sqRingSize : ring.cqRingSize;
+			}
+
+			ring.sqRing = mmap(nullptr, ring.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+			ring.cqRing = singleMap ? ring.sqRing : mmap(nullptr, ring.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+			ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			ring.sqes = (io_uring_sqe*)mmap(nullptr, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+
+			if (ring.sqRing == MAP_FAILED || ring.cqRing == MAP_FAILED || ring.sqes == MAP_FAILED)
+			{
+				ring.sqRing = ring.sqRing == MAP_FAILED ? nullptr : ring.sqRing;
+				ring.cqRing = ring.cqRing == MAP_FAILED ? nullptr : ring.cqRing;
+				ring.sqes   = ring.sqes   == MAP_FAILED ? nullptr : ring.sqes;
+				release_io_uring(ring);
+				return false;
+			}
+
+			unsigned char* sq = (unsigned char*)ring.sqRing;
+			unsigned char* cq = (unsigned char*)ring.cqRing;
+			ring.sqHead  = (unsigned*)(sq + params.sq_off.head);
+			ring.sqTail  = (unsigned*)(sq + params.sq_off.tail);
+			ring.sqMask  = (unsigned*)(sq + params.sq_off.ring_mask);
+			ring.sqArray = (unsigned*)(sq + params.sq_off.array);
+			ring.cqHead  = (unsigned*)(cq + params.cq_off.head);
+			ring.cqTail  = (unsigned*)(cq + params.cq_off.tail);
+			ring.cqMask  = (unsigned*)(cq + params.cq_off.ring_mask);
+			ring.cqes    = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+			return true;
+		}
+
+		// Queues a read of the remaining range. READV rather than READ so kernels from 5.1 onwards work
+		inline bool push_io_uring_read(IoUring& ring, AsyncRead& read)
+		{
+			unsigned tail = *ring.sqTail;
+
+			if (tail - __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE) >= ring.entries)
+			{
+				return false;
+			}
+
+			// A single readv transfers at most 2GB so larger ranges are split by the short read handling
+			read.iov.iov_base = read.destination;
+			read.iov.iov_len  = (size_t)(read.remaining < 0x40000000u ? read.remaining : 0x40000000u);
+
+			unsigned index = tail & *ring.sqMask;
+			io_uring_sqe& sqe = ring.sqes[index];
+			memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode    = IORING_OP_READV;
+			sqe.fd        = read.texture->file;
+			sqe.addr      = (uint64_t)(uintptr_t)&read.iov;
+			sqe.len       = 1;
+			sqe.off       = read.offset;
+			sqe.user_data = (uint64_t)(uintptr_t)&read;
+
+			ring.sqArray[index] = index;
+			__atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+			ring.toSubmit++;
+
+			return true;
+		}
+
+		inline bool enter_io_uring(IoUring& ring, unsigned minComplete)
+		{
+			unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+			if (ring.toSubmit == 0 && minComplete == 0)
+			{
+				return true;
+			}
+
+			long result = syscall(__NR_io_uring_enter, ring.fd, ring.toSubmit, minComplete, flags, nullptr, 0);
+
+			if (result < 0)
+			{
+				return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+			}
+
+			ring.toSubmit -= (unsigned)result < ring.toSubmit ? (unsigned)result : ring.toSubmit;
+			return true;
+		}
+
+		// Takes back the reads the kernel hasn't consumed after io_uring_enter failed for good, oldest first
+		template<typename Function>
+		inline void cancel_io_uring_reads(IoUring& ring, const Function& function)
+		{
+			unsigned tail = *ring.sqTail - ring.toSubmit;
+
+			for (unsigned i = tail; i != *ring.sqTail; ++i)
+			{
+				function(*(AsyncRead*)(uintptr_t)ring.sqes[i & *ring.sqMask].user_data);
+			}
+
+			__atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+			ring.toSubmit = 0;
+		}
+
+		template<typename Function>
+		inline uint32_t reap_io_uring(IoUring& ring, const Function& function)
+		{
+			unsigned head = *ring.cqHead;
+			unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+			uint32_t count = 0;
+
+			for (; head != tail; ++head, ++count)
+			{
+				const io_uring_cqe& cqe = ring.cqes[head & *ring.cqMask];
+				AsyncRead& read = *(AsyncRead*)(uintptr_t)cqe.user_data;
+				read.result = cqe.res;
+				function(read);
+			}
+
+			__atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+			return count;
+		}
+
+#endif
+
+		// Positional read used by the thread pool. Loops over short reads, returns the bytes read or -1
+		inline int64_t read_file_at(const AsyncTexture& texture, unsigned char* destination, uint64_t offset, uint64_t size)
+		{
+			uint64_t total = 0;
+
+			while (total < size)
+			{
+				uint64_t chunk = size - total < 0x40000000u ? size - total : 0x40000000u;
+#if defined(_WIN32)
+				OVERLAPPED overlapped;
+				memset(&overlapped, 0, sizeof(overlapped));
+				overlapped.Offset     = (DWORD)(offset + total);
+				overlapped.OffsetHigh = (DWORD)((offset + total) >> 32);
+
+				DWORD bytesRead = 0;
+
+				if (!ReadFile(texture.file, destination + total, (DWORD)chunk, &bytesRead, &overlapped))
+				{
+					return GetLastError() == ERROR_HANDLE_EOF ? (int64_t)total : -1;
+				}
+#else
+				ssize_t bytesRead = pread(texture.file, destination + total, (size_t)chunk, (off_t)(offset + total));
+
+				if (bytesRead < 0)
+				{
+					if (errno == EINTR) { continue; }
+					return -1;
+				}
+#endif
+				if (bytesRead == 0)
+				{
+					break;
+				}
+
+				total += (uint64_t)bytesRead;
+			}
+
+			return (int64_t)total;
+		}
+	}
+
+	struct AsyncLoader
+	{
+		AsyncLoaderOptions options;
+		AsyncBackend backend;
+
+		std::deque<internal::AsyncRead*> pending; // Not yet handed to the backend
+		uint32_t inFlight;
+
+#if defined(ktxpp_io_uring)
+		internal::IoUring ring;
+#endif
+
+		// Thread pool backend
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable workCompleted;
+		std::deque<internal::AsyncRead*> work;
+		std::deque<internal::AsyncRead*> completed; // Also io_uring reads that couldn't be submitted
+		bool quit;
+	};
+
+	namespace internal
+	{
+		inline void async_worker(AsyncLoader& loader)
+		{
+			std::unique_lock<std::mutex> lock(loader.mutex);
+
+			for (;;)
+			{
+				loader.workAvailable.wait(lock, [&]() { return loader.quit || !loader.work.empty(); });
+
+				if (loader.quit)
+				{
+					return;
+				}
+
+				AsyncRead* read = loader.work.front();
+				loader.work.pop_front();
+				lock.unlock();
+
+				read->result = read_file_at(*read->texture, read->destination, read->offset, read->remaining);
+
+				lock.lock();
+				loader.completed.push_back(read);
+				loader.workCompleted.notify_one();
+			}
+		}
+
+		// Returns false if the read couldn't be allocated
+		inline bool queue_read(AsyncLoader& loader, AsyncTexture& texture, AsyncReadKind kind, uint32_t mip, uint64_t offset, uint64_t size, unsigned char* destination, AsyncCallback callback, void* userData)
+		{
+			void* memory = allocate(loader.options.allocator, sizeof(AsyncRead), alignof(AsyncRead));
+
+			if (memory == nullptr)
+			{
+				return false;
+			}
+
+			AsyncRead* read = new (memory) AsyncRead();
+			read->texture          = &texture;
+			read->kind             = kind;
+			read->mip              = mip;
+			read->callback         = callback;
+			read->callbackUserData = userData;
+			read->destination      = destination;
+			read->offset           = offset;
+			read->remaining        = size;
+			read->result           = 0;
+			read->size             = size;
+#if defined(ktxpp_instrument)
+			read->queued           = get_instrument_time();
+#else
+			read->queued           = 0;
+#endif
+
+			texture.pendingReads++;
+			loader.pending.push_back(read);
+
+			return true;
+		}
+
+		// Reports a read that never reached the backend. Its callback runs before the call that asked for it returns
+		inline void fail_read(AsyncTexture& texture, uint32_t mip, AsyncStatus status, AsyncCallback callback, void* userData)
+		{
+			if (callback != nullptr)
+			{
+				callback(userData, texture, mip, status);
+			}
+		}
+
+		// Hands pending reads to the backend, up to the queue depth
+		inline void submit_reads(AsyncLoader& loader)
+		{
+#if defined(ktxpp_io_uring)
+			if (loader.backend == AsyncBackendIoUring)
+			{
+				while (!loader.pending.empty() && loader.inFlight < loader.options.queueDepth && push_io_uring_read(loader.ring, *loader.pending.front()))
+				{
+					loader.pending.pop_front();
+					loader.inFlight++;
+				}
+
+				// A ring that stops accepting work fails what it didn't take, so inFlight still drains
+				if (!enter_io_uring(loader.ring, 0))
+				{
+					cancel_io_uring_reads(loader.ring, [&](AsyncRead& read) { read.result = -1; loader.completed.push_back(&read); });
+				}
+
+				return;
+			}
+#endif
+			if (!loader.pending.empty())
+			{
+				std::lock_guard<std::mutex> lock(loader.mutex);
+
+				while (!loader.pending.empty())
+				{
+					loader.work.push_back(loader.pending.front());
+					loader.pending.pop_front();
+					loader.inFlight++;
+				}
+
+				loader.workAvailable.notify_all();
+			}
+		}
+
+		inline void complete_header(AsyncLoader& loader, AsyncTexture& texture)
+		{
+			ktxpp_stage(StageParse, "complete_header");
+			ktxpp_stage_work(sizeof(HeaderKTX), 0);
+
+			texture.validation = validate_header(texture.header, texture.desc);
+
+			if (texture.validation != ValidationSuccess)
+			{
+				texture.status = AsyncInvalidFile;
+				return;
+			}
+
+			uint32_t subresourceCount = get_subresource_count(texture.desc);
+			texture.subresources = (Subresource*)allocate(loader.options.allocator, subresourceCount * sizeof(Subresource), alignof(Subresource));
+
+			if (texture.subresources == nullptr)
+			{
+				texture.status = AsyncOutOfMemory;
+				return;
+			}
+
+			texture.dataSize = compute_subresource_layout(texture.desc, get_image_data_offset(texture.header), texture.subresources);
+
+			// Only the padding after the last level may be missing
+			const Subresource& last = texture.subresources[subresourceCount - 1];
+
+			if (texture.fileSize < last.offset + last.size)
+			{
+				texture.validation = ValidationTruncated;
+				texture.status = AsyncInvalidFile;
+				return;
+			}
+
+			texture.data = (unsigned char*)allocate(loader.options.allocator, (size_t)texture.dataSize, 16);
+
+			if (texture.data == nullptr)
+			{
+				texture.status = AsyncOutOfMemory;
+				return;
+			}
+
+			memcpy(texture.data, &texture.header, sizeof(HeaderKTX));
+			texture.status = AsyncSuccess;
+		}
+
+		inline AsyncStatus complete_mip(AsyncTexture& texture, uint32_t mip)
+		{
+			uint64_t expectedSize, levelSize;
+
+			if (!get_level_size(texture.desc, mip, expectedSize, levelSize))
+			{
+				texture.validation = ValidationInvalidHeader;
+				return AsyncInvalidFile;
+			}
+
+			uint32_t imageSize;
+			memcpy(&imageSize, texture.data + texture.subresources[get_subresource_index(texture.desc, mip, 0, 0)].offset - sizeof(uint32_t), sizeof(uint32_t));
+
+			if (imageSize != expectedSize)
+			{
+				texture.validation = ValidationImageSizeMismatch;
+				return AsyncInvalidFile;
+			}
+
+			return AsyncSuccess;
+		}
+
+		inline void complete_key_value_data(AsyncTexture& texture)
+		{
+			const unsigned char* cursor = texture.data + sizeof(HeaderKTX);
+			const unsigned char* keyValueEnd = cursor + texture.header.bytesOfKeyValueData;
+			KeyValue keyValue;
+
+			while (next_key_value(cursor, keyValueEnd, keyValue)) {}
+
+			if (cursor != keyValueEnd)
+			{
+				texture.validation = ValidationInvalidKeyValueData;
+			}
+		}
+
+		// Runs the callback of a read that finished, or requeues the rest of it after a short read
+		inline void complete_read(AsyncLoader& loader, AsyncRead* read)
+		{
+			loader.inFlight--;
+
+			if (read->result > 0 && (uint64_t)read->result < read->remaining)
+			{
+				read->destination += read->result;
+				read->offset      += (uint64_t)read->result;
+				read->remaining   -= (uint64_t)read->result;
+				loader.pending.push_front(read);
+				return;
+			}
+
+			AsyncTexture& texture = *read->texture;
+			AsyncStatus status = read->result >= 0 && (uint64_t)read->result == read->remaining ? AsyncSuccess : AsyncReadFailed;
+
+#if defined(ktxpp_instrument)
+			record_stage(StageIO, read->kind == AsyncReadHeader ? "async_read_header" : (read->kind == AsyncReadMip ? "async_read_mip" : "async_read_key_value_data"), read->queued, status == AsyncSuccess ? read->size : 0, 0);
+#endif
+
+			if (read->kind == AsyncReadHeader)
+			{
+				if (status == AsyncSuccess)
+				{
+					complete_header(loader, texture);
+				}
+				else
+				{
+					texture.validation = ValidationTruncated;
+					texture.status = status;
+				}
+
+				status = texture.status;
+			}
+			else if (status == AsyncSuccess && read->kind == AsyncReadMip)
+			{
+				status = complete_mip(texture, read->mip);
+			}
+			else if (status == AsyncSuccess && read->kind == AsyncReadKeyValueData)
+			{
+				complete_key_value_data(texture);
+				status = texture.validation == ValidationSuccess ? AsyncSuccess : AsyncInvalidFile;
+			}
+
+			texture.pendingReads--;
+
+			uint32_t mip = read->kind == AsyncReadHeader ? AsyncHeader : (read->kind == AsyncReadKeyValueData ? AsyncKeyValueData : read->mip);
+			AsyncCallback callback = read->callback;
+			void* userData = read->callbackUserData;
+
+			deallocate(loader.options.allocator, read, sizeof(AsyncRead));
+
+			if (callback != nullptr)
+			{
+				callback(userData, texture, mip, status);
+			}
+		}
+	}
+
+	inline void initialize_async_loader(AsyncLoader& loader, const AsyncLoaderOptions& options = AsyncLoaderOptions())
+	{
+		loader.options = options;
+		loader.options.queueDepth = options.queueDepth > 0 ? options.queueDepth : 1;
+		loader.backend = AsyncBackendThreadPool;
+		loader.inFlight = 0;
+		loader.quit = false;
+
+#if defined(ktxpp_io_uring)
+		if (options.allowIoUring && initialize_io_uring(loader.ring, loader.options.queueDepth))
+		{
+			loader.backend = AsyncBackendIoUring;
+			loader.options.queueDepth = loader.options.queueDepth < loader.ring.entries ? loader.options.queueDepth : loader.ring.entries;
+			return;
+		}
+#endif
+
+		uint32_t threadCount = options.threadCount > 0 ? options.threadCount : 1;
+
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			loader.threads.emplace_back([&loader]() { internal::async_worker(loader); });
+		}
+	}
+
+	// Runs callbacks for finished reads and submits queued ones. With wait it blocks until at least one callback has
+	// run, unless there is nothing in flight. Returns the number of callbacks that ran
+	inline uint32_t process_async_loader(AsyncLoader& loader, bool wait)
+	{
+		internal::submit_reads(loader);
+
+		std::vector<internal::AsyncRead*> finished;
+
+#if defined(ktxpp_io_uring)
+		if (loader.backend == AsyncBackendIoUring)
+		{
+			internal::reap_io_uring(loader.ring, [&](internal::AsyncRead& read) { finished.push_back(&read); });
+
+			if (finished.empty() && loader.completed.empty() && wait && loader.inFlight > 0)
+			{
+				// Reads the kernel already took still complete into the ring, so after an error keep polling it
+				if (!internal::enter_io_uring(loader.ring, 1))
+				{
+					internal::cancel_io_uring_reads(loader.ring, [&](internal::AsyncRead& read) { read.result = -1; loader.completed.push_back(&read); });
+					std::this_thread::yield();
+				}
+
+				internal::reap_io_uring(loader.ring, [&](internal::AsyncRead& read) { finished.push_back(&read); });
+			}
+
+			finished.insert(finished.end(), loader.completed.begin(), loader.completed.end());
+			loader.completed.clear();
+		}
+		else
+#endif
+		{
+			std::unique_lock<std::mutex> lock(loader.mutex);
+
+			if (wait && loader.inFlight > 0)
+			{
+				loader.workCompleted.wait(lock, [&]() { return !loader.completed.empty(); });
+			}
+
+			finished.assign(loader.completed.begin(), loader.completed.end());
+			loader.completed.clear();
+		}
+
+		uint32_t callbacks = 0;
+
+		for (internal::AsyncRead* read : finished)
+		{
+			bool shortRead = read->result > 0 && (uint64_t)read->result < read->remaining;
+			internal::complete_read(loader, read);
+			callbacks += shortRead ? 0 : 1;
+		}
+
+		// Reads queued by the callbacks go out before returning so they overlap with whatever the caller does next
+		internal::submit_reads(loader);
+
+		return callbacks;
+	}
+
+	// Processes until every queued read has finished and its callback has run
+	inline void wait_async_loader(AsyncLoader& loader)
+	{
+		while (loader.inFlight > 0 || !loader.pending.empty())
+		{
+			process_async_loader(loader, true);
+		}
+	}
+
+	// Opens a file and reads its header. The callback gets AsyncHeader as the mip, and on AsyncSuccess the texture
+	// has its descriptor, subresource table and data buffer ready for async_read_mip. The texture stays valid until
+	// async_close_texture, even if opening failed. Only when the texture itself can't be allocated is nullptr returned,
+	// without running the callback
+	inline AsyncTexture* async_open_texture(AsyncLoader& loader, const char* path, AsyncCallback callback, void* userData)
+	{
+		AsyncTexture* texture = (AsyncTexture*)allocate(loader.options.allocator, sizeof(AsyncTexture), alignof(AsyncTexture));
+
+		if (texture == nullptr)
+		{
+			return nullptr;
+		}
+
+		memset(texture, 0, sizeof(AsyncTexture));
+		texture->validation = ValidationSuccess;
+
+#if defined(_WIN32)
+		texture->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size;
+		bool opened = texture->file != INVALID_HANDLE_VALUE && GetFileSizeEx(texture->file, &size);
+		texture->fileSize = opened ? (uint64_t)size.QuadPart : 0;
+#else
+		texture->file = open(path, O_RDONLY | O_CLOEXEC);
+		struct stat status;
+		bool opened = texture->file >= 0 && fstat(texture->file, &status) == 0;
+		texture->fileSize = opened ? (uint64_t)status.st_size : 0;
+#endif
+
+		if (!opened)
+		{
+			texture->status = AsyncOpenFailed;
+
+			if (callback != nullptr)
+			{
+				callback(userData, *texture, AsyncHeader, AsyncOpenFailed);
+			}
+
+			return texture;
+		}
+
+		if (!internal::queue_read(loader, *texture, internal::AsyncReadHeader, AsyncHeader, 0, sizeof(internal::HeaderKTX), (unsigned char*)&texture->header, callback, userData))
+		{
+			texture->status = AsyncOutOfMemory;
+			internal::fail_read(*texture, AsyncHeader, AsyncOutOfMemory, callback, userData);
+			return texture;
+		}
+
+		internal::submit_reads(loader);
+
+		return texture;
+	}
+
+	// Reads one mip level, every layer and face, into texture.data. The imageSize field is checked when it lands. A
+	// level whose size can't be computed fails with AsyncInvalidFile and a read that can't be allocated with
+	// AsyncOutOfMemory, either way with the callback running before this returns
+	inline void async_read_mip(AsyncLoader& loader, AsyncTexture& texture, uint32_t mip, AsyncCallback callback, void* userData)
+	{
+		assert(texture.status == AsyncSuccess && mip < get_mip_count(texture.desc));
+
+		uint64_t imageSize, levelSize;
+
+		if (!get_level_size(texture.desc, mip, imageSize, levelSize))
+		{
+			texture.validation = ValidationInvalidHeader;
+			internal::fail_read(texture, mip, AsyncInvalidFile, callback, userData);
+			return;
+		}
+
+		// Includes the imageSize field but not the mipPadding, which may be missing after the last level
+		uint64_t offset = texture.subresources[get_subresource_index(texture.desc, mip, 0, 0)].offset - sizeof(uint32_t);
+		uint64_t size = sizeof(uint32_t) + levelSize;
+
+		// The padding after the last face of a cubemap may be missing as well
+		size = offset + size <= texture.fileSize ? size : texture.fileSize - offset;
+
+		if (!internal::queue_read(loader, texture, internal::AsyncReadMip, mip, offset, size, texture.data + offset, callback, userData))
+		{
+			internal::fail_read(texture, mip, AsyncOutOfMemory, callback, userData);
+			return;
+		}
+
+		internal::submit_reads(loader);
+	}
+
+	// Reads the key/value data into texture.data, right after the header, for next_key_value to walk. A read that can't
+	// be allocated fails with AsyncOutOfMemory before this returns
+	inline void async_read_key_value_data(AsyncLoader& loader, AsyncTexture& texture, AsyncCallback callback, void* userData)
+	{
+		assert(texture.status == AsyncSuccess);
+
+		uint32_t size = texture.header.bytesOfKeyValueData;
+		if (!internal::queue_read(loader, texture, internal::AsyncReadKeyValueData, AsyncKeyValueData, sizeof(internal::HeaderKTX), size, texture.data + sizeof(internal::HeaderKTX), callback, userData))
+		{
+			internal::fail_read(texture, AsyncKeyValueData, AsyncOutOfMemory, callback, userData);
+			return;
+		}
+
+		internal::submit_reads(loader);
+	}
+
+	// Closes the file and frees the buffers. No reads of this texture may be in flight
+	inline void async_close_texture(AsyncLoader& loader, AsyncTexture* texture)
+	{
+		if (texture == nullptr)
+		{
+			return;
+		}
+
+		assert(texture->pendingReads == 0);
+
+#if defined(_WIN32)
+		if (texture->file != INVALID_HANDLE_VALUE && texture->file != nullptr) { CloseHandle(texture->file); }
+#else
+		if (texture->file >= 0) { close(texture->file); }
+#endif
+
+		if (texture->subresources != nullptr)
+		{
+			deallocate(loader.options.allocator, texture->subresources, get_subresource_count(texture->desc) * sizeof(Subresource));
+		}
+
+		if (texture->data != nullptr)
+		{
+			deallocate(loader.options.allocator, texture->data, (size_t)texture->dataSize);
+		}
+
+		deallocate(loader.options.allocator, texture, sizeof(AsyncTexture));
+	}
+
+	// Waits for outstanding reads, then stops the backend
+	inline void release_async_loader(AsyncLoader& loader)
+	{
+		wait_async_loader(loader);
+
+#if defined(ktxpp_io_uring)
+		if (loader.backend == AsyncBackendIoUring)
+		{
+			internal::release_io_uring(loader.ring);
+		}
+#endif
+
+		{
+			std::lock_guard<std::mutex> lock(loader.mutex);
+			loader.quit = true;
+			loader.workAvailable.notify_all();
+		}
+
+		for (std::thread& thread : loader.threads)
+		{
+			thread.join();
+		}
+
+		loader.threads.clear();
+	}
+}
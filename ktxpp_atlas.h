@@ -0,0 +1,375 @@
+#pragma once
+
+// Texture atlases built from already encoded KTX 1.1 textures. Every image is placed on a whole number of blocks of
+// the shared format, so building the atlas is copying blocks and nothing is re-encoded. With mipCount above 1 the
+// placements are aligned so each mip of each image lands on whole blocks too and its mips are copied the same way.
+//
+// Images are packed with a skyline bottom-left packer, tallest first, trying each power of two width up to maxWidth
+// and keeping the smallest atlas. Images are never rotated, a rotated block would need re-encoding. PVRTC blocks
+// depend on their neighbours and can't be moved, so PVRTC textures are rejected
+
+#include "ktxpp.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ktxpp
+{
+	enum AtlasResult
+	{
+		AtlasSuccess,
+		AtlasInvalidImage,     // An image given to the builder failed validate_header
+		AtlasUnsupportedImage, // Not a single 2D image, fewer mips than the atlas, or PVRTC
+		AtlasMismatchedFormat, // Every image must have the format of the first
+		AtlasEmpty,
+		AtlasTooLarge,         // The images don't fit in maxWidth x maxHeight
+	};
+
+	// Where an image ended up, in texels of mip 0
+	struct AtlasPlacement
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	namespace internal
+	{
+		struct AtlasSource
+		{
+			const unsigned char* data;
+			Descriptor desc;
+			uint64_t imageDataOffset;
+		};
+
+		// A run of the skyline, in cells
+		struct SkylineSegment
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+		};
+	}
+
+	struct AtlasBuilder
+	{
+		uint32_t maxWidth = 4096;
+		uint32_t maxHeight = 4096;
+		uint32_t mipCount = 1;
+		uint32_t padding = 0; // Texels kept clear right of and below each image, before rounding up to whole blocks
+		bool powerOfTwo = false; // Round the height up to a power of two as well as the width
+		std::vector<internal::AtlasSource> images;
+	};
+
+	// Only the pointer is kept, so the data must stay alive until the atlas is built
+	inline AtlasResult add_atlas_image(AtlasBuilder& builder, const unsigned char* data, uint64_t size)
+	{
+		internal::AtlasSource source;
+		source.data = data;
+
+		if (validate_header(data, size, source.desc) != ValidationSuccess)
+		{
+			return AtlasInvalidImage;
+		}
+
+		const Descriptor& desc = source.desc;
+
+		switch (desc.glInternalFormat)
+		{
+			case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG: case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
+			case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG: case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
+			case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG: case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
+			case GL_COMPRESSED_SRGB_PVRTC_2BPPV1: case GL_COMPRESSED_SRGB_PVRTC_4BPPV1:
+			case GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV1: case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV1:
+			case GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV2_IMG: case GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV2_IMG:
+				return AtlasUnsupportedImage;
+			default:
+				break;
+		}
+
+		if (desc.type != Texture2D || desc.arraySize != 1 || get_mip_count(desc) < builder.mipCount || desc.bitsPerPixelOrBlock == 0 || desc.bitsPerPixelOrBlock % 8 != 0)
+		{
+			return AtlasUnsupportedImage;
+		}
+
+		if (!builder.images.empty())
+		{
+			const Descriptor& first = builder.images[0].desc;
+
+			if (desc.glInternalFormat != first.glInternalFormat || desc.glFormat != first.glFormat || desc.glType != first.glType)
+			{
+				return AtlasMismatchedFormat;
+			}
+		}
+
+		HeaderKTX header;
+		memcpy(&header, data, sizeof(HeaderKTX));
+		source.imageDataOffset = get_image_data_offset(header);
+		builder.images.push_back(source);
+		return AtlasSuccess;
+	}
+
+	namespace internal
+	{
+		// Lowest position for a width x height rectangle, ties going left. Returns false if it doesn't fit anywhere
+		inline bool find_skyline_position(const std::vector<SkylineSegment>& skyline, uint32_t atlasWidth, uint32_t atlasHeight, uint32_t width, uint32_t height, uint32_t& bestIndex, uint32_t& bestY)
+		{
+			bool found = false;
+
+			for (uint32_t i = 0; i < skyline.size() && skyline[i].x + width <= atlasWidth; ++i)
+			{
+				// The rectangle rests on the highest segment under it
+				uint32_t y = 0, covered = 0;
+
+				for (uint32_t j = i; covered < width; ++j)
+				{
+					y = std::max(y, skyline[j].y);
+					covered += skyline[j].width;
+				}
+
+				if (y + height <= atlasHeight && (!found || y < bestY))
+				{
+					found = true;
+					bestIndex = i;
+					bestY = y;
+				}
+			}
+
+			return found;
+		}
+
+		inline void add_skyline_level(std::vector<SkylineSegment>& skyline, uint32_t index, uint32_t y, uint32_t width)
+		{
+			SkylineSegment segment = { skyline[index].x, y, width };
+			uint32_t end = segment.x + width;
+
+			// Segments under the new one shrink or go
+			uint32_t next = index;
+
+			while (next < skyline.size() && skyline[next].x + skyline[next].width <= end)
+			{
+				next++;
+			}
+
+			if (next < skyline.size() && skyline[next].x < end)
+			{
+				skyline[next].width -= end - skyline[next].x;
+				skyline[next].x = end;
+			}
+
+			skyline.erase(skyline.begin() + index, skyline.begin() + next);
+			skyline.insert(skyline.begin() + index, segment);
+
+			// Neighbours at the same height become one segment
+			for (uint32_t i = index > 0 ? index - 1 : 0; i + 1 < skyline.size() && i <= index + 1;)
+			{
+				if (skyline[i].y == skyline[i + 1].y)
+				{
+					skyline[i].width += skyline[i + 1].width;
+					skyline.erase(skyline.begin() + i + 1);
+				}
+				else
+				{
+					i++;
+				}
+			}
+		}
+
+		// Packs rectangles given in cells, in order, into an atlas atlasWidth cells wide. Returns the height used, or 0
+		// if they don't all fit below atlasHeight
+		inline uint32_t pack_skyline(const std::vector<uint32_t>& order, const std::vector<AtlasPlacement>& cells, uint32_t atlasWidth, uint32_t atlasHeight, std::vector<AtlasPlacement>& positions)
+		{
+			std::vector<SkylineSegment> skyline(1);
+			skyline[0].x = 0;
+			skyline[0].y = 0;
+			skyline[0].width = atlasWidth;
+			uint32_t usedHeight = 0;
+
+			for (uint32_t image : order)
+			{
+				uint32_t index = 0, y = 0;
+
+				if (!find_skyline_position(skyline, atlasWidth, atlasHeight, cells[image].width, cells[image].height, index, y))
+				{
+					return 0;
+				}
+
+				positions[image].x = skyline[index].x;
+				positions[image].y = y;
+				add_skyline_level(skyline, index, y + cells[image].height, cells[image].width);
+				usedHeight = std::max(usedHeight, y + cells[image].height);
+			}
+
+			return usedHeight;
+		}
+
+		inline uint32_t round_up_to_power_of_two(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result < value && result < 0x80000000u) { result <<= 1; }
+			return result;
+		}
+
+		// Unused blocks are cleared to transparent black. For ASTC that takes a void extent block, zeros would decode
+		// to the error colour
+		inline void get_atlas_clear_block(GLInternalFormat format, unsigned char* block, uint32_t size)
+		{
+			memset(block, 0, size);
+
+			if ((format >= GL_COMPRESSED_RGBA_ASTC_4x4 && format <= GL_COMPRESSED_RGBA_ASTC_12x12) ||
+				(format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4 && format <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12))
+			{
+				const unsigned char voidExtent[8] = { 0xFC, 0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+				memcpy(block, voidExtent, sizeof(voidExtent));
+			}
+		}
+	}
+
+	// Packs every image and writes the atlas as a KTX 1.1 file with builder.mipCount mips. placements gets one entry
+	// per image in the order they were added
+	inline AtlasResult build_atlas(const AtlasBuilder& builder, std::vector<unsigned char>& atlas, std::vector<AtlasPlacement>& placements)
+	{
+		if (builder.images.empty())
+		{
+			return AtlasEmpty;
+		}
+
+		const Descriptor& format = builder.images[0].desc;
+		uint32_t mipCount = std::max(builder.mipCount, 1u);
+		uint32_t cellWidth = format.blockWidth << (mipCount - 1);
+		uint32_t cellHeight = format.blockHeight << (mipCount - 1);
+		uint32_t imageCount = (uint32_t)builder.images.size();
+
+		// Sizes in cells, including padding
+		std::vector<AtlasPlacement> cells(imageCount);
+		uint64_t area = 0;
+		uint32_t widest = 0;
+
+		for (uint32_t i = 0; i < imageCount; ++i)
+		{
+			const Descriptor& desc = builder.images[i].desc;
+			cells[i].width = (uint32_t)(((uint64_t)desc.width + builder.padding + cellWidth - 1) / cellWidth);
+			cells[i].height = (uint32_t)(((uint64_t)desc.height + builder.padding + cellHeight - 1) / cellHeight);
+			area += (uint64_t)cells[i].width * cells[i].height;
+			widest = std::max(widest, cells[i].width);
+		}
+
+		// Tallest first, then widest, keeping the order added otherwise
+		std::vector<uint32_t> order(imageCount);
+
+		for (uint32_t i = 0; i < imageCount; ++i)
+		{
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{
+			return cells[a].height != cells[b].height ? cells[a].height > cells[b].height : cells[a].width > cells[b].width;
+		});
+
+		uint32_t maxHeightInCells = builder.maxHeight / cellHeight;
+		std::vector<AtlasPlacement> positions(imageCount), bestPositions;
+		uint32_t bestWidth = 0, bestHeight = 0;
+
+		for (uint64_t width = internal::round_up_to_power_of_two(widest * cellWidth); width <= builder.maxWidth; width *= 2)
+		{
+			// Power of two widths that aren't a whole number of cells only lose the remainder
+			uint32_t widthInCells = (uint32_t)(width / cellWidth);
+
+			if (widthInCells < widest || (uint64_t)widthInCells * maxHeightInCells < area)
+			{
+				continue;
+			}
+
+			uint32_t usedHeight = internal::pack_skyline(order, cells, widthInCells, maxHeightInCells, positions);
+
+			if (usedHeight == 0)
+			{
+				continue;
+			}
+
+			uint32_t height = usedHeight * cellHeight;
+			height = builder.powerOfTwo ? internal::round_up_to_power_of_two(height) : height;
+
+			if (height > builder.maxHeight)
+			{
+				continue;
+			}
+
+			if (bestWidth == 0 || width * height < (uint64_t)bestWidth * bestHeight ||
+				(width * height == (uint64_t)bestWidth * bestHeight && std::max<uint64_t>(width, height) < std::max(bestWidth, bestHeight)))
+			{
+				bestWidth = (uint32_t)width;
+				bestHeight = height;
+				bestPositions = positions;
+			}
+		}
+
+		if (bestWidth == 0)
+		{
+			return AtlasTooLarge;
+		}
+
+		HeaderKTX header;
+		encode_header(format.glInternalFormat, format.glType, format.glFormat, format.glBaseInternalFormat, bestWidth, bestHeight, 0, Texture2D, mipCount, 0, header);
+
+		Descriptor desc;
+		std::vector<Subresource> layout(mipCount);
+		atlas.resize((size_t)prepare_texture(header, desc, layout.data()));
+		write_texture_layout(header, desc, layout.data(), atlas.data());
+
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+		unsigned char clearBlock[64];
+		internal::get_atlas_clear_block(desc.glInternalFormat, clearBlock, bytesPerBlock);
+
+		for (const Subresource& subresource : layout)
+		{
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, subresource.mip, widthInBlocks, heightInBlocks);
+
+			for (uint32_t row = 0; row < heightInBlocks; ++row)
+			{
+				unsigned char* destination = atlas.data() + subresource.offset + (uint64_t)row * subresource.rowPitch;
+
+				for (uint32_t block = 0; block < widthInBlocks; ++block)
+				{
+					memcpy(destination + (uint64_t)block * bytesPerBlock, clearBlock, bytesPerBlock);
+				}
+			}
+		}
+
+		// Copy each image's mips block by block, with rows repitched from the image to the atlas
+		placements.resize(imageCount);
+
+		for (uint32_t i = 0; i < imageCount; ++i)
+		{
+			const internal::AtlasSource& source = builder.images[i];
+			AtlasPlacement& placement = placements[i];
+			placement.x = bestPositions[i].x * cellWidth;
+			placement.y = bestPositions[i].y * cellHeight;
+			placement.width = source.desc.width;
+			placement.height = source.desc.height;
+
+			std::vector<Subresource> sourceLayout(get_subresource_count(source.desc));
+			compute_subresource_layout(source.desc, source.imageDataOffset, sourceLayout.data());
+
+			for (uint32_t mip = 0; mip < mipCount; ++mip)
+			{
+				uint32_t widthInBlocks, heightInBlocks;
+				get_mip_size_in_blocks(source.desc, mip, widthInBlocks, heightInBlocks);
+
+				const Subresource& from = sourceLayout[mip];
+				const Subresource& to = layout[mip];
+				uint64_t x = (placement.x >> mip) / desc.blockWidth, y = (placement.y >> mip) / desc.blockHeight;
+
+				for (uint32_t row = 0; row < heightInBlocks; ++row)
+				{
+					memcpy(atlas.data() + to.offset + (y + row) * to.rowPitch + x * bytesPerBlock, source.data + from.offset + (uint64_t)row * from.rowPitch, (size_t)widthInBlocks * bytesPerBlock);
+				}
+			}
+		}
+
+		return AtlasSuccess;
+	}
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+// Persistent cache of encoder output, so incremental builds only encode what changed. Entries are keyed by a hash
+// of the source data, the target format and the encoder settings, and hold whatever the encoder produced, usually a
+// complete KTX file.
+//
+// Every entry is a file in the cache directory. Entries are written to a temporary file and renamed into place, and
+// carry a checksum that is verified on load, so any number of threads and processes can share a cache and a torn
+// or corrupt entry is only ever a miss. Loading an entry refreshes its modification time, which is what the least
+// recently used eviction goes by once the cache outgrows its size limit
+
+#include "ktxpp_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <sys/types.h>
+	#include <sys/stat.h>
+#else
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace ktxpp
+{
+	namespace internal
+	{
+		static ktxpp_constexpr uint32_t CACHE_MAGIC   = 0x4843504b; // "KPCH"
+		static ktxpp_constexpr uint32_t CACHE_VERSION = 1;
+
+		struct CacheEntryHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t size; // Of the data that follows
+			Hash128 key;
+			Hash128 checksum; // Of the data
+		};
+
+		struct CacheFile
+		{
+			std::string path;
+			uint64_t size;
+			uint64_t lastUse; // Modification time in the file system's units
+		};
+
+		inline std::string get_cache_entry_name(const Hash128& key)
+		{
+			char name[40];
+			snprintf(name, sizeof(name), "%016llx%016llx.kc", (unsigned long long)key.high, (unsigned long long)key.low);
+			return name;
+		}
+
+		inline uint32_t get_process_id()
+		{
+#if defined(_WIN32)
+			return (uint32_t)GetCurrentProcessId();
+#else
+			return (uint32_t)getpid();
+#endif
+		}
+
+		inline bool create_directory(const std::string& path)
+		{
+#if defined(_WIN32)
+			return CreateDirectoryA(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+			return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+		}
+
+		// Replaces any existing file, atomically where the platform allows
+		inline bool replace_file(const std::string& from, const std::string& to)
+		{
+#if defined(_WIN32)
+			return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return rename(from.c_str(), to.c_str()) == 0;
+#endif
+		}
+
+		// File sizes through stat rather than ftell, whose long is 32 bits on Windows. The open file is checked by
+		// handle, as the path may already name a newer entry
+		inline bool get_file_size(FILE* fh, uint64_t& size)
+		{
+#if defined(_WIN32)
+			struct _stat64 status;
+			bool success = _fstat64(_fileno(fh), &status) == 0;
+#else
+			struct stat status;
+			bool success = fstat(fileno(fh), &status) == 0;
+#endif
+			size = success ? (uint64_t)status.st_size : 0;
+			return success;
+		}
+
+		inline bool get_file_size(const std::string& path, uint64_t& size)
+		{
+#if defined(_WIN32)
+			struct _stat64 status;
+			bool success = _stat64(path.c_str(), &status) == 0;
+#else
+			struct stat status;
+			bool success = stat(path.c_str(), &status) == 0;
+#endif
+			size = success ? (uint64_t)status.st_size : 0;
+			return success;
+		}
+
+		inline void touch_file(const std::string& path)
+		{
+#if defined(_WIN32)
+			HANDLE handle = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (handle != INVALID_HANDLE_VALUE)
+			{
+				FILETIME now;
+				GetSystemTimeAsFileTime(&now);
+				SetFileTime(handle, nullptr, &now, &now);
+				CloseHandle(handle);
+			}
+#else
+			utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+#endif
+		}
+
+		// Lists the entries of a cache directory, skipping temporary files
+		inline void list_cache_files(const std::string& directory, std::vector<CacheFile>& files)
+		{
+			files.clear();
+
+#if defined(_WIN32)
+			WIN32_FIND_DATAA data;
+			HANDLE find = FindFirstFileA((directory + "\\*.kc").c_str(), &data);
+
+			if (find == INVALID_HANDLE_VALUE)
+			{
+				return;
+			}
+
+			do
+			{
+				CacheFile file;
+				file.path = directory + "\\" + data.cFileName;
+				file.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+				file.lastUse = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+				files.push_back(file);
+			}
+			while (FindNextFileA(find, &data));
+
+			FindClose(find);
+#else
+			DIR* dir = opendir(directory.c_str());
+
+			if (dir == nullptr)
+			{
+				return;
+			}
+
+			while (dirent* entry = readdir(dir))
+			{
+				size_t length = strlen(entry->d_name);
+				struct stat status;
+
+				if (length < 3 || strcmp(entry->d_name + length - 3, ".kc") != 0)
+				{
+					continue;
+				}
+
+				CacheFile file;
+				file.path = directory + "/" + entry->d_name;
+
+				if (stat(file.path.c_str(), &status) == 0)
+				{
+#if defined(__APPLE__)
+					file.lastUse = (uint64_t)status.st_mtimespec.tv_sec * 1000000000ull + (uint64_t)status.st_mtimespec.tv_nsec;
+#else
+					file.lastUse = (uint64_t)status.st_mtim.tv_sec * 1000000000ull + (uint64_t)status.st_mtim.tv_nsec;
+#endif
+					file.size = (uint64_t)status.st_size;
+					files.push_back(file);
+				}
+			}
+
+			closedir(dir);
+#endif
+		}
+	}
+
+	struct EncodeCache
+	{
+		std::string directory;
+		std::mutex mutex;
+		uint64_t maxSize; // Guarded by mutex. Bytes on disk, exceeded by at most one entry between trims
+		uint64_t size; // Guarded by mutex. Tracks this process's writes, other processes are picked up when trimming
+
+		std::atomic<uint64_t> hits;
+		std::atomic<uint64_t> misses;
+		std::atomic<uint32_t> temporaryCounter;
+	};
+
+	// Key for source data encoded to format with the given settings. settings must be plain bytes: pass a struct of
+	// encoder parameters with no padding or pointers, plus anything else that changes the output such as the encoder
+	// version
+	inline Hash128 get_encode_cache_key(const void* source, size_t sourceSize, GLInternalFormat format, const void* settings, size_t settingsSize)
+	{
+		uint32_t formatValue = (uint32_t)format;
+		Hash128 key = hash_data(source, sourceSize);
+		key = hash_combine(key, &formatValue, sizeof(formatValue));
+		return hash_combine(key, settings, settingsSize);
+	}
+
+	// Removes the least recently used entries until the cache is no larger than targetSize
+	inline void trim_encode_cache(EncodeCache& cache, uint64_t targetSize)
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+
+		std::vector<internal::CacheFile> files;
+		internal::list_cache_files(cache.directory, files);
+		std::sort(files.begin(), files.end(), [](const internal::CacheFile& a, const internal::CacheFile& b) { return a.lastUse < b.lastUse; });
+
+		uint64_t size = 0;
+
+		for (const internal::CacheFile& file : files)
+		{
+			size += file.size;
+		}
+
+		for (size_t i = 0; i < files.size() && size > targetSize; ++i)
+		{
+			// Another process may have removed it already, either way it no longer counts
+			remove(files[i].path.c_str());
+			size -= files[i].size;
+		}
+
+		cache.size = size;
+	}
+
+	// Creates the directory if needed. Returns false if it can't be created
+	inline bool open_encode_cache(EncodeCache& cache, const char* directory, uint64_t maxSize)
+	{
+		cache.directory = directory;
+		cache.maxSize = maxSize;
+		cache.size = 0;
+		cache.hits = 0;
+		cache.misses = 0;
+		cache.temporaryCounter = 0;
+
+		if (!internal::create_directory(cache.directory))
+		{
+			return false;
+		}
+
+		std::vector<internal::CacheFile> files;
+		internal::list_cache_files(cache.directory, files);
+
+		for (const internal::CacheFile& file : files)
+		{
+			cache.size += file.size;
+		}
+
+		if (cache.size > cache.maxSize)
+		{
+			trim_encode_cache(cache, cache.maxSize);
+		}
+
+		return true;
+	}
+
+	// Returns false on a miss, including when the entry turns out to be corrupt, in which case it is removed
+	inline bool load_encode_cache(EncodeCache& cache, const Hash128& key, std::vector<unsigned char>& data)
+	{
+		ktxpp_stage(StageIO, "load_encode_cache");
+
+		std::string path = cache.directory + "/" + internal::get_cache_entry_name(key);
+		FILE* fh = fopen(path.c_str(), "rb");
+		bool valid = false;
+
+		if (fh)
+		{
+			internal::CacheEntryHeader header;
+
+			if (fread(&header, sizeof(header), 1, fh) == 1 && header.magic == internal::CACHE_MAGIC && header.version == internal::CACHE_VERSION && header.key == key)
+			{
+				uint64_t fileSize;
+
+				if (internal::get_file_size(fh, fileSize) && fileSize == sizeof(header) + header.size)
+				{
+					data.resize((size_t)header.size);
+					valid = fread(data.data(), 1, data.size(), fh) == data.size() && hash_data(data.data(), data.size()) == header.checksum;
+				}
+			}
+
+			fclose(fh);
+
+			if (!valid)
+			{
+				remove(path.c_str());
+			}
+		}
+
+		if (valid)
+		{
+			ktxpp_stage_work(data.size(), 0);
+			internal::touch_file(path);
+			cache.hits++;
+		}
+		else
+		{
+			data.clear();
+			cache.misses++;
+		}
+
+		ktxpp_count_cache(valid);
+		return valid;
+	}
+
+	// Replaces any entry with the same key
+	inline bool store_encode_cache(EncodeCache& cache, const Hash128& key, const void* data, uint64_t size)
+	{
+		ktxpp_stage(StageIO, "store_encode_cache");
+		ktxpp_stage_work(size, 0);
+
+		internal::CacheEntryHeader header;
+		header.magic = internal::CACHE_MAGIC;
+		header.version = internal::CACHE_VERSION;
+		header.size = size;
+		header.key = key;
+		header.checksum = hash_data(data, (size_t)size);
+
+		// Unique across threads and processes sharing the directory
+		char temporaryName[64];
+		snprintf(temporaryName, sizeof(temporaryName), "/%08x_%08x.tmp", internal::get_process_id(), cache.temporaryCounter++);
+
+		std::string temporaryPath = cache.directory + temporaryName;
+		FILE* fh = fopen(temporaryPath.c_str(), "wb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		bool success = fwrite(&header, sizeof(header), 1, fh) == 1 && fwrite(data, 1, (size_t)size, fh) == size;
+		success = fclose(fh) == 0 && success;
+
+		// An entry being replaced stops counting. 0 when there is none
+		std::string path = cache.directory + "/" + internal::get_cache_entry_name(key);
+		uint64_t replacedSize;
+		internal::get_file_size(path, replacedSize);
+
+		if (!success || !internal::replace_file(temporaryPath, path))
+		{
+			remove(temporaryPath.c_str());
+			return false;
+		}
+
+		bool trim;
+		uint64_t targetSize;
+
+		{
+			std::lock_guard<std::mutex> lock(cache.mutex);
+			cache.size += sizeof(header) + size;
+			cache.size -= std::min(replacedSize, cache.size);
+			trim = cache.size > cache.maxSize;
+
+			// Trimming to below the limit leaves room for a run of stores before the directory is scanned again
+			targetSize = cache.maxSize - cache.maxSize / 8;
+		}
+
+		if (trim)
+		{
+			trim_encode_cache(cache, targetSize);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "ktxpp_supercompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ktxpp
+{
+	enum ConvertResult
+	{
+		ConvertSuccess,
+		ConvertInvalidSource,
+		ConvertUnsupportedFormat,
+		ConvertUnsupportedSupercompression,
+		ConvertSupercompressionFailed,
+	};
+
+	struct ConvertOptions
+	{
+		SupercompressionScheme supercompression = SupercompressionNone;
+		int supercompressionLevel = 0; // Codec specific, 0 picks the codec default
+		uint32_t threadCount = 1; // Threads used to process the levels of one file, 0 uses every core
+		Allocator allocator = get_default_allocator(); // Scratch memory. Must be thread safe if threadCount != 1
+	};
+
+	namespace internal
+	{
+		typedef std::vector<unsigned char, StlAllocator<unsigned char> > ScratchBuffer;
+
+		struct KeyValueKTX2
+		{
+			std::string key;
+			std::vector<unsigned char> value;
+
+			bool operator < (const KeyValueKTX2& other) const { return key < other.key; }
+		};
+
+		// KTX 1.1 stores "S=r,T=d,R=i" whereas KTX2 stores one letter per dimension, "rdi"
+		inline std::vector<unsigned char> convert_orientation(const KeyValue& keyValue, uint32_t dimensions)
+		{
+			std::vector<unsigned char> orientation;
+
+			for (uint32_t i = 0; i + 2 < keyValue.valueSize && orientation.size() < dimensions; ++i)
+			{
+				if (keyValue.value[i + 1] == '=')
+				{
+					orientation.push_back(keyValue.value[i + 2]);
+				}
+			}
+
+			orientation.push_back(0);
+			return orientation;
+		}
+
+		inline uint32_t get_type_size_ktx2(const Descriptor& desc, const HeaderKTX& header)
+		{
+			if (desc.compressed)
+			{
+				return 1;
+			}
+
+			switch (desc.glType)
+			{
+				case GL_BYTE: case GL_UNSIGNED_BYTE:
+					return 1;
+				case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: case GL_HALF_FLOAT_OES:
+				case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+					return 2;
+				case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT:
+				case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_10F_11F_11F_REV: case GL_UNSIGNED_INT_5_9_9_9_REV:
+					return 4;
+				default:
+					return header.glTypeSize;
+			}
+		}
+
+		// Copies every image of a level removing the KTX 1.1 row padding
+		inline void repack_level_ktx2(const Descriptor& desc, const Subresource* subresources, uint32_t mip, const unsigned char* source, unsigned char* destination)
+		{
+			uint32_t imagesPerMip = desc.arraySize * get_face_count(desc);
+			uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+
+			for (uint32_t i = 0; i < imagesPerMip; ++i)
+			{
+				const Subresource& subresource = subresources[get_subresource_index(desc, mip, 0, 0) + i];
+
+				uint32_t widthInBlocks, heightInBlocks;
+				get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+				uint32_t rowSize = widthInBlocks * bytesPerBlock;
+				uint32_t rowCount = heightInBlocks * subresource.depth;
+
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					memcpy(destination, source + subresource.offset + (uint64_t)row * subresource.rowPitch, rowSize);
+					destination += rowSize;
+				}
+			}
+		}
+
+		// Runs function(index) for every index in [0, count) on up to threadCount threads
+		template<typename Function>
+		inline void parallel_for(uint32_t count, uint32_t threadCount, const Function& function)
+		{
+			if (threadCount == 0)
+			{
+				threadCount = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			threadCount = std::min(threadCount, count);
+
+			if (threadCount <= 1)
+			{
+				for (uint32_t i = 0; i < count; ++i) { function(i); }
+				return;
+			}
+
+			std::atomic<uint32_t> next(0);
+			std::vector<std::thread> threads;
+
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&]()
+				{
+					for (uint32_t i = next++; i < count; i = next++) { function(i); }
+				});
+			}
+
+			for (std::thread& thread : threads) { thread.join(); }
+		}
+	}
+
+	// Repackages a KTX 1.1 file as KTX2. Row padding is removed, levels are stored smallest first, the key/value
+	// data is rebuilt sorted with KTXorientation translated and KTXwriter set, and levels can optionally be
+	// supercompressed with zstd or zlib. Levels are processed in parallel according to options.threadCount. All scratch
+	// memory comes from options.allocator, and the output from the allocator of the destination vector
+	template<typename DestinationAllocator>
+	inline ConvertResult convert_ktx1_to_ktx2(const unsigned char* source, uint64_t sourceSize, const ConvertOptions& options, std::vector<unsigned char, DestinationAllocator>& destination)
+	{
+		ktxpp_stage(StageConvert, "convert_ktx1_to_ktx2");
+		ktxpp_stage_work(sourceSize, 0);
+
+		StlAllocator<unsigned char> scratchAllocator(options.allocator);
+
+		Descriptor desc;
+
+		if (validate_header(source, sourceSize, desc) != ValidationSuccess)
+		{
+			return ConvertInvalidSource;
+		}
+
+		HeaderKTX header;
+		memcpy(&header, source, sizeof(HeaderKTX));
+
+		std::vector<Subresource, StlAllocator<Subresource> > subresources(get_subresource_count(desc), Subresource(), scratchAllocator);
+		compute_subresource_layout(desc, get_image_data_offset(header), subresources.data());
+
+		uint32_t dfdByteLength = encode_dfd(desc, nullptr);
+
+		if (dfdByteLength == 0 || desc.vkFormat == VK_FORMAT_UNDEFINED)
+		{
+			return ConvertUnsupportedFormat;
+		}
+
+		bool supercompressed = options.supercompression != SupercompressionNone;
+
+		if ((options.supercompression != SupercompressionZstd && options.supercompression != SupercompressionZLIB && supercompressed) ||
+			!is_supercompression_supported(options.supercompression))
+		{
+			return ConvertUnsupportedSupercompression;
+		}
+
+		// Rebuild the key/value data
+		std::vector<KeyValueKTX2> keyValues;
+		uint32_t dimensions = desc.type == Texture3D ? 3 : (desc.type == Texture1D ? 1 : 2);
+
+		const unsigned char* cursor = source + sizeof(HeaderKTX);
+		const unsigned char* keyValueEnd = cursor + header.bytesOfKeyValueData;
+		KeyValue keyValue;
+
+		while (next_key_value(cursor, keyValueEnd, keyValue))
+		{
+			KeyValueKTX2 entry;
+			entry.key = keyValue.key;
+
+			if (entry.key == "KTXwriter")
+			{
+				continue;
+			}
+			else if (entry.key == "KTXorientation")
+			{
+				entry.value = convert_orientation(keyValue, dimensions);
+			}
+			else
+			{
+				entry.value.assign(keyValue.value, keyValue.value + keyValue.valueSize);
+			}
+
+			keyValues.push_back(entry);
+		}
+
+		KeyValueKTX2 writer;
+		writer.key = "KTXwriter";
+		static const char writerName[] = "ktxpp";
+		writer.value.assign(writerName, writerName + sizeof(writerName));
+		keyValues.push_back(writer);
+
+		std::sort(keyValues.begin(), keyValues.end());
+
+		uint32_t kvdByteLength = 0;
+
+		for (const KeyValueKTX2& entry : keyValues)
+		{
+			kvdByteLength += (sizeof(uint32_t) + (uint32_t)entry.key.size() + 1 + (uint32_t)entry.value.size() + 3) & ~3u;
+		}
+
+		// Lay out everything that precedes the levels
+		uint32_t numMips = get_mip_count(desc);
+		uint32_t numFaces = get_face_count(desc);
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+
+		HeaderKTX2 headerKTX2;
+		static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', '\x1A', '\n' };
+		memcpy(headerKTX2.identifier, identifier, sizeof(identifier));
+		headerKTX2.vkFormat               = desc.vkFormat;
+		headerKTX2.typeSize               = get_type_size_ktx2(desc, header);
+		headerKTX2.pixelWidth             = header.pixelWidth;
+		headerKTX2.pixelHeight            = header.pixelHeight;
+		headerKTX2.pixelDepth             = header.pixelDepth;
+		headerKTX2.layerCount             = header.numberOfArrayElements;
+		headerKTX2.faceCount              = numFaces;
+		headerKTX2.levelCount             = header.numberOfMipmapLevels;
+		headerKTX2.supercompressionScheme = options.supercompression;
+		headerKTX2.dfdByteOffset          = (uint32_t)(sizeof(HeaderKTX2) + numMips * sizeof(LevelIndexKTX2));
+		headerKTX2.dfdByteLength          = dfdByteLength;
+		headerKTX2.kvdByteOffset          = kvdByteLength > 0 ? headerKTX2.dfdByteOffset + dfdByteLength : 0;
+		headerKTX2.kvdByteLength          = kvdByteLength;
+		headerKTX2.sgdByteOffset          = 0;
+		headerKTX2.sgdByteLength          = 0;
+
+		uint64_t levelDataOffset = headerKTX2.dfdByteOffset + dfdByteLength + kvdByteLength;
+
+		// Levels are aligned to lcm(4, texel block size) unless supercompressed
+		uint64_t alignment = 1;
+
+		if (!supercompressed)
+		{
+			alignment = bytesPerBlock;
+			while (alignment % 4 != 0) { alignment += bytesPerBlock; }
+		}
+
+		std::vector<LevelIndexKTX2, StlAllocator<LevelIndexKTX2> > levels(numMips, LevelIndexKTX2(), scratchAllocator);
+
+		for (uint32_t mip = 0; mip < numMips; ++mip)
+		{
+			const Subresource& subresource = subresources[get_subresource_index(desc, mip, 0, 0)];
+
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+			levels[mip].uncompressedByteLength = (uint64_t)widthInBlocks * bytesPerBlock * heightInBlocks * subresource.depth * desc.arraySize * numFaces;
+			levels[mip].byteLength = levels[mip].uncompressedByteLength;
+		}
+
+		// Supercompressed sizes are only known after compressing, so compress every level into its own buffer first
+		std::vector<ScratchBuffer, StlAllocator<ScratchBuffer> > compressedLevels(supercompressed ? numMips : 0, ScratchBuffer(scratchAllocator), scratchAllocator);
+		std::atomic<bool> compressionFailed(false);
+
+		if (supercompressed)
+		{
+			int level = options.supercompressionLevel != 0 ? options.supercompressionLevel : (options.supercompression == SupercompressionZstd ? 3 : 6);
+
+			parallel_for(numMips, options.threadCount, [&](uint32_t mip)
+			{
+				ScratchBuffer repacked((size_t)levels[mip].uncompressedByteLength, 0, scratchAllocator);
+				repack_level_ktx2(desc, subresources.data(), mip, source, repacked.data());
+
+				ScratchBuffer& compressed = compressedLevels[mip];
+				compressed.resize((size_t)get_supercompression_bound(options.supercompression, repacked.size()));
+
+				uint64_t compressedSize = supercompress(options.supercompression, level, repacked.data(), repacked.size(), compressed.data(), compressed.size());
+
+				if (compressedSize == 0 && !repacked.empty())
+				{
+					compressionFailed = true;
+				}
+
+				compressed.resize((size_t)compressedSize);
+				levels[mip].byteLength = compressedSize;
+			});
+
+			if (compressionFailed)
+			{
+				return ConvertSupercompressionFailed;
+			}
+		}
+
+		// Smallest level first
+		uint64_t offset = levelDataOffset;
+
+		for (uint32_t mip = numMips; mip-- > 0;)
+		{
+			offset = (offset + alignment - 1) / alignment * alignment;
+			levels[mip].byteOffset = offset;
+			offset += levels[mip].byteLength;
+		}
+
+		destination.assign((size_t)offset, 0);
+		unsigned char* output = destination.data();
+
+		memcpy(output, &headerKTX2, sizeof(HeaderKTX2));
+		memcpy(output + sizeof(HeaderKTX2), levels.data(), levels.size() * sizeof(LevelIndexKTX2));
+		encode_dfd(desc, output + headerKTX2.dfdByteOffset);
+
+		unsigned char* keyValueOutput = output + headerKTX2.kvdByteOffset;
+
+		for (const KeyValueKTX2& entry : keyValues)
+		{
+			uint32_t keyAndValueByteSize = (uint32_t)(entry.key.size() + 1 + entry.value.size());
+			memcpy(keyValueOutput, &keyAndValueByteSize, sizeof(uint32_t));
+			memcpy(keyValueOutput + sizeof(uint32_t), entry.key.c_str(), entry.key.size() + 1);
+
+			if (!entry.value.empty())
+			{
+				memcpy(keyValueOutput + sizeof(uint32_t) + entry.key.size() + 1, entry.value.data(), entry.value.size());
+			}
+
+			keyValueOutput += (sizeof(uint32_t) + keyAndValueByteSize + 3) & ~3u;
+		}
+
+		// Levels don't overlap so every thread writes straight into the output
+		parallel_for(numMips, options.threadCount, [&](uint32_t mip)
+		{
+			if (supercompressed)
+			{
+				if (!compressedLevels[mip].empty())
+				{
+					memcpy(output + levels[mip].byteOffset, compressedLevels[mip].data(), compressedLevels[mip].size());
+				}
+
+				ScratchBuffer(scratchAllocator).swap(compressedLevels[mip]);
+			}
+			else
+			{
+				repack_level_ktx2(desc, subresources.data(), mip, source, output + levels[mip].byteOffset);
+			}
+		});
+
+		return ConvertSuccess;
+	}
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+// C++20 coroutine front end to ktxpp_async.h
+//
+//   AsyncTexture* texture = co_await ktxpp::load_async(loader, "texture.ktx");
+//   AsyncStatus status = co_await loader.load_mip(*texture, 0);
+//
+// The awaitables work in any coroutine type. One thread pumps the loader with process(), and each coroutine whose
+// read has finished is handed to the executor given at construction, e.g. a job system queue, or resumed right
+// there on the pumping thread if there is none. Awaiting is safe from any thread: requests are queued and handed to
+// the loader by the next process()
+
+#include "ktxpp_async.h"
+
+#include <atomic>
+#include <coroutine>
+#include <string>
+
+namespace ktxpp
+{
+	// Where ready coroutines are resumed. A null schedule resumes them inline on the thread calling process()
+	struct CoroutineExecutor
+	{
+		void (*schedule)(void* userData, std::coroutine_handle<> handle);
+		void* userData;
+	};
+
+	class CoroutineLoader;
+
+	namespace internal
+	{
+		enum CoroutineRequestKind
+		{
+			CoroutineRequestOpen,
+			CoroutineRequestMip,
+			CoroutineRequestKeyValueData,
+		};
+
+		// Lives in the awaiting coroutine's frame for as long as it is suspended, so requests never allocate
+		struct CoroutineRequest
+		{
+			CoroutineLoader* loader;
+			CoroutineRequestKind kind;
+			std::string path;
+			AsyncTexture* texture;
+			uint32_t mip;
+			AsyncStatus status;
+			std::coroutine_handle<> handle;
+		};
+	}
+
+	class CoroutineLoader
+	{
+	public:
+
+		explicit CoroutineLoader(const AsyncLoaderOptions& options = AsyncLoaderOptions(), CoroutineExecutor executor = CoroutineExecutor())
+			: executor(executor), outstanding(0)
+		{
+			initialize_async_loader(loader, options);
+		}
+
+		~CoroutineLoader()
+		{
+			release_async_loader(loader);
+		}
+
+		CoroutineLoader(const CoroutineLoader&) = delete;
+		CoroutineLoader& operator = (const CoroutineLoader&) = delete;
+
+		struct OpenAwaiter
+		{
+			internal::CoroutineRequest request;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { request.handle = handle; request.loader->enqueue(request); }
+
+			// Check status before using anything else. Release with close() in every case. nullptr, with status
+			// AsyncOutOfMemory, when the texture itself couldn't be allocated
+			AsyncTexture* await_resume() const noexcept { return request.texture; }
+		};
+
+		struct ReadAwaiter
+		{
+			internal::CoroutineRequest request;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { request.handle = handle; request.loader->enqueue(request); }
+			AsyncStatus await_resume() const noexcept { return request.status; }
+		};
+
+		// Opens a file and reads its header. Resumes with the texture once its layout is known
+		OpenAwaiter load(const char* path)
+		{
+			return OpenAwaiter{ { this, internal::CoroutineRequestOpen, path, nullptr, 0, AsyncSuccess, {} } };
+		}
+
+		// Reads one level of a texture whose header loaded successfully into texture.data
+		ReadAwaiter load_mip(AsyncTexture& texture, uint32_t mip)
+		{
+			return ReadAwaiter{ { this, internal::CoroutineRequestMip, std::string(), &texture, mip, AsyncSuccess, {} } };
+		}
+
+		ReadAwaiter load_key_value_data(AsyncTexture& texture)
+		{
+			return ReadAwaiter{ { this, internal::CoroutineRequestKeyValueData, std::string(), &texture, 0, AsyncSuccess, {} } };
+		}
+
+		// No reads of the texture may be pending
+		void close(AsyncTexture* texture)
+		{
+			async_close_texture(loader, texture);
+		}
+
+		// Submits queued requests and hands finished coroutines to the executor. Must always be called from the same
+		// thread. With wait it blocks until at least one read finishes, unless nothing is in flight. Returns the
+		// number of coroutines scheduled
+		uint32_t process(bool wait)
+		{
+			std::deque<internal::CoroutineRequest*> requests;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				requests.swap(requestQueue);
+			}
+
+			for (internal::CoroutineRequest* request : requests)
+			{
+				if (request->kind == internal::CoroutineRequestOpen)
+				{
+					// Without a texture there is no callback, so the coroutine is resumed along with the finished reads
+					if (async_open_texture(loader, request->path.c_str(), on_read, request) == nullptr)
+					{
+						request->texture = nullptr;
+						request->status = AsyncOutOfMemory;
+						readyQueue.push_back(request->handle);
+					}
+				}
+				else if (request->kind == internal::CoroutineRequestMip)
+				{
+					async_read_mip(loader, *request->texture, request->mip, on_read, request);
+				}
+				else
+				{
+					async_read_key_value_data(loader, *request->texture, on_read, request);
+				}
+			}
+
+			process_async_loader(loader, wait && readyQueue.empty());
+
+			// Resuming may queue new requests, which is why nothing is locked at this point
+			std::vector<std::coroutine_handle<> > ready;
+			ready.swap(readyQueue);
+
+			for (std::coroutine_handle<> handle : ready)
+			{
+				outstanding--;
+
+				if (executor.schedule != nullptr)
+				{
+					executor.schedule(executor.userData, handle);
+				}
+				else
+				{
+					handle.resume();
+				}
+			}
+
+			return (uint32_t)ready.size();
+		}
+
+		// Requests that haven't resumed their coroutine yet
+		uint32_t get_outstanding() const
+		{
+			return outstanding.load();
+		}
+
+		// Pumps until every awaiting coroutine has been scheduled. Only useful when nothing else drives process()
+		void run()
+		{
+			while (get_outstanding() > 0)
+			{
+				process(true);
+			}
+		}
+
+		AsyncLoader& get_async_loader() { return loader; }
+
+	private:
+
+		void enqueue(internal::CoroutineRequest& request)
+		{
+			outstanding++;
+			std::lock_guard<std::mutex> lock(mutex);
+			requestQueue.push_back(&request);
+		}
+
+		static void on_read(void* userData, AsyncTexture& texture, uint32_t, AsyncStatus status)
+		{
+			internal::CoroutineRequest& request = *static_cast<internal::CoroutineRequest*>(userData);
+			request.texture = &texture;
+			request.status = status;
+			request.loader->readyQueue.push_back(request.handle);
+		}
+
+		AsyncLoader loader;
+		CoroutineExecutor executor;
+		std::atomic<uint32_t> outstanding;
+
+		std::mutex mutex;
+		std::deque<internal::CoroutineRequest*> requestQueue; // Guarded by mutex
+		std::vector<std::coroutine_handle<> > readyQueue; // Only touched by the thread calling process
+	};
+
+	inline CoroutineLoader::OpenAwaiter load_async(CoroutineLoader& loader, const char* path)
+	{
+		return loader.load(path);
+	}
+}
@@ -0,0 +1,1809 @@
+#pragma once
+
+// Runtime CPU feature dispatch for the SIMD kernels in ktxpp. The best implementation for the machine is chosen the
+// first time get_kernels() is called and every kernel is then a plain function pointer call. Set the KTXPP_SIMD
+// environment variable to scalar, sse2, avx2, avx512 or neon to force a lower level when testing a specific path.
+// Kernels are compiled with function level target attributes, so the rest of the program can keep its baseline ISA
+
+#include "ktxpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define ktxpp_x86
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define ktxpp_neon
+	#include <arm_neon.h>
+#endif
+
+// MSVC lets intrinsics of any level be used anywhere, GCC and Clang need the target enabled per function
+#if defined(ktxpp_x86) && !defined(_MSC_VER)
+	#define ktxpp_target_avx2   __attribute__((target("avx2")))
+	#define ktxpp_target_avx512 __attribute__((target("avx512f,avx512bw")))
+#else
+	#define ktxpp_target_avx2
+	#define ktxpp_target_avx512
+#endif
+
+namespace ktxpp
+{
+	enum SimdLevel
+	{
+		SimdScalar,
+		SimdSSE2,
+		SimdAVX2,
+		SimdAVX512, // AVX-512F and BW
+		SimdNEON,
+	};
+
+	enum YuvLayout
+	{
+		YuvUYVY, // Cb Y0 Cr Y1, GL_UNSIGNED_SHORT_8_8_REV_APPLE
+		YuvYUY2, // Y0 Cb Y1 Cr, GL_UNSIGNED_SHORT_8_8_APPLE
+	};
+
+	enum YuvMatrix
+	{
+		YuvBT601,
+		YuvBT709,
+	};
+
+	enum YuvRange
+	{
+		YuvLimitedRange, // Luma 16-235, chroma 16-240
+		YuvFullRange,
+	};
+
+	// Fixed point 4:2:2 to RGB coefficients from get_yuv_conversion. Every level does the same integer arithmetic, so
+	// they all produce identical output
+	struct YuvConversion
+	{
+		YuvLayout layout;
+		int16_t lumaBias;
+		int16_t lumaScale; // Coefficients are 3.13 fixed point
+		int16_t redCr;
+		int16_t greenCb; // Subtracted
+		int16_t greenCr; // Subtracted
+		int16_t blueCb;
+	};
+
+	// One entry per hot kernel. Buffers may be unaligned, and source and destination may be the same buffer unless
+	// the kernel writes more than it reads
+	struct Kernels
+	{
+		SimdLevel level;
+
+		void (*byteswap16)(const unsigned char* source, unsigned char* destination, size_t count); // count in 16-bit elements
+		void (*byteswap32)(const unsigned char* source, unsigned char* destination, size_t count); // count in 32-bit elements
+		void (*swap_red_blue)(const unsigned char* source, unsigned char* destination, size_t pixelCount); // RGBA8 <-> BGRA8
+
+		// 4:2:2 to opaque RGBA8. An odd pixelCount reads the whole last pair, not in place
+		void (*yuv422_to_rgba8)(const unsigned char* source, unsigned char* destination, size_t pixelCount, const YuvConversion& conversion);
+
+		// Legacy formats to opaque RGBA8, not in place. Partial pairs and bytes at the end are read whole
+		void (*rgbg_to_rgba8)(const unsigned char* source, unsigned char* destination, size_t pixelCount);
+		void (*grgb_to_rgba8)(const unsigned char* source, unsigned char* destination, size_t pixelCount);
+		void (*bw1bpp_to_rgba8)(const unsigned char* source, unsigned char* destination, size_t pixelCount);
+
+		// Squared and maximum absolute differences of two byte arrays. Byte i adds to sums[i % 48] and maxima[i % 48],
+		// so every channel of any interleaved 1 to 4 channel layout falls in whole lanes
+		void (*squared_error8)(const unsigned char* a, const unsigned char* b, size_t byteCount, uint64_t* sums, unsigned char* maxima);
+
+		// Sum, minimum, maximum and count of values other than 0 and 255 of a byte array, in the same 48 lanes
+		void (*channel_stats8)(const unsigned char* source, size_t byteCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima);
+
+		// Sums for SSIM over rowCount rows of two byte arrays: a, b, a * a, b * b and a * b of byte i of every row go to
+		// sums[i], sums[byteCount + i] and so on up to sums[4 * byteCount + i], overwriting them. At most 65536 rows
+		void (*ssim_sums8)(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t byteCount, uint32_t rowCount, uint32_t* sums);
+
+		// sRGB RGBA8 to linear float RGBA and back, alpha staying linear. Decoding is exact to float precision. Encoding
+		// clamps to [0, 1], NaN to 0, and lands within one step of the correctly rounded value, on it for all but 0.4% of
+		// inputs. Every level gives identical results
+		void (*srgb8_to_linear)(const unsigned char* source, float* destination, size_t pixelCount);
+		void (*linear_to_srgb8)(const float* source, unsigned char* destination, size_t pixelCount);
+	};
+
+	inline YuvConversion get_yuv_conversion(YuvLayout layout, YuvMatrix matrix, YuvRange range)
+	{
+		// Red from Cr and blue from Cb are 2 (1 - Kr) and 2 (1 - Kb), green takes the rest of the luma weights
+		double kr = matrix == YuvBT709 ? 0.2126 : 0.299;
+		double kb = matrix == YuvBT709 ? 0.0722 : 0.114;
+		double kg = 1.0 - kr - kb;
+		double lumaScale = range == YuvLimitedRange ? 255.0 / 219.0 : 1.0;
+		double chromaScale = range == YuvLimitedRange ? 255.0 / 224.0 : 1.0;
+
+		YuvConversion conversion;
+		conversion.layout = layout;
+		conversion.lumaBias = range == YuvLimitedRange ? 16 : 0;
+		conversion.lumaScale = (int16_t)(lumaScale * 8192.0 + 0.5);
+		conversion.redCr = (int16_t)(2.0 * (1.0 - kr) * chromaScale * 8192.0 + 0.5);
+		conversion.greenCb = (int16_t)(2.0 * (1.0 - kb) * kb / kg * chromaScale * 8192.0 + 0.5);
+		conversion.greenCr = (int16_t)(2.0 * (1.0 - kr) * kr / kg * chromaScale * 8192.0 + 0.5);
+		conversion.blueCb = (int16_t)(2.0 * (1.0 - kb) * chromaScale * 8192.0 + 0.5);
+		return conversion;
+	}
+
+	// How a GL_RGB_RAW_422_APPLE texture orders its bytes
+	inline YuvLayout get_yuv_layout(const Descriptor& desc)
+	{
+		return desc.glType == GL_UNSIGNED_SHORT_8_8_REV_APPLE ? YuvUYVY : YuvYUY2;
+	}
+
+	namespace internal
+	{
+		inline void byteswap16_scalar(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				unsigned char b0 = source[i * 2], b1 = source[i * 2 + 1];
+				destination[i * 2] = b1; destination[i * 2 + 1] = b0;
+			}
+		}
+
+		inline void byteswap32_scalar(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				unsigned char b0 = source[i * 4], b1 = source[i * 4 + 1], b2 = source[i * 4 + 2], b3 = source[i * 4 + 3];
+				destination[i * 4] = b3; destination[i * 4 + 1] = b2; destination[i * 4 + 2] = b1; destination[i * 4 + 3] = b0;
+			}
+		}
+
+		inline void swap_red_blue_scalar(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				unsigned char r = source[i * 4], g = source[i * 4 + 1], b = source[i * 4 + 2], a = source[i * 4 + 3];
+				destination[i * 4] = b; destination[i * 4 + 1] = g; destination[i * 4 + 2] = r; destination[i * 4 + 3] = a;
+			}
+		}
+
+		// Each term is ((value * 128) * coefficient) >> 16, which is what the SIMD multiply high instructions compute,
+		// leaving the result with 4 fractional bits
+		inline int yuv_term(int value, int16_t coefficient)
+		{
+			return (value * 128 * coefficient) >> 16;
+		}
+
+		inline unsigned char yuv_round(int value)
+		{
+			value = (value + 8) >> 4;
+			return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+		}
+
+		inline void yuv422_to_rgba8_scalar(const unsigned char* source, unsigned char* destination, size_t pixelCount, const YuvConversion& conversion)
+		{
+			size_t lumaOffset = conversion.layout == YuvUYVY ? 1 : 0;
+			size_t chromaOffset = conversion.layout == YuvUYVY ? 0 : 1;
+
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				const unsigned char* pair = source + (i / 2) * 4;
+				int red = yuv_term(pair[chromaOffset + 2] - 128, conversion.redCr);
+				int green = -yuv_term(pair[chromaOffset] - 128, conversion.greenCb) - yuv_term(pair[chromaOffset + 2] - 128, conversion.greenCr);
+				int blue = yuv_term(pair[chromaOffset] - 128, conversion.blueCb);
+				int luma = yuv_term(pair[lumaOffset + (i & 1) * 2] - conversion.lumaBias, conversion.lumaScale);
+
+				destination[i * 4] = yuv_round(luma + red);
+				destination[i * 4 + 1] = yuv_round(luma + green);
+				destination[i * 4 + 2] = yuv_round(luma + blue);
+				destination[i * 4 + 3] = 255;
+			}
+		}
+
+		inline void rgbg_to_rgba8_scalar(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				const unsigned char* pair = source + (i / 2) * 4;
+				destination[i * 4] = pair[0]; destination[i * 4 + 1] = pair[1 + (i & 1) * 2]; destination[i * 4 + 2] = pair[2]; destination[i * 4 + 3] = 255;
+			}
+		}
+
+		inline void grgb_to_rgba8_scalar(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				const unsigned char* pair = source + (i / 2) * 4;
+				destination[i * 4] = pair[1]; destination[i * 4 + 1] = pair[(i & 1) * 2]; destination[i * 4 + 2] = pair[3]; destination[i * 4 + 3] = 255;
+			}
+		}
+
+		inline void bw1bpp_to_rgba8_scalar(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				unsigned char value = ((source[i / 8] >> (7 - i % 8)) & 1) ? 255 : 0;
+				destination[i * 4] = value; destination[i * 4 + 1] = value; destination[i * 4 + 2] = value; destination[i * 4 + 3] = 255;
+			}
+		}
+
+		static ktxpp_constexpr size_t ERROR_LANES = 48;
+
+		inline void squared_error8_scalar(const unsigned char* a, const unsigned char* b, size_t byteCount, uint64_t* sums, unsigned char* maxima)
+		{
+			for (size_t i = 0; i < byteCount; ++i)
+			{
+				unsigned char difference = a[i] > b[i] ? (unsigned char)(a[i] - b[i]) : (unsigned char)(b[i] - a[i]);
+				sums[i % ERROR_LANES] += (uint64_t)difference * difference;
+				maxima[i % ERROR_LANES] = difference > maxima[i % ERROR_LANES] ? difference : maxima[i % ERROR_LANES];
+			}
+		}
+
+		// Adds the 32-bit lane sums and byte maxima of one run of a SIMD kernel. laneBytes maps lane i to its byte
+		inline void flush_squared_error8(const uint32_t* laneSums, const unsigned char* laneMaxima, const unsigned char* laneBytes, size_t laneCount, uint64_t* sums, unsigned char* maxima)
+		{
+			for (size_t i = 0; i < laneCount; ++i)
+			{
+				sums[laneBytes[i] % ERROR_LANES] += laneSums[i];
+			}
+
+			for (size_t i = 0; i < laneCount; ++i)
+			{
+				maxima[i % ERROR_LANES] = laneMaxima[i] > maxima[i % ERROR_LANES] ? laneMaxima[i] : maxima[i % ERROR_LANES];
+			}
+		}
+
+		// Each 32-bit lane takes at most this many squares of up to 255 * 255 before it is flushed
+		static ktxpp_constexpr size_t ERROR_RUN = 32768;
+
+		inline void channel_stats8_scalar(const unsigned char* source, size_t byteCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima)
+		{
+			for (size_t i = 0; i < byteCount; ++i)
+			{
+				unsigned char value = source[i];
+				sums[i % ERROR_LANES] += value;
+				partials[i % ERROR_LANES] += value != 0 && value != 255;
+				minima[i % ERROR_LANES] = value < minima[i % ERROR_LANES] ? value : minima[i % ERROR_LANES];
+				maxima[i % ERROR_LANES] = value > maxima[i % ERROR_LANES] ? value : maxima[i % ERROR_LANES];
+			}
+		}
+
+		// Adds one run of a SIMD kernel. laneBytes maps sum lane i to its byte, the other lanes are already in byte order
+		inline void flush_channel_stats8(const uint16_t* laneSums, const unsigned char* laneBytes, const unsigned char* laneCounts, const unsigned char* laneMinima, const unsigned char* laneMaxima,
+			size_t laneCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima)
+		{
+			for (size_t i = 0; i < laneCount; ++i)
+			{
+				sums[laneBytes[i] % ERROR_LANES] += laneSums[i];
+				partials[i % ERROR_LANES] += laneCounts[i];
+				minima[i % ERROR_LANES] = laneMinima[i] < minima[i % ERROR_LANES] ? laneMinima[i] : minima[i % ERROR_LANES];
+				maxima[i % ERROR_LANES] = laneMaxima[i] > maxima[i % ERROR_LANES] ? laneMaxima[i] : maxima[i % ERROR_LANES];
+			}
+		}
+
+		// Sums are kept in 16-bit lanes and counts in 8-bit lanes, so a run is at most 255 iterations
+		static ktxpp_constexpr size_t STATS_RUN = 255;
+
+		// Bytes begin to end of every row, for the columns SIMD kernels leave over
+		inline void ssim_sums8_columns(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t begin, size_t end, size_t byteCount, uint32_t rowCount, uint32_t* sums)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint32_t sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					uint32_t valueA = a[row * pitchA + i], valueB = b[row * pitchB + i];
+					sumA += valueA; sumB += valueB;
+					sumAA += valueA * valueA; sumBB += valueB * valueB; sumAB += valueA * valueB;
+				}
+
+				sums[i] = sumA; sums[byteCount + i] = sumB;
+				sums[2 * byteCount + i] = sumAA; sums[3 * byteCount + i] = sumBB; sums[4 * byteCount + i] = sumAB;
+			}
+		}
+
+		inline void ssim_sums8_scalar(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t byteCount, uint32_t rowCount, uint32_t* sums)
+		{
+			ssim_sums8_columns(a, pitchA, b, pitchB, 0, byteCount, byteCount, rowCount, sums);
+		}
+
+		// Decoded sRGB values for each byte, then byte / 255 for alpha
+		inline const float* get_srgb8_to_linear_table()
+		{
+			struct Table
+			{
+				float values[512];
+
+				Table()
+				{
+					for (int i = 0; i < 256; ++i)
+					{
+						double value = i / 255.0;
+						values[i] = (float)(value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4));
+						values[i + 256] = (float)value;
+					}
+				}
+			};
+
+			static const Table table;
+			return table.values;
+		}
+
+		// Used at every level, gathering from the table measured no faster than these loads
+		inline void srgb8_to_linear_scalar(const unsigned char* source, float* destination, size_t pixelCount)
+		{
+			const float* table = get_srgb8_to_linear_table();
+
+			for (size_t i = 0; i < pixelCount * 4; i += 4)
+			{
+				destination[i]     = table[source[i]];
+				destination[i + 1] = table[source[i + 1]];
+				destination[i + 2] = table[source[i + 2]];
+				destination[i + 3] = table[source[i + 3] + 256];
+			}
+		}
+
+		// Encoding is piecewise linear over the 13 octaves below 1, 8 pieces per octave, indexed by the exponent and top
+		// 3 mantissa bits and interpolated by the next 8. Each entry holds the bias / 512 in the high half and the slope
+		// in the low half, fitted to the exact curve plus a half for rounding. Below 2^-13 everything encodes to 0
+		static const uint32_t LINEAR_TO_SRGB8_TABLE[104] =
+		{
+			0x00330007, 0x00770013, 0x00800007, 0x00800007, 0x00800007, 0x00800007, 0x00800007, 0x00800007,
+			0x00800014, 0x00800014, 0x00810014, 0x008e0014, 0x009a0014, 0x00a70014, 0x00f50018, 0x01000014,
+			0x0100002d, 0x0100002d, 0x0101002d, 0x011b002d, 0x01750033, 0x0180002d, 0x0180002d, 0x0182002d,
+			0x01de0061, 0x02000061, 0x02030061, 0x02770061, 0x02800061, 0x02df0062, 0x03000061, 0x03040061,
+			0x037800c8, 0x03df00cc, 0x044700ca, 0x04af00c8, 0x050000c8, 0x057a00c0, 0x05de00b6, 0x063d00b0,
+			0x06990152, 0x0744013c, 0x07e4012a, 0x087a0121, 0x090d010d, 0x09960100, 0x0a1900f7, 0x0a9700ec,
+			0x0b1101c5, 0x0bf301b1, 0x0ccc0191, 0x0d97017b, 0x0e55016f, 0x0f0f0158, 0x0fbd014a, 0x10630143,
+			0x1109025e, 0x1239023d, 0x1358021a, 0x14650204, 0x156601ea, 0x165a01d3, 0x174501bc, 0x182601a9,
+			0x18fe0330, 0x1a9702f8, 0x1c1702cc, 0x1d7d02ad, 0x1ed4028d, 0x201b026d, 0x21520256, 0x227c0242,
+			0x23a0043e, 0x25c203fa, 0x27c003bf, 0x29a10392, 0x2b690368, 0x2d1f033b, 0x2ebe031d, 0x304d02ff,
+			0x31d205ab, 0x34aa0550, 0x3752050c, 0x39d504c0, 0x3c37048a, 0x3e7d0453, 0x40a90424, 0x42be03fc,
+			0x44c30797, 0x48900718, 0x4c1f06b0, 0x4f76065e, 0x52a5060e, 0x55ac05ca, 0x58940589, 0x5b5a0553,
+			0x5e0b0a26, 0x631c097f, 0x67dc08f0, 0x6c55087e, 0x70970812, 0x74a307b7, 0x787c076e, 0x7c35071f
+		};
+
+		static ktxpp_constexpr uint32_t LINEAR_TO_SRGB8_MIN = (127 - 13) << 23; // 2^-13
+		static ktxpp_constexpr uint32_t LINEAR_TO_SRGB8_MAX = 0x3f7fffff; // Largest float below 1
+
+		inline uint32_t linear_to_srgb8_value(float value)
+		{
+			float minimum, maximum;
+			memcpy(&minimum, &LINEAR_TO_SRGB8_MIN, sizeof(float));
+			memcpy(&maximum, &LINEAR_TO_SRGB8_MAX, sizeof(float));
+
+			// Written so NaN fails the first test
+			value = value > minimum ? (value < maximum ? value : maximum) : minimum;
+
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			uint32_t entry = LINEAR_TO_SRGB8_TABLE[(bits - LINEAR_TO_SRGB8_MIN) >> 20];
+			return (((entry >> 16) << 9) + (entry & 0xFFFF) * ((bits >> 12) & 0xFF)) >> 16;
+		}
+
+		// Rounds to nearest even like the vector conversions, and has no add the compiler could fuse into the multiply
+		inline uint32_t linear_to_alpha8_value(float value)
+		{
+			value = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+			return (uint32_t)nearbyintf(value * 255.0f);
+		}
+
+		inline void linear_to_srgb8_scalar(const float* source, unsigned char* destination, size_t pixelCount)
+		{
+			for (size_t i = 0; i < pixelCount * 4; i += 4)
+			{
+				destination[i]     = (unsigned char)linear_to_srgb8_value(source[i]);
+				destination[i + 1] = (unsigned char)linear_to_srgb8_value(source[i + 1]);
+				destination[i + 2] = (unsigned char)linear_to_srgb8_value(source[i + 2]);
+				destination[i + 3] = (unsigned char)linear_to_alpha8_value(source[i + 3]);
+			}
+		}
+
+		// Pixel size of the 8-bit sRGB layouts the conversions take, 0 for anything else. bgr is set when blue comes first
+		inline uint32_t get_srgb8_pixel_bytes(const Descriptor& desc, bool& bgr)
+		{
+			bgr = desc.glFormat == GL_BGRA || desc.glFormat == GL_BGR;
+
+			if (desc.glType != GL_UNSIGNED_BYTE)
+			{
+				return 0;
+			}
+			else if (desc.glInternalFormat == GL_SRGB8_ALPHA8 && (desc.glFormat == GL_RGBA || desc.glFormat == GL_BGRA))
+			{
+				return 4;
+			}
+			else if (desc.glInternalFormat == GL_SRGB8 && (desc.glFormat == GL_RGB || desc.glFormat == GL_BGR))
+			{
+				return 3;
+			}
+
+			return 0;
+		}
+
+		// Other layouts go through the kernels in runs of this many pixels, reordered into RGBA8 on the stack
+		static ktxpp_constexpr size_t SRGB8_RUN_PIXELS = 256;
+
+		inline void srgb8_row_to_rgba8(const Kernels& kernels, const unsigned char* source, uint32_t pixelBytes, bool bgr, unsigned char* destination, size_t pixelCount)
+		{
+			if (pixelBytes == 4)
+			{
+				kernels.swap_red_blue(source, destination, pixelCount);
+				return;
+			}
+
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				destination[i * 4]     = source[i * 3 + (bgr ? 2 : 0)];
+				destination[i * 4 + 1] = source[i * 3 + 1];
+				destination[i * 4 + 2] = source[i * 3 + (bgr ? 0 : 2)];
+				destination[i * 4 + 3] = 255;
+			}
+		}
+
+		inline void rgba8_to_srgb8_row(const Kernels& kernels, const unsigned char* source, uint32_t pixelBytes, bool bgr, unsigned char* destination, size_t pixelCount)
+		{
+			if (pixelBytes == 4)
+			{
+				kernels.swap_red_blue(source, destination, pixelCount);
+				return;
+			}
+
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				destination[i * 3]     = source[i * 4 + (bgr ? 2 : 0)];
+				destination[i * 3 + 1] = source[i * 4 + 1];
+				destination[i * 3 + 2] = source[i * 4 + (bgr ? 0 : 2)];
+			}
+		}
+
+#if defined(ktxpp_x86)
+
+		// SSE2 has no byte shuffle, so everything is built from 16-bit shifts and word shuffles
+
+		inline __m128i byteswap16_sse2(__m128i v)
+		{
+			return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		}
+
+		inline void byteswap16_sse2(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			size_t i = 0;
+
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(source + i * 2));
+				_mm_storeu_si128((__m128i*)(destination + i * 2), byteswap16_sse2(v));
+			}
+
+			byteswap16_scalar(source + i * 2, destination + i * 2, count - i);
+		}
+
+		inline void byteswap32_sse2(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			size_t i = 0;
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(source + i * 4));
+				v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1); // Swap the 16-bit halves of each word
+				_mm_storeu_si128((__m128i*)(destination + i * 4), byteswap16_sse2(v));
+			}
+
+			byteswap32_scalar(source + i * 4, destination + i * 4, count - i);
+		}
+
+		inline void swap_red_blue_sse2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m128i greenAlpha = _mm_set1_epi32((int)0xFF00FF00);
+			const __m128i red        = _mm_set1_epi32(0x000000FF);
+			size_t i = 0;
+
+			for (; i + 4 <= pixelCount; i += 4)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(source + i * 4));
+				__m128i r = _mm_slli_epi32(_mm_and_si128(v, red), 16);
+				__m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), red);
+				v = _mm_or_si128(_mm_and_si128(v, greenAlpha), _mm_or_si128(r, b));
+				_mm_storeu_si128((__m128i*)(destination + i * 4), v);
+			}
+
+			swap_red_blue_scalar(source + i * 4, destination + i * 4, pixelCount - i);
+		}
+
+		// AVX2 and AVX-512 use a byte shuffle. The pattern repeats every 128 bits so in-lane shuffles are enough
+
+		template<size_t ElementBytes>
+		ktxpp_target_avx2 inline void shuffle_avx2(const unsigned char* source, unsigned char* destination, size_t byteCount, __m256i mask)
+		{
+			size_t i = 0;
+
+			for (; i + 32 <= byteCount; i += 32)
+			{
+				__m256i v = _mm256_loadu_si256((const __m256i*)(source + i));
+				_mm256_storeu_si256((__m256i*)(destination + i), _mm256_shuffle_epi8(v, mask));
+			}
+
+			if (ElementBytes == 2) { byteswap16_scalar(source + i, destination + i, (byteCount - i) / 2); }
+			if (ElementBytes == 4) { byteswap32_scalar(source + i, destination + i, (byteCount - i) / 4); }
+			if (ElementBytes == 0) { swap_red_blue_scalar(source + i, destination + i, (byteCount - i) / 4); }
+		}
+
+		ktxpp_target_avx2 inline void byteswap16_avx2(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			__m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+			shuffle_avx2<2>(source, destination, count * 2, mask);
+		}
+
+		ktxpp_target_avx2 inline void byteswap32_avx2(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			__m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+			shuffle_avx2<4>(source, destination, count * 4, mask);
+		}
+
+		ktxpp_target_avx2 inline void swap_red_blue_avx2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			__m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+			shuffle_avx2<0>(source, destination, pixelCount * 4, mask);
+		}
+
+		ktxpp_target_avx512 inline void shuffle_avx512(const unsigned char* source, unsigned char* destination, size_t byteCount, __m512i mask)
+		{
+			size_t i = 0;
+
+			for (; i + 64 <= byteCount; i += 64)
+			{
+				__m512i v = _mm512_loadu_si512((const void*)(source + i));
+				_mm512_storeu_si512((void*)(destination + i), _mm512_shuffle_epi8(v, mask));
+			}
+
+			// The tail is a single masked load and store instead of a scalar loop
+			if (i < byteCount)
+			{
+				__mmask64 tail = ~(__mmask64)0 >> (64 - (byteCount - i));
+				__m512i v = _mm512_maskz_loadu_epi8(tail, source + i);
+				_mm512_mask_storeu_epi8(destination + i, tail, _mm512_shuffle_epi8(v, mask));
+			}
+		}
+
+		// Masks are given as four little-endian words of byte indices, repeated in every 128-bit lane
+		ktxpp_target_avx512 inline void byteswap16_avx512(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			shuffle_avx512(source, destination, count * 2, _mm512_set4_epi32(0x0E0F0C0D, 0x0A0B0809, 0x06070405, 0x02030001));
+		}
+
+		ktxpp_target_avx512 inline void byteswap32_avx512(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			shuffle_avx512(source, destination, count * 4, _mm512_set4_epi32(0x0C0D0E0F, 0x08090A0B, 0x04050607, 0x00010203));
+		}
+
+		ktxpp_target_avx512 inline void swap_red_blue_avx512(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			shuffle_avx512(source, destination, pixelCount * 4, _mm512_set4_epi32(0x0F0C0D0E, 0x0B08090A, 0x07040506, 0x03000102));
+		}
+
+		// 4:2:2 works on 8 pairs at a time: every 32-bit pair is split into 16-bit Y0, Cb, Y1 and Cr lanes, the chroma
+		// terms are computed once per pair and the even and odd pixels are interleaved again when packing to bytes
+
+		inline __m128i yuv_channel_sse2(__m128i low, __m128i high, __m128i shift)
+		{
+			const __m128i byteMask = _mm_set1_epi32(0xFF);
+			return _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(low, shift), byteMask), _mm_and_si128(_mm_srl_epi32(high, shift), byteMask));
+		}
+
+		// Clamps both halves to bytes and interleaves them, even pixels first
+		inline __m128i yuv_pack_sse2(__m128i even, __m128i odd)
+		{
+			__m128i packed = _mm_packus_epi16(_mm_srai_epi16(even, 4), _mm_srai_epi16(odd, 4));
+			return _mm_unpacklo_epi8(packed, _mm_unpackhi_epi64(packed, packed));
+		}
+
+		inline void yuv422_to_rgba8_sse2(const unsigned char* source, unsigned char* destination, size_t pixelCount, const YuvConversion& conversion)
+		{
+			bool uyvy = conversion.layout == YuvUYVY;
+			__m128i lumaShift0 = _mm_cvtsi32_si128(uyvy ? 8 : 0);
+			__m128i lumaShift1 = _mm_cvtsi32_si128(uyvy ? 24 : 16);
+			__m128i cbShift = _mm_cvtsi32_si128(uyvy ? 0 : 8);
+			__m128i crShift = _mm_cvtsi32_si128(uyvy ? 16 : 24);
+
+			// The rounding of the final shift is folded into the chroma terms
+			const __m128i lumaBias = _mm_set1_epi16(conversion.lumaBias);
+			const __m128i chromaBias = _mm_set1_epi16(128);
+			const __m128i rounding = _mm_set1_epi16(8);
+			const __m128i lumaScale = _mm_set1_epi16(conversion.lumaScale);
+			const __m128i redCr = _mm_set1_epi16(conversion.redCr);
+			const __m128i greenCb = _mm_set1_epi16(conversion.greenCb);
+			const __m128i greenCr = _mm_set1_epi16(conversion.greenCr);
+			const __m128i blueCb = _mm_set1_epi16(conversion.blueCb);
+			const __m128i alpha = _mm_set1_epi8((char)0xFF);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				__m128i low = _mm_loadu_si128((const __m128i*)(source + i * 2));
+				__m128i high = _mm_loadu_si128((const __m128i*)(source + i * 2 + 16));
+
+				__m128i cb = _mm_slli_epi16(_mm_sub_epi16(yuv_channel_sse2(low, high, cbShift), chromaBias), 7);
+				__m128i cr = _mm_slli_epi16(_mm_sub_epi16(yuv_channel_sse2(low, high, crShift), chromaBias), 7);
+				__m128i red = _mm_add_epi16(_mm_mulhi_epi16(cr, redCr), rounding);
+				__m128i green = _mm_sub_epi16(rounding, _mm_add_epi16(_mm_mulhi_epi16(cb, greenCb), _mm_mulhi_epi16(cr, greenCr)));
+				__m128i blue = _mm_add_epi16(_mm_mulhi_epi16(cb, blueCb), rounding);
+
+				__m128i luma0 = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(yuv_channel_sse2(low, high, lumaShift0), lumaBias), 7), lumaScale);
+				__m128i luma1 = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(yuv_channel_sse2(low, high, lumaShift1), lumaBias), 7), lumaScale);
+
+				__m128i r = yuv_pack_sse2(_mm_add_epi16(luma0, red), _mm_add_epi16(luma1, red));
+				__m128i g = yuv_pack_sse2(_mm_add_epi16(luma0, green), _mm_add_epi16(luma1, green));
+				__m128i b = yuv_pack_sse2(_mm_add_epi16(luma0, blue), _mm_add_epi16(luma1, blue));
+
+				__m128i rg = _mm_unpacklo_epi8(r, g), ba = _mm_unpacklo_epi8(b, alpha);
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_unpacklo_epi16(rg, ba));
+				_mm_storeu_si128((__m128i*)(destination + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+				rg = _mm_unpackhi_epi8(r, g); ba = _mm_unpackhi_epi8(b, alpha);
+				_mm_storeu_si128((__m128i*)(destination + i * 4 + 32), _mm_unpacklo_epi16(rg, ba));
+				_mm_storeu_si128((__m128i*)(destination + i * 4 + 48), _mm_unpackhi_epi16(rg, ba));
+			}
+
+			yuv422_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i, conversion);
+		}
+
+		// RGBG and GRGB build the even and odd pixel of each pair with masks and shifts, then interleave them
+
+		template<bool GreenFirst>
+		inline void rgbg_to_rgba8_sse2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+			const __m128i redBlue = _mm_set1_epi32(0x00FF00FF);
+			const __m128i green = _mm_set1_epi32(0x0000FF00);
+			const __m128i color = _mm_set1_epi32(0x00FFFFFF);
+			size_t i = 0;
+
+			for (; i + 8 <= pixelCount; i += 8)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(source + i * 2));
+				__m128i even, odd;
+
+				if (GreenFirst)
+				{
+					__m128i shifted = _mm_srli_epi32(v, 8);
+					even = _mm_or_si128(_mm_and_si128(shifted, redBlue), _mm_and_si128(_mm_slli_epi32(v, 8), green));
+					odd = _mm_and_si128(shifted, color);
+				}
+				else
+				{
+					even = _mm_and_si128(v, color);
+					odd = _mm_or_si128(_mm_and_si128(v, redBlue), _mm_and_si128(_mm_srli_epi32(v, 16), green));
+				}
+
+				even = _mm_or_si128(even, alpha);
+				odd = _mm_or_si128(odd, alpha);
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_unpacklo_epi32(even, odd));
+				_mm_storeu_si128((__m128i*)(destination + i * 4 + 16), _mm_unpackhi_epi32(even, odd));
+			}
+
+			if (GreenFirst) { grgb_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+			else            { rgbg_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+		}
+
+		// Each source byte is broadcast and tested against one bit per pixel
+		inline void bw1bpp_to_rgba8_sse2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+			const __m128i highBits = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+			const __m128i lowBits = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+			size_t i = 0;
+
+			for (; i + 8 <= pixelCount; i += 8)
+			{
+				__m128i v = _mm_set1_epi32(source[i / 8]);
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(v, highBits), highBits), alpha));
+				_mm_storeu_si128((__m128i*)(destination + i * 4 + 16), _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(v, lowBits), lowBits), alpha));
+			}
+
+			bw1bpp_to_rgba8_scalar(source + i / 8, destination + i * 4, pixelCount - i);
+		}
+
+		// 48 bytes per iteration, three vectors whose byte lanes always hold the same channels. Absolute differences come
+		// from saturating subtraction both ways, and squares fit 16 bits before being widened into 32-bit sums
+		inline void squared_error8_sse2(const unsigned char* a, const unsigned char* b, size_t byteCount, uint64_t* sums, unsigned char* maxima)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+
+			while (byteCount - i >= ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / ERROR_LANES, ERROR_RUN) * ERROR_LANES;
+				__m128i accumulators[12], maximum[3];
+
+				for (int v = 0; v < 12; ++v) { accumulators[v] = zero; }
+				for (int v = 0; v < 3; ++v) { maximum[v] = zero; }
+
+				for (; i < runEnd; i += ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						__m128i x = _mm_loadu_si128((const __m128i*)(a + i + v * 16));
+						__m128i y = _mm_loadu_si128((const __m128i*)(b + i + v * 16));
+						__m128i difference = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+						maximum[v] = _mm_max_epu8(maximum[v], difference);
+
+						__m128i low = _mm_unpacklo_epi8(difference, zero), high = _mm_unpackhi_epi8(difference, zero);
+						low = _mm_mullo_epi16(low, low);
+						high = _mm_mullo_epi16(high, high);
+						accumulators[v * 4] = _mm_add_epi32(accumulators[v * 4], _mm_unpacklo_epi16(low, zero));
+						accumulators[v * 4 + 1] = _mm_add_epi32(accumulators[v * 4 + 1], _mm_unpackhi_epi16(low, zero));
+						accumulators[v * 4 + 2] = _mm_add_epi32(accumulators[v * 4 + 2], _mm_unpacklo_epi16(high, zero));
+						accumulators[v * 4 + 3] = _mm_add_epi32(accumulators[v * 4 + 3], _mm_unpackhi_epi16(high, zero));
+					}
+				}
+
+				uint32_t laneSums[48];
+				unsigned char laneMaxima[48], laneBytes[48];
+
+				for (int v = 0; v < 12; ++v) { _mm_storeu_si128((__m128i*)(laneSums + v * 4), accumulators[v]); }
+				for (int v = 0; v < 3; ++v) { _mm_storeu_si128((__m128i*)(laneMaxima + v * 16), maximum[v]); }
+				for (int lane = 0; lane < 48; ++lane) { laneBytes[lane] = (unsigned char)lane; }
+
+				flush_squared_error8(laneSums, laneMaxima, laneBytes, 48, sums, maxima);
+			}
+
+			squared_error8_scalar(a + i, b + i, byteCount - i, sums, maxima);
+		}
+
+		// 48 bytes per iteration like squared_error8. Values other than 0 and 255 are found by comparing with both
+		inline void channel_stats8_sse2(const unsigned char* source, size_t byteCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima)
+		{
+			const __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi8(-1), one = _mm_set1_epi8(1);
+			size_t i = 0;
+
+			while (byteCount - i >= ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / ERROR_LANES, STATS_RUN) * ERROR_LANES;
+				__m128i accumulators[6], counts[3], minimum[3], maximum[3];
+
+				for (int v = 0; v < 6; ++v) { accumulators[v] = zero; }
+				for (int v = 0; v < 3; ++v) { counts[v] = zero; minimum[v] = full; maximum[v] = zero; }
+
+				for (; i < runEnd; i += ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						__m128i x = _mm_loadu_si128((const __m128i*)(source + i + v * 16));
+						minimum[v] = _mm_min_epu8(minimum[v], x);
+						maximum[v] = _mm_max_epu8(maximum[v], x);
+						accumulators[v * 2] = _mm_add_epi16(accumulators[v * 2], _mm_unpacklo_epi8(x, zero));
+						accumulators[v * 2 + 1] = _mm_add_epi16(accumulators[v * 2 + 1], _mm_unpackhi_epi8(x, zero));
+
+						__m128i extreme = _mm_or_si128(_mm_cmpeq_epi8(x, zero), _mm_cmpeq_epi8(x, full));
+						counts[v] = _mm_add_epi8(counts[v], _mm_andnot_si128(extreme, one));
+					}
+				}
+
+				uint16_t laneSums[48];
+				unsigned char laneBytes[48], laneCounts[48], laneMinima[48], laneMaxima[48];
+
+				for (int v = 0; v < 6; ++v) { _mm_storeu_si128((__m128i*)(laneSums + v * 8), accumulators[v]); }
+
+				for (int v = 0; v < 3; ++v)
+				{
+					_mm_storeu_si128((__m128i*)(laneCounts + v * 16), counts[v]);
+					_mm_storeu_si128((__m128i*)(laneMinima + v * 16), minimum[v]);
+					_mm_storeu_si128((__m128i*)(laneMaxima + v * 16), maximum[v]);
+				}
+
+				for (int lane = 0; lane < 48; ++lane) { laneBytes[lane] = (unsigned char)lane; }
+
+				flush_channel_stats8(laneSums, laneBytes, laneCounts, laneMinima, laneMaxima, 48, sums, partials, minima, maxima);
+			}
+
+			channel_stats8_scalar(source + i, byteCount - i, sums, partials, minima, maxima);
+		}
+
+		// 16 columns at a time down every row. Bytes and their products fit 16 bits, and are widened into 32-bit sums
+		inline void ssim_sums8_sse2(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t byteCount, uint32_t rowCount, uint32_t* sums)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+
+			for (; byteCount - i >= 16; i += 16)
+			{
+				__m128i accumulators[5][4];
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { accumulators[k][v] = zero; } }
+
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					__m128i x = _mm_loadu_si128((const __m128i*)(a + row * pitchA + i));
+					__m128i y = _mm_loadu_si128((const __m128i*)(b + row * pitchB + i));
+					__m128i values[5][2] = { { _mm_unpacklo_epi8(x, zero), _mm_unpackhi_epi8(x, zero) }, { _mm_unpacklo_epi8(y, zero), _mm_unpackhi_epi8(y, zero) } };
+
+					for (int half = 0; half < 2; ++half)
+					{
+						values[2][half] = _mm_mullo_epi16(values[0][half], values[0][half]);
+						values[3][half] = _mm_mullo_epi16(values[1][half], values[1][half]);
+						values[4][half] = _mm_mullo_epi16(values[0][half], values[1][half]);
+					}
+
+					for (int k = 0; k < 5; ++k)
+					{
+						accumulators[k][0] = _mm_add_epi32(accumulators[k][0], _mm_unpacklo_epi16(values[k][0], zero));
+						accumulators[k][1] = _mm_add_epi32(accumulators[k][1], _mm_unpackhi_epi16(values[k][0], zero));
+						accumulators[k][2] = _mm_add_epi32(accumulators[k][2], _mm_unpacklo_epi16(values[k][1], zero));
+						accumulators[k][3] = _mm_add_epi32(accumulators[k][3], _mm_unpackhi_epi16(values[k][1], zero));
+					}
+				}
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { _mm_storeu_si128((__m128i*)(sums + k * byteCount + i + v * 4), accumulators[k][v]); } }
+			}
+
+			ssim_sums8_columns(a, pitchA, b, pitchB, i, byteCount, byteCount, rowCount, sums);
+		}
+
+		// One RGBA pixel to four 32-bit values. SSE2 can't gather, so the table entries are loaded one by one
+		inline __m128i linear_to_srgb8_sse2(__m128 value)
+		{
+			const __m128 minimum = _mm_castsi128_ps(_mm_set1_epi32((int)LINEAR_TO_SRGB8_MIN));
+			const __m128 maximum = _mm_castsi128_ps(_mm_set1_epi32((int)LINEAR_TO_SRGB8_MAX));
+			const __m128i low16 = _mm_set1_epi32(0xFFFF), low8 = _mm_set1_epi32(0xFF);
+			const __m128i alphaMask = _mm_setr_epi32(0, 0, 0, -1);
+
+			// maxps returns its second operand when either is NaN
+			__m128i bits = _mm_castps_si128(_mm_min_ps(_mm_max_ps(value, minimum), maximum));
+
+			uint32_t index[4];
+			_mm_storeu_si128((__m128i*)index, _mm_srli_epi32(_mm_sub_epi32(bits, _mm_set1_epi32((int)LINEAR_TO_SRGB8_MIN)), 20));
+			__m128i entry = _mm_setr_epi32((int)LINEAR_TO_SRGB8_TABLE[index[0]], (int)LINEAR_TO_SRGB8_TABLE[index[1]], (int)LINEAR_TO_SRGB8_TABLE[index[2]], (int)LINEAR_TO_SRGB8_TABLE[index[3]]);
+
+			// Slopes and interpolants fit 16 bits with the high halves zero, so madd is a 32-bit multiply here
+			__m128i bias = _mm_slli_epi32(_mm_srli_epi32(entry, 16), 9);
+			__m128i product = _mm_madd_epi16(_mm_and_si128(entry, low16), _mm_and_si128(_mm_srli_epi32(bits, 12), low8));
+			__m128i srgb = _mm_srli_epi32(_mm_add_epi32(bias, product), 16);
+
+			__m128 alpha = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			__m128i alpha8 = _mm_cvtps_epi32(_mm_mul_ps(alpha, _mm_set1_ps(255.0f)));
+			return _mm_or_si128(_mm_andnot_si128(alphaMask, srgb), _mm_and_si128(alphaMask, alpha8));
+		}
+
+		inline void linear_to_srgb8_sse2(const float* source, unsigned char* destination, size_t pixelCount)
+		{
+			size_t i = 0;
+
+			for (; i + 4 <= pixelCount; i += 4)
+			{
+				__m128i p0 = linear_to_srgb8_sse2(_mm_loadu_ps(source + i * 4));
+				__m128i p1 = linear_to_srgb8_sse2(_mm_loadu_ps(source + i * 4 + 4));
+				__m128i p2 = linear_to_srgb8_sse2(_mm_loadu_ps(source + i * 4 + 8));
+				__m128i p3 = linear_to_srgb8_sse2(_mm_loadu_ps(source + i * 4 + 12));
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+			}
+
+			linear_to_srgb8_scalar(source + i * 4, destination + i * 4, pixelCount - i);
+		}
+
+		// The AVX2 version does the same in each 128-bit lane, 16 pairs at a time, and puts the lanes back in order when
+		// storing. AVX-512 uses it too, the wider registers would only move the lane shuffling around
+
+		ktxpp_target_avx2 inline __m256i yuv_channel_avx2(__m256i low, __m256i high, __m128i shift)
+		{
+			const __m256i byteMask = _mm256_set1_epi32(0xFF);
+			return _mm256_packs_epi32(_mm256_and_si256(_mm256_srl_epi32(low, shift), byteMask), _mm256_and_si256(_mm256_srl_epi32(high, shift), byteMask));
+		}
+
+		ktxpp_target_avx2 inline __m256i yuv_pack_avx2(__m256i even, __m256i odd)
+		{
+			__m256i packed = _mm256_packus_epi16(_mm256_srai_epi16(even, 4), _mm256_srai_epi16(odd, 4));
+			return _mm256_unpacklo_epi8(packed, _mm256_unpackhi_epi64(packed, packed));
+		}
+
+		ktxpp_target_avx2 inline void yuv422_to_rgba8_avx2(const unsigned char* source, unsigned char* destination, size_t pixelCount, const YuvConversion& conversion)
+		{
+			bool uyvy = conversion.layout == YuvUYVY;
+			__m128i lumaShift0 = _mm_cvtsi32_si128(uyvy ? 8 : 0);
+			__m128i lumaShift1 = _mm_cvtsi32_si128(uyvy ? 24 : 16);
+			__m128i cbShift = _mm_cvtsi32_si128(uyvy ? 0 : 8);
+			__m128i crShift = _mm_cvtsi32_si128(uyvy ? 16 : 24);
+
+			const __m256i lumaBias = _mm256_set1_epi16(conversion.lumaBias);
+			const __m256i chromaBias = _mm256_set1_epi16(128);
+			const __m256i rounding = _mm256_set1_epi16(8);
+			const __m256i lumaScale = _mm256_set1_epi16(conversion.lumaScale);
+			const __m256i redCr = _mm256_set1_epi16(conversion.redCr);
+			const __m256i greenCb = _mm256_set1_epi16(conversion.greenCb);
+			const __m256i greenCr = _mm256_set1_epi16(conversion.greenCr);
+			const __m256i blueCb = _mm256_set1_epi16(conversion.blueCb);
+			const __m256i alpha = _mm256_set1_epi8((char)0xFF);
+			size_t i = 0;
+
+			for (; i + 32 <= pixelCount; i += 32)
+			{
+				__m256i low = _mm256_loadu_si256((const __m256i*)(source + i * 2));
+				__m256i high = _mm256_loadu_si256((const __m256i*)(source + i * 2 + 32));
+
+				__m256i cb = _mm256_slli_epi16(_mm256_sub_epi16(yuv_channel_avx2(low, high, cbShift), chromaBias), 7);
+				__m256i cr = _mm256_slli_epi16(_mm256_sub_epi16(yuv_channel_avx2(low, high, crShift), chromaBias), 7);
+				__m256i red = _mm256_add_epi16(_mm256_mulhi_epi16(cr, redCr), rounding);
+				__m256i green = _mm256_sub_epi16(rounding, _mm256_add_epi16(_mm256_mulhi_epi16(cb, greenCb), _mm256_mulhi_epi16(cr, greenCr)));
+				__m256i blue = _mm256_add_epi16(_mm256_mulhi_epi16(cb, blueCb), rounding);
+
+				__m256i luma0 = _mm256_mulhi_epi16(_mm256_slli_epi16(_mm256_sub_epi16(yuv_channel_avx2(low, high, lumaShift0), lumaBias), 7), lumaScale);
+				__m256i luma1 = _mm256_mulhi_epi16(_mm256_slli_epi16(_mm256_sub_epi16(yuv_channel_avx2(low, high, lumaShift1), lumaBias), 7), lumaScale);
+
+				__m256i r = yuv_pack_avx2(_mm256_add_epi16(luma0, red), _mm256_add_epi16(luma1, red));
+				__m256i g = yuv_pack_avx2(_mm256_add_epi16(luma0, green), _mm256_add_epi16(luma1, green));
+				__m256i b = yuv_pack_avx2(_mm256_add_epi16(luma0, blue), _mm256_add_epi16(luma1, blue));
+
+				// Lane 0 holds pixels 0-7 and 16-23, lane 1 pixels 8-15 and 24-31
+				__m256i rg = _mm256_unpacklo_epi8(r, g), ba = _mm256_unpacklo_epi8(b, alpha);
+				__m256i first = _mm256_unpacklo_epi16(rg, ba), second = _mm256_unpackhi_epi16(rg, ba);
+				_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_permute2x128_si256(first, second, 0x20));
+				_mm256_storeu_si256((__m256i*)(destination + i * 4 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+
+				rg = _mm256_unpackhi_epi8(r, g); ba = _mm256_unpackhi_epi8(b, alpha);
+				first = _mm256_unpacklo_epi16(rg, ba); second = _mm256_unpackhi_epi16(rg, ba);
+				_mm256_storeu_si256((__m256i*)(destination + i * 4 + 64), _mm256_permute2x128_si256(first, second, 0x20));
+				_mm256_storeu_si256((__m256i*)(destination + i * 4 + 96), _mm256_permute2x128_si256(first, second, 0x31));
+			}
+
+			yuv422_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i, conversion);
+		}
+
+		// AVX2 and AVX-512 spread two pairs into each 128-bit lane and expand them with a byte shuffle. Shuffle indices
+		// with the top bit set give zero, which alpha is ORed into
+
+		template<bool GreenFirst>
+		ktxpp_target_avx2 inline void rgbg_to_rgba8_avx2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m256i mask = GreenFirst ?
+				_mm256_setr_epi8(1, 0, 3, -1, 1, 2, 3, -1, 5, 4, 7, -1, 5, 6, 7, -1, 1, 0, 3, -1, 1, 2, 3, -1, 5, 4, 7, -1, 5, 6, 7, -1) :
+				_mm256_setr_epi8(0, 1, 2, -1, 0, 3, 2, -1, 4, 5, 6, -1, 4, 7, 6, -1, 0, 1, 2, -1, 0, 3, 2, -1, 4, 5, 6, -1, 4, 7, 6, -1);
+			const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				__m256i low = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(source + i * 2))), 0x50);
+				__m256i high = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(source + i * 2 + 16))), 0x50);
+				_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(low, mask), alpha));
+				_mm256_storeu_si256((__m256i*)(destination + i * 4 + 32), _mm256_or_si256(_mm256_shuffle_epi8(high, mask), alpha));
+			}
+
+			if (GreenFirst) { grgb_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+			else            { rgbg_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+		}
+
+		ktxpp_target_avx2 inline void bw1bpp_to_rgba8_avx2(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+			const __m256i bits = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+			size_t i = 0;
+
+			for (; i + 8 <= pixelCount; i += 8)
+			{
+				__m256i v = _mm256_set1_epi32(source[i / 8]);
+				_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits), alpha));
+			}
+
+			bw1bpp_to_rgba8_scalar(source + i / 8, destination + i * 4, pixelCount - i);
+		}
+
+		// Masks are given as in byteswap16_avx512, 0x80 marks the alpha bytes
+		template<bool GreenFirst>
+		ktxpp_target_avx512 inline void rgbg_to_rgba8_avx512(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m512i mask = GreenFirst ? _mm512_set4_epi32(0x80070605, 0x80070405, 0x80030201, 0x80030001) : _mm512_set4_epi32(0x80060704, 0x80060504, 0x80020300, 0x80020100);
+			const __m512i spread = _mm512_set_epi64(3, 3, 2, 2, 1, 1, 0, 0);
+			const __m512i alpha = _mm512_set1_epi32((int)0xFF000000);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				// The zeroing forms keep GCC 12 from warning about the undefined upper lanes of cast and unmasked intrinsics
+				__m512i v = _mm512_maskz_permutexvar_epi64(0xff, spread, _mm512_maskz_loadu_epi64(0x0f, source + i * 2));
+				_mm512_storeu_si512((void*)(destination + i * 4), _mm512_or_si512(_mm512_shuffle_epi8(v, mask), alpha));
+			}
+
+			if (GreenFirst) { grgb_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+			else            { rgbg_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+		}
+
+		// Two source bytes per iteration, each bit selecting white or black through an opmask
+		ktxpp_target_avx512 inline void bw1bpp_to_rgba8_avx512(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			const __m512i bits = _mm512_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x8000, 0x4000, 0x2000, 0x1000, 0x0800, 0x0400, 0x0200, 0x0100);
+			const __m512i black = _mm512_set1_epi32((int)0xFF000000);
+			const __m512i white = _mm512_set1_epi32(-1);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				__mmask16 set = _mm512_test_epi32_mask(_mm512_set1_epi32(source[i / 8] | (source[i / 8 + 1] << 8)), bits);
+				_mm512_storeu_si512((void*)(destination + i * 4), _mm512_mask_mov_epi32(black, set, white));
+			}
+
+			bw1bpp_to_rgba8_scalar(source + i / 8, destination + i * 4, pixelCount - i);
+		}
+
+		// 96 bytes per iteration, which is two periods of 48. Unpacking works within 128-bit lanes, so the low half of
+		// each widened vector comes from bytes 0-15 of the source vector and the high half from bytes 16-31
+		ktxpp_target_avx2 inline void squared_error8_avx2(const unsigned char* a, const unsigned char* b, size_t byteCount, uint64_t* sums, unsigned char* maxima)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			size_t i = 0;
+
+			while (byteCount - i >= 2 * ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / (2 * ERROR_LANES), ERROR_RUN) * 2 * ERROR_LANES;
+				__m256i accumulators[12], maximum[3];
+
+				for (int v = 0; v < 12; ++v) { accumulators[v] = zero; }
+				for (int v = 0; v < 3; ++v) { maximum[v] = zero; }
+
+				for (; i < runEnd; i += 2 * ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						__m256i x = _mm256_loadu_si256((const __m256i*)(a + i + v * 32));
+						__m256i y = _mm256_loadu_si256((const __m256i*)(b + i + v * 32));
+						__m256i difference = _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+						maximum[v] = _mm256_max_epu8(maximum[v], difference);
+
+						__m256i low = _mm256_unpacklo_epi8(difference, zero), high = _mm256_unpackhi_epi8(difference, zero);
+						low = _mm256_mullo_epi16(low, low);
+						high = _mm256_mullo_epi16(high, high);
+						accumulators[v * 4] = _mm256_add_epi32(accumulators[v * 4], _mm256_unpacklo_epi16(low, zero));
+						accumulators[v * 4 + 1] = _mm256_add_epi32(accumulators[v * 4 + 1], _mm256_unpackhi_epi16(low, zero));
+						accumulators[v * 4 + 2] = _mm256_add_epi32(accumulators[v * 4 + 2], _mm256_unpacklo_epi16(high, zero));
+						accumulators[v * 4 + 3] = _mm256_add_epi32(accumulators[v * 4 + 3], _mm256_unpackhi_epi16(high, zero));
+					}
+				}
+
+				uint32_t laneSums[96];
+				unsigned char laneMaxima[96], laneBytes[96];
+
+				for (int v = 0; v < 12; ++v) { _mm256_storeu_si256((__m256i*)(laneSums + v * 8), accumulators[v]); }
+				for (int v = 0; v < 3; ++v) { _mm256_storeu_si256((__m256i*)(laneMaxima + v * 32), maximum[v]); }
+
+				for (int lane = 0; lane < 96; ++lane)
+				{
+					int v = lane / 32, quarter = (lane / 8) % 4, element = lane % 8;
+					laneBytes[lane] = (unsigned char)(v * 32 + (element < 4 ? 0 : 16) + quarter * 4 + element % 4);
+				}
+
+				flush_squared_error8(laneSums, laneMaxima, laneBytes, 96, sums, maxima);
+			}
+
+			squared_error8_scalar(a + i, b + i, byteCount - i, sums, maxima);
+		}
+
+		// 96 bytes per iteration, with the sums unpacked within 128-bit lanes as in squared_error8_avx2
+		ktxpp_target_avx2 inline void channel_stats8_avx2(const unsigned char* source, size_t byteCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima)
+		{
+			const __m256i zero = _mm256_setzero_si256(), full = _mm256_set1_epi8(-1), one = _mm256_set1_epi8(1);
+			size_t i = 0;
+
+			while (byteCount - i >= 2 * ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / (2 * ERROR_LANES), STATS_RUN) * 2 * ERROR_LANES;
+				__m256i accumulators[6], counts[3], minimum[3], maximum[3];
+
+				for (int v = 0; v < 6; ++v) { accumulators[v] = zero; }
+				for (int v = 0; v < 3; ++v) { counts[v] = zero; minimum[v] = full; maximum[v] = zero; }
+
+				for (; i < runEnd; i += 2 * ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						__m256i x = _mm256_loadu_si256((const __m256i*)(source + i + v * 32));
+						minimum[v] = _mm256_min_epu8(minimum[v], x);
+						maximum[v] = _mm256_max_epu8(maximum[v], x);
+						accumulators[v * 2] = _mm256_add_epi16(accumulators[v * 2], _mm256_unpacklo_epi8(x, zero));
+						accumulators[v * 2 + 1] = _mm256_add_epi16(accumulators[v * 2 + 1], _mm256_unpackhi_epi8(x, zero));
+
+						__m256i extreme = _mm256_or_si256(_mm256_cmpeq_epi8(x, zero), _mm256_cmpeq_epi8(x, full));
+						counts[v] = _mm256_add_epi8(counts[v], _mm256_andnot_si256(extreme, one));
+					}
+				}
+
+				uint16_t laneSums[96];
+				unsigned char laneBytes[96], laneCounts[96], laneMinima[96], laneMaxima[96];
+
+				for (int v = 0; v < 6; ++v) { _mm256_storeu_si256((__m256i*)(laneSums + v * 16), accumulators[v]); }
+
+				for (int v = 0; v < 3; ++v)
+				{
+					_mm256_storeu_si256((__m256i*)(laneCounts + v * 32), counts[v]);
+					_mm256_storeu_si256((__m256i*)(laneMinima + v * 32), minimum[v]);
+					_mm256_storeu_si256((__m256i*)(laneMaxima + v * 32), maximum[v]);
+				}
+
+				for (int lane = 0; lane < 96; ++lane)
+				{
+					int v = lane / 32, half = (lane / 16) % 2, element = lane % 16;
+					laneBytes[lane] = (unsigned char)(v * 32 + (element < 8 ? 0 : 16) + half * 8 + element % 8);
+				}
+
+				flush_channel_stats8(laneSums, laneBytes, laneCounts, laneMinima, laneMaxima, 96, sums, partials, minima, maxima);
+			}
+
+			channel_stats8_scalar(source + i, byteCount - i, sums, partials, minima, maxima);
+		}
+
+		// 32 columns at a time like ssim_sums8_sse2. The bytes are widened straight to 32 bits, which keeps them in
+		// order across the 128-bit lanes
+		ktxpp_target_avx2 inline void ssim_sums8_avx2(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t byteCount, uint32_t rowCount, uint32_t* sums)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			size_t i = 0;
+
+			for (; byteCount - i >= 32; i += 32)
+			{
+				__m256i accumulators[5][4];
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { accumulators[k][v] = zero; } }
+
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					for (int v = 0; v < 4; ++v)
+					{
+						__m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(a + row * pitchA + i + v * 8)));
+						__m256i y = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(b + row * pitchB + i + v * 8)));
+
+						// The high 16 bits of every lane are 0, so multiply-add gives the plain products
+						accumulators[0][v] = _mm256_add_epi32(accumulators[0][v], x);
+						accumulators[1][v] = _mm256_add_epi32(accumulators[1][v], y);
+						accumulators[2][v] = _mm256_add_epi32(accumulators[2][v], _mm256_madd_epi16(x, x));
+						accumulators[3][v] = _mm256_add_epi32(accumulators[3][v], _mm256_madd_epi16(y, y));
+						accumulators[4][v] = _mm256_add_epi32(accumulators[4][v], _mm256_madd_epi16(x, y));
+					}
+				}
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { _mm256_storeu_si256((__m256i*)(sums + k * byteCount + i + v * 8), accumulators[k][v]); } }
+			}
+
+			ssim_sums8_columns(a, pitchA, b, pitchB, i, byteCount, byteCount, rowCount, sums);
+		}
+
+		// Gathers the table entries two pixels at a time. AVX-512 uses this too, the lookups are the limit rather than
+		// the width
+		ktxpp_target_avx2 inline __m256i linear_to_srgb8_avx2(__m256 value)
+		{
+			const __m256 minimum = _mm256_castsi256_ps(_mm256_set1_epi32((int)LINEAR_TO_SRGB8_MIN));
+			const __m256 maximum = _mm256_castsi256_ps(_mm256_set1_epi32((int)LINEAR_TO_SRGB8_MAX));
+			const __m256i low16 = _mm256_set1_epi32(0xFFFF), low8 = _mm256_set1_epi32(0xFF);
+
+			__m256i bits = _mm256_castps_si256(_mm256_min_ps(_mm256_max_ps(value, minimum), maximum));
+			__m256i index = _mm256_srli_epi32(_mm256_sub_epi32(bits, _mm256_set1_epi32((int)LINEAR_TO_SRGB8_MIN)), 20);
+			__m256i entry = _mm256_i32gather_epi32((const int*)LINEAR_TO_SRGB8_TABLE, index, 4);
+
+			__m256i bias = _mm256_slli_epi32(_mm256_srli_epi32(entry, 16), 9);
+			__m256i product = _mm256_madd_epi16(_mm256_and_si256(entry, low16), _mm256_and_si256(_mm256_srli_epi32(bits, 12), low8));
+			__m256i srgb = _mm256_srli_epi32(_mm256_add_epi32(bias, product), 16);
+
+			__m256 alpha = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			return _mm256_blend_epi32(srgb, _mm256_cvtps_epi32(_mm256_mul_ps(alpha, _mm256_set1_ps(255.0f))), 0x88);
+		}
+
+		ktxpp_target_avx2 inline void linear_to_srgb8_avx2(const float* source, unsigned char* destination, size_t pixelCount)
+		{
+			// Packing works within 128-bit lanes, leaving pixels 0 2 4 6 1 3 5 7
+			const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			size_t i = 0;
+
+			for (; i + 8 <= pixelCount; i += 8)
+			{
+				__m256i p01 = linear_to_srgb8_avx2(_mm256_loadu_ps(source + i * 4));
+				__m256i p23 = linear_to_srgb8_avx2(_mm256_loadu_ps(source + i * 4 + 8));
+				__m256i p45 = linear_to_srgb8_avx2(_mm256_loadu_ps(source + i * 4 + 16));
+				__m256i p67 = linear_to_srgb8_avx2(_mm256_loadu_ps(source + i * 4 + 24));
+				__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_packs_epi32(p45, p67));
+				_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_permutevar8x32_epi32(packed, order));
+			}
+
+			linear_to_srgb8_scalar(source + i * 4, destination + i * 4, pixelCount - i);
+		}
+
+		inline void cpuid(int leaf, int subleaf, int registers[4])
+		{
+#if defined(_MSC_VER)
+			__cpuidex(registers, leaf, subleaf);
+#else
+			unsigned int a = 0, b = 0, c = 0, d = 0;
+			__cpuid_count(leaf, subleaf, a, b, c, d);
+			registers[0] = (int)a; registers[1] = (int)b; registers[2] = (int)c; registers[3] = (int)d;
+#endif
+		}
+
+		// Which register states the OS saves on context switches. AVX needs YMM, AVX-512 also needs opmask and ZMM
+		inline uint64_t get_xcr0()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return ((uint64_t)edx << 32) | eax;
+#endif
+		}
+
+#elif defined(ktxpp_neon)
+
+		inline void byteswap16_neon(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			size_t i = 0;
+
+			for (; i + 8 <= count; i += 8)
+			{
+				vst1q_u8(destination + i * 2, vrev16q_u8(vld1q_u8(source + i * 2)));
+			}
+
+			byteswap16_scalar(source + i * 2, destination + i * 2, count - i);
+		}
+
+		inline void byteswap32_neon(const unsigned char* source, unsigned char* destination, size_t count)
+		{
+			size_t i = 0;
+
+			for (; i + 4 <= count; i += 4)
+			{
+				vst1q_u8(destination + i * 4, vrev32q_u8(vld1q_u8(source + i * 4)));
+			}
+
+			byteswap32_scalar(source + i * 4, destination + i * 4, count - i);
+		}
+
+		inline void swap_red_blue_neon(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				uint8x16x4_t v = vld4q_u8(source + i * 4);
+				uint8x16_t red = v.val[0];
+				v.val[0] = v.val[2];
+				v.val[2] = red;
+				vst4q_u8(destination + i * 4, v);
+			}
+
+			swap_red_blue_scalar(source + i * 4, destination + i * 4, pixelCount - i);
+		}
+
+		// vld4 splits the pairs into Y0, Cb, Y1 and Cr for free. vqdmulh doubles the product, so the inputs are only
+		// shifted by 6 to match the scalar terms
+		inline void yuv422_to_rgba8_neon(const unsigned char* source, unsigned char* destination, size_t pixelCount, const YuvConversion& conversion)
+		{
+			bool uyvy = conversion.layout == YuvUYVY;
+			const int16x8_t lumaBias = vdupq_n_s16(conversion.lumaBias);
+			const int16x8_t chromaBias = vdupq_n_s16(128);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				uint8x8x4_t pairs = vld4_u8(source + i * 2);
+				uint8x8_t y0 = uyvy ? pairs.val[1] : pairs.val[0];
+				uint8x8_t y1 = uyvy ? pairs.val[3] : pairs.val[2];
+				uint8x8_t cbBytes = uyvy ? pairs.val[0] : pairs.val[1];
+				uint8x8_t crBytes = uyvy ? pairs.val[2] : pairs.val[3];
+
+				int16x8_t cb = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cbBytes)), chromaBias), 6);
+				int16x8_t cr = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(crBytes)), chromaBias), 6);
+				int16x8_t red = vqdmulhq_s16(cr, vdupq_n_s16(conversion.redCr));
+				int16x8_t green = vnegq_s16(vaddq_s16(vqdmulhq_s16(cb, vdupq_n_s16(conversion.greenCb)), vqdmulhq_s16(cr, vdupq_n_s16(conversion.greenCr))));
+				int16x8_t blue = vqdmulhq_s16(cb, vdupq_n_s16(conversion.blueCb));
+
+				int16x8_t luma0 = vqdmulhq_s16(vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y0)), lumaBias), 6), vdupq_n_s16(conversion.lumaScale));
+				int16x8_t luma1 = vqdmulhq_s16(vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y1)), lumaBias), 6), vdupq_n_s16(conversion.lumaScale));
+
+				// Rounding shift with unsigned saturation is exactly the scalar rounding and clamping
+				uint8x8x2_t r = vzip_u8(vqrshrun_n_s16(vaddq_s16(luma0, red), 4), vqrshrun_n_s16(vaddq_s16(luma1, red), 4));
+				uint8x8x2_t g = vzip_u8(vqrshrun_n_s16(vaddq_s16(luma0, green), 4), vqrshrun_n_s16(vaddq_s16(luma1, green), 4));
+				uint8x8x2_t b = vzip_u8(vqrshrun_n_s16(vaddq_s16(luma0, blue), 4), vqrshrun_n_s16(vaddq_s16(luma1, blue), 4));
+
+				uint8x16x4_t rgba;
+				rgba.val[0] = vcombine_u8(r.val[0], r.val[1]);
+				rgba.val[1] = vcombine_u8(g.val[0], g.val[1]);
+				rgba.val[2] = vcombine_u8(b.val[0], b.val[1]);
+				rgba.val[3] = vdupq_n_u8(0xFF);
+				vst4q_u8(destination + i * 4, rgba);
+			}
+
+			yuv422_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i, conversion);
+		}
+
+		template<bool GreenFirst>
+		inline void rgbg_to_rgba8_neon(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				uint8x8x4_t pairs = vld4_u8(source + i * 2);
+				uint8x8_t red = GreenFirst ? pairs.val[1] : pairs.val[0];
+				uint8x8_t blue = GreenFirst ? pairs.val[3] : pairs.val[2];
+				uint8x8x2_t r = vzip_u8(red, red);
+				uint8x8x2_t g = GreenFirst ? vzip_u8(pairs.val[0], pairs.val[2]) : vzip_u8(pairs.val[1], pairs.val[3]);
+				uint8x8x2_t b = vzip_u8(blue, blue);
+
+				uint8x16x4_t rgba;
+				rgba.val[0] = vcombine_u8(r.val[0], r.val[1]);
+				rgba.val[1] = vcombine_u8(g.val[0], g.val[1]);
+				rgba.val[2] = vcombine_u8(b.val[0], b.val[1]);
+				rgba.val[3] = vdupq_n_u8(0xFF);
+				vst4q_u8(destination + i * 4, rgba);
+			}
+
+			if (GreenFirst) { grgb_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+			else            { rgbg_to_rgba8_scalar(source + i * 2, destination + i * 4, pixelCount - i); }
+		}
+
+		inline void bw1bpp_to_rgba8_neon(const unsigned char* source, unsigned char* destination, size_t pixelCount)
+		{
+			static const uint8_t bitValues[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+			const uint8x16_t bits = vld1q_u8(bitValues);
+			size_t i = 0;
+
+			for (; i + 16 <= pixelCount; i += 16)
+			{
+				uint8x16_t value = vtstq_u8(vcombine_u8(vdup_n_u8(source[i / 8]), vdup_n_u8(source[i / 8 + 1])), bits);
+
+				uint8x16x4_t rgba;
+				rgba.val[0] = value;
+				rgba.val[1] = value;
+				rgba.val[2] = value;
+				rgba.val[3] = vdupq_n_u8(0xFF);
+				vst4q_u8(destination + i * 4, rgba);
+			}
+
+			bw1bpp_to_rgba8_scalar(source + i / 8, destination + i * 4, pixelCount - i);
+		}
+
+		inline void squared_error8_neon(const unsigned char* a, const unsigned char* b, size_t byteCount, uint64_t* sums, unsigned char* maxima)
+		{
+			size_t i = 0;
+
+			while (byteCount - i >= ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / ERROR_LANES, ERROR_RUN) * ERROR_LANES;
+				uint32x4_t accumulators[12];
+				uint8x16_t maximum[3];
+
+				for (int v = 0; v < 12; ++v) { accumulators[v] = vdupq_n_u32(0); }
+				for (int v = 0; v < 3; ++v) { maximum[v] = vdupq_n_u8(0); }
+
+				for (; i < runEnd; i += ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						uint8x16_t difference = vabdq_u8(vld1q_u8(a + i + v * 16), vld1q_u8(b + i + v * 16));
+						maximum[v] = vmaxq_u8(maximum[v], difference);
+
+						uint16x8_t low = vmull_u8(vget_low_u8(difference), vget_low_u8(difference));
+						uint16x8_t high = vmull_u8(vget_high_u8(difference), vget_high_u8(difference));
+						accumulators[v * 4] = vaddw_u16(accumulators[v * 4], vget_low_u16(low));
+						accumulators[v * 4 + 1] = vaddw_u16(accumulators[v * 4 + 1], vget_high_u16(low));
+						accumulators[v * 4 + 2] = vaddw_u16(accumulators[v * 4 + 2], vget_low_u16(high));
+						accumulators[v * 4 + 3] = vaddw_u16(accumulators[v * 4 + 3], vget_high_u16(high));
+					}
+				}
+
+				uint32_t laneSums[48];
+				unsigned char laneMaxima[48], laneBytes[48];
+
+				for (int v = 0; v < 12; ++v) { vst1q_u32(laneSums + v * 4, accumulators[v]); }
+				for (int v = 0; v < 3; ++v) { vst1q_u8(laneMaxima + v * 16, maximum[v]); }
+				for (int lane = 0; lane < 48; ++lane) { laneBytes[lane] = (unsigned char)lane; }
+
+				flush_squared_error8(laneSums, laneMaxima, laneBytes, 48, sums, maxima);
+			}
+
+			squared_error8_scalar(a + i, b + i, byteCount - i, sums, maxima);
+		}
+
+		inline void channel_stats8_neon(const unsigned char* source, size_t byteCount, uint64_t* sums, uint64_t* partials, unsigned char* minima, unsigned char* maxima)
+		{
+			size_t i = 0;
+
+			while (byteCount - i >= ERROR_LANES)
+			{
+				size_t runEnd = i + std::min((byteCount - i) / ERROR_LANES, STATS_RUN) * ERROR_LANES;
+				uint16x8_t accumulators[6];
+				uint8x16_t counts[3], minimum[3], maximum[3];
+
+				for (int v = 0; v < 6; ++v) { accumulators[v] = vdupq_n_u16(0); }
+				for (int v = 0; v < 3; ++v) { counts[v] = vdupq_n_u8(0); minimum[v] = vdupq_n_u8(255); maximum[v] = vdupq_n_u8(0); }
+
+				for (; i < runEnd; i += ERROR_LANES)
+				{
+					for (int v = 0; v < 3; ++v)
+					{
+						uint8x16_t x = vld1q_u8(source + i + v * 16);
+						minimum[v] = vminq_u8(minimum[v], x);
+						maximum[v] = vmaxq_u8(maximum[v], x);
+						accumulators[v * 2] = vaddw_u8(accumulators[v * 2], vget_low_u8(x));
+						accumulators[v * 2 + 1] = vaddw_u8(accumulators[v * 2 + 1], vget_high_u8(x));
+
+						uint8x16_t extreme = vorrq_u8(vceqq_u8(x, vdupq_n_u8(0)), vceqq_u8(x, vdupq_n_u8(255)));
+						counts[v] = vaddq_u8(counts[v], vbicq_u8(vdupq_n_u8(1), extreme));
+					}
+				}
+
+				uint16_t laneSums[48];
+				unsigned char laneBytes[48], laneCounts[48], laneMinima[48], laneMaxima[48];
+
+				for (int v = 0; v < 6; ++v) { vst1q_u16(laneSums + v * 8, accumulators[v]); }
+
+				for (int v = 0; v < 3; ++v)
+				{
+					vst1q_u8(laneCounts + v * 16, counts[v]);
+					vst1q_u8(laneMinima + v * 16, minimum[v]);
+					vst1q_u8(laneMaxima + v * 16, maximum[v]);
+				}
+
+				for (int lane = 0; lane < 48; ++lane) { laneBytes[lane] = (unsigned char)lane; }
+
+				flush_channel_stats8(laneSums, laneBytes, laneCounts, laneMinima, laneMaxima, 48, sums, partials, minima, maxima);
+			}
+
+			channel_stats8_scalar(source + i, byteCount - i, sums, partials, minima, maxima);
+		}
+
+		// 16 columns at a time like ssim_sums8_sse2, with widening adds and multiply-accumulates
+		inline void ssim_sums8_neon(const unsigned char* a, size_t pitchA, const unsigned char* b, size_t pitchB, size_t byteCount, uint32_t rowCount, uint32_t* sums)
+		{
+			size_t i = 0;
+
+			for (; byteCount - i >= 16; i += 16)
+			{
+				uint32x4_t accumulators[5][4];
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { accumulators[k][v] = vdupq_n_u32(0); } }
+
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					uint8x16_t x = vld1q_u8(a + row * pitchA + i), y = vld1q_u8(b + row * pitchB + i);
+					uint16x8_t wideX[2] = { vmovl_u8(vget_low_u8(x)), vmovl_u8(vget_high_u8(x)) };
+					uint16x8_t wideY[2] = { vmovl_u8(vget_low_u8(y)), vmovl_u8(vget_high_u8(y)) };
+
+					for (int v = 0; v < 4; ++v)
+					{
+						uint16x4_t valueX = v % 2 == 0 ? vget_low_u16(wideX[v / 2]) : vget_high_u16(wideX[v / 2]);
+						uint16x4_t valueY = v % 2 == 0 ? vget_low_u16(wideY[v / 2]) : vget_high_u16(wideY[v / 2]);
+						accumulators[0][v] = vaddw_u16(accumulators[0][v], valueX);
+						accumulators[1][v] = vaddw_u16(accumulators[1][v], valueY);
+						accumulators[2][v] = vmlal_u16(accumulators[2][v], valueX, valueX);
+						accumulators[3][v] = vmlal_u16(accumulators[3][v], valueY, valueY);
+						accumulators[4][v] = vmlal_u16(accumulators[4][v], valueX, valueY);
+					}
+				}
+
+				for (int k = 0; k < 5; ++k) { for (int v = 0; v < 4; ++v) { vst1q_u32(sums + k * byteCount + i + v * 4, accumulators[k][v]); } }
+			}
+
+			ssim_sums8_columns(a, pitchA, b, pitchB, i, byteCount, byteCount, rowCount, sums);
+		}
+
+		// NEON has no gather either. Rounding to nearest even needs ARMv8, 32-bit ARM keeps the scalar version
+#if defined(__aarch64__) || defined(_M_ARM64)
+		inline uint32x4_t linear_to_srgb8_neon(float32x4_t value)
+		{
+			const float32x4_t minimum = vreinterpretq_f32_u32(vdupq_n_u32(LINEAR_TO_SRGB8_MIN));
+			const float32x4_t maximum = vreinterpretq_f32_u32(vdupq_n_u32(LINEAR_TO_SRGB8_MAX));
+			const uint32x4_t alphaMask = vcombine_u32(vdup_n_u32(0), vcreate_u32(0xFFFFFFFF00000000ull));
+
+			// Selecting on the comparison sends NaN to the minimum, vmaxq would pass it through
+			float32x4_t clamped = vminq_f32(vbslq_f32(vcgtq_f32(value, minimum), value, minimum), maximum);
+			uint32x4_t bits = vreinterpretq_u32_f32(clamped);
+
+			uint32_t index[4];
+			vst1q_u32(index, vshrq_n_u32(vsubq_u32(bits, vdupq_n_u32(LINEAR_TO_SRGB8_MIN)), 20));
+			uint32_t entries[4] = { LINEAR_TO_SRGB8_TABLE[index[0]], LINEAR_TO_SRGB8_TABLE[index[1]], LINEAR_TO_SRGB8_TABLE[index[2]], LINEAR_TO_SRGB8_TABLE[index[3]] };
+			uint32x4_t entry = vld1q_u32(entries);
+
+			uint32x4_t bias = vshlq_n_u32(vshrq_n_u32(entry, 16), 9);
+			uint32x4_t product = vmulq_u32(vandq_u32(entry, vdupq_n_u32(0xFFFF)), vandq_u32(vshrq_n_u32(bits, 12), vdupq_n_u32(0xFF)));
+			uint32x4_t srgb = vshrq_n_u32(vaddq_u32(bias, product), 16);
+
+			float32x4_t alpha = vminq_f32(vbslq_f32(vcgtq_f32(value, vdupq_n_f32(0.0f)), value, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+			uint32x4_t alpha8 = vreinterpretq_u32_s32(vcvtnq_s32_f32(vmulq_f32(alpha, vdupq_n_f32(255.0f))));
+			return vbslq_u32(alphaMask, alpha8, srgb);
+		}
+
+		inline void linear_to_srgb8_neon(const float* source, unsigned char* destination, size_t pixelCount)
+		{
+			size_t i = 0;
+
+			for (; i + 4 <= pixelCount; i += 4)
+			{
+				uint16x8_t p01 = vcombine_u16(vmovn_u32(linear_to_srgb8_neon(vld1q_f32(source + i * 4))), vmovn_u32(linear_to_srgb8_neon(vld1q_f32(source + i * 4 + 4))));
+				uint16x8_t p23 = vcombine_u16(vmovn_u32(linear_to_srgb8_neon(vld1q_f32(source + i * 4 + 8))), vmovn_u32(linear_to_srgb8_neon(vld1q_f32(source + i * 4 + 12))));
+				vst1q_u8(destination + i * 4, vcombine_u8(vmovn_u16(p01), vmovn_u16(p23)));
+			}
+
+			linear_to_srgb8_scalar(source + i * 4, destination + i * 4, pixelCount - i);
+		}
+#else
+		inline void linear_to_srgb8_neon(const float* source, unsigned char* destination, size_t pixelCount)
+		{
+			linear_to_srgb8_scalar(source, destination, pixelCount);
+		}
+#endif
+
+#endif
+	}
+
+	// Highest level this CPU and OS support
+	inline SimdLevel detect_simd_level()
+	{
+#if defined(ktxpp_x86)
+		int registers[4];
+		cpuid(0, 0, registers);
+		int maxLeaf = registers[0];
+
+		cpuid(1, 0, registers);
+		bool sse2    = (registers[3] & (1 << 26)) != 0;
+		bool osxsave = (registers[2] & (1 << 27)) != 0;
+		bool avx     = (registers[2] & (1 << 28)) != 0;
+
+		if (!sse2)
+		{
+			return SimdScalar;
+		}
+
+		if (maxLeaf < 7 || !osxsave || !avx)
+		{
+			return SimdSSE2;
+		}
+
+		uint64_t xcr0 = get_xcr0();
+		cpuid(7, 0, registers);
+		bool avx2     = (registers[1] & (1 << 5)) != 0;
+		bool avx512f  = (registers[1] & (1 << 16)) != 0;
+		bool avx512bw = (registers[1] & (1 << 30)) != 0;
+
+		if (avx512f && avx512bw && (xcr0 & 0xE6) == 0xE6)
+		{
+			return SimdAVX512;
+		}
+
+		if (avx2 && (xcr0 & 0x6) == 0x6)
+		{
+			return SimdAVX2;
+		}
+
+		return SimdSSE2;
+#elif defined(ktxpp_neon)
+		return SimdNEON;
+#else
+		return SimdScalar;
+#endif
+	}
+
+	inline const char* get_simd_level_name(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdSSE2:   return "sse2";
+			case SimdAVX2:   return "avx2";
+			case SimdAVX512: return "avx512";
+			case SimdNEON:   return "neon";
+			default:         return "scalar";
+		}
+	}
+
+	// Whether a level can run here. NEON and the x86 levels are mutually exclusive
+	inline bool is_simd_level_supported(SimdLevel level)
+	{
+		SimdLevel detected = detect_simd_level();
+
+		if (level == SimdScalar)
+		{
+			return true;
+		}
+
+		return detected == SimdNEON ? level == SimdNEON : (level != SimdNEON && level <= detected);
+	}
+
+	// Kernel table for a specific level, which must be supported. Useful to compare implementations against each other
+	inline Kernels get_kernels(SimdLevel level)
+	{
+		Kernels kernels = { SimdScalar, byteswap16_scalar, byteswap32_scalar, swap_red_blue_scalar, yuv422_to_rgba8_scalar, rgbg_to_rgba8_scalar, grgb_to_rgba8_scalar, bw1bpp_to_rgba8_scalar, squared_error8_scalar, channel_stats8_scalar, ssim_sums8_scalar, srgb8_to_linear_scalar, linear_to_srgb8_scalar };
+
+		switch (level)
+		{
+#if defined(ktxpp_x86)
+			case SimdSSE2:
+			{
+				Kernels sse2 = { SimdSSE2, byteswap16_sse2, byteswap32_sse2, swap_red_blue_sse2, yuv422_to_rgba8_sse2, rgbg_to_rgba8_sse2<false>, rgbg_to_rgba8_sse2<true>, bw1bpp_to_rgba8_sse2, squared_error8_sse2, channel_stats8_sse2, ssim_sums8_sse2, srgb8_to_linear_scalar, linear_to_srgb8_sse2 };
+				kernels = sse2;
+				break;
+			}
+			case SimdAVX2:
+			{
+				Kernels avx2 = { SimdAVX2, byteswap16_avx2, byteswap32_avx2, swap_red_blue_avx2, yuv422_to_rgba8_avx2, rgbg_to_rgba8_avx2<false>, rgbg_to_rgba8_avx2<true>, bw1bpp_to_rgba8_avx2, squared_error8_avx2, channel_stats8_avx2, ssim_sums8_avx2, srgb8_to_linear_scalar, linear_to_srgb8_avx2 };
+				kernels = avx2;
+				break;
+			}
+			case SimdAVX512:
+			{
+				Kernels avx512 = { SimdAVX512, byteswap16_avx512, byteswap32_avx512, swap_red_blue_avx512, yuv422_to_rgba8_avx2, rgbg_to_rgba8_avx512<false>, rgbg_to_rgba8_avx512<true>, bw1bpp_to_rgba8_avx512, squared_error8_avx2, channel_stats8_avx2, ssim_sums8_avx2, srgb8_to_linear_scalar, linear_to_srgb8_avx2 };
+				kernels = avx512;
+				break;
+			}
+#elif defined(ktxpp_neon)
+			case SimdNEON:
+			{
+				Kernels neon = { SimdNEON, byteswap16_neon, byteswap32_neon, swap_red_blue_neon, yuv422_to_rgba8_neon, rgbg_to_rgba8_neon<false>, rgbg_to_rgba8_neon<true>, bw1bpp_to_rgba8_neon, squared_error8_neon, channel_stats8_neon, ssim_sums8_neon, srgb8_to_linear_scalar, linear_to_srgb8_neon };
+				kernels = neon;
+				break;
+			}
+#endif
+			default:
+				break;
+		}
+
+		return kernels;
+	}
+
+	// The kernels for this machine, resolved once. KTXPP_SIMD can lower the level but never raise it above what the
+	// CPU supports
+	inline const Kernels& get_kernels()
+	{
+		struct Resolver
+		{
+			static Kernels resolve()
+			{
+				SimdLevel level = detect_simd_level();
+				const char* requested = getenv("KTXPP_SIMD");
+
+				if (requested != nullptr)
+				{
+					const SimdLevel levels[] = { SimdScalar, SimdSSE2, SimdAVX2, SimdAVX512, SimdNEON };
+
+					for (SimdLevel candidate : levels)
+					{
+						if (strcmp(requested, get_simd_level_name(candidate)) == 0 && is_simd_level_supported(candidate))
+						{
+							level = candidate;
+						}
+					}
+				}
+
+				return get_kernels(level);
+			}
+		};
+
+		static const Kernels kernels = Resolver::resolve();
+		return kernels;
+	}
+
+	// Converts one subresource of a GL_RGB_RAW_422_APPLE texture to RGBA8 with the kernels for this machine. destination
+	// holds width * height * depth tightly packed pixels
+	inline void convert_yuv422_to_rgba8(const unsigned char* fileData, const Subresource& subresource, unsigned char* destination, const YuvConversion& conversion)
+	{
+		ktxpp_stage(StageDecode, "convert_yuv422_to_rgba8");
+		ktxpp_stage_work(subresource.size, (uint64_t)subresource.width * subresource.height * subresource.depth);
+
+		const Kernels& kernels = get_kernels();
+		uint64_t rowCount = (uint64_t)subresource.height * subresource.depth;
+
+		for (uint64_t row = 0; row < rowCount; ++row)
+		{
+			kernels.yuv422_to_rgba8(fileData + subresource.offset + row * subresource.rowPitch, destination + row * subresource.width * 4, subresource.width, conversion);
+		}
+	}
+
+	// Expands one subresource of a GL_RGBG8888_KTXPP, GL_GRGB8888_KTXPP or GL_BW1BPP_KTXPP texture to RGBA8 with the
+	// kernels for this machine. destination holds width * height * depth tightly packed pixels. Returns false for other
+	// formats
+	inline bool unpack_to_rgba8(const Descriptor& desc, const unsigned char* fileData, const Subresource& subresource, unsigned char* destination)
+	{
+		const Kernels& kernels = get_kernels();
+		void (*kernel)(const unsigned char* source, unsigned char* destination, size_t pixelCount) = nullptr;
+
+		switch (desc.glInternalFormat)
+		{
+			case GL_RGBG8888_KTXPP: kernel = kernels.rgbg_to_rgba8; break;
+			case GL_GRGB8888_KTXPP: kernel = kernels.grgb_to_rgba8; break;
+			case GL_BW1BPP_KTXPP:   kernel = kernels.bw1bpp_to_rgba8; break;
+			default: return false;
+		}
+
+		ktxpp_stage(StageDecode, "unpack_to_rgba8");
+		ktxpp_stage_work(subresource.size, (uint64_t)subresource.width * subresource.height * subresource.depth);
+
+		// Blocks are one pixel high, so every slice is height rows of the same pitch
+		uint64_t rowCount = (uint64_t)subresource.height * subresource.depth;
+
+		for (uint64_t row = 0; row < rowCount; ++row)
+		{
+			kernel(fileData + subresource.offset + row * subresource.rowPitch, destination + row * subresource.width * 4, subresource.width);
+		}
+
+		return true;
+	}
+
+	// Decodes one subresource of a GL_SRGB8_ALPHA8 or GL_SRGB8 texture, RGB(A) or BGR(A), to linear float RGBA with the
+	// kernels for this machine. Alpha is 1 without an alpha channel. destination holds width * height * depth tightly
+	// packed pixels. Returns false for other formats
+	inline bool convert_srgb_to_linear(const Descriptor& desc, const unsigned char* fileData, const Subresource& subresource, float* destination)
+	{
+		bool bgr;
+		uint32_t pixelBytes = internal::get_srgb8_pixel_bytes(desc, bgr);
+
+		if (pixelBytes == 0)
+		{
+			return false;
+		}
+
+		ktxpp_stage(StageDecode, "convert_srgb_to_linear");
+		ktxpp_stage_work(subresource.size, (uint64_t)subresource.width * subresource.height * subresource.depth);
+
+		const Kernels& kernels = get_kernels();
+		uint64_t rowCount = (uint64_t)subresource.height * subresource.depth;
+
+		for (uint64_t row = 0; row < rowCount; ++row)
+		{
+			const unsigned char* source = fileData + subresource.offset + row * subresource.rowPitch;
+			float* rowDestination = destination + row * subresource.width * 4;
+
+			if (pixelBytes == 4 && !bgr)
+			{
+				kernels.srgb8_to_linear(source, rowDestination, subresource.width);
+				continue;
+			}
+
+			unsigned char rgba[internal::SRGB8_RUN_PIXELS * 4];
+
+			for (size_t i = 0; i < subresource.width; i += internal::SRGB8_RUN_PIXELS)
+			{
+				size_t count = std::min<size_t>(internal::SRGB8_RUN_PIXELS, subresource.width - i);
+				internal::srgb8_row_to_rgba8(kernels, source + i * pixelBytes, pixelBytes, bgr, rgba, count);
+				kernels.srgb8_to_linear(rgba, rowDestination + i * 4, count);
+			}
+		}
+
+		return true;
+	}
+
+	// The reverse, encoding width * height * depth tightly packed linear pixels into one subresource of any of those
+	// textures, dropping alpha without an alpha channel. Row padding is left untouched. Returns false for other formats
+	inline bool convert_linear_to_srgb(const Descriptor& desc, const float* source, const Subresource& subresource, unsigned char* fileData)
+	{
+		bool bgr;
+		uint32_t pixelBytes = internal::get_srgb8_pixel_bytes(desc, bgr);
+
+		if (pixelBytes == 0)
+		{
+			return false;
+		}
+
+		ktxpp_stage(StageConvert, "convert_linear_to_srgb");
+		ktxpp_stage_work(subresource.size, (uint64_t)subresource.width * subresource.height * subresource.depth);
+
+		const Kernels& kernels = get_kernels();
+		uint64_t rowCount = (uint64_t)subresource.height * subresource.depth;
+
+		for (uint64_t row = 0; row < rowCount; ++row)
+		{
+			const float* rowSource = source + row * subresource.width * 4;
+			unsigned char* destination = fileData + subresource.offset + row * subresource.rowPitch;
+
+			if (pixelBytes == 4 && !bgr)
+			{
+				kernels.linear_to_srgb8(rowSource, destination, subresource.width);
+				continue;
+			}
+
+			unsigned char rgba[internal::SRGB8_RUN_PIXELS * 4];
+
+			for (size_t i = 0; i < subresource.width; i += internal::SRGB8_RUN_PIXELS)
+			{
+				size_t count = std::min<size_t>(internal::SRGB8_RUN_PIXELS, subresource.width - i);
+				kernels.linear_to_srgb8(rowSource + i * 4, rgba, count);
+				internal::rgba8_to_srgb8_row(kernels, rgba, pixelBytes, bgr, destination + i * pixelBytes, count);
+			}
+		}
+
+		return true;
+	}
+}
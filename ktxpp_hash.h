@@ -0,0 +1,112 @@
+#pragma once
+
+// 128-bit content hashing for deduplication and cache keys. Define ktxpp_xxhash to use XXH3, which picks its own
+// SIMD path, otherwise a portable four lane hash in the style of XXH64 is used. Hashes are only comparable between
+// builds that agree on ktxpp_xxhash
+
+#include "ktxpp.h"
+
+#if defined(ktxpp_xxhash)
+	#if !defined(XXH_INLINE_ALL)
+		#define XXH_INLINE_ALL
+	#endif
+	#include <xxhash.h>
+#endif
+
+namespace ktxpp
+{
+	struct Hash128
+	{
+		uint64_t low;
+		uint64_t high;
+
+		bool operator == (const Hash128& other) const { return low == other.low && high == other.high; }
+		bool operator != (const Hash128& other) const { return !(*this == other); }
+		bool operator < (const Hash128& other) const { return high != other.high ? high < other.high : low < other.low; }
+	};
+
+	namespace internal
+	{
+		static ktxpp_constexpr uint64_t HASH_PRIME1 = 0x9e3779b185ebca87ull;
+		static ktxpp_constexpr uint64_t HASH_PRIME2 = 0xc2b2ae3d27d4eb4full;
+		static ktxpp_constexpr uint64_t HASH_PRIME3 = 0x165667b19e3779f9ull;
+		static ktxpp_constexpr uint64_t HASH_PRIME4 = 0x85ebca77c2b2ae63ull;
+
+		inline uint64_t hash_rotate(uint64_t value, int bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
+
+		inline uint64_t hash_read64(const unsigned char* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		inline uint64_t hash_round(uint64_t accumulator, uint64_t lane)
+		{
+			return hash_rotate(accumulator + lane * HASH_PRIME2, 31) * HASH_PRIME1;
+		}
+
+		inline uint64_t hash_avalanche(uint64_t hash)
+		{
+			hash ^= hash >> 33;
+			hash *= HASH_PRIME2;
+			hash ^= hash >> 29;
+			hash *= HASH_PRIME3;
+			return hash ^ (hash >> 32);
+		}
+
+		inline Hash128 hash_data_portable(const unsigned char* data, size_t size, uint64_t seed)
+		{
+			// Four independent lanes keep the multipliers busy, 32 bytes per iteration
+			uint64_t lanes[4] = { seed + HASH_PRIME1 + HASH_PRIME2, seed + HASH_PRIME2, seed, seed - HASH_PRIME1 };
+			size_t i = 0;
+
+			for (; i + 32 <= size; i += 32)
+			{
+				lanes[0] = hash_round(lanes[0], hash_read64(data + i));
+				lanes[1] = hash_round(lanes[1], hash_read64(data + i + 8));
+				lanes[2] = hash_round(lanes[2], hash_read64(data + i + 16));
+				lanes[3] = hash_round(lanes[3], hash_read64(data + i + 24));
+			}
+
+			// The tail, zero padded, goes through the lanes too so both halves depend on every byte
+			unsigned char tail[32] = {};
+			memcpy(tail, data + i, size - i);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				lanes[lane] = hash_round(lanes[lane], hash_read64(tail + lane * 8) ^ ((uint64_t)size * HASH_PRIME4));
+			}
+
+			uint64_t low = hash_rotate(lanes[0], 1) + hash_rotate(lanes[1], 7) + hash_rotate(lanes[2], 12) + hash_rotate(lanes[3], 18);
+			uint64_t high = hash_rotate(lanes[3], 1) + hash_rotate(lanes[2], 7) + hash_rotate(lanes[1], 12) + hash_rotate(lanes[0], 18);
+
+			Hash128 hash;
+			hash.low = hash_avalanche(low ^ (uint64_t)size);
+			hash.high = hash_avalanche(high + hash.low * HASH_PRIME3);
+			return hash;
+		}
+	}
+
+	inline Hash128 hash_data(const void* data, size_t size, uint64_t seed = 0)
+	{
+#if defined(ktxpp_xxhash)
+		XXH128_hash_t xxhash = XXH3_128bits_withSeed(data, size, seed);
+		Hash128 hash = { xxhash.low64, xxhash.high64 };
+		return hash;
+#else
+		return internal::hash_data_portable(static_cast<const unsigned char*>(data), size, seed);
+#endif
+	}
+
+	// Hashes data after everything hashed so far, for keys made of several pieces
+	inline Hash128 hash_combine(const Hash128& hash, const void* data, size_t size)
+	{
+		Hash128 next = hash_data(data, size, hash.low ^ internal::hash_rotate(hash.high, 32));
+		next.high ^= hash.high;
+		return next;
+	}
+}
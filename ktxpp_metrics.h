@@ -0,0 +1,517 @@
+#pragma once
+
+// Image quality metrics for validating encodes: mean squared error, PSNR, SSIM and maximum absolute error per
+// channel, between two textures or between one subresource and the pixels it was made from. Images with 8 or 16-bit
+// unsigned channels are compared as stored, anything else has to be decoded to such an image first.
+//
+// Subresources, and bands of rows within large ones, are measured in parallel, and 8-bit error sums use the SIMD
+// kernels from ktxpp_dispatch.h, as do 8-bit SSIM sums. SSIM follows Wang et al. over 8x8 windows every 4 pixels, with one window covering
+// the whole image when it is smaller than that
+
+#include "ktxpp_convert.h"
+#include "ktxpp_dispatch.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ktxpp
+{
+	enum MetricsResult
+	{
+		MetricsSuccess,
+		MetricsInvalidTexture,
+		MetricsUnsupportedFormat,
+		MetricsMismatchedImages, // Formats, dimensions or subresource counts differ
+	};
+
+	// 1 to 4 interleaved unsigned channels of 1 or 2 bytes. Depth slices follow each other rowPitch * height apart
+	struct ImageView
+	{
+		const unsigned char* data;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t rowPitch; // In bytes
+		uint32_t channelCount;
+		uint32_t bytesPerChannel;
+	};
+
+	struct ChannelMetrics
+	{
+		double mse;
+		double psnr; // Infinite when the channels are identical
+		double ssim; // 0 when not computed
+		uint32_t maxError;
+	};
+
+	// Channels are in storage order, e.g. blue first for BGRA
+	struct ImageMetrics
+	{
+		uint32_t channelCount;
+		ChannelMetrics channels[4];
+		ChannelMetrics average; // mse and ssim averaged over the channels, psnr from that mse, the largest maxError
+	};
+
+	struct MetricsOptions
+	{
+		uint32_t threadCount = 1; // 0 uses every core
+		bool ssim = true; // Several times the cost of the other metrics together
+	};
+
+	namespace internal
+	{
+		// Rows per work item. A multiple of 4 so SSIM windows can be attributed to the band their top row is in
+		static ktxpp_constexpr uint32_t METRICS_BAND_ROWS = 64;
+
+		struct MetricsSums
+		{
+			uint64_t squaredError[4];
+			uint32_t maxError[4];
+			double ssim[4];
+			uint64_t ssimWindows;
+		};
+
+		// One band of rows of one depth slice
+		struct MetricsTask
+		{
+			const ImageView* a;
+			const ImageView* b;
+			uint32_t image;
+			uint32_t slice;
+			uint32_t rowBegin;
+			uint32_t rowEnd;
+		};
+
+		struct SsimBlock
+		{
+			uint64_t a, b, aa, bb, ab;
+		};
+
+		inline uint32_t read_channel(const unsigned char* data, uint32_t bytesPerChannel)
+		{
+			if (bytesPerChannel == 1)
+			{
+				return *data;
+			}
+
+			uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		inline void accumulate_errors(const MetricsTask& task, MetricsSums& sums)
+		{
+			const ImageView& a = *task.a;
+			const ImageView& b = *task.b;
+			size_t rowBytes = (size_t)a.width * a.channelCount * a.bytesPerChannel;
+			uint64_t firstRow = (uint64_t)task.slice * a.height;
+
+			if (a.bytesPerChannel == 1)
+			{
+				const Kernels& kernels = get_kernels();
+				uint64_t laneSums[ERROR_LANES] = {};
+				unsigned char laneMaxima[ERROR_LANES] = {};
+
+				for (uint32_t row = task.rowBegin; row < task.rowEnd; ++row)
+				{
+					kernels.squared_error8(a.data + (firstRow + row) * a.rowPitch, b.data + (firstRow + row) * b.rowPitch, rowBytes, laneSums, laneMaxima);
+				}
+
+				for (size_t lane = 0; lane < ERROR_LANES; ++lane)
+				{
+					uint32_t channel = (uint32_t)(lane % a.channelCount);
+					sums.squaredError[channel] += laneSums[lane];
+					sums.maxError[channel] = std::max(sums.maxError[channel], (uint32_t)laneMaxima[lane]);
+				}
+
+				return;
+			}
+
+			for (uint32_t row = task.rowBegin; row < task.rowEnd; ++row)
+			{
+				const unsigned char* rowA = a.data + (firstRow + row) * a.rowPitch;
+				const unsigned char* rowB = b.data + (firstRow + row) * b.rowPitch;
+
+				for (size_t i = 0; i < rowBytes; i += 2)
+				{
+					uint32_t channel = (uint32_t)(i / 2 % a.channelCount);
+					uint32_t valueA = read_channel(rowA + i, 2), valueB = read_channel(rowB + i, 2);
+					uint32_t difference = valueA > valueB ? valueA - valueB : valueB - valueA;
+					sums.squaredError[channel] += (uint64_t)difference * difference;
+					sums.maxError[channel] = std::max(sums.maxError[channel], difference);
+				}
+			}
+		}
+
+		// Sums of every channel over blockCount blocks of blockWidth by height pixels, side by side from the left edge.
+		// One pass over the rows for a whole row of 4x4 blocks, or a single block for an image smaller than a window
+		template<uint32_t BytesPerChannel>
+		inline void sum_ssim_blocks(const MetricsTask& task, uint32_t y, uint32_t height, uint32_t blockWidth, uint32_t blockCount, SsimBlock* blocks)
+		{
+			const ImageView& a = *task.a;
+			const ImageView& b = *task.b;
+			uint32_t channelCount = a.channelCount;
+			uint64_t firstRow = (uint64_t)task.slice * a.height + y;
+
+			memset(blocks, 0, sizeof(SsimBlock) * blockCount * channelCount);
+
+			for (uint32_t row = 0; row < height; ++row)
+			{
+				const unsigned char* rowA = a.data + (firstRow + row) * a.rowPitch;
+				const unsigned char* rowB = b.data + (firstRow + row) * b.rowPitch;
+
+				for (uint32_t block = 0; block < blockCount; ++block)
+				{
+					for (uint32_t column = 0; column < blockWidth; ++column)
+					{
+						for (uint32_t channel = 0; channel < channelCount; ++channel)
+						{
+							uint64_t valueA = read_channel(rowA, BytesPerChannel), valueB = read_channel(rowB, BytesPerChannel);
+							SsimBlock& sums = blocks[block * channelCount + channel];
+							sums.a += valueA; sums.b += valueB;
+							sums.aa += valueA * valueA; sums.bb += valueB * valueB; sums.ab += valueA * valueB;
+							rowA += BytesPerChannel;
+							rowB += BytesPerChannel;
+						}
+					}
+				}
+			}
+		}
+
+		inline void sum_ssim_blocks(const MetricsTask& task, uint32_t y, uint32_t height, uint32_t blockWidth, uint32_t blockCount, SsimBlock* blocks)
+		{
+			if (task.a->bytesPerChannel == 1)
+			{
+				sum_ssim_blocks<1>(task, y, height, blockWidth, blockCount, blocks);
+			}
+			else
+			{
+				sum_ssim_blocks<2>(task, y, height, blockWidth, blockCount, blocks);
+			}
+		}
+
+		// sum_ssim_blocks for a row of 4x4 blocks of 8-bit channels. The kernel sums each byte down the 4 rows, which are
+		// then added up per block and channel. byteSums holds 5 * 4 * channelCount * blockCount values
+		inline void sum_ssim_blocks8(const MetricsTask& task, uint32_t y, uint32_t blockCount, uint32_t* byteSums, SsimBlock* blocks)
+		{
+			const ImageView& a = *task.a;
+			const ImageView& b = *task.b;
+			uint32_t channelCount = a.channelCount;
+			size_t byteCount = (size_t)blockCount * 4 * channelCount;
+			uint64_t firstRow = (uint64_t)task.slice * a.height + y;
+
+			get_kernels().ssim_sums8(a.data + firstRow * a.rowPitch, a.rowPitch, b.data + firstRow * b.rowPitch, b.rowPitch, byteCount, 4, byteSums);
+
+			for (uint32_t block = 0; block < blockCount; ++block)
+			{
+				for (uint32_t channel = 0; channel < channelCount; ++channel)
+				{
+					SsimBlock sums = {};
+
+					for (size_t i = block * 4 * channelCount + channel; i < (block + 1) * 4 * channelCount; i += channelCount)
+					{
+						sums.a += byteSums[i]; sums.b += byteSums[byteCount + i];
+						sums.aa += byteSums[2 * byteCount + i]; sums.bb += byteSums[3 * byteCount + i]; sums.ab += byteSums[4 * byteCount + i];
+					}
+
+					blocks[block * channelCount + channel] = sums;
+				}
+			}
+		}
+
+		inline double get_ssim(const SsimBlock& sums, double pixelCount, double maxValue)
+		{
+			const double c1 = (0.01 * maxValue) * (0.01 * maxValue);
+			const double c2 = (0.03 * maxValue) * (0.03 * maxValue);
+
+			double meanA = sums.a / pixelCount, meanB = sums.b / pixelCount;
+			double varianceA = sums.aa / pixelCount - meanA * meanA;
+			double varianceB = sums.bb / pixelCount - meanB * meanB;
+			double covariance = sums.ab / pixelCount - meanA * meanB;
+
+			return ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) / ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+		}
+
+		// Windows whose top row is in the task's band. Each one adds up 2x2 blocks, so block rows are summed once and
+		// reused by the windows above and below them
+		inline void accumulate_ssim(const MetricsTask& task, MetricsSums& sums)
+		{
+			const ImageView& a = *task.a;
+			uint32_t channelCount = a.channelCount;
+			double maxValue = a.bytesPerChannel == 1 ? 255.0 : 65535.0;
+
+			if (a.width < 8 || a.height < 8)
+			{
+				if (task.rowBegin == 0)
+				{
+					SsimBlock whole[4];
+					sum_ssim_blocks(task, 0, a.height, a.width, 1, whole);
+
+					for (uint32_t channel = 0; channel < channelCount; ++channel)
+					{
+						sums.ssim[channel] += get_ssim(whole[channel], (double)a.width * a.height, maxValue);
+					}
+
+					sums.ssimWindows++;
+				}
+
+				return;
+			}
+
+			uint32_t blocksX = a.width / 4;
+			uint32_t lastWindowRow = a.height / 4 - 2; // In blocks
+			uint32_t firstBlockRow = task.rowBegin / 4;
+			uint32_t endBlockRow = std::min((task.rowEnd + 3) / 4, lastWindowRow + 1);
+
+			if (firstBlockRow >= endBlockRow)
+			{
+				return;
+			}
+
+			std::vector<SsimBlock> upper(blocksX * channelCount), lower(blocksX * channelCount);
+			std::vector<uint32_t> byteSums(a.bytesPerChannel == 1 ? 5 * 4 * channelCount * blocksX : 0);
+
+			// 8-bit channels go through the SIMD kernels, 16-bit ones would overflow their 32-bit sums
+			auto sumBlocks = [&](uint32_t blockY, SsimBlock* blocks)
+			{
+				if (a.bytesPerChannel == 1)
+				{
+					sum_ssim_blocks8(task, blockY * 4, blocksX, byteSums.data(), blocks);
+				}
+				else
+				{
+					sum_ssim_blocks(task, blockY * 4, 4, 4, blocksX, blocks);
+				}
+			};
+
+			sumBlocks(firstBlockRow, upper.data());
+
+			for (uint32_t blockY = firstBlockRow; blockY < endBlockRow; ++blockY)
+			{
+				sumBlocks(blockY + 1, lower.data());
+
+				for (uint32_t blockX = 0; blockX + 1 < blocksX; ++blockX)
+				{
+					for (uint32_t channel = 0; channel < channelCount; ++channel)
+					{
+						const SsimBlock* quad[4] = { &upper[blockX * channelCount + channel], &upper[(blockX + 1) * channelCount + channel],
+						                             &lower[blockX * channelCount + channel], &lower[(blockX + 1) * channelCount + channel] };
+						SsimBlock window = {};
+
+						for (const SsimBlock* block : quad)
+						{
+							window.a += block->a; window.b += block->b;
+							window.aa += block->aa; window.bb += block->bb; window.ab += block->ab;
+						}
+
+						sums.ssim[channel] += get_ssim(window, 64.0, maxValue);
+					}
+
+					sums.ssimWindows++;
+				}
+
+				upper.swap(lower);
+			}
+		}
+
+		inline bool is_valid_image_view(const ImageView& view)
+		{
+			return view.data != nullptr && view.width > 0 && view.height > 0 && view.depth > 0 && view.channelCount >= 1 && view.channelCount <= 4 &&
+			       (view.bytesPerChannel == 1 || view.bytesPerChannel == 2) && view.rowPitch >= (uint64_t)view.width * view.channelCount * view.bytesPerChannel;
+		}
+
+		inline bool is_same_image_layout(const ImageView& a, const ImageView& b)
+		{
+			return a.width == b.width && a.height == b.height && a.depth == b.depth && a.channelCount == b.channelCount && a.bytesPerChannel == b.bytesPerChannel;
+		}
+
+		inline void add_metrics_tasks(const ImageView& a, const ImageView& b, uint32_t image, std::vector<MetricsTask>& tasks)
+		{
+			for (uint32_t slice = 0; slice < a.depth; ++slice)
+			{
+				for (uint32_t row = 0; row < a.height; row += METRICS_BAND_ROWS)
+				{
+					MetricsTask task = { &a, &b, image, slice, row, std::min(row + METRICS_BAND_ROWS, a.height) };
+					tasks.push_back(task);
+				}
+			}
+		}
+
+		inline void finish_metrics(const ImageView& view, const MetricsSums& sums, bool ssim, ImageMetrics& metrics)
+		{
+			double pixelCount = (double)view.width * view.height * view.depth;
+			double maxValue = view.bytesPerChannel == 1 ? 255.0 : 65535.0;
+
+			metrics.channelCount = view.channelCount;
+			memset(metrics.channels, 0, sizeof(metrics.channels));
+			memset(&metrics.average, 0, sizeof(metrics.average));
+
+			for (uint32_t channel = 0; channel < view.channelCount; ++channel)
+			{
+				ChannelMetrics& channelMetrics = metrics.channels[channel];
+				channelMetrics.mse = sums.squaredError[channel] / pixelCount;
+				channelMetrics.ssim = ssim && sums.ssimWindows > 0 ? sums.ssim[channel] / sums.ssimWindows : 0.0;
+				channelMetrics.maxError = sums.maxError[channel];
+
+				metrics.average.mse += channelMetrics.mse / view.channelCount;
+				metrics.average.ssim += channelMetrics.ssim / view.channelCount;
+				metrics.average.maxError = std::max(metrics.average.maxError, channelMetrics.maxError);
+			}
+
+			for (uint32_t channel = 0; channel <= view.channelCount; ++channel)
+			{
+				ChannelMetrics& channelMetrics = channel < view.channelCount ? metrics.channels[channel] : metrics.average;
+				channelMetrics.psnr = channelMetrics.mse > 0.0 ? 10.0 * log10(maxValue * maxValue / channelMetrics.mse) : std::numeric_limits<double>::infinity();
+			}
+		}
+
+		// Runs every task, then adds up each image's bands in order so the result doesn't depend on the thread count
+		inline void run_metrics_tasks(const std::vector<MetricsTask>& tasks, const MetricsOptions& options, std::vector<MetricsSums>& imageSums)
+		{
+			std::vector<MetricsSums> taskSums(tasks.size());
+			memset(taskSums.data(), 0, taskSums.size() * sizeof(MetricsSums));
+
+			parallel_for((uint32_t)tasks.size(), options.threadCount, [&](uint32_t index)
+			{
+				accumulate_errors(tasks[index], taskSums[index]);
+
+				if (options.ssim)
+				{
+					accumulate_ssim(tasks[index], taskSums[index]);
+				}
+			});
+
+			memset(imageSums.data(), 0, imageSums.size() * sizeof(MetricsSums));
+
+			for (size_t i = 0; i < tasks.size(); ++i)
+			{
+				MetricsSums& sums = imageSums[tasks[i].image];
+
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					sums.squaredError[channel] += taskSums[i].squaredError[channel];
+					sums.maxError[channel] = std::max(sums.maxError[channel], taskSums[i].maxError[channel]);
+					sums.ssim[channel] += taskSums[i].ssim[channel];
+				}
+
+				sums.ssimWindows += taskSums[i].ssimWindows;
+			}
+		}
+	}
+
+	// The subresource as an image, for formats whose channels are all GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT. Returns
+	// false for anything else, including packed and compressed formats
+	inline bool get_image_view(const Descriptor& desc, const unsigned char* fileData, const Subresource& subresource, ImageView& view)
+	{
+		if (desc.compressed || (desc.glType != GL_UNSIGNED_BYTE && desc.glType != GL_UNSIGNED_SHORT))
+		{
+			return false;
+		}
+
+		switch (desc.glFormat)
+		{
+			case GL_RED: case GL_GREEN: case GL_BLUE: case GL_ALPHA: case GL_LUMINANCE:
+			case GL_RED_INTEGER: case GL_GREEN_INTEGER: case GL_BLUE_INTEGER: case GL_ALPHA_INTEGER: case GL_LUMINANCE_INTEGER:
+				view.channelCount = 1;
+				break;
+			case GL_RG: case GL_LUMINANCE_ALPHA: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA_INTEGER:
+				view.channelCount = 2;
+				break;
+			case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+				view.channelCount = 3;
+				break;
+			case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER:
+				view.channelCount = 4;
+				break;
+			default:
+				return false;
+		}
+
+		view.data = fileData + subresource.offset;
+		view.width = subresource.width;
+		view.height = subresource.height;
+		view.depth = subresource.depth;
+		view.rowPitch = subresource.rowPitch;
+		view.bytesPerChannel = desc.glType == GL_UNSIGNED_SHORT ? 2 : 1;
+
+		return desc.bitsPerPixelOrBlock == view.channelCount * view.bytesPerChannel * 8;
+	}
+
+	inline MetricsResult compare_images(const ImageView& a, const ImageView& b, const MetricsOptions& options, ImageMetrics& metrics)
+	{
+		if (!internal::is_valid_image_view(a) || !internal::is_valid_image_view(b))
+		{
+			return MetricsUnsupportedFormat;
+		}
+
+		if (!internal::is_same_image_layout(a, b))
+		{
+			return MetricsMismatchedImages;
+		}
+
+		std::vector<internal::MetricsTask> tasks;
+		std::vector<internal::MetricsSums> sums(1);
+		internal::add_metrics_tasks(a, b, 0, tasks);
+		internal::run_metrics_tasks(tasks, options, sums);
+		internal::finish_metrics(a, sums[0], options.ssim, metrics);
+
+		return MetricsSuccess;
+	}
+
+	// Compares every subresource of two KTX files of the same format and dimensions, e.g. an encode against a
+	// reference. On success metrics holds one entry per subresource in layout order
+	inline MetricsResult compare_textures(const unsigned char* fileA, uint64_t sizeA, const unsigned char* fileB, uint64_t sizeB, const MetricsOptions& options, std::vector<ImageMetrics>& metrics)
+	{
+		Descriptor descA, descB;
+
+		if (validate_header(fileA, sizeA, descA) != ValidationSuccess || validate_header(fileB, sizeB, descB) != ValidationSuccess)
+		{
+			return MetricsInvalidTexture;
+		}
+
+		if (descA.glInternalFormat != descB.glInternalFormat || descA.glFormat != descB.glFormat || descA.glType != descB.glType ||
+			descA.width != descB.width || descA.height != descB.height || descA.depth != descB.depth || descA.type != descB.type ||
+			descA.arraySize != descB.arraySize || get_mip_count(descA) != get_mip_count(descB))
+		{
+			return MetricsMismatchedImages;
+		}
+
+		HeaderKTX headerA, headerB;
+		memcpy(&headerA, fileA, sizeof(HeaderKTX));
+		memcpy(&headerB, fileB, sizeof(HeaderKTX));
+
+		uint32_t subresourceCount = get_subresource_count(descA);
+		std::vector<Subresource> layoutA(subresourceCount), layoutB(subresourceCount);
+		compute_subresource_layout(descA, get_image_data_offset(headerA), layoutA.data());
+		compute_subresource_layout(descB, get_image_data_offset(headerB), layoutB.data());
+
+		std::vector<ImageView> viewsA(subresourceCount), viewsB(subresourceCount);
+		std::vector<internal::MetricsTask> tasks;
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			if (!get_image_view(descA, fileA, layoutA[i], viewsA[i]) || !get_image_view(descB, fileB, layoutB[i], viewsB[i]))
+			{
+				return MetricsUnsupportedFormat;
+			}
+		}
+
+		// Views don't move from here on, tasks point into them
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			internal::add_metrics_tasks(viewsA[i], viewsB[i], i, tasks);
+		}
+
+		std::vector<internal::MetricsSums> sums(subresourceCount);
+		internal::run_metrics_tasks(tasks, options, sums);
+		metrics.resize(subresourceCount);
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			internal::finish_metrics(viewsA[i], sums[i], options.ssim, metrics[i]);
+		}
+
+		return MetricsSuccess;
+	}
+}
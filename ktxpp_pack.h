@@ -0,0 +1,729 @@
+#pragma once
+
+// Pack files: many KTX 1.1 textures in one file, found through a directory at the front. Opening a library of
+// textures costs one open and one directory read instead of an open and a header read per texture.
+//
+//   PackHeader
+//   PackEntry[entryCount]              sorted by name hash
+//   Subresource[subresourceCount]      each texture's run is contiguous, offsets are from the start of the pack
+//   names                              entryCount names, not null terminated
+//   textures                           each an unmodified KTX file starting on a pageSize boundary
+//
+// Packs built with deduplication store identical images once, whether they are layers of one texture or mips
+// shared between textures, and point every copy's subresource at the same bytes
+//
+// The directory is stored in the layout the reader uses, so a mapped pack only needs its bounds checked before
+// subresources can be used in place. Packs use the byte order of the machine that built them, like KTX files do
+
+#include "ktxpp_hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace ktxpp
+{
+	enum PackResult
+	{
+		PackSuccess,
+		PackInvalidTexture,      // A texture given to the builder failed validate_header
+		PackDuplicateName,
+		PackOpenFailed,
+		PackWriteFailed,
+		PackTruncated,
+		PackInvalidIdentifier,
+		PackUnsupportedEndianness,
+		PackUnsupportedVersion,
+		PackMisaligned,          // Pack data must be 8 byte aligned
+		PackInvalidDirectory,
+	};
+
+	namespace internal
+	{
+		static ktxpp_constexpr uint32_t PACK_MAGIC      = 0x4b41504b; // "KPAK"
+		static ktxpp_constexpr uint32_t PACK_VERSION    = 1;
+		static ktxpp_constexpr uint32_t PACK_ENDIANNESS = 0x04030201;
+
+		struct PackHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t endianness;
+			uint32_t pageSize; // Alignment of every texture
+			uint32_t entryCount;
+			uint32_t subresourceCount;
+			uint32_t namesSize;
+			uint32_t reserved;
+			uint64_t dataOffset; // Offset of the first texture, i.e. the size of the directory rounded up to pageSize
+			uint64_t fileSize;
+		};
+
+		static_assert(sizeof(PackHeader) == 48, "PackHeader must match the file layout");
+		static_assert(sizeof(Subresource) == 48, "Subresource is stored in packs as is");
+
+		// FNV-1a, names are short and hashed once per lookup
+		inline uint64_t hash_pack_name(const char* name, size_t size)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3ull;
+			}
+
+			return hash;
+		}
+
+		inline uint64_t align_pack_offset(uint64_t offset, uint32_t alignment)
+		{
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+		// Descriptors read from a pack hold enums and bools, which must be checked as raw bytes before being loaded.
+		// Everything decode_header derives from the format must then match it, as layouts divide by the block size
+		inline bool is_valid_pack_descriptor(const Descriptor& desc)
+		{
+			uint32_t glFields[4];
+			uint32_t type;
+			unsigned char flags[3];
+			memcpy(glFields, &desc.glInternalFormat, sizeof(glFields));
+			memcpy(&type, &desc.type, sizeof(type));
+			memcpy(flags, &desc.compressed, sizeof(flags));
+
+			if (glFields[0] > 0xffff || glFields[1] > 0xffff || glFields[2] > 0xffff || glFields[3] > 0xffff ||
+			    type > Cubemap || flags[0] > 1 || flags[1] > 1 || flags[2] > 1 ||
+			    desc.numMips > 32 || desc.arraySize == 0 || desc.width == 0 || desc.height == 0 || desc.depth == 0)
+			{
+				return false;
+			}
+
+			uint32_t blockWidth, blockHeight;
+			get_block_size(desc.glInternalFormat, blockWidth, blockHeight);
+			uint32_t bitsPerPixelOrBlock = get_bits_per_pixel_or_block(desc.glInternalFormat);
+
+			if (bitsPerPixelOrBlock == 0 || bitsPerPixelOrBlock % 8 != 0 || bitsPerPixelOrBlock != desc.bitsPerPixelOrBlock ||
+			    blockWidth == 0 || blockHeight == 0 || blockWidth != desc.blockWidth || blockHeight != desc.blockHeight ||
+			    desc.compressed != is_compressed(desc.glInternalFormat) || desc.srgb != is_srgb(desc.glInternalFormat))
+			{
+				return false;
+			}
+
+			return desc.rowPitch == desc.width * desc.bitsPerPixelOrBlock / (8 * desc.blockWidth) &&
+			       desc.depthPitch == desc.rowPitch * desc.height / desc.blockHeight;
+		}
+
+		// The subresource at index of a texture must describe that mip, layer and face, with rows that hold a whole
+		// row of blocks and a size that covers them, so readers that trust it stay inside it
+		inline bool is_valid_pack_subresource(const Descriptor& desc, uint32_t index, const Subresource& subresource)
+		{
+			uint32_t faceCount = get_face_count(desc);
+			uint32_t mip = index / (desc.arraySize * faceCount);
+
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+			uint32_t mipWidth  = (desc.width  >> mip) > 0 ? (desc.width  >> mip) : 1;
+			uint32_t mipHeight = (desc.height >> mip) > 0 ? (desc.height >> mip) : 1;
+			uint32_t mipDepth  = (desc.depth  >> mip) > 0 ? (desc.depth  >> mip) : 1;
+
+			return subresource.mip == mip && subresource.layer == index / faceCount % desc.arraySize && subresource.face == index % faceCount &&
+			       subresource.width == mipWidth && subresource.height == mipHeight && subresource.depth == mipDepth &&
+			       subresource.rowPitch >= (uint64_t)widthInBlocks * (desc.bitsPerPixelOrBlock / 8) &&
+			       subresource.size == (uint64_t)subresource.rowPitch * heightInBlocks * mipDepth;
+		}
+	}
+
+	enum PackEntryFlags
+	{
+		// Some of the texture's images are stored once for it and other textures, or other layers of it, so its data
+		// isn't a complete KTX file and its images must be found through its subresources
+		PackEntryDeduplicated = 1,
+	};
+
+	struct PackEntry
+	{
+		uint64_t nameHash;
+		uint64_t offset; // Of the texture's KTX file from the start of the pack
+		uint64_t size;
+		uint32_t firstSubresource; // get_subresource_count(desc) entries of the subresource table
+		uint32_t nameOffset; // Into the names
+		uint32_t nameSize;
+		uint32_t flags; // PackEntryFlags
+		Descriptor desc;
+	};
+
+	static_assert(sizeof(PackEntry) % 8 == 0, "PackEntry must keep the subresource table 8 byte aligned");
+
+	// A pack in memory. Everything points into the pack data, which must stay alive
+	struct Pack
+	{
+		const unsigned char* data;
+		uint64_t size;
+		internal::PackHeader header;
+		const PackEntry* entries;
+		const Subresource* subresources;
+		const char* names;
+	};
+
+	// Checks the directory of a pack in memory, without touching the textures. data must be 8 byte aligned, which
+	// mapped files and heap allocations always are. pack is only filled in on success, and left empty otherwise so
+	// lookups find nothing
+	inline PackResult open_pack(Pack& pack, const unsigned char* data, uint64_t size)
+	{
+		using namespace internal;
+
+		ktxpp_stage(StageParse, "open_pack");
+		ktxpp_stage_work(size, 0);
+
+		memset(&pack, 0, sizeof(pack));
+
+		if (size < sizeof(PackHeader))
+		{
+			return PackTruncated;
+		}
+
+		if (((uintptr_t)data & 7) != 0)
+		{
+			return PackMisaligned;
+		}
+
+		PackHeader header;
+		memcpy(&header, data, sizeof(header));
+
+		if (header.magic != PACK_MAGIC)
+		{
+			return PackInvalidIdentifier;
+		}
+
+		if (header.endianness != PACK_ENDIANNESS)
+		{
+			return PackUnsupportedEndianness;
+		}
+
+		if (header.version != PACK_VERSION)
+		{
+			return PackUnsupportedVersion;
+		}
+
+		if (header.fileSize > size)
+		{
+			return PackTruncated;
+		}
+
+		uint64_t entriesOffset = sizeof(PackHeader);
+		uint64_t subresourcesOffset = entriesOffset + (uint64_t)header.entryCount * sizeof(PackEntry);
+		uint64_t namesOffset = subresourcesOffset + (uint64_t)header.subresourceCount * sizeof(Subresource);
+
+		if (namesOffset + header.namesSize > header.dataOffset || header.dataOffset > header.fileSize)
+		{
+			return PackInvalidDirectory;
+		}
+
+		Pack opened;
+		opened.data = data;
+		opened.size = header.fileSize;
+		opened.header = header;
+		opened.entries = reinterpret_cast<const PackEntry*>(data + entriesOffset);
+		opened.subresources = reinterpret_cast<const Subresource*>(data + subresourcesOffset);
+		opened.names = reinterpret_cast<const char*>(data + namesOffset);
+
+		// Every pointer handed out later must stay inside the pack
+		for (uint32_t i = 0; i < header.entryCount; ++i)
+		{
+			const PackEntry& entry = opened.entries[i];
+			const Descriptor& desc = entry.desc;
+
+			if ((i > 0 && entry.nameHash < opened.entries[i - 1].nameHash) ||
+			    (uint64_t)entry.nameOffset + entry.nameSize > header.namesSize ||
+			    entry.offset < header.dataOffset || entry.offset > header.fileSize || entry.size > header.fileSize - entry.offset ||
+			    !is_valid_pack_descriptor(desc) || desc.arraySize > header.subresourceCount)
+			{
+				return PackInvalidDirectory;
+			}
+
+			uint64_t subresourceCount = (uint64_t)get_mip_count(desc) * desc.arraySize * get_face_count(desc);
+
+			if ((uint64_t)entry.firstSubresource + subresourceCount > header.subresourceCount)
+			{
+				return PackInvalidDirectory;
+			}
+
+			for (uint32_t j = 0; j < (uint32_t)subresourceCount; ++j)
+			{
+				const Subresource& subresource = opened.subresources[entry.firstSubresource + j];
+
+				if (!is_valid_pack_subresource(desc, j, subresource))
+				{
+					return PackInvalidDirectory;
+				}
+
+				// Shared images of deduplicated textures can be anywhere in the texture data
+				uint64_t begin = (entry.flags & PackEntryDeduplicated) ? header.dataOffset : entry.offset;
+				uint64_t size = (entry.flags & PackEntryDeduplicated) ? header.fileSize - header.dataOffset : entry.size;
+
+				if (subresource.offset < begin || subresource.offset - begin > size || subresource.size > size - (subresource.offset - begin))
+				{
+					return PackInvalidDirectory;
+				}
+			}
+		}
+
+		pack = opened;
+		return PackSuccess;
+	}
+
+	// Returns nullptr when the pack has no texture of that name
+	inline const PackEntry* find_pack_texture(const Pack& pack, const char* name)
+	{
+		size_t nameSize = strlen(name);
+		uint64_t hash = internal::hash_pack_name(name, nameSize);
+
+		const PackEntry* end = pack.entries + pack.header.entryCount;
+		const PackEntry* entry = std::lower_bound(pack.entries, end, hash, [](const PackEntry& e, uint64_t h) { return e.nameHash < h; });
+
+		for (; entry != end && entry->nameHash == hash; ++entry)
+		{
+			if (entry->nameSize == nameSize && memcmp(pack.names + entry->nameOffset, name, nameSize) == 0)
+			{
+				return entry;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// get_subresource_count(entry.desc) entries, indexed with get_subresource_index. Offsets are from pack.data
+	inline const Subresource* get_pack_subresources(const Pack& pack, const PackEntry& entry)
+	{
+		return pack.subresources + entry.firstSubresource;
+	}
+
+	// The texture's complete KTX file, entry.size bytes. Deduplicated textures only keep their header and key/value
+	// data there
+	inline const unsigned char* get_pack_texture_data(const Pack& pack, const PackEntry& entry)
+	{
+		return pack.data + entry.offset;
+	}
+
+	inline std::string get_pack_texture_name(const Pack& pack, const PackEntry& entry)
+	{
+		return std::string(pack.names + entry.nameOffset, entry.nameSize);
+	}
+
+	// A pack mapped read only from disk
+	struct PackFile
+	{
+		Pack pack;
+		void* mapping;
+		uint64_t mappingSize;
+	};
+
+	inline void close_pack_file(PackFile& file)
+	{
+		if (file.mapping != nullptr)
+		{
+#if defined(_WIN32)
+			UnmapViewOfFile(file.mapping);
+#else
+			munmap(file.mapping, (size_t)file.mappingSize);
+#endif
+		}
+
+		file.mapping = nullptr;
+		file.mappingSize = 0;
+	}
+
+	inline PackResult open_pack_file(PackFile& file, const char* path)
+	{
+		file.mapping = nullptr;
+		file.mappingSize = 0;
+
+#if defined(_WIN32)
+		HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return PackOpenFailed;
+		}
+
+		LARGE_INTEGER size;
+		HANDLE mapping = nullptr;
+
+		if (GetFileSizeEx(handle, &size) && size.QuadPart > 0)
+		{
+			mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+
+		if (mapping != nullptr)
+		{
+			file.mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			file.mappingSize = (uint64_t)size.QuadPart;
+			CloseHandle(mapping);
+		}
+
+		CloseHandle(handle);
+#else
+		int fd = open(path, O_RDONLY);
+
+		if (fd < 0)
+		{
+			return PackOpenFailed;
+		}
+
+		struct stat status;
+
+		if (fstat(fd, &status) == 0 && status.st_size > 0)
+		{
+			void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+			if (mapping != MAP_FAILED)
+			{
+				file.mapping = mapping;
+				file.mappingSize = (uint64_t)status.st_size;
+			}
+		}
+
+		close(fd);
+#endif
+
+		if (file.mapping == nullptr)
+		{
+			return PackOpenFailed;
+		}
+
+		PackResult result = open_pack(file.pack, static_cast<const unsigned char*>(file.mapping), file.mappingSize);
+
+		if (result != PackSuccess)
+		{
+			close_pack_file(file);
+		}
+
+		return result;
+	}
+
+	namespace internal
+	{
+		struct PackSource
+		{
+			std::string name;
+			uint64_t nameHash;
+			const unsigned char* data;
+			uint64_t size;
+			Descriptor desc;
+			std::vector<Subresource> subresources; // Offsets from the start of the texture
+		};
+
+		struct PackVectorWriter
+		{
+			std::vector<unsigned char>& data;
+
+			bool write(const void* source, uint64_t size)
+			{
+				data.insert(data.end(), static_cast<const unsigned char*>(source), static_cast<const unsigned char*>(source) + size);
+				return true;
+			}
+		};
+
+		struct PackFileWriter
+		{
+			FILE* fh;
+
+			bool write(const void* source, uint64_t size)
+			{
+				return fwrite(source, 1, (size_t)size, fh) == size;
+			}
+		};
+	}
+
+	// Collects textures for a pack. Their data isn't copied and must stay alive until the pack is written
+	struct PackBuilder
+	{
+		uint32_t pageSize = 4096;
+		bool deduplicate = false; // Store identical images once, see PackEntryDeduplicated
+		std::vector<internal::PackSource> textures;
+	};
+
+	// Textures are stored in the order they are added, so add them in the order they are usually loaded
+	inline PackResult add_pack_texture(PackBuilder& builder, const char* name, const unsigned char* data, uint64_t size)
+	{
+		internal::PackSource source;
+		source.name = name;
+		source.nameHash = internal::hash_pack_name(name, source.name.size());
+		source.data = data;
+		source.size = size;
+
+		if (validate_header(data, size, source.desc) != ValidationSuccess)
+		{
+			return PackInvalidTexture;
+		}
+
+		internal::HeaderKTX header;
+		memcpy(&header, data, sizeof(header));
+
+		source.subresources.resize(get_subresource_count(source.desc));
+		compute_subresource_layout(source.desc, get_image_data_offset(header), source.subresources.data());
+
+		builder.textures.push_back(std::move(source));
+		return PackSuccess;
+	}
+
+	namespace internal
+	{
+		// Where a texture's data goes in the pack
+		struct PackTextureLayout
+		{
+			uint64_t offset;
+			uint64_t size;
+			std::vector<uint64_t> subresourceOffsets; // From the start of the pack
+			std::vector<bool> stored; // False for subresources that point at an identical one stored earlier
+			bool deduplicated; // Some subresource isn't stored, so the texture's data isn't a complete KTX file
+		};
+
+		// Texture data goes in the order textures were added. When deduplicating, a texture with an image that was seen
+		// before keeps the bytes before its first image and then only the images that weren't, each 16 byte aligned.
+		// Textures with nothing to share are stored whole. Identical hashes are always confirmed against the source
+		// bytes, so collisions can't merge different images
+		inline void layout_pack_textures(const PackBuilder& builder, uint64_t dataOffset, uint32_t pageSize, std::vector<PackTextureLayout>& layouts)
+		{
+			const std::vector<PackSource>& textures = builder.textures;
+			std::unordered_map<uint64_t, std::vector<std::pair<uint32_t, uint32_t> > > seen; // Hash to texture and subresource
+			uint64_t offset = dataOffset;
+
+			layouts.resize(textures.size());
+
+			for (uint32_t i = 0; i < (uint32_t)textures.size(); ++i)
+			{
+				const PackSource& source = textures[i];
+				PackTextureLayout& layout = layouts[i];
+
+				layout.offset = offset;
+				layout.size = source.size;
+				layout.subresourceOffsets.resize(source.subresources.size());
+				layout.stored.assign(source.subresources.size(), true);
+				layout.deduplicated = false;
+
+				// Find every image seen before first, the layout depends on whether there are any
+				std::vector<std::pair<uint32_t, uint32_t> > matches(source.subresources.size());
+
+				for (uint32_t j = 0; j < (uint32_t)source.subresources.size() && builder.deduplicate; ++j)
+				{
+					const Subresource& subresource = source.subresources[j];
+					const unsigned char* image = source.data + subresource.offset;
+					std::vector<std::pair<uint32_t, uint32_t> >& candidates = seen[hash_data(image, (size_t)subresource.size).low];
+
+					for (const std::pair<uint32_t, uint32_t>& candidate : candidates)
+					{
+						const Subresource& other = textures[candidate.first].subresources[candidate.second];
+
+						if (other.size == subresource.size && memcmp(textures[candidate.first].data + other.offset, image, (size_t)subresource.size) == 0)
+						{
+							matches[j] = candidate;
+							layout.stored[j] = false;
+							layout.deduplicated = true;
+							break;
+						}
+					}
+
+					if (layout.stored[j])
+					{
+						candidates.push_back(std::make_pair(i, j));
+					}
+				}
+
+				if (layout.deduplicated)
+				{
+					layout.size = source.subresources[0].offset;
+				}
+
+				for (uint32_t j = 0; j < (uint32_t)source.subresources.size(); ++j)
+				{
+					const Subresource& subresource = source.subresources[j];
+
+					if (!layout.deduplicated)
+					{
+						layout.subresourceOffsets[j] = offset + subresource.offset;
+					}
+					else if (!layout.stored[j])
+					{
+						layout.subresourceOffsets[j] = layouts[matches[j].first].subresourceOffsets[matches[j].second];
+					}
+					else
+					{
+						layout.size = align_pack_offset(layout.size, 16);
+						layout.subresourceOffsets[j] = offset + layout.size;
+						layout.size += subresource.size;
+					}
+				}
+
+				offset = align_pack_offset(offset + layout.size, pageSize);
+			}
+		}
+
+		template<typename Writer>
+		PackResult write_pack(const PackBuilder& builder, Writer& writer)
+		{
+			const std::vector<PackSource>& textures = builder.textures;
+			uint32_t pageSize = std::max(builder.pageSize, 16u);
+
+			std::vector<uint32_t> order(textures.size());
+
+			for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+			{
+				order[i] = i;
+			}
+
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+			{
+				return textures[a].nameHash != textures[b].nameHash ? textures[a].nameHash < textures[b].nameHash : textures[a].name < textures[b].name;
+			});
+
+			PackHeader header = {};
+			header.magic = PACK_MAGIC;
+			header.version = PACK_VERSION;
+			header.endianness = PACK_ENDIANNESS;
+			header.pageSize = pageSize;
+			header.entryCount = (uint32_t)textures.size();
+
+			uint64_t namesSize = 0;
+
+			for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+			{
+				if (i > 0 && textures[order[i]].name == textures[order[i - 1]].name)
+				{
+					return PackDuplicateName;
+				}
+
+				header.subresourceCount += (uint32_t)textures[order[i]].subresources.size();
+				namesSize += textures[order[i]].name.size();
+			}
+
+			header.namesSize = (uint32_t)namesSize;
+
+			uint64_t directorySize = sizeof(PackHeader) + (uint64_t)header.entryCount * sizeof(PackEntry) + (uint64_t)header.subresourceCount * sizeof(Subresource) + namesSize;
+			header.dataOffset = align_pack_offset(directorySize, pageSize);
+
+			std::vector<PackTextureLayout> layouts;
+			layout_pack_textures(builder, header.dataOffset, pageSize, layouts);
+			header.fileSize = textures.empty() ? header.dataOffset : layouts.back().offset + layouts.back().size;
+
+			std::vector<PackEntry> entries(textures.size());
+			std::vector<Subresource> subresources;
+			std::string names;
+			subresources.reserve(header.subresourceCount);
+			names.reserve((size_t)namesSize);
+
+			for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+			{
+				const PackSource& source = textures[order[i]];
+				const PackTextureLayout& layout = layouts[order[i]];
+				PackEntry& entry = entries[i];
+
+				memset(&entry, 0, sizeof(entry));
+				entry.nameHash = source.nameHash;
+				entry.offset = layout.offset;
+				entry.size = layout.size;
+				entry.firstSubresource = (uint32_t)subresources.size();
+				entry.nameOffset = (uint32_t)names.size();
+				entry.nameSize = (uint32_t)source.name.size();
+				entry.flags = layout.deduplicated ? PackEntryDeduplicated : 0;
+				entry.desc = source.desc;
+
+				for (uint32_t j = 0; j < (uint32_t)source.subresources.size(); ++j)
+				{
+					subresources.push_back(source.subresources[j]);
+					subresources.back().offset = layout.subresourceOffsets[j];
+				}
+
+				names += source.name;
+			}
+
+			std::vector<unsigned char> padding(pageSize, 0);
+
+			bool success = writer.write(&header, sizeof(header)) &&
+			               writer.write(entries.data(), entries.size() * sizeof(PackEntry)) &&
+			               writer.write(subresources.data(), subresources.size() * sizeof(Subresource)) &&
+			               writer.write(names.data(), names.size()) &&
+			               writer.write(padding.data(), header.dataOffset - directorySize);
+
+			uint64_t offset = header.dataOffset;
+
+			for (uint32_t i = 0; i < (uint32_t)textures.size() && success; ++i)
+			{
+				const PackSource& source = textures[i];
+				const PackTextureLayout& layout = layouts[i];
+
+				success = writer.write(padding.data(), layout.offset - offset);
+
+				if (!layout.deduplicated)
+				{
+					success = success && writer.write(source.data, source.size);
+				}
+				else
+				{
+					uint64_t prefixSize = source.subresources[0].offset;
+					success = success && writer.write(source.data, prefixSize);
+					offset = layout.offset + prefixSize;
+
+					for (uint32_t j = 0; j < (uint32_t)source.subresources.size() && success; ++j)
+					{
+						if (layout.stored[j])
+						{
+							const Subresource& subresource = source.subresources[j];
+							success = writer.write(padding.data(), layout.subresourceOffsets[j] - offset) && writer.write(source.data + subresource.offset, subresource.size);
+							offset = layout.subresourceOffsets[j] + subresource.size;
+						}
+					}
+				}
+
+				offset = layout.offset + layout.size;
+			}
+
+			return success ? PackSuccess : PackWriteFailed;
+		}
+	}
+
+	inline PackResult build_pack(const PackBuilder& builder, std::vector<unsigned char>& pack)
+	{
+		pack.clear();
+		internal::PackVectorWriter writer = { pack };
+		return internal::write_pack(builder, writer);
+	}
+
+	// Streams the pack to disk, so only the source textures are ever in memory
+	inline PackResult write_pack(const PackBuilder& builder, const char* path)
+	{
+		FILE* fh = fopen(path, "wb");
+
+		if (!fh)
+		{
+			return PackOpenFailed;
+		}
+
+		internal::PackFileWriter writer = { fh };
+		PackResult result = internal::write_pack(builder, writer);
+
+		if (fclose(fh) != 0 && result == PackSuccess)
+		{
+			result = PackWriteFailed;
+		}
+
+		return result;
+	}
+}
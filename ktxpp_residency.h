@@ -0,0 +1,240 @@
+#pragma once
+
+// Memory costs of a texture at each residency level, and a planner that picks which mips of many textures to keep
+// resident under a memory budget. A texture resident from mip m holds m and every smaller mip, the tail, for every
+// array layer and face. Costs are whole blocks with rows packed tightly, which is what the GPU copy of the data
+// takes before any driver alignment, rather than the 4-byte aligned rows of the file.
+//
+// Costs come from compute_residency_costs once per texture. plan_residency then runs every frame: it allocates
+// nothing and makes about twenty passes over the requests, each a few nanoseconds per texture
+
+#include "ktxpp.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ktxpp
+{
+	enum ResidencyResult
+	{
+		ResidencySuccess,
+		ResidencyOverBudget, // Even the floor mips don't fit, every texture is left at its floor
+		ResidencyInvalidRequest, // A request without costs
+	};
+
+	// KTX dimensions are 32 bits, so no texture has more mips than this
+	static ktxpp_constexpr uint32_t RESIDENCY_MAX_MIPS = 32;
+
+	struct ResidencyCosts
+	{
+		uint32_t mipCount;
+		uint64_t tailCosts[RESIDENCY_MAX_MIPS + 1]; // Bytes resident from each mip down, 0 past the last mip
+	};
+
+	// One texture for plan_residency. Mips wantedMip and above are all that's useful, e.g. from its size on screen, and
+	// floorMip and below always stay resident
+	struct ResidencyRequest
+	{
+		const ResidencyCosts* costs = nullptr;
+		float priority = 1.0f; // Relative, a texture with twice the priority keeps one more mip. 0 or less drops to the floor first
+		uint32_t wantedMip = 0;
+		uint32_t floorMip = RESIDENCY_MAX_MIPS; // Clamped to the last mip
+	};
+
+	// Bytes of one subresource of a mip
+	inline uint64_t get_image_cost(const Descriptor& desc, uint32_t mip)
+	{
+		uint32_t widthInBlocks, heightInBlocks;
+		get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+		uint64_t mipDepth = (desc.depth >> mip) > 0 ? (desc.depth >> mip) : 1;
+		uint64_t rowSize = ((uint64_t)widthInBlocks * desc.bitsPerPixelOrBlock + 7) / 8;
+
+		return rowSize * heightInBlocks * mipDepth;
+	}
+
+	// Bytes of a mip across every array layer and face
+	inline uint64_t get_mip_cost(const Descriptor& desc, uint32_t mip)
+	{
+		return get_image_cost(desc, mip) * desc.arraySize * get_face_count(desc);
+	}
+
+	// Bytes of a mip and every smaller one, across every array layer and face
+	inline uint64_t get_tail_cost(const Descriptor& desc, uint32_t mip)
+	{
+		uint64_t cost = 0;
+
+		for (uint32_t i = mip; i < get_mip_count(desc); ++i)
+		{
+			cost += get_mip_cost(desc, i);
+		}
+
+		return cost;
+	}
+
+	inline void compute_residency_costs(const Descriptor& desc, ResidencyCosts& costs)
+	{
+		costs.mipCount = std::min(get_mip_count(desc), RESIDENCY_MAX_MIPS);
+
+		for (uint32_t mip = costs.mipCount; mip <= RESIDENCY_MAX_MIPS; ++mip)
+		{
+			costs.tailCosts[mip] = 0;
+		}
+
+		for (uint32_t mip = costs.mipCount; mip-- > 0;)
+		{
+			costs.tailCosts[mip] = costs.tailCosts[mip + 1] + get_mip_cost(desc, mip);
+		}
+	}
+
+	namespace internal
+	{
+		// Mips a texture gives up at a threshold: the fewest k for which priority * 2^k reaches it
+		inline uint32_t get_residency_drop(float priority, double threshold)
+		{
+			if (!(priority > 0.0f))
+			{
+				return threshold > 0.0 ? RESIDENCY_MAX_MIPS : 0;
+			}
+
+			// With both as mantissa * 2^exponent, priority reaches threshold after the difference in exponents, plus one
+			// more if its mantissa is the smaller. Integer compares rather than log2 or a division, as this runs for
+			// every texture on every step of the search
+			double scaled = priority;
+			uint64_t thresholdBits, priorityBits;
+			memcpy(&thresholdBits, &threshold, sizeof(thresholdBits));
+			memcpy(&priorityBits, &scaled, sizeof(priorityBits));
+
+			int64_t drop = (int64_t)(thresholdBits >> 52) - (int64_t)(priorityBits >> 52) + ((thresholdBits & 0xfffffffffffffull) > (priorityBits & 0xfffffffffffffull));
+
+			if (drop <= 0)
+			{
+				return 0;
+			}
+
+			return drop < RESIDENCY_MAX_MIPS ? (uint32_t)drop : RESIDENCY_MAX_MIPS;
+		}
+
+		inline uint32_t get_residency_top_mip(const ResidencyRequest& request, uint32_t drop)
+		{
+			uint32_t floorMip = std::min(request.floorMip, request.costs->mipCount - 1);
+			uint32_t wantedMip = std::min(request.wantedMip, floorMip);
+
+			return std::min(wantedMip + drop, floorMip);
+		}
+
+		inline uint64_t get_residency_cost(const ResidencyRequest* requests, uint32_t count, double threshold)
+		{
+			uint64_t cost = 0;
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				cost += requests[i].costs->tailCosts[get_residency_top_mip(requests[i], get_residency_drop(requests[i].priority, threshold))];
+			}
+
+			return cost;
+		}
+
+		// Halvings of the threshold range, far finer than the priorities callers can tell apart
+		static ktxpp_constexpr uint32_t RESIDENCY_SEARCH_STEPS = 20;
+	}
+
+	// Chooses the top resident mip of each texture so the total stays within budget bytes. Every texture starts at its
+	// wanted mip, and while that doesn't fit, textures give up mips in order of priority: the lowest threshold is
+	// searched for at which a texture of priority p has dropped log2(threshold / p) mips. Budget left over under the
+	// threshold is handed out one mip at a time in request order. topMips receives count entries
+	inline ResidencyResult plan_residency(const ResidencyRequest* requests, uint32_t count, uint64_t budget, uint32_t* topMips, uint64_t& residentBytes)
+	{
+		ktxpp_stage(StageLayout, "plan_residency");
+
+		// Defined on every return, even for an invalid request
+		residentBytes = 0;
+
+		float minimum = 0.0f, maximum = 0.0f;
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (!requests[i].costs || requests[i].costs->mipCount == 0)
+			{
+				return ResidencyInvalidRequest;
+			}
+
+			if (requests[i].priority > 0.0f)
+			{
+				minimum = minimum > 0.0f ? std::min(minimum, requests[i].priority) : requests[i].priority;
+				maximum = std::max(maximum, requests[i].priority);
+			}
+		}
+
+		// Nothing drops at a threshold of 0, and everything is at its floor at the largest priority times 2^33
+		double lower = 0.0, upper = (maximum > 0.0f ? maximum : 1.0) * std::ldexp(1.0, (int)RESIDENCY_MAX_MIPS + 1);
+		ResidencyResult result = ResidencySuccess;
+
+		if (internal::get_residency_cost(requests, count, lower) <= budget)
+		{
+			upper = lower;
+		}
+		else if (internal::get_residency_cost(requests, count, upper) > budget)
+		{
+			result = ResidencyOverBudget;
+		}
+		else
+		{
+			// Up to the smallest priority only textures of priority 0 or less drop, past it the search halves the range
+			// in log2
+			if (minimum > 0.0f && internal::get_residency_cost(requests, count, minimum) <= budget)
+			{
+				upper = minimum;
+			}
+			else if (minimum > 0.0f)
+			{
+				lower = minimum;
+			}
+
+			for (uint32_t step = 0; step < internal::RESIDENCY_SEARCH_STEPS && lower > 0.0 && lower < upper; ++step)
+			{
+				double middle = std::sqrt(lower * upper);
+
+				if (middle <= lower || middle >= upper)
+				{
+					break;
+				}
+
+				if (internal::get_residency_cost(requests, count, middle) <= budget)
+				{
+					upper = middle;
+				}
+				else
+				{
+					lower = middle;
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			topMips[i] = internal::get_residency_top_mip(requests[i], internal::get_residency_drop(requests[i].priority, upper));
+			residentBytes += requests[i].costs->tailCosts[topMips[i]];
+		}
+
+		if (result != ResidencySuccess || upper == lower)
+		{
+			return result;
+		}
+
+		// Textures that would keep more at the threshold just below take what's left
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const ResidencyCosts& costs = *requests[i].costs;
+			uint32_t target = internal::get_residency_top_mip(requests[i], internal::get_residency_drop(requests[i].priority, lower));
+
+			while (topMips[i] > target && residentBytes - costs.tailCosts[topMips[i]] + costs.tailCosts[topMips[i] - 1] <= budget)
+			{
+				residentBytes += costs.tailCosts[topMips[i] - 1] - costs.tailCosts[topMips[i]];
+				topMips[i]--;
+			}
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,727 @@
+#pragma once
+
+// Texture cache shared between processes, so a pool of workers loading the same popular files parses and decodes
+// each once. Entries live in a named shared memory segment, a POSIX shm object or a Windows file mapping, and hold
+// the parsed Descriptor and subresource table of a KTX 1.1 file, optionally the file itself, and optionally any
+// number of pages of decoded data the caller produced from it, such as RGBA8 texels of a mip.
+//
+// The index is an open addressed hash table of atomic slots. A store claims a slot with a compare and swap, copies
+// the entry into space taken from the segment by another, and publishes it with a release store, so lookups never
+// lock or wait and only ever see complete entries. Everything in the segment is addressed by offset, as each
+// process maps it somewhere else.
+//
+// Entries are never removed and the segment never grows: once it is full, stores fail with SharedCacheFull and
+// lookups carry on. Remove the segment, e.g. when deploying new assets, to start over.
+//
+// A process can die part way through. A slot whose store outlives its process, or runs for longer than any store
+// takes, is given up on by the next store of the key, which claims another slot and leaks the space of the first.
+// A segment whose creator died before initializing it is removed and created again by the next process to open it
+
+#include "ktxpp_hash.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace ktxpp
+{
+	// Processes only share atomics that work without a lock, anything else would lock per process
+	static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "The shared texture cache needs lock free atomics");
+
+	enum SharedCacheResult
+	{
+		SharedCacheSuccess,
+		SharedCacheInvalidTexture, // The file failed validate_header, or a page names a subresource it doesn't have
+		SharedCacheExists,         // Another process stored the key first, or is storing it
+		SharedCacheFull,           // No room left in the segment or in the index
+	};
+
+	// Decoded data for one subresource. What the bytes hold is up to the caller, format is there to tell pages apart
+	struct SharedCachePage
+	{
+		const unsigned char* data;
+		uint64_t size;
+		uint32_t subresource;
+		uint32_t format; // e.g. GL_RGBA8 for decoded texels
+		uint32_t width;
+		uint32_t height;
+		uint32_t rowPitch;
+	};
+
+	namespace internal
+	{
+		static ktxpp_constexpr uint32_t SHARED_CACHE_MAGIC   = 0x4353504b; // "KPSC"
+		static ktxpp_constexpr uint32_t SHARED_CACHE_VERSION = 2;
+		static ktxpp_constexpr uint32_t SHARED_CACHE_READY   = 1;
+		static ktxpp_constexpr uint64_t SHARED_CACHE_FAILED  = 1; // Entry offset of a slot whose store ran out of space
+		static ktxpp_constexpr uint64_t SHARED_CACHE_ALIGNMENT = 64; // Of every entry and every block of data, a cache line
+
+		// How long to wait for the process that created the segment to initialize it
+		static ktxpp_constexpr uint32_t SHARED_CACHE_OPEN_ATTEMPTS = 1000;
+		static ktxpp_constexpr uint32_t SHARED_CACHE_OPEN_SLEEP_MS = 1;
+
+		// Seconds after which a store still in progress is taken for a process that hung, far more than copying in
+		// even a large file takes
+		static ktxpp_constexpr uint32_t SHARED_CACHE_STORE_TIMEOUT_S = 30;
+
+		struct SharedCacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			std::atomic<uint32_t> state; // SHARED_CACHE_READY once the creator has filled in the rest
+			std::atomic<uint32_t> creator; // Process id of the creator, written before anything else
+			uint32_t slotCount; // A power of two
+			uint64_t segmentSize;
+			uint64_t dataOffset; // Of the first entry, after the slots
+			std::atomic<uint64_t> dataUsed; // Bytes taken from dataOffset on
+			std::atomic<uint64_t> hits;
+			std::atomic<uint64_t> misses;
+			std::atomic<uint64_t> stores;
+		};
+
+		struct SharedCacheSlot
+		{
+			std::atomic<uint64_t> tag; // The key's high half, never 0, set once by the store that claims the slot
+			std::atomic<uint64_t> entry; // Offset of the entry, 0 until it is complete
+			std::atomic<uint64_t> lease; // Process id of the store in the high half, the second it started in the low
+		};
+
+		struct SharedCacheEntry
+		{
+			Hash128 key;
+			Descriptor desc;
+			uint64_t fileOffset; // 0 when the file wasn't stored
+			uint64_t fileSize;
+			uint32_t subresourceCount;
+			uint32_t pageCount;
+			// Followed by the subresource table and the page records
+		};
+
+		struct SharedCachePageRecord
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint32_t subresource;
+			uint32_t format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t rowPitch;
+			uint32_t reserved;
+		};
+
+		static_assert(sizeof(SharedCacheEntry) % 8 == 0, "SharedCacheEntry must keep the subresource table 8 byte aligned");
+		static_assert(sizeof(Subresource) % 8 == 0, "Subresource must keep the page records 8 byte aligned");
+
+		inline uint64_t align_shared_offset(uint64_t offset)
+		{
+			return (offset + SHARED_CACHE_ALIGNMENT - 1) / SHARED_CACHE_ALIGNMENT * SHARED_CACHE_ALIGNMENT;
+		}
+
+		inline uint64_t get_shared_cache_tag(const Hash128& key)
+		{
+			return key.high != 0 ? key.high : 1;
+		}
+
+		inline void wait_for_shared_cache()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(SHARED_CACHE_OPEN_SLEEP_MS));
+		}
+
+		inline uint32_t get_shared_cache_process_id()
+		{
+#if defined(_WIN32)
+			return (uint32_t)GetCurrentProcessId();
+#else
+			return (uint32_t)getpid();
+#endif
+		}
+
+		// Wall clock seconds, the same in every process. Only differences are used, so wrapping doesn't matter
+		inline uint32_t get_shared_cache_time()
+		{
+			return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+
+		inline uint64_t make_shared_cache_lease(uint32_t processId, uint32_t time)
+		{
+			return (uint64_t)processId << 32 | time;
+		}
+
+		// Processes this one isn't allowed to query, e.g. of another user, count as running
+		inline bool is_shared_cache_process_alive(uint32_t processId)
+		{
+#if defined(_WIN32)
+			HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+
+			if (process == nullptr)
+			{
+				return GetLastError() == ERROR_ACCESS_DENIED;
+			}
+
+			bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+			CloseHandle(process);
+			return alive;
+#else
+			return kill((pid_t)processId, 0) == 0 || errno == EPERM;
+#endif
+		}
+
+		// Fails the store in progress in slot if its process died or it has run past SHARED_CACHE_STORE_TIMEOUT_S, so
+		// the key can be stored in another slot. Returns whether the slot was failed
+		inline bool abandon_shared_cache_store(SharedCacheSlot& slot)
+		{
+			uint64_t lease = slot.lease.load(std::memory_order_acquire);
+			uint32_t now = get_shared_cache_time();
+
+			// Claimed, but the lease isn't written yet. Start the clock for a process that died in between, a live one
+			// overwrites it
+			if (lease == 0)
+			{
+				slot.lease.compare_exchange_strong(lease, make_shared_cache_lease(0, now), std::memory_order_acq_rel);
+				return false;
+			}
+
+			uint32_t owner = (uint32_t)(lease >> 32);
+
+			if ((owner == 0 || is_shared_cache_process_alive(owner)) && now - (uint32_t)lease <= SHARED_CACHE_STORE_TIMEOUT_S)
+			{
+				return false;
+			}
+
+			uint64_t inProgress = 0;
+			return slot.entry.compare_exchange_strong(inProgress, SHARED_CACHE_FAILED, std::memory_order_acq_rel) || inProgress == SHARED_CACHE_FAILED;
+		}
+	}
+
+	// A process's view of the segment
+	struct SharedTextureCache
+	{
+		unsigned char* base;
+		uint64_t size; // Of the mapping
+		internal::SharedCacheHeader* header;
+		internal::SharedCacheSlot* slots;
+#if defined(_WIN32)
+		HANDLE mapping;
+#endif
+	};
+
+	// A cached texture. Everything points into the segment and stays valid while the cache is open
+	struct SharedTexture
+	{
+		Descriptor desc;
+		const Subresource* subresources; // get_subresource_count(desc) entries, offsets into the file
+		const unsigned char* file; // nullptr when stored without the file
+		uint64_t fileSize;
+		uint32_t pageCount;
+		const internal::SharedCachePageRecord* pages;
+		const unsigned char* base;
+	};
+
+	struct SharedCacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t stores;
+		uint64_t bytesUsed; // Of the space for entries
+		uint64_t capacity;
+	};
+
+	// Key for a file by name and version, e.g. its path and modification time, so workers can look it up before
+	// reading it
+	inline Hash128 get_shared_cache_key(const char* name, uint64_t version)
+	{
+		Hash128 key = hash_data(name, strlen(name));
+		return hash_combine(key, &version, sizeof(version));
+	}
+
+	namespace internal
+	{
+#if !defined(_WIN32)
+		// Removes the segment at path if it's still the abandoned one, and not one created since by another process
+		// that found it abandoned too
+		inline void remove_abandoned_shared_cache(const std::string& path, const struct stat& abandoned)
+		{
+			int fd = shm_open(path.c_str(), O_RDONLY, 0600);
+
+			if (fd < 0)
+			{
+				return;
+			}
+
+			struct stat status;
+			bool same = fstat(fd, &status) == 0 && status.st_dev == abandoned.st_dev && status.st_ino == abandoned.st_ino;
+			close(fd);
+
+			if (same)
+			{
+				shm_unlink(path.c_str());
+			}
+		}
+#endif
+
+		// One attempt of open_shared_texture_cache. abandoned is set when the segment exists but its creator died
+		// before initializing it, after removing it where that's possible
+		inline bool map_shared_texture_cache(SharedTextureCache& cache, const char* name, uint64_t size, uint32_t slots, bool& abandoned)
+		{
+			abandoned = false;
+			cache.base = nullptr;
+			cache.size = 0;
+			cache.header = nullptr;
+			cache.slots = nullptr;
+
+			// Too small to create, but an existing segment can still be opened
+			uint64_t dataOffset = align_shared_offset(sizeof(SharedCacheHeader) + (uint64_t)slots * sizeof(SharedCacheSlot));
+			bool creatable = size > dataOffset;
+			bool created;
+			void* view;
+			uint64_t mappedSize;
+
+#if defined(_WIN32)
+			std::string mappingName = std::string("Local\\") + name;
+			HANDLE mapping = creatable ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, mappingName.c_str()) :
+			                             OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+
+			if (mapping == nullptr)
+			{
+				return false;
+			}
+
+			// Whoever created the mapping chose its size
+			created = creatable && GetLastError() != ERROR_ALREADY_EXISTS;
+			view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+			MEMORY_BASIC_INFORMATION info;
+
+			if (view == nullptr || VirtualQuery(view, &info, sizeof(info)) == 0)
+			{
+				if (view)
+				{
+					UnmapViewOfFile(view);
+				}
+
+				CloseHandle(mapping);
+				return false;
+			}
+
+			mappedSize = info.RegionSize;
+			cache.mapping = mapping;
+#else
+			std::string path = std::string("/") + name;
+			int fd = creatable ? shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600) : -1;
+			created = fd >= 0;
+
+			if (created)
+			{
+				if (ftruncate(fd, (off_t)size) != 0)
+				{
+					close(fd);
+					shm_unlink(path.c_str());
+					return false;
+				}
+
+				mappedSize = size;
+			}
+			else
+			{
+				fd = !creatable || errno == EEXIST ? shm_open(path.c_str(), O_RDWR, 0600) : -1;
+
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				// The creator may not have sized it yet
+				struct stat status;
+
+				for (uint32_t attempt = 0; fstat(fd, &status) == 0 && status.st_size == 0 && attempt < SHARED_CACHE_OPEN_ATTEMPTS; ++attempt)
+				{
+					wait_for_shared_cache();
+				}
+
+				bool sized = fstat(fd, &status) == 0;
+
+				if (!sized || (uint64_t)status.st_size <= sizeof(SharedCacheHeader))
+				{
+					// A live creator sizes the segment right after creating it
+					abandoned = sized && status.st_size == 0;
+
+					if (abandoned)
+					{
+						remove_abandoned_shared_cache(path, status);
+					}
+
+					close(fd);
+					return false;
+				}
+
+				mappedSize = (uint64_t)status.st_size;
+			}
+
+			// Zeroed if it can't be told, which matches no segment
+			struct stat segment = {};
+			fstat(fd, &segment);
+			view = mmap(nullptr, (size_t)mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+
+			if (view == MAP_FAILED)
+			{
+				if (created)
+				{
+					shm_unlink(path.c_str());
+				}
+
+				return false;
+			}
+#endif
+
+			cache.base = (unsigned char*)view;
+			cache.size = mappedSize;
+
+			// New segments are zero filled, the atomics are still constructed properly before anyone is told it's ready
+			if (created)
+			{
+				SharedCacheHeader* header = new (cache.base) SharedCacheHeader();
+				header->creator.store(get_shared_cache_process_id(), std::memory_order_relaxed);
+				header->magic = SHARED_CACHE_MAGIC;
+				header->version = SHARED_CACHE_VERSION;
+				header->slotCount = slots;
+				header->segmentSize = mappedSize;
+				header->dataOffset = dataOffset;
+
+				for (uint32_t i = 0; i < slots; ++i)
+				{
+					new (cache.base + sizeof(SharedCacheHeader) + i * sizeof(SharedCacheSlot)) SharedCacheSlot();
+				}
+
+				header->state.store(SHARED_CACHE_READY, std::memory_order_release);
+			}
+
+			cache.header = (SharedCacheHeader*)cache.base;
+
+			for (uint32_t attempt = 0; cache.header->state.load(std::memory_order_acquire) != SHARED_CACHE_READY && attempt < SHARED_CACHE_OPEN_ATTEMPTS; ++attempt)
+			{
+				wait_for_shared_cache();
+			}
+
+			const SharedCacheHeader& header = *cache.header;
+			bool valid = header.state.load(std::memory_order_acquire) == SHARED_CACHE_READY && header.magic == SHARED_CACHE_MAGIC &&
+			             header.version == SHARED_CACHE_VERSION && header.segmentSize <= mappedSize && header.slotCount != 0 &&
+			             (header.slotCount & (header.slotCount - 1)) == 0 &&
+			             header.dataOffset >= sizeof(SharedCacheHeader) + (uint64_t)header.slotCount * sizeof(SharedCacheSlot) &&
+			             header.dataOffset < header.segmentSize;
+
+			if (!valid)
+			{
+				// A live creator writes its process id right after mapping the segment
+				if (header.state.load(std::memory_order_acquire) != SHARED_CACHE_READY)
+				{
+					uint32_t creator = header.creator.load(std::memory_order_acquire);
+					abandoned = creator == 0 || !is_shared_cache_process_alive(creator);
+				}
+
+#if defined(_WIN32)
+				UnmapViewOfFile(view);
+				CloseHandle(cache.mapping);
+#else
+				munmap(view, (size_t)mappedSize);
+
+				if (abandoned)
+				{
+					remove_abandoned_shared_cache(path, segment);
+				}
+#endif
+				cache.base = nullptr;
+				cache.header = nullptr;
+				return false;
+			}
+
+			cache.slots = (SharedCacheSlot*)(cache.base + sizeof(SharedCacheHeader));
+			return true;
+		}
+	}
+
+	// Opens the segment called name, creating it with size bytes and slotCount index slots if no process has yet.
+	// name is a plain identifier, e.g. "thumbnails", shared by every process. When the segment exists its own size
+	// and slot count are used. Returns false if it can't be created or mapped, or was made by another version
+	inline bool open_shared_texture_cache(SharedTextureCache& cache, const char* name, uint64_t size, uint32_t slotCount = 4096)
+	{
+		uint32_t slots = 16;
+
+		while (slots < slotCount && slots < 0x80000000u)
+		{
+			slots *= 2;
+		}
+
+		// A segment whose creator died is removed by the first attempt and created again by the second. On Windows
+		// it only goes once no other process has it open
+		bool abandoned = false;
+
+		for (uint32_t attempt = 0; attempt < 2; ++attempt)
+		{
+			if (internal::map_shared_texture_cache(cache, name, size, slots, abandoned))
+			{
+				return true;
+			}
+
+			if (!abandoned)
+			{
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	// Unmaps the segment. It stays alive for other processes, and for this one to open again
+	inline void close_shared_texture_cache(SharedTextureCache& cache)
+	{
+		if (cache.base)
+		{
+#if defined(_WIN32)
+			UnmapViewOfFile(cache.base);
+			CloseHandle(cache.mapping);
+#else
+			munmap(cache.base, (size_t)cache.size);
+#endif
+		}
+
+		cache.base = nullptr;
+		cache.header = nullptr;
+		cache.slots = nullptr;
+	}
+
+	// Removes the segment by name. Processes that have it open keep their mapping, the next open creates a new one.
+	// Windows removes a mapping when the last process closes it, so this only does something elsewhere
+	inline bool remove_shared_texture_cache(const char* name)
+	{
+#if defined(_WIN32)
+		(void)name;
+		return true;
+#else
+		return shm_unlink((std::string("/") + name).c_str()) == 0 || errno == ENOENT;
+#endif
+	}
+
+	inline bool find_shared_texture(SharedTextureCache& cache, const Hash128& key, SharedTexture& texture)
+	{
+		ktxpp_stage(StageIO, "find_shared_texture");
+
+		internal::SharedCacheHeader& header = *cache.header;
+		uint64_t tag = internal::get_shared_cache_tag(key);
+		uint32_t mask = header.slotCount - 1;
+		bool found = false;
+
+		for (uint32_t probe = 0; probe <= mask && !found; ++probe)
+		{
+			internal::SharedCacheSlot& slot = cache.slots[(key.low + probe) & mask];
+			uint64_t slotTag = slot.tag.load(std::memory_order_acquire);
+
+			// Slots are only ever claimed, so an empty one ends the probe sequence
+			if (slotTag == 0)
+			{
+				break;
+			}
+
+			uint64_t offset = slotTag == tag ? slot.entry.load(std::memory_order_acquire) : 0;
+
+			if (offset <= internal::SHARED_CACHE_FAILED)
+			{
+				continue;
+			}
+
+			const internal::SharedCacheEntry& entry = *(const internal::SharedCacheEntry*)(cache.base + offset);
+
+			if (entry.key == key)
+			{
+				const unsigned char* tables = cache.base + offset + sizeof(internal::SharedCacheEntry);
+				texture.desc = entry.desc;
+				texture.subresources = (const Subresource*)tables;
+				texture.file = entry.fileOffset != 0 ? cache.base + entry.fileOffset : nullptr;
+				texture.fileSize = entry.fileSize;
+				texture.pageCount = entry.pageCount;
+				texture.pages = (const internal::SharedCachePageRecord*)(tables + entry.subresourceCount * sizeof(Subresource));
+				texture.base = cache.base;
+				found = true;
+			}
+		}
+
+		(found ? header.hits : header.misses).fetch_add(1, std::memory_order_relaxed);
+		ktxpp_count_cache(found);
+		return found;
+	}
+
+	inline void get_shared_texture_page(const SharedTexture& texture, uint32_t index, SharedCachePage& page)
+	{
+		const internal::SharedCachePageRecord& record = texture.pages[index];
+		page.data = texture.base + record.offset;
+		page.size = record.size;
+		page.subresource = record.subresource;
+		page.format = record.format;
+		page.width = record.width;
+		page.height = record.height;
+		page.rowPitch = record.rowPitch;
+	}
+
+	// Parses file and stores its descriptor and subresource table under key, along with the file itself if storeFile
+	// is set and pageCount pages of decoded data. Nothing is replaced: the first store of a key wins
+	inline SharedCacheResult store_shared_texture(SharedTextureCache& cache, const Hash128& key, const unsigned char* file, uint64_t fileSize, bool storeFile, const SharedCachePage* pages = nullptr, uint32_t pageCount = 0)
+	{
+		ktxpp_stage(StageIO, "store_shared_texture");
+
+		// Padding is cleared too, nothing from this process's stack ends up in shared memory
+		Descriptor desc;
+		memset(&desc, 0, sizeof(desc));
+
+		if (validate_header(file, fileSize, desc) != ValidationSuccess)
+		{
+			return SharedCacheInvalidTexture;
+		}
+
+		uint32_t subresourceCount = get_subresource_count(desc);
+		uint64_t tablesSize = sizeof(internal::SharedCacheEntry) + (uint64_t)subresourceCount * sizeof(Subresource) + (uint64_t)pageCount * sizeof(internal::SharedCachePageRecord);
+		uint64_t size = internal::align_shared_offset(tablesSize) + (storeFile ? internal::align_shared_offset(fileSize) : 0);
+
+		for (uint32_t i = 0; i < pageCount; ++i)
+		{
+			if (pages[i].subresource >= subresourceCount)
+			{
+				return SharedCacheInvalidTexture;
+			}
+
+			size += internal::align_shared_offset(pages[i].size);
+		}
+
+		// Claim a slot for the key first, so processes loading the same file at once don't all copy it in
+		internal::SharedCacheHeader& header = *cache.header;
+		uint64_t tag = internal::get_shared_cache_tag(key);
+		uint32_t mask = header.slotCount - 1;
+		internal::SharedCacheSlot* claimed = nullptr;
+
+		for (uint32_t probe = 0; probe <= mask && !claimed; ++probe)
+		{
+			internal::SharedCacheSlot& slot = cache.slots[(key.low + probe) & mask];
+			uint64_t slotTag = 0;
+
+			if (slot.tag.compare_exchange_strong(slotTag, tag, std::memory_order_acq_rel))
+			{
+				claimed = &slot;
+				claimed->lease.store(internal::make_shared_cache_lease(internal::get_shared_cache_process_id(), internal::get_shared_cache_time()), std::memory_order_release);
+			}
+			else if (slotTag == tag)
+			{
+				// The same high half of another key is only told apart once that entry is complete. A store left behind
+				// by a process that died is failed, and probing carries on to claim another slot
+				uint64_t offset = slot.entry.load(std::memory_order_acquire);
+
+				if ((offset == 0 && !internal::abandon_shared_cache_store(slot)) ||
+				    (offset > internal::SHARED_CACHE_FAILED && ((const internal::SharedCacheEntry*)(cache.base + offset))->key == key))
+				{
+					return SharedCacheExists;
+				}
+			}
+		}
+
+		if (!claimed)
+		{
+			return SharedCacheFull;
+		}
+
+		uint64_t used = header.dataUsed.load(std::memory_order_relaxed);
+		uint64_t capacity = header.segmentSize - header.dataOffset;
+
+		do
+		{
+			if (size > capacity - used)
+			{
+				claimed->entry.store(internal::SHARED_CACHE_FAILED, std::memory_order_release);
+				return SharedCacheFull;
+			}
+		}
+		while (!header.dataUsed.compare_exchange_weak(used, used + size, std::memory_order_relaxed));
+
+		uint64_t offset = header.dataOffset + used;
+		unsigned char* destination = cache.base + offset;
+
+		internal::SharedCacheEntry& entry = *(internal::SharedCacheEntry*)destination;
+		entry.key = key;
+		entry.desc = desc;
+		entry.fileSize = fileSize;
+		entry.subresourceCount = subresourceCount;
+		entry.pageCount = pageCount;
+
+		HeaderKTX ktxHeader;
+		memcpy(&ktxHeader, file, sizeof(HeaderKTX));
+		Subresource* subresources = (Subresource*)(destination + sizeof(internal::SharedCacheEntry));
+		memset(subresources, 0, subresourceCount * sizeof(Subresource));
+		compute_subresource_layout(desc, get_image_data_offset(ktxHeader), subresources);
+
+		uint64_t dataOffset = offset + internal::align_shared_offset(tablesSize);
+		entry.fileOffset = storeFile ? dataOffset : 0;
+
+		if (storeFile)
+		{
+			memcpy(cache.base + dataOffset, file, (size_t)fileSize);
+			dataOffset += internal::align_shared_offset(fileSize);
+		}
+
+		internal::SharedCachePageRecord* records = (internal::SharedCachePageRecord*)(destination + sizeof(internal::SharedCacheEntry) + subresourceCount * sizeof(Subresource));
+
+		for (uint32_t i = 0; i < pageCount; ++i)
+		{
+			internal::SharedCachePageRecord& record = records[i];
+			record.offset = dataOffset;
+			record.size = pages[i].size;
+			record.subresource = pages[i].subresource;
+			record.format = pages[i].format;
+			record.width = pages[i].width;
+			record.height = pages[i].height;
+			record.rowPitch = pages[i].rowPitch;
+			record.reserved = 0;
+
+			memcpy(cache.base + dataOffset, pages[i].data, (size_t)pages[i].size);
+			dataOffset += internal::align_shared_offset(pages[i].size);
+		}
+
+		ktxpp_stage_work(size, 0);
+
+		// Everything above becomes visible to a process that sees the offset. If another process took this store for
+		// a hung one in the meantime, its store of the key wins and this space is left unused
+		uint64_t inProgress = 0;
+
+		if (!claimed->entry.compare_exchange_strong(inProgress, offset, std::memory_order_release, std::memory_order_relaxed))
+		{
+			return SharedCacheExists;
+		}
+
+		header.stores.fetch_add(1, std::memory_order_relaxed);
+		return SharedCacheSuccess;
+	}
+
+	inline SharedCacheStats get_shared_cache_stats(const SharedTextureCache& cache)
+	{
+		SharedCacheStats stats;
+		stats.hits = cache.header->hits.load(std::memory_order_relaxed);
+		stats.misses = cache.header->misses.load(std::memory_order_relaxed);
+		stats.stores = cache.header->stores.load(std::memory_order_relaxed);
+		stats.bytesUsed = cache.header->dataUsed.load(std::memory_order_relaxed);
+		stats.capacity = cache.header->segmentSize - cache.header->dataOffset;
+		return stats;
+	}
+}
@@ -0,0 +1,353 @@
+#pragma once
+
+// Statistics for choosing a format before encoding: the range and mean of each channel, whether alpha is opaque, 1-bit
+// or fully used, and which blocks of the target block size hold a single colour. A texture with opaque alpha can go to
+// BC1 rather than BC3, constant channels can be dropped, and constant blocks can be written without searching.
+//
+// Images are the same 8 or 16-bit unsigned images ktxpp_metrics.h compares. Each band of rows is read once, 8-bit
+// channels through the SIMD kernels from ktxpp_dispatch.h, with the constant block test run on a band while it is
+// still in cache. Bands, and the subresources of a texture, are analyzed in parallel
+
+#include "ktxpp_metrics.h"
+
+namespace ktxpp
+{
+	enum StatsResult
+	{
+		StatsSuccess,
+		StatsInvalidTexture,
+		StatsUnsupportedFormat,
+	};
+
+	enum AlphaUsage
+	{
+		AlphaNone,   // No alpha channel
+		AlphaOpaque, // Every alpha is the maximum value
+		AlphaBinary, // Every alpha is 0 or the maximum value
+		AlphaFull,
+	};
+
+	struct ChannelStats
+	{
+		uint32_t minimum;
+		uint32_t maximum;
+		double mean;
+		bool constant; // minimum == maximum
+	};
+
+	// Channels are in storage order, e.g. blue first for BGRA
+	struct ImageStats
+	{
+		uint32_t channelCount;
+		ChannelStats channels[4];
+		AlphaUsage alpha;
+		uint64_t blockCount; // Partial blocks at the right and bottom edges included
+		uint64_t constantBlockCount;
+		std::vector<unsigned char> constantBlocks; // With StatsOptions::blockMask, 1 per constant block in row order, slice after slice
+	};
+
+	struct StatsOptions
+	{
+		uint32_t blockWidth = 4; // Of the target format, e.g. 4x4 for BC or 6x6 for ASTC 6x6
+		uint32_t blockHeight = 4;
+		bool blockMask = false;
+		uint32_t threadCount = 1; // 0 uses every core
+	};
+
+	namespace internal
+	{
+		// Rows per work item before rounding up to whole blocks
+		static ktxpp_constexpr uint32_t STATS_BAND_ROWS = 64;
+
+		struct StatsSums
+		{
+			uint64_t sums[4];
+			uint64_t partials[4]; // Values other than 0 and the maximum
+			uint32_t minima[4];
+			uint32_t maxima[4];
+			uint64_t constantBlocks;
+		};
+
+		// Rows of one depth slice, always starting on a block row
+		struct StatsTask
+		{
+			const ImageView* image;
+			uint32_t index;
+			uint32_t slice;
+			uint32_t rowBegin;
+			uint32_t rowEnd;
+		};
+
+		inline void accumulate_channel_stats(const StatsTask& task, StatsSums& sums)
+		{
+			const ImageView& image = *task.image;
+			size_t rowBytes = (size_t)image.width * image.channelCount * image.bytesPerChannel;
+			const unsigned char* first = image.data + ((uint64_t)task.slice * image.height + task.rowBegin) * image.rowPitch;
+			uint32_t rowCount = task.rowEnd - task.rowBegin;
+
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				sums.minima[channel] = 0xffffffffu;
+			}
+
+			if (image.bytesPerChannel == 1)
+			{
+				const Kernels& kernels = get_kernels();
+				uint64_t laneSums[ERROR_LANES] = {}, lanePartials[ERROR_LANES] = {};
+				unsigned char laneMinima[ERROR_LANES], laneMaxima[ERROR_LANES] = {};
+				memset(laneMinima, 255, sizeof(laneMinima));
+
+				// Rows are a whole number of pixels, so unpadded rows can go through as one
+				if (image.rowPitch == rowBytes)
+				{
+					kernels.channel_stats8(first, rowBytes * rowCount, laneSums, lanePartials, laneMinima, laneMaxima);
+				}
+				else
+				{
+					for (uint32_t row = 0; row < rowCount; ++row)
+					{
+						kernels.channel_stats8(first + (uint64_t)row * image.rowPitch, rowBytes, laneSums, lanePartials, laneMinima, laneMaxima);
+					}
+				}
+
+				for (size_t lane = 0; lane < ERROR_LANES; ++lane)
+				{
+					uint32_t channel = (uint32_t)(lane % image.channelCount);
+					sums.sums[channel] += laneSums[lane];
+					sums.partials[channel] += lanePartials[lane];
+					sums.minima[channel] = std::min(sums.minima[channel], (uint32_t)laneMinima[lane]);
+					sums.maxima[channel] = std::max(sums.maxima[channel], (uint32_t)laneMaxima[lane]);
+				}
+
+				return;
+			}
+
+			for (uint32_t row = 0; row < rowCount; ++row)
+			{
+				const unsigned char* data = first + (uint64_t)row * image.rowPitch;
+
+				for (size_t i = 0; i < rowBytes; i += 2)
+				{
+					uint32_t channel = (uint32_t)(i / 2 % image.channelCount);
+					uint32_t value = read_channel(data + i, 2);
+					sums.sums[channel] += value;
+					sums.partials[channel] += value != 0 && value != 0xffff;
+					sums.minima[channel] = std::min(sums.minima[channel], value);
+					sums.maxima[channel] = std::max(sums.maxima[channel], value);
+				}
+			}
+		}
+
+		// A block is constant when each of its rows repeats its first pixel, found by comparing the row with itself one
+		// pixel along, and every row matches the first
+		inline void find_constant_blocks(const StatsTask& task, const StatsOptions& options, StatsSums& sums, unsigned char* mask)
+		{
+			const ImageView& image = *task.image;
+			size_t pixelBytes = (size_t)image.channelCount * image.bytesPerChannel;
+			uint32_t widthInBlocks = (image.width + options.blockWidth - 1) / options.blockWidth;
+			uint32_t heightInBlocks = (image.height + options.blockHeight - 1) / options.blockHeight;
+
+			for (uint32_t blockRow = task.rowBegin / options.blockHeight; blockRow * options.blockHeight < task.rowEnd; ++blockRow)
+			{
+				uint32_t rowBegin = blockRow * options.blockHeight;
+				uint32_t rowEnd = std::min(rowBegin + options.blockHeight, image.height);
+				const unsigned char* firstRow = image.data + ((uint64_t)task.slice * image.height + rowBegin) * image.rowPitch;
+
+				for (uint32_t block = 0; block < widthInBlocks; ++block)
+				{
+					uint32_t x = block * options.blockWidth;
+					size_t segmentBytes = std::min(options.blockWidth, image.width - x) * pixelBytes;
+					const unsigned char* segment = firstRow + x * pixelBytes;
+					bool constant = memcmp(segment, segment + pixelBytes, segmentBytes - pixelBytes) == 0;
+
+					for (uint32_t row = rowBegin + 1; row < rowEnd && constant; ++row)
+					{
+						constant = memcmp(segment, segment + (uint64_t)(row - rowBegin) * image.rowPitch, segmentBytes) == 0;
+					}
+
+					sums.constantBlocks += constant;
+
+					if (mask)
+					{
+						mask[((uint64_t)task.slice * heightInBlocks + blockRow) * widthInBlocks + block] = constant;
+					}
+				}
+			}
+		}
+
+		inline void add_stats_tasks(const ImageView& image, uint32_t index, const StatsOptions& options, std::vector<StatsTask>& tasks)
+		{
+			uint32_t bandRows = (STATS_BAND_ROWS + options.blockHeight - 1) / options.blockHeight * options.blockHeight;
+
+			for (uint32_t slice = 0; slice < image.depth; ++slice)
+			{
+				for (uint32_t row = 0; row < image.height; row += bandRows)
+				{
+					StatsTask task = { &image, index, slice, row, std::min(row + bandRows, image.height) };
+					tasks.push_back(task);
+				}
+			}
+		}
+
+		inline void finish_stats(const ImageView& image, const StatsSums& sums, int alphaChannel, const StatsOptions& options, ImageStats& stats)
+		{
+			double pixelCount = (double)image.width * image.height * image.depth;
+			uint32_t maxValue = image.bytesPerChannel == 1 ? 255 : 65535;
+
+			stats.channelCount = image.channelCount;
+			memset(stats.channels, 0, sizeof(stats.channels));
+
+			for (uint32_t channel = 0; channel < image.channelCount; ++channel)
+			{
+				ChannelStats& channelStats = stats.channels[channel];
+				channelStats.minimum = sums.minima[channel];
+				channelStats.maximum = sums.maxima[channel];
+				channelStats.mean = (double)sums.sums[channel] / pixelCount;
+				channelStats.constant = channelStats.minimum == channelStats.maximum;
+			}
+
+			stats.alpha = AlphaNone;
+
+			if (alphaChannel >= 0 && (uint32_t)alphaChannel < image.channelCount)
+			{
+				const ChannelStats& alpha = stats.channels[alphaChannel];
+				stats.alpha = alpha.minimum == maxValue ? AlphaOpaque : (sums.partials[alphaChannel] == 0 ? AlphaBinary : AlphaFull);
+			}
+
+			stats.blockCount = (uint64_t)((image.width + options.blockWidth - 1) / options.blockWidth) * ((image.height + options.blockHeight - 1) / options.blockHeight) * image.depth;
+			stats.constantBlockCount = sums.constantBlocks;
+		}
+
+		inline void run_stats_tasks(const std::vector<StatsTask>& tasks, const StatsOptions& options, std::vector<ImageStats>& stats, std::vector<StatsSums>& imageSums)
+		{
+			std::vector<StatsSums> taskSums(tasks.size());
+			memset(taskSums.data(), 0, taskSums.size() * sizeof(StatsSums));
+
+			parallel_for((uint32_t)tasks.size(), options.threadCount, [&](uint32_t index)
+			{
+				const StatsTask& task = tasks[index];
+				accumulate_channel_stats(task, taskSums[index]);
+				find_constant_blocks(task, options, taskSums[index], options.blockMask ? stats[task.index].constantBlocks.data() : nullptr);
+			});
+
+			memset(imageSums.data(), 0, imageSums.size() * sizeof(StatsSums));
+
+			for (StatsSums& sums : imageSums)
+			{
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					sums.minima[channel] = 0xffffffffu;
+				}
+			}
+
+			for (size_t i = 0; i < tasks.size(); ++i)
+			{
+				StatsSums& sums = imageSums[tasks[i].index];
+
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					sums.sums[channel] += taskSums[i].sums[channel];
+					sums.partials[channel] += taskSums[i].partials[channel];
+					sums.minima[channel] = std::min(sums.minima[channel], taskSums[i].minima[channel]);
+					sums.maxima[channel] = std::max(sums.maxima[channel], taskSums[i].maxima[channel]);
+				}
+
+				sums.constantBlocks += taskSums[i].constantBlocks;
+			}
+		}
+
+		inline void prepare_block_mask(const ImageView& image, const StatsOptions& options, ImageStats& stats)
+		{
+			size_t blockCount = (size_t)((image.width + options.blockWidth - 1) / options.blockWidth) * ((image.height + options.blockHeight - 1) / options.blockHeight) * image.depth;
+			stats.constantBlocks.assign(options.blockMask ? blockCount : 0, 0);
+		}
+	}
+
+	// Which channel of the formats get_image_view accepts holds alpha, -1 if none
+	inline int get_alpha_channel(const Descriptor& desc)
+	{
+		switch (desc.glFormat)
+		{
+			case GL_ALPHA: case GL_ALPHA_INTEGER:
+				return 0;
+			case GL_LUMINANCE_ALPHA: case GL_LUMINANCE_ALPHA_INTEGER:
+				return 1;
+			case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER:
+				return 3;
+			default:
+				return -1;
+		}
+	}
+
+	// alphaChannel is the channel to report alpha usage for, or -1
+	inline StatsResult analyze_image(const ImageView& image, int alphaChannel, const StatsOptions& options, ImageStats& stats)
+	{
+		if (!internal::is_valid_image_view(image) || options.blockWidth == 0 || options.blockHeight == 0)
+		{
+			return StatsUnsupportedFormat;
+		}
+
+		std::vector<internal::StatsTask> tasks;
+		std::vector<internal::StatsSums> sums(1);
+		std::vector<ImageStats> results(1);
+		internal::prepare_block_mask(image, options, results[0]);
+		internal::add_stats_tasks(image, 0, options, tasks);
+		internal::run_stats_tasks(tasks, options, results, sums);
+		internal::finish_stats(image, sums[0], alphaChannel, options, results[0]);
+		stats = std::move(results[0]);
+
+		return StatsSuccess;
+	}
+
+	// Analyzes every subresource of a KTX file. On success stats holds one entry per subresource in layout order
+	inline StatsResult analyze_texture(const unsigned char* file, uint64_t size, const StatsOptions& options, std::vector<ImageStats>& stats)
+	{
+		Descriptor desc;
+
+		if (validate_header(file, size, desc) != ValidationSuccess)
+		{
+			return StatsInvalidTexture;
+		}
+
+		if (options.blockWidth == 0 || options.blockHeight == 0)
+		{
+			return StatsUnsupportedFormat;
+		}
+
+		HeaderKTX header;
+		memcpy(&header, file, sizeof(HeaderKTX));
+
+		uint32_t subresourceCount = get_subresource_count(desc);
+		std::vector<Subresource> layout(subresourceCount);
+		compute_subresource_layout(desc, get_image_data_offset(header), layout.data());
+
+		std::vector<ImageView> views(subresourceCount);
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			if (!get_image_view(desc, file, layout[i], views[i]))
+			{
+				return StatsUnsupportedFormat;
+			}
+		}
+
+		std::vector<internal::StatsTask> tasks;
+		std::vector<internal::StatsSums> sums(subresourceCount);
+		stats.resize(subresourceCount);
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			internal::prepare_block_mask(views[i], options, stats[i]);
+			internal::add_stats_tasks(views[i], i, options, tasks);
+		}
+
+		internal::run_stats_tasks(tasks, options, stats, sums);
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			internal::finish_stats(views[i], sums[i], get_alpha_channel(desc), options, stats[i]);
+		}
+
+		return StatsSuccess;
+	}
+}
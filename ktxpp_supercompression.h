@@ -0,0 +1,224 @@
+#pragma once
+
+#include "ktxpp.h"
+
+// Supercompression is optional and each codec is only compiled when its library is available.
+// Define ktxpp_zstd, ktxpp_lz4 and/or ktxpp_zlib before including this file and link against the library
+#if defined(ktxpp_zstd)
+#include <zstd.h>
+#endif
+
+#if defined(ktxpp_lz4)
+#include <lz4.h>
+#endif
+
+#if defined(ktxpp_zlib)
+#include <climits>
+#include <zlib.h>
+#endif
+
+namespace ktxpp
+{
+	// Values match the supercompressionScheme field of KTX2. LZ4 is not part of the KTX2 spec and lives in the
+	// vendor range, so it is only meaningful to ktxpp
+	enum SupercompressionScheme
+	{
+		SupercompressionNone   = 0,
+		SupercompressionBasisLZ = 1,
+		SupercompressionZstd   = 2,
+		SupercompressionZLIB   = 3,
+		SupercompressionLZ4    = 0x10000,
+	};
+
+	// Mirrors an entry of the KTX2 level index. Offsets are relative to the start of the compressed data
+	struct SupercompressedRange
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	inline bool is_supercompression_supported(SupercompressionScheme scheme)
+	{
+		switch (scheme)
+		{
+			case SupercompressionNone: return true;
+#if defined(ktxpp_zstd)
+			case SupercompressionZstd: return true;
+#endif
+#if defined(ktxpp_lz4)
+			case SupercompressionLZ4:  return true;
+#endif
+#if defined(ktxpp_zlib)
+			case SupercompressionZLIB: return true;
+#endif
+			default: return false;
+		}
+	}
+
+	// Worst case size of the compressed data, use it to size the destination of supercompress
+	inline uint64_t get_supercompression_bound(SupercompressionScheme scheme, uint64_t size)
+	{
+		switch (scheme)
+		{
+#if defined(ktxpp_zstd)
+			case SupercompressionZstd: return ZSTD_compressBound((size_t)size);
+#endif
+#if defined(ktxpp_lz4)
+			case SupercompressionLZ4:  return size <= LZ4_MAX_INPUT_SIZE ? (uint64_t)LZ4_compressBound((int)size) : 0;
+#endif
+#if defined(ktxpp_zlib)
+			case SupercompressionZLIB: return size <= ULONG_MAX ? (uint64_t)compressBound((uLong)size) : 0;
+#endif
+			default: return size;
+		}
+	}
+
+	// Compresses a block of memory. The level is codec specific (zstd 1-22, zlib 1-9, LZ4 acceleration where
+	// higher is faster) and 0 picks the codec default. Returns the compressed size, or 0 if the scheme is unavailable or compression failed
+	inline uint64_t supercompress(SupercompressionScheme scheme, int level, const unsigned char* source, uint64_t sourceSize, unsigned char* destination, uint64_t destinationCapacity)
+	{
+		ktxpp_stage(StageConvert, "supercompress");
+		ktxpp_stage_work(sourceSize, 0);
+
+		switch (scheme)
+		{
+			case SupercompressionNone:
+			{
+				if (destinationCapacity < sourceSize) return 0;
+				memcpy(destination, source, (size_t)sourceSize);
+				return sourceSize;
+			}
+#if defined(ktxpp_zstd)
+			case SupercompressionZstd:
+			{
+				size_t result = ZSTD_compress(destination, (size_t)destinationCapacity, source, (size_t)sourceSize, level);
+				return ZSTD_isError(result) ? 0 : result;
+			}
+#endif
+#if defined(ktxpp_lz4)
+			case SupercompressionLZ4:
+			{
+				// LZ4 sizes are ints. A larger source can't be compressed in one block, extra capacity is never needed
+				if (sourceSize > LZ4_MAX_INPUT_SIZE) return 0;
+				int capacity = destinationCapacity > 0x7fffffff ? 0x7fffffff : (int)destinationCapacity;
+				int result = LZ4_compress_fast((const char*)source, (char*)destination, (int)sourceSize, capacity, level > 0 ? level : 1);
+				return result > 0 ? (uint64_t)result : 0;
+			}
+#endif
+#if defined(ktxpp_zlib)
+			case SupercompressionZLIB:
+			{
+				// zlib sizes are unsigned longs, only 32 bits on Windows. As with LZ4, extra capacity is never needed
+				if (sourceSize > ULONG_MAX) return 0;
+				uLongf destinationSize = destinationCapacity > ULONG_MAX ? ULONG_MAX : (uLongf)destinationCapacity;
+				int result = compress2(destination, &destinationSize, source, (uLong)sourceSize, level != 0 ? level : Z_DEFAULT_COMPRESSION);
+				return result == Z_OK ? destinationSize : 0;
+			}
+#endif
+			default:
+				return 0;
+		}
+	}
+
+	// Decompresses a block of memory whose uncompressed size is known up front, as it always is in a level index.
+	// Returns false if the data is corrupt, the size does not match or the scheme is unavailable
+	inline bool decompress(SupercompressionScheme scheme, const unsigned char* source, uint64_t sourceSize, unsigned char* destination, uint64_t destinationSize)
+	{
+		ktxpp_stage(StageDecode, "decompress");
+		ktxpp_stage_work(destinationSize, 0);
+
+		switch (scheme)
+		{
+			case SupercompressionNone:
+			{
+				if (sourceSize != destinationSize) return false;
+				memcpy(destination, source, (size_t)sourceSize);
+				return true;
+			}
+#if defined(ktxpp_zstd)
+			case SupercompressionZstd:
+			{
+				size_t result = ZSTD_decompress(destination, (size_t)destinationSize, source, (size_t)sourceSize);
+				return !ZSTD_isError(result) && result == destinationSize;
+			}
+#endif
+#if defined(ktxpp_lz4)
+			case SupercompressionLZ4:
+			{
+				if (sourceSize > 0x7fffffff || destinationSize > LZ4_MAX_INPUT_SIZE) return false;
+				int result = LZ4_decompress_safe((const char*)source, (char*)destination, (int)sourceSize, (int)destinationSize);
+				return result >= 0 && (uint64_t)result == destinationSize;
+			}
+#endif
+#if defined(ktxpp_zlib)
+			case SupercompressionZLIB:
+			{
+				if (sourceSize > ULONG_MAX || destinationSize > ULONG_MAX) return false;
+				uLongf size = (uLongf)destinationSize;
+				int result = uncompress(destination, &size, source, (uLong)sourceSize);
+				return result == Z_OK && size == destinationSize;
+			}
+#endif
+			default:
+				return false;
+		}
+	}
+
+	// Compresses the image of one subresource from a KTX file in memory. Every subresource is independent, so
+	// they can be compressed concurrently into separate buffers. Returns the compressed size or 0 on failure
+	inline uint64_t supercompress_subresource(SupercompressionScheme scheme, int level, const Subresource& subresource, const unsigned char* file, unsigned char* destination, uint64_t destinationCapacity)
+	{
+		return supercompress(scheme, level, file + subresource.offset, subresource.size, destination, destinationCapacity);
+	}
+
+	// Decompresses one subresource straight into its place in a KTX file laid out with compute_subresource_layout.
+	// Ranges never overlap so any number of subresources can be decompressed in parallel, or only the ones needed
+	inline bool decompress_subresource(SupercompressionScheme scheme, const SupercompressedRange& range, const unsigned char* compressedData, const Subresource& subresource, unsigned char* file)
+	{
+		if (range.uncompressedByteLength != subresource.size)
+		{
+			return false;
+		}
+
+		return decompress(scheme, compressedData + range.byteOffset, range.byteLength, file + subresource.offset, subresource.size);
+	}
+
+	// Upper bound of the size of all compressed subresources stored back to back
+	inline uint64_t get_supercompression_bound(SupercompressionScheme scheme, const Descriptor& desc, const Subresource* subresources)
+	{
+		uint64_t bound = 0;
+
+		for (uint32_t i = 0; i < get_subresource_count(desc); ++i)
+		{
+			bound += get_supercompression_bound(scheme, subresources[i].size);
+		}
+
+		return bound;
+	}
+
+	// Compresses every subresource independently and stores them back to back, filling one range per subresource
+	// in the same order as the subresource table. Returns the total compressed size or 0 on failure
+	inline uint64_t supercompress_texture(SupercompressionScheme scheme, int level, const Descriptor& desc, const Subresource* subresources, const unsigned char* file, SupercompressedRange* ranges, unsigned char* destination, uint64_t destinationCapacity)
+	{
+		uint64_t offset = 0;
+
+		for (uint32_t i = 0; i < get_subresource_count(desc); ++i)
+		{
+			uint64_t compressedSize = supercompress_subresource(scheme, level, subresources[i], file, destination + offset, destinationCapacity - offset);
+
+			if (compressedSize == 0 && subresources[i].size != 0)
+			{
+				return 0;
+			}
+
+			ranges[i].byteOffset = offset;
+			ranges[i].byteLength = compressedSize;
+			ranges[i].uncompressedByteLength = subresources[i].size;
+
+			offset += compressedSize;
+		}
+
+		return offset;
+	}
+}
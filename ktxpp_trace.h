@@ -0,0 +1,185 @@
+#pragma once
+
+// Trace recording on top of the instrumentation hooks in ktxpp.h. Start a recorder, load some textures, stop it and
+// write the JSON out in the Chrome trace event format, which chrome://tracing and ui.perfetto.dev both open. Nothing is
+// recorded unless ktxpp_instrument is defined.
+//
+// Each stage becomes a complete event on the thread that ran it. Reads overlap each other on the thread that reaps
+// them, so they are written as async events instead, which the viewers put on tracks of their own
+
+#include "ktxpp.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ktxpp
+{
+	namespace internal
+	{
+		struct TraceEvent
+		{
+			StageEvent event;
+			uint32_t thread; // Index into TraceRecorder::threads
+		};
+	}
+
+	struct TraceRecorder
+	{
+		TraceHooks hooks;
+		uint64_t origin; // get_instrument_time when recording started, time zero in the trace
+		size_t maxEvents;
+
+		std::mutex mutex;
+		std::vector<internal::TraceEvent> events; // Guarded by mutex, as are the two below
+		std::vector<std::thread::id> threads;
+		uint64_t droppedEvents; // Past maxEvents
+	};
+
+	namespace internal
+	{
+		inline const char* get_stage_category(Stage stage)
+		{
+			switch (stage)
+			{
+				case StageIO:      return "io";
+				case StageParse:   return "parse";
+				case StageLayout:  return "layout";
+				case StageDecode:  return "decode";
+				case StageConvert: return "convert";
+				default:           return "unknown";
+			}
+		}
+
+		inline void record_trace_event(void* userData, const StageEvent& event)
+		{
+			TraceRecorder& recorder = *static_cast<TraceRecorder*>(userData);
+			std::thread::id id = std::this_thread::get_id();
+			std::lock_guard<std::mutex> lock(recorder.mutex);
+
+			if (recorder.events.size() >= recorder.maxEvents)
+			{
+				recorder.droppedEvents++;
+				return;
+			}
+
+			// Only a handful of threads ever touch ktxpp, a linear search beats hashing thread ids
+			uint32_t thread = 0;
+
+			while (thread < recorder.threads.size() && recorder.threads[thread] != id)
+			{
+				thread++;
+			}
+
+			if (thread == recorder.threads.size())
+			{
+				recorder.threads.push_back(id);
+			}
+
+			TraceEvent traceEvent = { event, thread };
+			recorder.events.push_back(traceEvent);
+		}
+
+		// Trace timestamps are in microseconds, written with nanosecond precision
+		inline void append_trace_time(std::string& json, uint64_t nanoseconds)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%llu.%03u", (unsigned long long)(nanoseconds / 1000), (unsigned)(nanoseconds % 1000));
+			json += text;
+		}
+	}
+
+	// Installs the recorder's hooks, replacing any others. Only one recorder can be active at a time
+	inline void start_trace(TraceRecorder& recorder, size_t maxEvents = 1 << 20)
+	{
+		{
+			std::lock_guard<std::mutex> lock(recorder.mutex);
+			recorder.events.clear();
+			recorder.threads.clear();
+			recorder.droppedEvents = 0;
+		}
+
+		recorder.hooks.userData = &recorder;
+		recorder.hooks.stage = internal::record_trace_event;
+		recorder.origin = get_instrument_time();
+		recorder.maxEvents = maxEvents;
+		set_trace_hooks(&recorder.hooks);
+	}
+
+	// Stages already running on other threads may still report afterwards, so keep the recorder alive until they are
+	// known to have finished
+	inline void stop_trace(TraceRecorder& recorder)
+	{
+		(void)recorder;
+		set_trace_hooks(nullptr);
+	}
+
+	inline void write_chrome_trace(TraceRecorder& recorder, std::string& json)
+	{
+		std::lock_guard<std::mutex> lock(recorder.mutex);
+		char text[256];
+
+		json = "{\"traceEvents\":[\n";
+
+		for (uint32_t thread = 0; thread < recorder.threads.size(); ++thread)
+		{
+			snprintf(text, sizeof(text), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"ktxpp %u\"}},\n", thread + 1, thread + 1);
+			json += text;
+		}
+
+		for (size_t i = 0; i < recorder.events.size(); ++i)
+		{
+			const internal::TraceEvent& traceEvent = recorder.events[i];
+			const StageEvent& event = traceEvent.event;
+			uint64_t start = event.start > recorder.origin ? event.start - recorder.origin : 0;
+			const char* category = internal::get_stage_category(event.stage);
+
+			if (event.stage == StageIO)
+			{
+				snprintf(text, sizeof(text), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":", event.name, category, (unsigned long long)i, traceEvent.thread + 1);
+				json += text;
+				internal::append_trace_time(json, start);
+				snprintf(text, sizeof(text), ",\"args\":{\"bytes\":%llu}},\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":", (unsigned long long)event.bytes, event.name, category, (unsigned long long)i, traceEvent.thread + 1);
+				json += text;
+				internal::append_trace_time(json, start + event.nanoseconds);
+				json += "},\n";
+				continue;
+			}
+
+			snprintf(text, sizeof(text), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":", event.name, category, traceEvent.thread + 1);
+			json += text;
+			internal::append_trace_time(json, start);
+			json += ",\"dur\":";
+			internal::append_trace_time(json, event.nanoseconds);
+			snprintf(text, sizeof(text), ",\"args\":{\"bytes\":%llu,\"texels\":%llu}},\n", (unsigned long long)event.bytes, (unsigned long long)event.texels);
+			json += text;
+		}
+
+		// JSON has no trailing commas
+		if (json.size() >= 2 && json[json.size() - 2] == ',')
+		{
+			json.erase(json.size() - 2, 1);
+		}
+
+		snprintf(text, sizeof(text), "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":%llu}}\n", (unsigned long long)recorder.droppedEvents);
+		json += text;
+	}
+
+	inline bool write_chrome_trace(TraceRecorder& recorder, const char* path)
+	{
+		std::string json;
+		write_chrome_trace(recorder, json);
+
+		FILE* fh = fopen(path, "wb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		bool success = fwrite(json.data(), 1, json.size(), fh) == json.size();
+		return fclose(fh) == 0 && success;
+	}
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+// Staging buffer layout for uploading a texture to the GPU. plan_upload places every subresource in one buffer,
+// respecting the device's offset and row pitch alignment, and describes each with a copy region that fills in a
+// VkBufferImageCopy or a D3D12_PLACED_SUBRESOURCE_FOOTPRINT field for field. fill_staging_buffer then copies the
+// image data from the file into a mapped buffer, repitching rows as needed, on as many threads as asked for.
+//
+// Nothing here calls a graphics API, the plan only depends on the descriptor, the subresource layout and the
+// alignments, so it can be computed ahead of time or on a loader thread
+
+#include "ktxpp_convert.h"
+
+#include <vector>
+
+namespace ktxpp
+{
+	enum UploadResult
+	{
+		UploadSuccess,
+		UploadInvalidAlignment, // Alignments must be nonzero powers of two
+		UploadUnsupportedFormat, // Blocks that aren't a whole number of bytes, or an unknown format
+		UploadUnsupportedTexture, // Arrays of 3D textures, or rows too long for a 32-bit pitch
+	};
+
+	// Vulkan takes these from VkPhysicalDeviceLimits::optimalBufferCopyOffsetAlignment and
+	// optimalBufferCopyRowPitchAlignment, D3D12 from get_d3d12_upload_alignment. Offsets are also kept a multiple of
+	// the block size and of 4, and row pitches a multiple of the block size, as Vulkan requires
+	struct UploadAlignment
+	{
+		uint32_t offsetAlignment = 16;
+		uint32_t rowPitchAlignment = 1;
+	};
+
+	// One copy into one subresource. width, height and depth are the mip size in texels, the rest covers whole blocks
+	struct UploadRegion
+	{
+		uint64_t bufferOffset; // VkBufferImageCopy::bufferOffset, D3D12_PLACED_SUBRESOURCE_FOOTPRINT::Offset
+		uint64_t size; // Bytes from bufferOffset to the end of the last row
+		uint32_t rowPitch; // In bytes. D3D12_SUBRESOURCE_FOOTPRINT::RowPitch
+		uint32_t bufferRowLength; // rowPitch in texels. VkBufferImageCopy::bufferRowLength
+		uint32_t bufferImageHeight; // Height in whole blocks, in texels. VkBufferImageCopy::bufferImageHeight and D3D12 Height
+		uint32_t footprintWidth; // Width in whole blocks, in texels. D3D12_SUBRESOURCE_FOOTPRINT::Width
+		uint32_t width; // VkBufferImageCopy::imageExtent
+		uint32_t height;
+		uint32_t depth; // Also D3D12_SUBRESOURCE_FOOTPRINT::Depth
+		uint32_t mip; // VkImageSubresourceLayers::mipLevel
+		uint32_t arrayLayer; // layer * faces + face. VkImageSubresourceLayers::baseArrayLayer
+		uint32_t d3d12Subresource; // mip + arrayLayer * mips. D3D12_TEXTURE_COPY_LOCATION::SubresourceIndex
+		uint32_t subresource; // The subresource the data comes from
+	};
+
+	struct UploadPlan
+	{
+		std::vector<UploadRegion> regions; // In subresource order: mips, then array layers, then faces
+		uint64_t size; // Of the staging buffer, in bytes
+		uint32_t bytesPerBlock;
+		uint32_t blockWidth;
+		uint32_t blockHeight;
+	};
+
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	inline UploadAlignment get_d3d12_upload_alignment()
+	{
+		UploadAlignment alignment;
+		alignment.offsetAlignment = 512;
+		alignment.rowPitchAlignment = 256;
+		return alignment;
+	}
+
+	namespace internal
+	{
+		// Block sizes of 3, 6 and 12 bytes make the combined alignments something other than a power of two
+		inline uint64_t least_common_multiple(uint64_t a, uint64_t b)
+		{
+			uint64_t x = a, y = b;
+
+			while (y != 0)
+			{
+				uint64_t remainder = x % y;
+				x = y;
+				y = remainder;
+			}
+
+			return a / x * b;
+		}
+
+		inline bool is_power_of_two(uint32_t value)
+		{
+			return value != 0 && (value & (value - 1)) == 0;
+		}
+
+		// Block rows per copy task, so large mips are spread over threads too
+		static ktxpp_constexpr uint32_t UPLOAD_BAND_ROWS = 256;
+
+		struct UploadTask
+		{
+			uint32_t region;
+			uint32_t firstRow; // Block rows, counting through every depth slice
+			uint32_t rowCount;
+		};
+	}
+
+	// Lays out a staging buffer for the subresources computed by compute_subresource_layout or
+	// compute_subresource_layout_ktx2. Regions are packed in subresource order with only the padding the alignments need
+	inline UploadResult plan_upload(const Descriptor& desc, const Subresource* subresources, const UploadAlignment& alignment, UploadPlan& plan)
+	{
+		ktxpp_stage(StageLayout, "plan_upload");
+
+		if (!internal::is_power_of_two(alignment.offsetAlignment) || !internal::is_power_of_two(alignment.rowPitchAlignment))
+		{
+			return UploadInvalidAlignment;
+		}
+
+		if (desc.bitsPerPixelOrBlock == 0 || desc.bitsPerPixelOrBlock % 8 != 0 || desc.blockWidth == 0 || desc.blockHeight == 0)
+		{
+			return UploadUnsupportedFormat;
+		}
+
+		if (desc.type == Texture3D && desc.arraySize > 1)
+		{
+			return UploadUnsupportedTexture;
+		}
+
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+		uint64_t offsetAlignment = internal::least_common_multiple(internal::least_common_multiple(alignment.offsetAlignment, bytesPerBlock), 4);
+		uint64_t rowPitchAlignment = internal::least_common_multiple(alignment.rowPitchAlignment, bytesPerBlock);
+
+		uint32_t subresourceCount = get_subresource_count(desc);
+		uint32_t mipCount = get_mip_count(desc);
+		uint32_t faceCount = get_face_count(desc);
+		uint64_t offset = 0;
+
+		plan.regions.resize(subresourceCount);
+		plan.bytesPerBlock = bytesPerBlock;
+		plan.blockWidth = desc.blockWidth;
+		plan.blockHeight = desc.blockHeight;
+
+		for (uint32_t i = 0; i < subresourceCount; ++i)
+		{
+			const Subresource& subresource = subresources[i];
+			uint32_t widthInBlocks, heightInBlocks;
+			get_mip_size_in_blocks(desc, subresource.mip, widthInBlocks, heightInBlocks);
+
+			uint64_t rowPitch = ((uint64_t)widthInBlocks * bytesPerBlock + rowPitchAlignment - 1) / rowPitchAlignment * rowPitchAlignment;
+			uint64_t rowLength = rowPitch / bytesPerBlock * desc.blockWidth;
+
+			if (rowPitch > 0xffffffffu || rowLength > 0xffffffffu)
+			{
+				return UploadUnsupportedTexture;
+			}
+
+			offset = (offset + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+			UploadRegion& region = plan.regions[i];
+			region.bufferOffset = offset;
+			region.size = rowPitch * heightInBlocks * subresource.depth;
+			region.rowPitch = (uint32_t)rowPitch;
+			region.bufferRowLength = (uint32_t)rowLength;
+			region.bufferImageHeight = heightInBlocks * desc.blockHeight;
+			region.footprintWidth = widthInBlocks * desc.blockWidth;
+			region.width = subresource.width;
+			region.height = subresource.height;
+			region.depth = subresource.depth;
+			region.mip = subresource.mip;
+			region.arrayLayer = subresource.layer * faceCount + subresource.face;
+			region.d3d12Subresource = subresource.mip + region.arrayLayer * mipCount;
+			region.subresource = i;
+
+			offset += region.size;
+		}
+
+		plan.size = offset;
+		return UploadSuccess;
+	}
+
+	// Copies every region's image data from fileData, which must hold the uncompressed data at the subresource
+	// offsets, into staging, which must hold plan.size bytes. Supercompressed KTX2 levels have to be inflated first.
+	// Padding between rows and regions is left as it was. threadCount 0 uses every core
+	inline void fill_staging_buffer(const UploadPlan& plan, const Subresource* subresources, const unsigned char* fileData, unsigned char* staging, uint32_t threadCount = 1)
+	{
+		ktxpp_stage(StageConvert, "fill_staging_buffer");
+		ktxpp_stage_work(plan.size, 0);
+
+		std::vector<internal::UploadTask> tasks;
+
+		for (uint32_t i = 0; i < plan.regions.size(); ++i)
+		{
+			const UploadRegion& region = plan.regions[i];
+			uint32_t rowCount = region.bufferImageHeight / plan.blockHeight * region.depth;
+
+			for (uint32_t row = 0; row < rowCount; row += internal::UPLOAD_BAND_ROWS)
+			{
+				internal::UploadTask task = { i, row, std::min(internal::UPLOAD_BAND_ROWS, rowCount - row) };
+				tasks.push_back(task);
+			}
+		}
+
+		internal::parallel_for((uint32_t)tasks.size(), threadCount, [&](uint32_t index)
+		{
+			const internal::UploadTask& task = tasks[index];
+			const UploadRegion& region = plan.regions[task.region];
+			const Subresource& subresource = subresources[region.subresource];
+			uint32_t rowSize = region.footprintWidth / plan.blockWidth * plan.bytesPerBlock;
+
+			const unsigned char* source = fileData + subresource.offset + (uint64_t)task.firstRow * subresource.rowPitch;
+			unsigned char* destination = staging + region.bufferOffset + (uint64_t)task.firstRow * region.rowPitch;
+
+			if (subresource.rowPitch == region.rowPitch)
+			{
+				memcpy(destination, source, (size_t)region.rowPitch * (task.rowCount - 1) + rowSize);
+				return;
+			}
+
+			for (uint32_t row = 0; row < task.rowCount; ++row)
+			{
+				memcpy(destination + (uint64_t)row * region.rowPitch, source + (uint64_t)row * subresource.rowPitch, rowSize);
+			}
+		});
+	}
+}
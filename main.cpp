@@ -55,10 +55,17 @@ int main()
 	paths.push_back("test/test_ASTC_12x10.ktx");
 	paths.push_back("test/test_ASTC_12x12.ktx");
 
+	// File buffers only live for one iteration, so they all come from an arena that is reset per file
+	ktxpp::ArenaAllocator arena;
+	ktxpp::initialize_arena(arena, ktxpp::get_default_allocator(), 1024 * 1024);
+	ktxpp::Allocator allocator = ktxpp::get_arena_allocator(arena);
+
 	for (uint32_t i = 0; i < paths.size(); ++i)
 	{
 		const std::string& path = paths[i];
 
+		ktxpp::reset_arena(arena);
+
 		FILE* fh = fopen(path.c_str(), "rb");
 
 		if(fh)
@@ -68,7 +75,14 @@ int main()
 			size = ftell(fh);
 			rewind(fh);
 
-			unsigned char* test = new unsigned char[size];
+			unsigned char* test = static_cast<unsigned char*>(ktxpp::allocate(allocator, size));
+
+			// Null when the arena needs a new chunk and its parent allocator is out of memory
+			if (test == nullptr)
+			{
+				fclose(fh);
+				continue;
+			}
 
 			fread(test, sizeof(*test), size, fh);
 
@@ -81,4 +95,6 @@ int main()
 			fclose(fh);
 		}
 	}
+
+	ktxpp::release_arena(arena);
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+// Arena allocation over a counting parent and over a fixed slab: alignment, oversized requests, chunk reuse after a
+// reset, exhaustion, containers through StlAllocator and a whole conversion with arena scratch memory
+
+#include "../ktxpp_convert.h"
+#include "ktxpp_test_util.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+	// Default allocator that keeps count, so chunks can be seen being requested, reused and returned
+	struct CountingParent
+	{
+		uint32_t allocations = 0;
+		uint32_t outstanding = 0;
+		size_t largest = 0;
+	};
+
+	void* counting_allocate(void* userData, size_t size, size_t alignment)
+	{
+		CountingParent& parent = *static_cast<CountingParent*>(userData);
+		parent.allocations++;
+		parent.outstanding++;
+		parent.largest = size > parent.largest ? size : parent.largest;
+		return ktxpp::allocate(ktxpp::get_default_allocator(), size, alignment);
+	}
+
+	void counting_deallocate(void* userData, void* pointer, size_t size)
+	{
+		static_cast<CountingParent*>(userData)->outstanding--;
+		ktxpp::deallocate(ktxpp::get_default_allocator(), pointer, size);
+	}
+
+	ktxpp::Allocator get_counting_allocator(CountingParent& parent)
+	{
+		ktxpp::Allocator allocator = { counting_allocate, counting_deallocate, &parent };
+		return allocator;
+	}
+
+	bool is_aligned(const void* pointer, size_t alignment)
+	{
+		return ((uintptr_t)pointer & (alignment - 1)) == 0;
+	}
+
+	struct alignas(64) CacheLine
+	{
+		unsigned char data[64];
+	};
+
+	// Allocations of every alignment, each filled with its own byte. Overlapping ones would overwrite each other
+	void check_alignment(ktxpp::ArenaAllocator& arena)
+	{
+		const size_t alignments[] = { 1, 2, 4, 8, 16, 32, 64, 256, 4096 };
+		std::vector<unsigned char*> pointers;
+		std::vector<size_t> sizes;
+		bool aligned = true;
+
+		for (uint32_t pass = 0; pass < 4; ++pass)
+		{
+			for (size_t alignment : alignments)
+			{
+				size_t size = 1 + pointers.size() * 13;
+				unsigned char* pointer = static_cast<unsigned char*>(ktxpp::arena_allocate(arena, size, alignment));
+				aligned &= pointer != nullptr && is_aligned(pointer, alignment);
+
+				if (pointer != nullptr)
+				{
+					memset(pointer, (int)pointers.size(), size);
+					pointers.push_back(pointer);
+					sizes.push_back(size);
+				}
+			}
+		}
+
+		check(aligned, "arena returned a misaligned or null pointer");
+
+		bool intact = true;
+
+		for (size_t i = 0; i < pointers.size(); ++i)
+		{
+			intact &= std::count(pointers[i], pointers[i] + sizes[i], (unsigned char)i) == (std::ptrdiff_t)sizes[i];
+		}
+
+		check(intact, "arena allocations overlap");
+	}
+
+	std::vector<unsigned char> make_source()
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, 29, 11, 0, ktxpp::Texture2D, 5, 2, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			for (uint64_t i = 0; i < subresource.size; ++i)
+			{
+				file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 13 + subresource.mip * 7 + subresource.layer);
+			}
+		}
+
+		return file;
+	}
+}
+
+int main()
+{
+	CountingParent parent;
+	ktxpp::ArenaAllocator arena;
+	ktxpp::initialize_arena(arena, get_counting_allocator(parent), 4096);
+
+	// Nothing is requested up front
+	check(parent.allocations == 0, "arena allocated before it was used");
+
+	check_alignment(arena);
+	check(parent.allocations > 1, "arena never grew");
+
+	// Requests larger than a chunk get a chunk of their own, and the arena keeps going afterwards
+	void* large = ktxpp::arena_allocate(arena, 20000, 64);
+	check(large != nullptr && is_aligned(large, 64), "allocation larger than a chunk failed");
+	check(parent.largest >= 20000, "chunk of a large allocation is too small");
+	memset(large, 0xAB, 20000);
+	check(ktxpp::arena_allocate(arena, 100, 16) != nullptr, "allocation after a large one failed");
+
+	// The same allocations after a reset fit in the chunks already there, starting back at the first
+	uint32_t allocations = parent.allocations;
+	ktxpp::reset_arena(arena);
+	void* first = ktxpp::arena_allocate(arena, 1, 1);
+	check(first == (void*)(arena.first + 1), "reset didn't start over at the first chunk");
+
+	ktxpp::reset_arena(arena);
+	check_alignment(arena);
+	check(ktxpp::arena_allocate(arena, 20000, 64) != nullptr, "large allocation after a reset failed");
+	check(parent.allocations == allocations, "chunks weren't reused after a reset");
+
+	// Everything goes back to the parent, and the arena is ready to grow again
+	ktxpp::release_arena(arena);
+	check(parent.outstanding == 0, "release didn't return every chunk");
+	check(arena.first == nullptr && ktxpp::arena_allocate(arena, 64, 16) != nullptr, "arena is unusable after release");
+	ktxpp::release_arena(arena);
+
+	// A slab never grows: allocations fail once it's full, until it's reset
+	{
+		alignas(16) unsigned char slab[1024];
+		ktxpp::ArenaAllocator slabArena;
+		ktxpp::initialize_arena(slabArena, slab, sizeof(slab));
+
+		uint32_t count = 0;
+		void* pointer = nullptr;
+
+		while ((pointer = ktxpp::arena_allocate(slabArena, 100, 16)) != nullptr && count < 100)
+		{
+			check(pointer >= (void*)slab && (unsigned char*)pointer + 100 <= slab + sizeof(slab), "slab allocation outside the slab");
+			count++;
+		}
+
+		check(pointer == nullptr && count > 0 && count * 100 <= sizeof(slab), "slab didn't run out");
+		check(ktxpp::arena_allocate(slabArena, 2000, 16) == nullptr, "slab satisfied an allocation larger than itself");
+
+		ktxpp::reset_arena(slabArena);
+		check(ktxpp::arena_allocate(slabArena, 100, 16) != nullptr, "slab is still full after a reset");
+
+		ktxpp::release_arena(slabArena);
+		check(ktxpp::arena_allocate(slabArena, 100, 16) != nullptr, "slab is unusable after release");
+
+		// Too small to even hold its header
+		ktxpp::ArenaAllocator tinyArena;
+		ktxpp::initialize_arena(tinyArena, slab, sizeof(ktxpp::ArenaAllocator::Chunk) - 1);
+		check(ktxpp::arena_allocate(tinyArena, 1, 1) == nullptr, "slab smaller than its header allocated");
+
+		// Containers on a full slab see bad_alloc rather than null
+		ktxpp::initialize_arena(slabArena, slab, sizeof(slab));
+		ktxpp::StlAllocator<unsigned char> slabAllocator(ktxpp::get_arena_allocator(slabArena));
+		bool thrown = false;
+
+		try
+		{
+			std::vector<unsigned char, ktxpp::StlAllocator<unsigned char> > buffer(4096, 0, slabAllocator);
+		}
+		catch (const std::bad_alloc&)
+		{
+			thrown = true;
+		}
+
+		check(thrown, "StlAllocator didn't throw on an exhausted slab");
+	}
+
+	// Containers grow inside the arena with the alignment of their type
+	ktxpp::initialize_arena(arena, get_counting_allocator(parent), 4096);
+	{
+		ktxpp::StlAllocator<uint64_t> allocator(ktxpp::get_arena_allocator(arena));
+		std::vector<uint64_t, ktxpp::StlAllocator<uint64_t> > values(allocator);
+
+		for (uint64_t i = 0; i < 10000; ++i)
+		{
+			values.push_back(i * i);
+		}
+
+		bool kept = true;
+
+		for (uint64_t i = 0; i < values.size(); ++i)
+		{
+			kept &= values[i] == i * i;
+		}
+
+		check(kept, "vector in the arena lost values while growing");
+
+		std::vector<CacheLine, ktxpp::StlAllocator<CacheLine> > lines(7, CacheLine(), ktxpp::StlAllocator<CacheLine>(allocator));
+		check(is_aligned(lines.data(), 64), "StlAllocator ignored the alignment of its type");
+		check(ktxpp::StlAllocator<CacheLine>(allocator) == allocator, "rebound StlAllocator compares unequal");
+	}
+	ktxpp::release_arena(arena);
+
+	// A whole conversion with arena scratch memory matches one with the default allocator, and runs from the chunks
+	// of the first one once the arena is reset
+	std::vector<unsigned char> source = make_source();
+	std::vector<unsigned char> expected;
+	ktxpp::ConvertOptions options;
+	check(ktxpp::convert_ktx1_to_ktx2(source.data(), source.size(), options, expected) == ktxpp::ConvertSuccess, "conversion failed");
+
+	ktxpp::initialize_arena(arena, get_counting_allocator(parent), 1024);
+	options.allocator = ktxpp::get_arena_allocator(arena);
+
+	for (uint32_t pass = 0; pass < 3; ++pass)
+	{
+		uint32_t before = parent.allocations;
+		ktxpp::reset_arena(arena);
+
+		std::vector<unsigned char> converted;
+		check(ktxpp::convert_ktx1_to_ktx2(source.data(), source.size(), options, converted) == ktxpp::ConvertSuccess, "conversion with an arena failed");
+		check(converted == expected, "conversion with an arena differs");
+		check(pass == 0 ? parent.allocations > before : parent.allocations == before, "conversion didn't reuse the arena's chunks");
+	}
+
+	ktxpp::release_arena(arena);
+	check(parent.outstanding == 0, "chunks leaked");
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+// Loads every file given on the command line through the async loader, with io_uring when available and with the
+// thread pool, reading the key/value data and all mips, and compares the result with a plain blocking read
+
+#include "../ktxpp_async.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	struct Load
+	{
+		ktxpp::AsyncLoader* loader;
+		std::string path;
+		ktxpp::AsyncTexture* texture;
+		uint32_t mipsRemaining;
+		bool keyValuesRead;
+		bool failed;
+	};
+
+	void on_read(void* userData, ktxpp::AsyncTexture& texture, uint32_t mip, ktxpp::AsyncStatus status)
+	{
+		Load& load = *static_cast<Load*>(userData);
+
+		if (status != ktxpp::AsyncSuccess)
+		{
+			// Formats ktxpp can't lay out yet are expected to be rejected at the header
+			bool unsupported = mip == ktxpp::AsyncHeader && status == ktxpp::AsyncInvalidFile && texture.validation == ktxpp::ValidationUnsupportedFormat;
+			load.failed = !unsupported;
+			load.mipsRemaining = 0;
+			return;
+		}
+
+		if (mip == ktxpp::AsyncHeader)
+		{
+			load.mipsRemaining = ktxpp::get_mip_count(texture.desc);
+
+			// Smallest first so something can be shown as early as possible
+			for (uint32_t i = load.mipsRemaining; i-- > 0;)
+			{
+				ktxpp::async_read_mip(*load.loader, texture, i, on_read, &load);
+			}
+
+			ktxpp::async_read_key_value_data(*load.loader, texture, on_read, &load);
+		}
+		else if (mip == ktxpp::AsyncKeyValueData)
+		{
+			load.keyValuesRead = true;
+		}
+		else
+		{
+			load.mipsRemaining--;
+		}
+	}
+
+	// Allocates while the budget in userData lasts
+	void* allocate_limited(void* userData, size_t size, size_t alignment)
+	{
+		uint32_t& remaining = *static_cast<uint32_t*>(userData);
+
+		if (remaining == 0)
+		{
+			return nullptr;
+		}
+
+		remaining--;
+		return ktxpp::internal::default_allocate(nullptr, size, alignment);
+	}
+
+	void test_backend(bool allowIoUring, int argc, char** argv)
+	{
+		ktxpp::AsyncLoaderOptions options;
+		options.allowIoUring = allowIoUring;
+		options.queueDepth = 8;
+
+		ktxpp::AsyncLoader loader;
+		ktxpp::initialize_async_loader(loader, options);
+		printf("Backend %s\n", loader.backend == ktxpp::AsyncBackendIoUring ? "io_uring" : "thread pool");
+
+		std::vector<Load> loads(argc - 1);
+
+		// Open everything up front so header reads for all files are in flight together
+		for (int i = 1; i < argc; ++i)
+		{
+			Load& load = loads[i - 1];
+			load.loader = &loader;
+			load.path = argv[i];
+			load.mipsRemaining = 0;
+			load.keyValuesRead = false;
+			load.failed = false;
+			load.texture = ktxpp::async_open_texture(loader, argv[i], on_read, &load);
+		}
+
+		ktxpp::wait_async_loader(loader);
+
+		for (Load& load : loads)
+		{
+			ktxpp::AsyncTexture& texture = *load.texture;
+
+			if (load.failed || load.mipsRemaining != 0)
+			{
+				fprintf(stderr, "%s: async load failed (status %d, validation %d)\n", load.path.c_str(), texture.status, texture.validation);
+				failures++;
+			}
+			else if (texture.status == ktxpp::AsyncSuccess)
+			{
+				std::vector<unsigned char> file;
+				read_file(load.path.c_str(), file);
+				size_t compared = (size_t)(file.size() < texture.dataSize ? file.size() : texture.dataSize);
+
+				// Padding between faces and levels isn't read, so compare the headers, key/value data and images only
+				bool same = load.keyValuesRead && memcmp(file.data(), texture.data, (size_t)ktxpp::get_image_data_offset(texture.header)) == 0;
+
+				for (uint32_t i = 0; i < ktxpp::get_subresource_count(texture.desc) && same; ++i)
+				{
+					const ktxpp::Subresource& subresource = texture.subresources[i];
+					same = subresource.offset + subresource.size <= compared && memcmp(file.data() + subresource.offset, texture.data + subresource.offset, (size_t)subresource.size) == 0;
+				}
+
+				check(same, load.path, "async data differs from a blocking read");
+			}
+
+			ktxpp::async_close_texture(loader, load.texture);
+		}
+
+		// A missing file fails at open
+		Load missing = { &loader, "missing.ktx", nullptr, 0, false, false };
+		missing.texture = ktxpp::async_open_texture(loader, "missing.ktx", on_read, &missing);
+
+		check(missing.failed && missing.texture->status == ktxpp::AsyncOpenFailed, "missing file wasn't reported");
+
+		ktxpp::async_close_texture(loader, missing.texture);
+		ktxpp::release_async_loader(loader);
+
+		// Without memory for the header read the open fails right away, leaving nothing in flight
+		if (argc > 1)
+		{
+			uint32_t remaining = 1;
+			options.allocator.allocate = allocate_limited;
+			options.allocator.deallocate = ktxpp::internal::default_deallocate;
+			options.allocator.userData = &remaining;
+			ktxpp::initialize_async_loader(loader, options);
+
+			Load starved = { &loader, argv[1], nullptr, 0, false, false };
+			starved.texture = ktxpp::async_open_texture(loader, argv[1], on_read, &starved);
+
+			check(starved.failed && starved.texture->status == ktxpp::AsyncOutOfMemory && loader.inFlight == 0 && loader.pending.empty(), "header read without memory wasn't reported");
+
+			ktxpp::async_close_texture(loader, starved.texture);
+			ktxpp::release_async_loader(loader);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	test_backend(true, argc, argv);
+	test_backend(false, argc, argv);
+	return failures > 0 ? 1 : 0;
+}
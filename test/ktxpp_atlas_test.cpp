@@ -0,0 +1,216 @@
+// Builds atlases from synthetic textures in block compressed and uncompressed formats, then checks that placements
+// are aligned and disjoint, that every block of every mip was copied and that the rest of the atlas is cleared
+
+#include "../ktxpp_atlas.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	// Image data is numbered per texture so blocks copied from the wrong image or place show up
+	std::vector<unsigned char> make_texture(ktxpp::GLInternalFormat format, ktxpp::GLType type, ktxpp::GLFormat glFormat, uint32_t width, uint32_t height, uint32_t mipCount, ktxpp::TextureType textureType, uint32_t seed)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(format, type, glFormat, width, height, 0, textureType, mipCount, 0, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			for (uint64_t i = 0; i < subresource.size; ++i)
+			{
+				file[(size_t)(subresource.offset + i)] = (unsigned char)((i + seed * 131 + subresource.mip * 17) * 2654435761u >> 11);
+			}
+		}
+
+		return file;
+	}
+
+	void check_atlas(const char* context, const ktxpp::AtlasBuilder& builder, const std::vector<std::vector<unsigned char> >& files)
+	{
+		std::vector<unsigned char> atlas;
+		std::vector<ktxpp::AtlasPlacement> placements;
+
+		if (ktxpp::build_atlas(builder, atlas, placements) != ktxpp::AtlasSuccess)
+		{
+			check(false, context, "not built");
+			return;
+		}
+
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header(atlas.data(), atlas.size(), desc) != ktxpp::ValidationSuccess || ktxpp::get_mip_count(desc) != builder.mipCount ||
+			desc.glInternalFormat != builder.images[0].desc.glInternalFormat || desc.width > builder.maxWidth || desc.height > builder.maxHeight)
+		{
+			check(false, context, "atlas is not a valid texture");
+			return;
+		}
+
+		ktxpp::internal::HeaderKTX header;
+		memcpy(&header, atlas.data(), sizeof(header));
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), layout.data());
+
+		uint32_t alignmentX = desc.blockWidth << (builder.mipCount - 1), alignmentY = desc.blockHeight << (builder.mipCount - 1);
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+		bool aligned = true, disjoint = true, copied = true;
+
+		// Which image owns each block of each mip, to find the blocks that should be cleared
+		std::vector<std::vector<int> > owners(builder.mipCount);
+
+		for (uint32_t mip = 0; mip < builder.mipCount; ++mip)
+		{
+			uint32_t widthInBlocks, heightInBlocks;
+			ktxpp::get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+			owners[mip].assign((size_t)widthInBlocks * heightInBlocks, -1);
+		}
+
+		for (size_t i = 0; i < placements.size(); ++i)
+		{
+			const ktxpp::AtlasPlacement& placement = placements[i];
+			const ktxpp::Descriptor& source = builder.images[i].desc;
+			aligned &= placement.x % alignmentX == 0 && placement.y % alignmentY == 0 && placement.width == source.width && placement.height == source.height;
+			aligned &= placement.x + placement.width + builder.padding <= desc.width && placement.y + placement.height + builder.padding <= desc.height;
+
+			ktxpp::internal::HeaderKTX sourceHeader;
+			memcpy(&sourceHeader, files[i].data(), sizeof(sourceHeader));
+			std::vector<ktxpp::Subresource> sourceLayout(ktxpp::get_subresource_count(source));
+			ktxpp::compute_subresource_layout(source, ktxpp::get_image_data_offset(sourceHeader), sourceLayout.data());
+
+			for (uint32_t mip = 0; mip < builder.mipCount; ++mip)
+			{
+				uint32_t widthInBlocks, heightInBlocks, atlasWidthInBlocks, atlasHeightInBlocks;
+				ktxpp::get_mip_size_in_blocks(source, mip, widthInBlocks, heightInBlocks);
+				ktxpp::get_mip_size_in_blocks(desc, mip, atlasWidthInBlocks, atlasHeightInBlocks);
+				uint32_t x = (placement.x >> mip) / desc.blockWidth, y = (placement.y >> mip) / desc.blockHeight;
+
+				for (uint32_t row = 0; row < heightInBlocks; ++row)
+				{
+					for (uint32_t column = 0; column < widthInBlocks; ++column)
+					{
+						int& owner = owners[mip][(size_t)(y + row) * atlasWidthInBlocks + x + column];
+						disjoint &= owner == -1;
+						owner = (int)i;
+
+						const unsigned char* expected = files[i].data() + sourceLayout[mip].offset + (uint64_t)row * sourceLayout[mip].rowPitch + (uint64_t)column * bytesPerBlock;
+						const unsigned char* actual = atlas.data() + layout[mip].offset + (uint64_t)(y + row) * layout[mip].rowPitch + (uint64_t)(x + column) * bytesPerBlock;
+						copied &= memcmp(expected, actual, bytesPerBlock) == 0;
+					}
+				}
+			}
+		}
+
+		unsigned char clearBlock[64];
+		ktxpp::internal::get_atlas_clear_block(desc.glInternalFormat, clearBlock, bytesPerBlock);
+		bool cleared = true;
+
+		for (uint32_t mip = 0; mip < builder.mipCount; ++mip)
+		{
+			uint32_t widthInBlocks, heightInBlocks;
+			ktxpp::get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+
+			for (size_t block = 0; block < owners[mip].size(); ++block)
+			{
+				const unsigned char* actual = atlas.data() + layout[mip].offset + block / widthInBlocks * layout[mip].rowPitch + block % widthInBlocks * bytesPerBlock;
+				cleared &= owners[mip][block] != -1 || memcmp(actual, clearBlock, bytesPerBlock) == 0;
+			}
+		}
+
+		check(aligned, context, "placement not aligned or outside the atlas");
+		check(disjoint, context, "placements overlap");
+		check(copied, context, "blocks not copied");
+		check(cleared, context, "unused blocks not cleared");
+	}
+
+	// Sizes that aren't multiples of the block size, the smallest mips narrower than a block
+	void check_format(const char* context, ktxpp::GLInternalFormat format, ktxpp::GLType type, ktxpp::GLFormat glFormat, uint32_t mipCount, uint32_t padding)
+	{
+		const uint32_t sizes[][2] = { { 64, 64 }, { 13, 7 }, { 100, 30 }, { 30, 100 }, { 17, 17 }, { 8, 120 }, { 45, 9 }, { 64, 64 }, { 33, 31 }, { 5, 5 }, { 200, 12 } };
+		std::vector<std::vector<unsigned char> > files;
+		ktxpp::AtlasBuilder builder;
+		builder.mipCount = mipCount;
+		builder.padding = padding;
+
+		for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+		{
+			// Some with a mip more than the atlas needs, where the size allows
+			uint32_t fullChain = 1;
+			while ((std::max(sizes[i][0], sizes[i][1]) >> fullChain) > 0) { fullChain++; }
+			files.push_back(make_texture(format, type, glFormat, sizes[i][0], sizes[i][1], std::min(mipCount + i % 2, fullChain), ktxpp::Texture2D, i));
+		}
+
+		for (const std::vector<unsigned char>& file : files)
+		{
+			check(ktxpp::add_atlas_image(builder, file.data(), file.size()) == ktxpp::AtlasSuccess, context, "image not added");
+		}
+
+		check_atlas(context, builder, files);
+
+		builder.powerOfTwo = true;
+		check_atlas(context, builder, files);
+	}
+
+	// Equal squares pack without gaps, and the smallest atlas is square
+	void check_tight()
+	{
+		std::vector<std::vector<unsigned char> > files;
+		ktxpp::AtlasBuilder builder;
+
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			files.push_back(make_texture(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT5, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 16, 16, 1, ktxpp::Texture2D, i));
+			ktxpp::add_atlas_image(builder, files.back().data(), files.back().size());
+		}
+
+		std::vector<unsigned char> atlas;
+		std::vector<ktxpp::AtlasPlacement> placements;
+		ktxpp::Descriptor desc;
+		check(ktxpp::build_atlas(builder, atlas, placements) == ktxpp::AtlasSuccess && ktxpp::validate_header(atlas.data(), atlas.size(), desc) == ktxpp::ValidationSuccess, "tight", "not built");
+		check(desc.width == 128 && desc.height == 128, "tight", "squares not packed tightly");
+		check_atlas("tight", builder, files);
+
+		builder.maxWidth = 64;
+		builder.maxHeight = 240;
+		check(ktxpp::build_atlas(builder, atlas, placements) == ktxpp::AtlasTooLarge, "tight", "packed into too small an atlas");
+
+		builder.maxHeight = 256;
+		check(ktxpp::build_atlas(builder, atlas, placements) == ktxpp::AtlasSuccess && placements[63].x + placements[63].y > 0, "tight", "not packed into the exact size");
+	}
+
+	void check_errors()
+	{
+		ktxpp::AtlasBuilder builder;
+		std::vector<unsigned char> atlas;
+		std::vector<ktxpp::AtlasPlacement> placements;
+		check(ktxpp::build_atlas(builder, atlas, placements) == ktxpp::AtlasEmpty, "errors", "empty atlas built");
+
+		builder.mipCount = 2;
+		std::vector<unsigned char> bc1 = make_texture(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 32, 32, 2, ktxpp::Texture2D, 0);
+		std::vector<unsigned char> bc3 = make_texture(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT5, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 32, 32, 2, ktxpp::Texture2D, 0);
+		std::vector<unsigned char> oneMip = make_texture(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 32, 32, 1, ktxpp::Texture2D, 0);
+		std::vector<unsigned char> cubemap = make_texture(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 32, 32, 2, ktxpp::Cubemap, 0);
+		std::vector<unsigned char> pvrtc = make_texture(ktxpp::GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 32, 32, 2, ktxpp::Texture2D, 0);
+
+		check(ktxpp::add_atlas_image(builder, bc1.data(), 10) == ktxpp::AtlasInvalidImage, "errors", "truncated image added");
+		check(ktxpp::add_atlas_image(builder, bc1.data(), bc1.size()) == ktxpp::AtlasSuccess, "errors", "image not added");
+		check(ktxpp::add_atlas_image(builder, bc3.data(), bc3.size()) == ktxpp::AtlasMismatchedFormat, "errors", "mismatched format added");
+		check(ktxpp::add_atlas_image(builder, oneMip.data(), oneMip.size()) == ktxpp::AtlasUnsupportedImage, "errors", "image with too few mips added");
+		check(ktxpp::add_atlas_image(builder, cubemap.data(), cubemap.size()) == ktxpp::AtlasUnsupportedImage, "errors", "cubemap added");
+		check(ktxpp::add_atlas_image(builder, pvrtc.data(), pvrtc.size()) == ktxpp::AtlasUnsupportedImage, "errors", "PVRTC added");
+		check(builder.images.size() == 1, "errors", "rejected images kept");
+	}
+}
+
+int main()
+{
+	check_format("bc1", ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 1, 0);
+	check_format("bc3 mipmapped", ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT5, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 3, 0);
+	check_format("astc 6x6 mipmapped", ktxpp::GL_COMPRESSED_RGBA_ASTC_6x6, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 2, 0);
+	check_format("astc 10x5 padded", ktxpp::GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 1, 3);
+	check_format("rgb8 mipmapped", ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, 3, 2);
+	check_format("rgba8", ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 1, 0);
+	check_tight();
+	check_errors();
+
+	return failures > 0 ? 1 : 0;
+}
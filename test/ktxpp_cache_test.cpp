@@ -0,0 +1,155 @@
+// Exercises the encode cache in a scratch directory: round trips, misses, corrupt entries, least recently used
+// eviction and threads sharing one cache
+
+#include "../ktxpp_cache.h"
+#include "ktxpp_test_util.h"
+
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	std::vector<unsigned char> make_data(uint32_t seed, size_t size)
+	{
+		std::vector<unsigned char> data(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = (unsigned char)(((i + seed) * 2654435761u) >> 13);
+		}
+
+		return data;
+	}
+
+	ktxpp::Hash128 make_key(uint32_t seed)
+	{
+		const uint32_t settings[] = { seed, 0 };
+		std::vector<unsigned char> source = make_data(seed, 64);
+		return ktxpp::get_encode_cache_key(source.data(), source.size(), ktxpp::GL_COMPRESSED_RGB_S3TC_DXT1, settings, sizeof(settings));
+	}
+
+	// Modification times only have the file system's granularity
+	void wait_for_clock()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+}
+
+int main()
+{
+	const char* directory = "ktxpp_cache_test_entries";
+	const size_t entrySize = 1000 + sizeof(ktxpp::internal::CacheEntryHeader);
+
+	ktxpp::EncodeCache cache;
+
+	if (!ktxpp::open_encode_cache(cache, directory, 1 << 20))
+	{
+		fprintf(stderr, "could not create %s\n", directory);
+		return 1;
+	}
+
+	ktxpp::trim_encode_cache(cache, 0);
+
+	// Keys depend on every input
+	const uint32_t settings[] = { 1, 2 };
+	std::vector<unsigned char> source = make_data(0, 256);
+	ktxpp::Hash128 key = ktxpp::get_encode_cache_key(source.data(), source.size(), ktxpp::GL_RGBA8, settings, sizeof(settings));
+	check(key != ktxpp::get_encode_cache_key(source.data(), source.size() - 1, ktxpp::GL_RGBA8, settings, sizeof(settings)), "key ignores the source");
+	check(key != ktxpp::get_encode_cache_key(source.data(), source.size(), ktxpp::GL_RGB8, settings, sizeof(settings)), "key ignores the format");
+	check(key != ktxpp::get_encode_cache_key(source.data(), source.size(), ktxpp::GL_RGBA8, settings, sizeof(uint32_t)), "key ignores the settings");
+
+	// Round trip, and a miss for anything else
+	std::vector<unsigned char> loaded;
+	std::vector<unsigned char> value = make_data(1, 1000);
+	check(!ktxpp::load_encode_cache(cache, make_key(1), loaded), "hit in an empty cache");
+	check(ktxpp::store_encode_cache(cache, make_key(1), value.data(), value.size()), "store failed");
+	check(ktxpp::load_encode_cache(cache, make_key(1), loaded) && loaded == value, "stored entry not loaded back");
+	check(!ktxpp::load_encode_cache(cache, make_key(2), loaded), "hit for another key");
+	check(ktxpp::store_encode_cache(cache, make_key(1), value.data(), value.size()) && cache.size == entrySize, "replaced entry still counted");
+
+	// Entries survive the cache being reopened, and a corrupt one is a miss that gets removed
+	ktxpp::EncodeCache reopened;
+	check(ktxpp::open_encode_cache(reopened, directory, 1 << 20) && reopened.size == entrySize, "reopened cache has the wrong size");
+	check(ktxpp::load_encode_cache(reopened, make_key(1), loaded) && loaded == value, "entry lost when reopening");
+
+	std::string path = std::string(directory) + "/" + ktxpp::internal::get_cache_entry_name(make_key(1));
+	FILE* fh = fopen(path.c_str(), "r+b");
+
+	if (fh)
+	{
+		fseek(fh, (long)entrySize - 1, SEEK_SET);
+		fputc(value.back() ^ 1, fh);
+		fclose(fh);
+	}
+
+	check(!ktxpp::load_encode_cache(cache, make_key(1), loaded), "corrupt entry loaded");
+	fh = fopen(path.c_str(), "rb");
+	check(fh == nullptr, "corrupt entry kept");
+
+	if (fh)
+	{
+		fclose(fh);
+	}
+
+	// With room for four entries, the ones loaded recently survive a trim
+	ktxpp::trim_encode_cache(cache, 0);
+	cache.maxSize = 4 * entrySize;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		std::vector<unsigned char> data = make_data(i, 1000);
+		ktxpp::store_encode_cache(cache, make_key(i), data.data(), data.size());
+		wait_for_clock();
+	}
+
+	check(ktxpp::load_encode_cache(cache, make_key(0), loaded), "entry evicted before the cache was full");
+	wait_for_clock();
+
+	std::vector<unsigned char> data = make_data(4, 1000);
+	ktxpp::store_encode_cache(cache, make_key(4), data.data(), data.size());
+
+	check(cache.size <= cache.maxSize, "cache larger than its limit");
+	check(ktxpp::load_encode_cache(cache, make_key(0), loaded), "recently used entry evicted");
+	check(ktxpp::load_encode_cache(cache, make_key(4), loaded), "newest entry evicted");
+	check(!ktxpp::load_encode_cache(cache, make_key(1), loaded), "least recently used entry kept");
+
+	// Threads racing on the same keys only ever see complete entries
+	ktxpp::trim_encode_cache(cache, 0);
+	cache.maxSize = 1 << 20;
+	std::atomic<uint32_t> mismatches(0);
+	std::vector<std::thread> threads;
+
+	for (uint32_t t = 0; t < 4; ++t)
+	{
+		threads.push_back(std::thread([&cache, &mismatches, t]()
+		{
+			std::vector<unsigned char> result;
+
+			for (uint32_t i = 0; i < 200; ++i)
+			{
+				uint32_t seed = (i + t) % 8;
+				std::vector<unsigned char> expected = make_data(seed, 1000 + seed * 100);
+
+				if (ktxpp::load_encode_cache(cache, make_key(seed), result))
+				{
+					mismatches += result != expected;
+				}
+				else
+				{
+					ktxpp::store_encode_cache(cache, make_key(seed), expected.data(), expected.size());
+				}
+			}
+		}));
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	check(mismatches == 0, "a thread loaded another entry's data");
+	check(cache.hits > 0, "threads never hit the cache");
+
+	ktxpp::trim_encode_cache(cache, 0);
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// Loads every file given on the command line from concurrent coroutines, first resumed inline by the loader and
+// then through a queue standing in for a job system executor
+
+#include "../ktxpp_coroutine.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	int completed = 0;
+
+	// Minimal fire and forget coroutine type, as an engine's own task type would be
+	struct DetachedTask
+	{
+		struct promise_type
+		{
+			DetachedTask get_return_object() { return DetachedTask(); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	DetachedTask load_texture(ktxpp::CoroutineLoader& loader, const char* path)
+	{
+		ktxpp::AsyncTexture* texture = co_await ktxpp::load_async(loader, path);
+
+		if (texture->status == ktxpp::AsyncSuccess)
+		{
+			// Smallest level first, then the key/value data
+			for (uint32_t mip = ktxpp::get_mip_count(texture->desc); mip-- > 0;)
+			{
+				if (co_await loader.load_mip(*texture, mip) != ktxpp::AsyncSuccess)
+				{
+					fprintf(stderr, "%s: mip %u failed\n", path, mip);
+					failures++;
+				}
+			}
+
+			if (co_await loader.load_key_value_data(*texture) != ktxpp::AsyncSuccess)
+			{
+				fprintf(stderr, "%s: key/value data failed\n", path);
+				failures++;
+			}
+		}
+		else if (texture->validation != ktxpp::ValidationUnsupportedFormat)
+		{
+			fprintf(stderr, "%s: open failed with status %d\n", path, texture->status);
+			failures++;
+		}
+
+		loader.close(texture);
+		completed++;
+	}
+
+	void* allocate_nothing(void*, size_t, size_t)
+	{
+		return nullptr;
+	}
+
+	DetachedTask load_without_memory(ktxpp::CoroutineLoader& loader, const char* path)
+	{
+		ktxpp::AsyncTexture* texture = co_await ktxpp::load_async(loader, path);
+
+		if (texture != nullptr)
+		{
+			fprintf(stderr, "%s: opened without memory\n", path);
+			failures++;
+		}
+
+		loader.close(texture);
+		completed++;
+	}
+
+	struct QueueExecutor
+	{
+		std::vector<std::coroutine_handle<> > queue;
+
+		static void schedule(void* userData, std::coroutine_handle<> handle)
+		{
+			static_cast<QueueExecutor*>(userData)->queue.push_back(handle);
+		}
+	};
+}
+
+int main(int argc, char** argv)
+{
+	{
+		ktxpp::CoroutineLoader loader;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			load_texture(loader, argv[i]);
+		}
+
+		loader.run();
+	}
+
+	{
+		QueueExecutor executor;
+		ktxpp::CoroutineLoader loader(ktxpp::AsyncLoaderOptions(), ktxpp::CoroutineExecutor{ QueueExecutor::schedule, &executor });
+
+		for (int i = 1; i < argc; ++i)
+		{
+			load_texture(loader, argv[i]);
+		}
+
+		// The job system loop: pump I/O, then run whatever became ready
+		while (loader.get_outstanding() > 0 || !executor.queue.empty())
+		{
+			loader.process(executor.queue.empty());
+
+			std::vector<std::coroutine_handle<> > jobs;
+			jobs.swap(executor.queue);
+
+			for (std::coroutine_handle<> job : jobs)
+			{
+				job.resume();
+			}
+		}
+	}
+
+	// A texture that can't even be allocated still resumes its coroutine
+	{
+		ktxpp::AsyncLoaderOptions options;
+		options.allocator.allocate = allocate_nothing;
+		ktxpp::CoroutineLoader loader(options);
+
+		for (int i = 1; i < argc; ++i)
+		{
+			load_without_memory(loader, argv[i]);
+		}
+
+		loader.run();
+	}
+
+	if (completed != 3 * (argc - 1))
+	{
+		fprintf(stderr, "%d of %d loads completed\n", completed, 3 * (argc - 1));
+		failures++;
+	}
+
+	return failures > 0 ? 1 : 0;
+}
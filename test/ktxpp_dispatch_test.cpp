@@ -0,0 +1,577 @@
+// Compares every SIMD level this machine supports against the scalar kernels, in place and out of place, for all
+// lengths around the vector widths. When KTXPP_SIMD names a supported level, also checks that get_kernels() honours it.
+// The fixed point 4:2:2 conversion and the sRGB encoding are also checked against floating point, and the unpacked
+// formats get their traits checked on synthetic textures
+
+#include "../ktxpp_dispatch.h"
+#include "ktxpp_test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	typedef void (*KernelFunction)(const unsigned char*, unsigned char*, size_t);
+
+	void compare(const char* name, ktxpp::SimdLevel level, KernelFunction reference, KernelFunction kernel, size_t elementBytes)
+	{
+		for (size_t count = 0; count < 300; ++count)
+		{
+			// Offset by one byte so unaligned loads and stores are exercised too
+			std::vector<unsigned char> source(count * elementBytes + 1);
+
+			for (size_t i = 0; i < source.size(); ++i)
+			{
+				source[i] = (unsigned char)(i * 37 + count);
+			}
+
+			std::vector<unsigned char> expected(source.size()), result(source.size()), inPlace(source);
+			reference(source.data() + 1, expected.data() + 1, count);
+			kernel(source.data() + 1, result.data() + 1, count);
+			kernel(inPlace.data() + 1, inPlace.data() + 1, count);
+
+			if (memcmp(expected.data() + 1, result.data() + 1, count * elementBytes) != 0 ||
+				memcmp(expected.data() + 1, inPlace.data() + 1, count * elementBytes) != 0)
+			{
+				fprintf(stderr, "%s (%s) differs from scalar for %zu elements\n", name, ktxpp::get_simd_level_name(level), count);
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// For kernels that expand their input, so never in place. Sources hold sourceBits per pixel
+	void compare_expand(const char* name, ktxpp::SimdLevel level, KernelFunction reference, KernelFunction kernel, size_t sourceBits)
+	{
+		for (size_t count = 0; count < 300; ++count)
+		{
+			std::vector<unsigned char> source((count * sourceBits + 31) / 32 * 4 + 1);
+
+			for (size_t i = 0; i < source.size(); ++i)
+			{
+				source[i] = (unsigned char)(i * 37 + count);
+			}
+
+			std::vector<unsigned char> expected(count * 4 + 1), result(expected.size());
+			reference(source.data() + 1, expected.data() + 1, count);
+			kernel(source.data() + 1, result.data() + 1, count);
+
+			if (memcmp(expected.data() + 1, result.data() + 1, count * 4) != 0)
+			{
+				fprintf(stderr, "%s (%s) differs from scalar for %zu pixels\n", name, ktxpp::get_simd_level_name(level), count);
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// Short lengths around the vector widths, then one long enough that the 32-bit lane sums are flushed midway
+	void compare_squared_error(ktxpp::SimdLevel level, const ktxpp::Kernels& scalar, const ktxpp::Kernels& kernels)
+	{
+		std::vector<size_t> counts;
+
+		for (size_t count = 0; count < 300; ++count)
+		{
+			counts.push_back(count);
+		}
+
+		counts.push_back(ktxpp::internal::ERROR_RUN * 96 * 2 + 37);
+
+		for (size_t count : counts)
+		{
+			std::vector<unsigned char> a(count + 1), b(count + 1);
+
+			for (size_t i = 0; i < a.size(); ++i)
+			{
+				a[i] = (unsigned char)(i * 37 + count);
+				b[i] = (unsigned char)((i * 37 + count) ^ (i * 11 % 256));
+			}
+
+			// Both start part way through the lanes so accumulating on top of earlier sums is covered too
+			uint64_t expectedSums[48], sums[48];
+			unsigned char expectedMaxima[48], maxima[48];
+
+			for (size_t lane = 0; lane < 48; ++lane)
+			{
+				expectedSums[lane] = sums[lane] = lane;
+				expectedMaxima[lane] = maxima[lane] = (unsigned char)lane;
+			}
+
+			scalar.squared_error8(a.data() + 1, b.data() + 1, count, expectedSums, expectedMaxima);
+			kernels.squared_error8(a.data() + 1, b.data() + 1, count, sums, maxima);
+
+			if (memcmp(expectedSums, sums, sizeof(sums)) != 0 || memcmp(expectedMaxima, maxima, sizeof(maxima)) != 0)
+			{
+				fprintf(stderr, "squared_error8 (%s) differs from scalar for %zu bytes\n", ktxpp::get_simd_level_name(level), count);
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// Widths around the vector widths over a few row counts, rows padded so the pitch matters, and the most rows the
+	// sums hold on bytes of 255
+	void compare_ssim_sums(ktxpp::SimdLevel level, const ktxpp::Kernels& scalar, const ktxpp::Kernels& kernels)
+	{
+		const uint32_t rowCounts[] = { 1, 4, 9 };
+
+		for (size_t count = 0; count < 100; ++count)
+		{
+			for (uint32_t rowCount : rowCounts)
+			{
+				size_t pitch = count + 3;
+				std::vector<unsigned char> a(pitch * rowCount + 1), b(a.size());
+
+				for (size_t i = 0; i < a.size(); ++i)
+				{
+					a[i] = (unsigned char)(i * 37 + count);
+					b[i] = (unsigned char)((i * 37 + count) ^ (i * 11 % 256));
+				}
+
+				std::vector<uint32_t> expected(5 * count), sums(5 * count, 1);
+				scalar.ssim_sums8(a.data() + 1, pitch, b.data() + 1, pitch, count, rowCount, expected.data());
+				kernels.ssim_sums8(a.data() + 1, pitch, b.data() + 1, pitch, count, rowCount, sums.data());
+
+				if (sums != expected)
+				{
+					fprintf(stderr, "ssim_sums8 (%s) differs from scalar for %zu bytes and %u rows\n", ktxpp::get_simd_level_name(level), count, rowCount);
+					failures++;
+					return;
+				}
+			}
+		}
+
+		std::vector<unsigned char> full(64, 255);
+		std::vector<uint32_t> sums(5 * 64);
+		kernels.ssim_sums8(full.data(), 0, full.data(), 0, 64, 65536, sums.data());
+
+		if (sums[0] != 65536u * 255 || sums[4 * 64 + 63] != 65536u * 255 * 255)
+		{
+			fprintf(stderr, "ssim_sums8 (%s) overflows\n", ktxpp::get_simd_level_name(level));
+			failures++;
+		}
+	}
+
+	// Same lengths as squared_error8, on bytes with runs of 0 and 255 so every count is exercised
+	void compare_channel_stats(ktxpp::SimdLevel level, const ktxpp::Kernels& scalar, const ktxpp::Kernels& kernels)
+	{
+		std::vector<size_t> counts;
+
+		for (size_t count = 0; count < 300; ++count)
+		{
+			counts.push_back(count);
+		}
+
+		counts.push_back(ktxpp::internal::STATS_RUN * 96 * 3 + 37);
+
+		for (size_t count : counts)
+		{
+			std::vector<unsigned char> source(count + 1);
+
+			for (size_t i = 0; i < source.size(); ++i)
+			{
+				source[i] = i % 7 == 0 ? 0 : (i % 5 == 0 ? 255 : (unsigned char)(i * 37 + count));
+			}
+
+			uint64_t expectedSums[48], sums[48], expectedPartials[48], partials[48];
+			unsigned char expectedMinima[48], minima[48], expectedMaxima[48], maxima[48];
+
+			for (size_t lane = 0; lane < 48; ++lane)
+			{
+				expectedSums[lane] = sums[lane] = expectedPartials[lane] = partials[lane] = lane;
+				expectedMinima[lane] = minima[lane] = (unsigned char)(200 + lane);
+				expectedMaxima[lane] = maxima[lane] = (unsigned char)lane;
+			}
+
+			scalar.channel_stats8(source.data() + 1, count, expectedSums, expectedPartials, expectedMinima, expectedMaxima);
+			kernels.channel_stats8(source.data() + 1, count, sums, partials, minima, maxima);
+
+			if (memcmp(expectedSums, sums, sizeof(sums)) != 0 || memcmp(expectedPartials, partials, sizeof(partials)) != 0 ||
+				memcmp(expectedMinima, minima, sizeof(minima)) != 0 || memcmp(expectedMaxima, maxima, sizeof(maxima)) != 0)
+			{
+				fprintf(stderr, "channel_stats8 (%s) differs from scalar for %zu bytes\n", ktxpp::get_simd_level_name(level), count);
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// Floats spread over every octave the encoding table covers, plus the values either side of its ends
+	std::vector<float> make_linear_floats(size_t count)
+	{
+		const float specials[] = { 0.0f, -0.0f, -1.0f, 1.0f, 2.0f, 1e-30f, 1.0f / 8192.0f, 0.99999994f, NAN, -NAN, INFINITY, -INFINITY };
+		std::vector<float> values(specials, specials + sizeof(specials) / sizeof(specials[0]));
+
+		for (size_t i = values.size(); i < count; ++i)
+		{
+			uint32_t bits = 0x39000000u + (uint32_t)((i * 2654435761u) % (0x3f800000u - 0x39000000u));
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			values.push_back(value);
+		}
+
+		return values;
+	}
+
+	void compare_srgb(ktxpp::SimdLevel level, const ktxpp::Kernels& scalar, const ktxpp::Kernels& kernels)
+	{
+		std::vector<float> linear = make_linear_floats(301 * 4);
+
+		for (size_t count = 0; count < 300; ++count)
+		{
+			// Offset by one element so unaligned loads and stores are exercised too
+			std::vector<unsigned char> bytes(count * 4 + 1), expectedBytes(bytes.size()), resultBytes(bytes.size());
+			std::vector<float> expected(bytes.size()), result(bytes.size());
+
+			for (size_t i = 0; i < bytes.size(); ++i)
+			{
+				bytes[i] = (unsigned char)(i * 37 + count);
+			}
+
+			scalar.srgb8_to_linear(bytes.data() + 1, expected.data() + 1, count);
+			kernels.srgb8_to_linear(bytes.data() + 1, result.data() + 1, count);
+			scalar.linear_to_srgb8(linear.data() + 1, expectedBytes.data() + 1, count);
+			kernels.linear_to_srgb8(linear.data() + 1, resultBytes.data() + 1, count);
+
+			if (memcmp(expected.data() + 1, result.data() + 1, count * 4 * sizeof(float)) != 0 || expectedBytes != resultBytes)
+			{
+				fprintf(stderr, "sRGB kernels (%s) differ from scalar for %zu pixels\n", ktxpp::get_simd_level_name(level), count);
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// Encoding against the exact curve, decoding then encoding every byte, and the clamping of values out of range
+	void check_srgb_accuracy()
+	{
+		std::vector<float> linear = make_linear_floats(1 << 20);
+		std::vector<unsigned char> encoded(linear.size());
+		ktxpp::internal::linear_to_srgb8_scalar(linear.data(), encoded.data(), linear.size() / 4);
+		int maxError = 0;
+
+		for (size_t i = 0; i < linear.size(); ++i)
+		{
+			double value = std::isnan(linear[i]) ? 0.0 : (linear[i] < 0.0f ? 0.0 : (linear[i] > 1.0f ? 1.0 : linear[i]));
+			double srgb = (i & 3) == 3 ? value : (value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055);
+			int error = std::abs((int)std::lround(srgb * 255.0) - encoded[i]);
+			maxError = error > maxError ? error : maxError;
+		}
+
+		unsigned char bytes[1024], roundTrip[1024];
+		float decoded[1024];
+
+		for (int i = 0; i < 1024; ++i)
+		{
+			bytes[i] = (unsigned char)(i / 4);
+		}
+
+		ktxpp::internal::srgb8_to_linear_scalar(bytes, decoded, 256);
+		ktxpp::internal::linear_to_srgb8_scalar(decoded, roundTrip, 256);
+
+		if (maxError > 1 || memcmp(bytes, roundTrip, sizeof(bytes)) != 0 || decoded[0] != 0.0f || decoded[1023] != 1.0f ||
+			std::fabs(decoded[128 * 4] - 0.2158605f) > 1e-6f || decoded[128 * 4 + 3] != 128.0f / 255.0f)
+		{
+			fprintf(stderr, "sRGB kernels are off by %d or don't round trip\n", maxError);
+			failures++;
+		}
+	}
+
+	// Decoding a texture and encoding it again gives back the same bytes, padding included, and every layout decodes
+	// its red, blue and alpha to the right channels. Rows are wider than one run of the reordering layouts
+	void check_srgb_texture(const char* context, ktxpp::GLInternalFormat format, ktxpp::GLFormat glFormat, uint32_t pixelBytes, bool bgr)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(format, ktxpp::GL_UNSIGNED_BYTE, glFormat, 300, 3, 0, ktxpp::Texture2D, 1, 0, desc, layout);
+		const ktxpp::Subresource& subresource = layout[0];
+
+		for (uint64_t i = 0; i < subresource.size; ++i)
+		{
+			file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 37);
+		}
+
+		std::vector<float> linear(300 * 3 * 4);
+		std::vector<unsigned char> encoded = file;
+		memset(encoded.data() + subresource.offset, 0, (size_t)subresource.size);
+
+		check(ktxpp::convert_srgb_to_linear(desc, file.data(), subresource, linear.data()) && ktxpp::convert_linear_to_srgb(desc, linear.data(), subresource, encoded.data()) && encoded == file,
+			context, "doesn't round trip");
+
+		// The last pixel of the second row
+		const float* table = ktxpp::internal::get_srgb8_to_linear_table();
+		const unsigned char* pixel = file.data() + subresource.offset + subresource.rowPitch + 299 * pixelBytes;
+		const float* decoded = linear.data() + (300 + 299) * 4;
+		check(decoded[0] == table[pixel[bgr ? 2 : 0]] && decoded[1] == table[pixel[1]] && decoded[2] == table[pixel[bgr ? 0 : 2]] && decoded[3] == (pixelBytes == 4 ? table[pixel[3] + 256] : 1.0f),
+			context, "channels decoded out of order");
+
+		desc.glInternalFormat = ktxpp::GL_RGBA8;
+		check(!ktxpp::convert_srgb_to_linear(desc, file.data(), subresource, linear.data()) && !ktxpp::convert_linear_to_srgb(desc, linear.data(), subresource, encoded.data()), context, "accepted as GL_RGBA8");
+	}
+
+	const ktxpp::YuvLayout yuvLayouts[] = { ktxpp::YuvUYVY, ktxpp::YuvYUY2 };
+	const ktxpp::YuvMatrix yuvMatrices[] = { ktxpp::YuvBT601, ktxpp::YuvBT709 };
+	const ktxpp::YuvRange yuvRanges[] = { ktxpp::YuvLimitedRange, ktxpp::YuvFullRange };
+
+	void compare_yuv(ktxpp::SimdLevel level, const ktxpp::Kernels& scalar, const ktxpp::Kernels& kernels)
+	{
+		for (ktxpp::YuvLayout layout : yuvLayouts)
+		for (ktxpp::YuvMatrix matrix : yuvMatrices)
+		for (ktxpp::YuvRange range : yuvRanges)
+		{
+			ktxpp::YuvConversion conversion = ktxpp::get_yuv_conversion(layout, matrix, range);
+
+			for (size_t count = 0; count < 300; ++count)
+			{
+				std::vector<unsigned char> source((count + 1) / 2 * 4 + 1);
+
+				for (size_t i = 0; i < source.size(); ++i)
+				{
+					source[i] = (unsigned char)(i * 37 + count);
+				}
+
+				std::vector<unsigned char> expected(count * 4 + 1), result(expected.size());
+				scalar.yuv422_to_rgba8(source.data() + 1, expected.data() + 1, count, conversion);
+				kernels.yuv422_to_rgba8(source.data() + 1, result.data() + 1, count, conversion);
+
+				if (memcmp(expected.data() + 1, result.data() + 1, count * 4) != 0)
+				{
+					fprintf(stderr, "yuv422_to_rgba8 (%s) differs from scalar for %zu pixels\n", ktxpp::get_simd_level_name(level), count);
+					failures++;
+					return;
+				}
+			}
+		}
+	}
+
+	// The scalar kernel against the same conversion in floating point, over a grid of Y, Cb and Cr
+	void check_yuv_accuracy()
+	{
+		for (ktxpp::YuvMatrix matrix : yuvMatrices)
+		for (ktxpp::YuvRange range : yuvRanges)
+		{
+			double kr = matrix == ktxpp::YuvBT709 ? 0.2126 : 0.299;
+			double kb = matrix == ktxpp::YuvBT709 ? 0.0722 : 0.114;
+			double kg = 1.0 - kr - kb;
+			double lumaBias = range == ktxpp::YuvLimitedRange ? 16.0 : 0.0;
+			double lumaScale = range == ktxpp::YuvLimitedRange ? 255.0 / 219.0 : 1.0;
+			double chromaScale = range == ktxpp::YuvLimitedRange ? 255.0 / 224.0 : 1.0;
+
+			ktxpp::YuvConversion conversion = ktxpp::get_yuv_conversion(ktxpp::YuvYUY2, matrix, range);
+			int maxError = 0;
+
+			for (int y = 0; y < 256; y += 3)
+			for (int cb = 0; cb < 256; cb += 3)
+			for (int cr = 0; cr < 256; cr += 3)
+			{
+				unsigned char pair[4] = { (unsigned char)y, (unsigned char)cb, (unsigned char)y, (unsigned char)cr };
+				unsigned char rgba[8];
+				ktxpp::internal::yuv422_to_rgba8_scalar(pair, rgba, 2, conversion);
+
+				double luma = (y - lumaBias) * lumaScale;
+				double u = (cb - 128) * chromaScale, v = (cr - 128) * chromaScale;
+				double reference[3] = { luma + 2.0 * (1.0 - kr) * v, luma - 2.0 * (1.0 - kb) * kb / kg * u - 2.0 * (1.0 - kr) * kr / kg * v, luma + 2.0 * (1.0 - kb) * u };
+
+				for (int c = 0; c < 3; ++c)
+				{
+					int expected = (int)std::lround(reference[c] < 0.0 ? 0.0 : (reference[c] > 255.0 ? 255.0 : reference[c]));
+					int error = std::abs(expected - rgba[c]);
+					maxError = error > maxError ? error : maxError;
+				}
+
+				if (rgba[3] != 255 || memcmp(rgba, rgba + 4, 4) != 0)
+				{
+					maxError = 256;
+				}
+			}
+
+			if (maxError > 1)
+			{
+				fprintf(stderr, "yuv422_to_rgba8 is off by %d for %s %s range\n", maxError, matrix == ktxpp::YuvBT709 ? "BT.709" : "BT.601", range == ktxpp::YuvLimitedRange ? "limited" : "full");
+				failures++;
+			}
+		}
+	}
+
+	// An odd width 4:2:2 texture gets 2x1 blocks, and converts row by row to what the kernel gives per row
+	void check_yuv_texture()
+	{
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(ktxpp::GL_RGB_RAW_422_APPLE, ktxpp::GL_UNSIGNED_SHORT_8_8_REV_APPLE, ktxpp::GL_RGB_422_APPLE, ktxpp::GL_RGB_422_APPLE, 33, 3, 0, ktxpp::Texture2D, 1, 0, header);
+
+		ktxpp::Descriptor desc;
+		ktxpp::Subresource subresource;
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, &subresource));
+		ktxpp::write_texture_layout(header, desc, &subresource, file.data());
+
+		for (uint64_t i = 0; i < subresource.size; ++i)
+		{
+			file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 37);
+		}
+
+		ktxpp::Descriptor validated;
+
+		if (ktxpp::validate_header(file.data(), file.size(), validated) != ktxpp::ValidationSuccess || validated.blockWidth != 2 || validated.blockHeight != 1 ||
+			validated.bitsPerPixelOrBlock != 32 || validated.vkFormat != ktxpp::VK_FORMAT_B8G8R8G8_422_UNORM || ktxpp::get_yuv_layout(validated) != ktxpp::YuvUYVY ||
+			subresource.rowPitch != 17 * 4 || subresource.size != 17 * 4 * 3)
+		{
+			fprintf(stderr, "GL_RGB_RAW_422_APPLE has the wrong traits\n");
+			failures++;
+			return;
+		}
+
+		ktxpp::YuvConversion conversion = ktxpp::get_yuv_conversion(ktxpp::YuvUYVY, ktxpp::YuvBT709, ktxpp::YuvLimitedRange);
+		std::vector<unsigned char> image(33 * 3 * 4), expected(image.size());
+		ktxpp::convert_yuv422_to_rgba8(file.data(), subresource, image.data(), conversion);
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			ktxpp::internal::yuv422_to_rgba8_scalar(file.data() + subresource.offset + row * subresource.rowPitch, expected.data() + row * 33 * 4, 33, conversion);
+		}
+
+		if (image != expected)
+		{
+			fprintf(stderr, "convert_yuv422_to_rgba8 differs from the kernel\n");
+			failures++;
+		}
+	}
+
+	// Legacy formats are stored like block compressed ones, with unpadded rows of blocks
+	void check_legacy_texture(ktxpp::GLInternalFormat format, const char* name, KernelFunction reference, uint32_t blockWidth, uint32_t bits)
+	{
+		const uint32_t width = 13, height = 3;
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(format, (ktxpp::GLType)0, (ktxpp::GLFormat)0, (ktxpp::GLFormat)0, width, height, 0, ktxpp::Texture2D, 1, 0, header);
+
+		ktxpp::Descriptor desc;
+		ktxpp::Subresource subresource;
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, &subresource));
+		ktxpp::write_texture_layout(header, desc, &subresource, file.data());
+
+		for (uint64_t i = 0; i < subresource.size; ++i)
+		{
+			file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 37);
+		}
+
+		uint32_t rowPitch = (width + blockWidth - 1) / blockWidth * bits / 8;
+		ktxpp::Descriptor validated;
+
+		if (ktxpp::validate_header(file.data(), file.size(), validated) != ktxpp::ValidationSuccess || !validated.compressed || validated.blockWidth != blockWidth ||
+			validated.blockHeight != 1 || validated.bitsPerPixelOrBlock != bits || subresource.rowPitch != rowPitch || subresource.size != rowPitch * height)
+		{
+			fprintf(stderr, "%s has the wrong traits\n", name);
+			failures++;
+			return;
+		}
+
+		std::vector<unsigned char> image(width * height * 4), expected(image.size());
+
+		for (uint32_t row = 0; row < height; ++row)
+		{
+			reference(file.data() + subresource.offset + row * rowPitch, expected.data() + row * width * 4, width);
+		}
+
+		if (!ktxpp::unpack_to_rgba8(validated, file.data(), subresource, image.data()) || image != expected)
+		{
+			fprintf(stderr, "unpack_to_rgba8 differs from the kernel for %s\n", name);
+			failures++;
+		}
+
+		// Compressed files can't be 3D, but the same rows read as slices one row high must come out the same
+		ktxpp::Subresource slices = subresource;
+		slices.height = 1;
+		slices.depth = height;
+		std::fill(image.begin(), image.end(), 0);
+
+		if (!ktxpp::unpack_to_rgba8(validated, file.data(), slices, image.data()) || image != expected)
+		{
+			fprintf(stderr, "unpack_to_rgba8 misses slices for %s\n", name);
+			failures++;
+		}
+	}
+
+	// The scalar kernels themselves, on a few known pixels
+	void check_legacy_kernels()
+	{
+		const unsigned char rgbg[4] = { 10, 20, 30, 40 }, grgb[4] = { 20, 10, 40, 30 }, bw1bpp[1] = { 0xA1 };
+		const unsigned char pairs[8] = { 10, 20, 30, 255, 10, 40, 30, 255 };
+		const unsigned char bw[32] = { 255, 255, 255, 255, 0, 0, 0, 255, 255, 255, 255, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255, 255 };
+		unsigned char result[32];
+
+		ktxpp::internal::rgbg_to_rgba8_scalar(rgbg, result, 2);
+		bool success = memcmp(result, pairs, sizeof(pairs)) == 0;
+		ktxpp::internal::grgb_to_rgba8_scalar(grgb, result, 2);
+		success &= memcmp(result, pairs, sizeof(pairs)) == 0;
+		ktxpp::internal::bw1bpp_to_rgba8_scalar(bw1bpp, result, 8);
+		success &= memcmp(result, bw, sizeof(bw)) == 0;
+
+		if (!success)
+		{
+			fprintf(stderr, "Legacy format kernels give the wrong pixels\n");
+			failures++;
+		}
+	}
+}
+
+int main()
+{
+	const ktxpp::SimdLevel levels[] = { ktxpp::SimdSSE2, ktxpp::SimdAVX2, ktxpp::SimdAVX512, ktxpp::SimdNEON };
+	ktxpp::Kernels scalar = ktxpp::get_kernels(ktxpp::SimdScalar);
+
+	printf("Detected %s\n", ktxpp::get_simd_level_name(ktxpp::detect_simd_level()));
+
+	for (ktxpp::SimdLevel level : levels)
+	{
+		if (!ktxpp::is_simd_level_supported(level))
+		{
+			continue;
+		}
+
+		ktxpp::Kernels kernels = ktxpp::get_kernels(level);
+		compare("byteswap16", level, scalar.byteswap16, kernels.byteswap16, 2);
+		compare("byteswap32", level, scalar.byteswap32, kernels.byteswap32, 4);
+		compare("swap_red_blue", level, scalar.swap_red_blue, kernels.swap_red_blue, 4);
+		compare_yuv(level, scalar, kernels);
+		compare_expand("rgbg_to_rgba8", level, scalar.rgbg_to_rgba8, kernels.rgbg_to_rgba8, 16);
+		compare_expand("grgb_to_rgba8", level, scalar.grgb_to_rgba8, kernels.grgb_to_rgba8, 16);
+		compare_expand("bw1bpp_to_rgba8", level, scalar.bw1bpp_to_rgba8, kernels.bw1bpp_to_rgba8, 1);
+		compare_squared_error(level, scalar, kernels);
+		compare_channel_stats(level, scalar, kernels);
+		compare_ssim_sums(level, scalar, kernels);
+		compare_srgb(level, scalar, kernels);
+		printf("Checked %s\n", ktxpp::get_simd_level_name(level));
+	}
+
+	check_yuv_accuracy();
+	check_yuv_texture();
+	check_legacy_kernels();
+	check_srgb_accuracy();
+	check_srgb_texture("GL_SRGB8_ALPHA8", ktxpp::GL_SRGB8_ALPHA8, ktxpp::GL_RGBA, 4, false);
+	check_srgb_texture("GL_SRGB8_ALPHA8 BGRA", ktxpp::GL_SRGB8_ALPHA8, ktxpp::GL_BGRA, 4, true);
+	check_srgb_texture("GL_SRGB8", ktxpp::GL_SRGB8, ktxpp::GL_RGB, 3, false);
+	check_srgb_texture("GL_SRGB8 BGR", ktxpp::GL_SRGB8, ktxpp::GL_BGR, 3, true);
+	check_legacy_texture(ktxpp::GL_RGBG8888_KTXPP, "GL_RGBG8888_KTXPP", scalar.rgbg_to_rgba8, 2, 32);
+	check_legacy_texture(ktxpp::GL_GRGB8888_KTXPP, "GL_GRGB8888_KTXPP", scalar.grgb_to_rgba8, 2, 32);
+	check_legacy_texture(ktxpp::GL_BW1BPP_KTXPP, "GL_BW1BPP_KTXPP", scalar.bw1bpp_to_rgba8, 8, 8);
+
+	// Levels the CPU lacks are ignored, so only check the override when the requested level can run
+	const char* requested = getenv("KTXPP_SIMD");
+	bool requestedSupported = false;
+
+	for (ktxpp::SimdLevel level : levels)
+	{
+		requestedSupported |= requested != nullptr && strcmp(requested, ktxpp::get_simd_level_name(level)) == 0 && ktxpp::is_simd_level_supported(level);
+	}
+
+	requestedSupported |= requested != nullptr && strcmp(requested, "scalar") == 0;
+
+	if (requestedSupported && strcmp(requested, ktxpp::get_simd_level_name(ktxpp::get_kernels().level)) != 0)
+	{
+		fprintf(stderr, "KTXPP_SIMD=%s ignored, got %s\n", requested, ktxpp::get_simd_level_name(ktxpp::get_kernels().level));
+		failures++;
+	}
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+// Checks the image metrics against known answers on synthetic images, that threading doesn't change them, and
+// compares every supported texture in the corpus with itself
+
+#include "../ktxpp_metrics.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	std::vector<unsigned char> make_noise(uint32_t seed, size_t size)
+	{
+		std::vector<unsigned char> data(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = (unsigned char)(((i + seed) * 2654435761u) >> 13);
+		}
+
+		return data;
+	}
+
+	// A smooth gradient, so a small shift keeps the SSIM high while noise drives it down
+	std::vector<unsigned char> make_gradient(uint32_t width, uint32_t height, uint32_t depth, uint32_t channelCount)
+	{
+		std::vector<unsigned char> data((size_t)width * height * depth * channelCount);
+
+		for (size_t i = 0; i < data.size(); ++i)
+		{
+			size_t pixel = i / channelCount;
+			uint32_t x = (uint32_t)(pixel % width), y = (uint32_t)(pixel / width % height);
+			data[i] = (unsigned char)(16 + (x * 3 + y * 2 + (uint32_t)(i % channelCount) * 20) % 200);
+		}
+
+		return data;
+	}
+
+	ktxpp::ImageView make_view(const std::vector<unsigned char>& data, uint32_t width, uint32_t height, uint32_t depth, uint32_t channelCount, uint32_t bytesPerChannel)
+	{
+		ktxpp::ImageView view = { data.data(), width, height, depth, width * channelCount * bytesPerChannel, channelCount, bytesPerChannel };
+		return view;
+	}
+
+	bool same_metrics(const ktxpp::ImageMetrics& a, const ktxpp::ImageMetrics& b)
+	{
+		bool same = a.channelCount == b.channelCount;
+
+		for (uint32_t channel = 0; channel <= a.channelCount; ++channel)
+		{
+			const ktxpp::ChannelMetrics& channelA = channel < a.channelCount ? a.channels[channel] : a.average;
+			const ktxpp::ChannelMetrics& channelB = channel < b.channelCount ? b.channels[channel] : b.average;
+			same &= channelA.mse == channelB.mse && channelA.psnr == channelB.psnr && channelA.ssim == channelB.ssim && channelA.maxError == channelB.maxError;
+		}
+
+		return same;
+	}
+
+	void check_image(const char* context, uint32_t width, uint32_t height, uint32_t depth, uint32_t channelCount)
+	{
+		ktxpp::MetricsOptions options;
+		ktxpp::ImageMetrics metrics;
+		std::vector<unsigned char> reference = make_gradient(width, height, depth, channelCount);
+		ktxpp::ImageView referenceView = make_view(reference, width, height, depth, channelCount, 1);
+
+		// Identical
+		check(ktxpp::compare_images(referenceView, referenceView, options, metrics) == ktxpp::MetricsSuccess, context, "identical images not compared");
+		check(metrics.channelCount == channelCount && metrics.average.mse == 0.0 && std::isinf(metrics.average.psnr) && metrics.average.maxError == 0, context, "identical images have errors");
+		check(std::fabs(metrics.average.ssim - 1.0) < 1e-9, context, "identical images have an SSIM below 1");
+
+		// Off by one in the last channel only
+		std::vector<unsigned char> shifted = reference;
+
+		for (size_t i = channelCount - 1; i < shifted.size(); i += channelCount)
+		{
+			shifted[i]++;
+		}
+
+		check(ktxpp::compare_images(referenceView, make_view(shifted, width, height, depth, channelCount, 1), options, metrics) == ktxpp::MetricsSuccess, context, "shifted images not compared");
+		check(metrics.channels[channelCount - 1].mse == 1.0 && metrics.channels[channelCount - 1].maxError == 1, context, "shifted channel has the wrong error");
+		check(std::fabs(metrics.channels[channelCount - 1].psnr - 20.0 * log10(255.0)) < 1e-9, context, "shifted channel has the wrong PSNR");
+		check(metrics.channels[channelCount - 1].ssim > 0.99 && metrics.channels[channelCount - 1].ssim < 1.0, context, "shifted channel has the wrong SSIM");
+		check(metrics.channels[0].mse == (channelCount == 1 ? 1.0 : 0.0), context, "shift leaked into another channel");
+		check(std::fabs(metrics.average.mse - 1.0 / channelCount) < 1e-12, context, "average MSE is not the mean of the channels");
+
+		// Noise, and the same again over several threads and without SSIM
+		std::vector<unsigned char> noise = make_noise(7, reference.size());
+		ktxpp::ImageView noiseView = make_view(noise, width, height, depth, channelCount, 1);
+		check(ktxpp::compare_images(referenceView, noiseView, options, metrics) == ktxpp::MetricsSuccess, context, "noise not compared");
+		check(metrics.average.ssim < 0.5 && metrics.average.mse > 100.0, context, "noise scores too well");
+
+		ktxpp::ImageMetrics threaded, unstructured;
+		options.threadCount = 4;
+		ktxpp::compare_images(referenceView, noiseView, options, threaded);
+		check(same_metrics(metrics, threaded), context, "threading changes the result");
+
+		options.ssim = false;
+		ktxpp::compare_images(referenceView, noiseView, options, unstructured);
+		check(unstructured.average.mse == metrics.average.mse && unstructured.average.ssim == 0.0, context, "SSIM not skipped");
+
+		// 16-bit channels, the same errors scaled by 256 against a peak of 65535 rather than 255 * 256
+		std::vector<unsigned char> wide(reference.size() * 2), wideNoise(reference.size() * 2);
+
+		for (size_t i = 0; i < reference.size(); ++i)
+		{
+			uint16_t value = (uint16_t)(reference[i] * 256), noiseValue = (uint16_t)(noise[i] * 256);
+			memcpy(&wide[i * 2], &value, 2);
+			memcpy(&wideNoise[i * 2], &noiseValue, 2);
+		}
+
+		ktxpp::ImageMetrics wideMetrics;
+		options.ssim = true;
+		check(ktxpp::compare_images(make_view(wide, width, height, depth, channelCount, 2), make_view(wideNoise, width, height, depth, channelCount, 2), options, wideMetrics) == ktxpp::MetricsSuccess, context, "16-bit images not compared");
+		check(wideMetrics.average.mse == metrics.average.mse * 65536.0 && wideMetrics.average.maxError == metrics.average.maxError * 256, context, "16-bit errors differ from 8-bit");
+		check(std::fabs(wideMetrics.average.psnr - metrics.average.psnr - 20.0 * log10(65535.0 / 65280.0)) < 1e-9, context, "16-bit PSNR differs from 8-bit");
+	}
+
+	void check_errors()
+	{
+		std::vector<unsigned char> data(64 * 4);
+		ktxpp::ImageMetrics metrics;
+		ktxpp::MetricsOptions options;
+		ktxpp::ImageView a = make_view(data, 8, 8, 1, 4, 1), b = a;
+
+		b.width = 4;
+		check(ktxpp::compare_images(a, b, options, metrics) == ktxpp::MetricsMismatchedImages, "errors", "different sizes compared");
+
+		b = a;
+		b.bytesPerChannel = 4;
+		check(ktxpp::compare_images(a, b, options, metrics) == ktxpp::MetricsUnsupportedFormat, "errors", "32-bit channels compared");
+
+		b = a;
+		b.rowPitch = 8;
+		check(ktxpp::compare_images(a, b, options, metrics) == ktxpp::MetricsUnsupportedFormat, "errors", "short row pitch accepted");
+
+		std::vector<ktxpp::ImageMetrics> textureMetrics;
+		check(ktxpp::compare_textures(data.data(), data.size(), data.data(), data.size(), options, textureMetrics) == ktxpp::MetricsInvalidTexture, "errors", "garbage compared");
+	}
+
+	// A mipmapped array texture against a copy with one pixel of one subresource changed
+	void check_texture()
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 37, 70, 0, ktxpp::Texture2D, 7, 3, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			std::vector<unsigned char> pixels = make_gradient(subresource.width, subresource.height, 1, 4);
+			ktxpp::write_subresource(desc, subresource, pixels.data(), subresource.width * 4, file.data());
+		}
+
+		std::vector<unsigned char> changed = file;
+		changed[(size_t)layout[4].offset + 2] ^= 0x10;
+
+		ktxpp::MetricsOptions options;
+		options.threadCount = 0;
+		std::vector<ktxpp::ImageMetrics> metrics;
+		check(ktxpp::compare_textures(file.data(), file.size(), changed.data(), changed.size(), options, metrics) == ktxpp::MetricsSuccess, "texture", "textures not compared");
+		check(metrics.size() == layout.size(), "texture", "wrong number of subresources");
+
+		for (size_t i = 0; i < metrics.size(); ++i)
+		{
+			bool expectError = i == 4;
+			check((metrics[i].channels[2].maxError == 16) == expectError && metrics[i].channels[0].maxError == 0, "texture", "error in the wrong subresource");
+		}
+
+		ktxpp::Descriptor otherDesc;
+		std::vector<ktxpp::Subresource> otherLayout;
+		std::vector<unsigned char> other = make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 37, 70, 0, ktxpp::Texture2D, 7, 2, otherDesc, otherLayout);
+		check(ktxpp::compare_textures(file.data(), file.size(), other.data(), other.size(), options, metrics) == ktxpp::MetricsMismatchedImages, "texture", "different array sizes compared");
+	}
+
+	void check_corpus_file(const char* path)
+	{
+		std::vector<unsigned char> file;
+
+		if (!read_file(path, file))
+		{
+			check(false, path, "could not read file");
+			return;
+		}
+
+		ktxpp::MetricsOptions options;
+		std::vector<ktxpp::ImageMetrics> metrics;
+		ktxpp::MetricsResult result = ktxpp::compare_textures(file.data(), file.size(), file.data(), file.size(), options, metrics);
+
+		if (result == ktxpp::MetricsSuccess)
+		{
+			for (const ktxpp::ImageMetrics& image : metrics)
+			{
+				check(image.average.mse == 0.0 && image.average.maxError == 0 && std::fabs(image.average.ssim - 1.0) < 1e-9, path, "differs from itself");
+			}
+		}
+		else
+		{
+			check(result == ktxpp::MetricsUnsupportedFormat || result == ktxpp::MetricsInvalidTexture, path, "unexpected result");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	check_image("rgba 8x8", 8, 8, 1, 4);
+	check_image("rgb 67x131", 67, 131, 1, 3);
+	check_image("r 5x3", 5, 3, 1, 1);
+	check_image("rg 19x9x3", 19, 9, 3, 2);
+	check_image("rgba 300x1", 300, 1, 1, 4);
+	check_errors();
+	check_texture();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		check_corpus_file(argv[i]);
+	}
+
+	return failures > 0 ? 1 : 0;
+}
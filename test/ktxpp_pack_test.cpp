@@ -0,0 +1,233 @@
+// Builds a pack from every file given on the command line, then checks that each texture is found and lies where
+// its own subresource layout says, both in memory and mapped from disk. Files ktxpp can't validate are left out
+//
+// Usage: ktxpp_pack_test file.ktx...
+
+#include "../ktxpp_pack.h"
+#include "ktxpp_test_util.h"
+
+namespace
+{
+	void check_pack(const ktxpp::Pack& pack, const std::vector<std::string>& names, const std::vector<std::vector<unsigned char> >& files)
+	{
+		check(pack.header.entryCount == names.size(), "pack", "wrong number of entries");
+		check(ktxpp::find_pack_texture(pack, "missing.ktx") == nullptr, "pack", "found a texture that isn't in the pack");
+
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			const ktxpp::PackEntry* entry = ktxpp::find_pack_texture(pack, names[i].c_str());
+
+			if (entry == nullptr)
+			{
+				check(false, names[i], "not found");
+				continue;
+			}
+
+			bool deduplicated = (entry->flags & ktxpp::PackEntryDeduplicated) != 0;
+			check(ktxpp::get_pack_texture_name(pack, *entry) == names[i], names[i], "wrong name");
+			check(entry->offset % pack.header.pageSize == 0, names[i], "texture isn't page aligned");
+			check(deduplicated || (entry->size == files[i].size() && memcmp(ktxpp::get_pack_texture_data(pack, *entry), files[i].data(), files[i].size()) == 0), names[i], "texture data differs");
+
+			ktxpp::internal::HeaderKTX header;
+			memcpy(&header, files[i].data(), sizeof(header));
+
+			ktxpp::Descriptor desc;
+			std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(entry->desc));
+			ktxpp::prepare_texture(header, desc, layout.data());
+			check(desc.glInternalFormat == entry->desc.glInternalFormat && desc.width == entry->desc.width && desc.numMips == entry->desc.numMips, names[i], "descriptor differs");
+
+			const ktxpp::Subresource* subresources = ktxpp::get_pack_subresources(pack, *entry);
+
+			for (size_t j = 0; j < layout.size(); ++j)
+			{
+				check(deduplicated || subresources[j].offset == entry->offset + layout[j].offset, names[i], "subresource isn't where the KTX file has it");
+				check(subresources[j].size == layout[j].size && subresources[j].rowPitch == layout[j].rowPitch, names[i], "subresource differs");
+				check(memcmp(pack.data + subresources[j].offset, files[i].data() + layout[j].offset, (size_t)layout[j].size) == 0, names[i], "image differs");
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> names;
+	std::vector<std::vector<unsigned char> > files;
+	ktxpp::PackBuilder builder;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::vector<unsigned char> file;
+
+		if (!read_file(argv[i], file))
+		{
+			check(false, argv[i], "could not read file");
+			continue;
+		}
+
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header(file.data(), file.size(), desc) == ktxpp::ValidationSuccess)
+		{
+			names.push_back(argv[i]);
+			files.push_back(std::move(file));
+		}
+	}
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		check(ktxpp::add_pack_texture(builder, names[i].c_str(), files[i].data(), files[i].size()) == ktxpp::PackSuccess, names[i], "rejected by the builder");
+	}
+
+	std::vector<unsigned char> packData;
+	check(ktxpp::build_pack(builder, packData) == ktxpp::PackSuccess, "pack", "build failed");
+
+	ktxpp::Pack pack;
+	check(ktxpp::open_pack(pack, packData.data(), packData.size()) == ktxpp::PackSuccess, "pack", "open failed");
+
+	if (failures == 0)
+	{
+		check_pack(pack, names, files);
+	}
+
+	// The same pack streamed to disk and mapped back
+	std::string path = "ktxpp_pack_test.pak";
+	check(ktxpp::write_pack(builder, path.c_str()) == ktxpp::PackSuccess, "pack", "write failed");
+
+	ktxpp::PackFile packFile;
+
+	if (ktxpp::open_pack_file(packFile, path.c_str()) == ktxpp::PackSuccess)
+	{
+		check(packFile.pack.size == packData.size() && memcmp(packFile.mapping, packData.data(), packData.size()) == 0, "pack", "file differs from the in memory pack");
+		check_pack(packFile.pack, names, files);
+		ktxpp::close_pack_file(packFile);
+	}
+	else
+	{
+		check(false, "pack", "mapping failed");
+	}
+
+	remove(path.c_str());
+
+	// Deduplicated, with every texture added a second time under another name so all of its images are shared
+	ktxpp::PackBuilder dedupBuilder;
+	dedupBuilder.deduplicate = true;
+	std::vector<std::string> dedupNames = names;
+	std::vector<std::vector<unsigned char> > dedupFiles = files;
+	uint64_t imageSize = 0;
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		dedupNames.push_back(names[i] + ".copy");
+		dedupFiles.push_back(files[i]);
+	}
+
+	for (size_t i = 0; i < dedupNames.size(); ++i)
+	{
+		check(ktxpp::add_pack_texture(dedupBuilder, dedupNames[i].c_str(), dedupFiles[i].data(), dedupFiles[i].size()) == ktxpp::PackSuccess, dedupNames[i], "rejected by the builder");
+	}
+
+	for (const ktxpp::internal::PackSource& source : dedupBuilder.textures)
+	{
+		for (const ktxpp::Subresource& subresource : source.subresources)
+		{
+			imageSize += subresource.size;
+		}
+	}
+
+	std::vector<unsigned char> dedupData;
+	check(ktxpp::build_pack(dedupBuilder, dedupData) == ktxpp::PackSuccess, "deduplicated pack", "build failed");
+	check(ktxpp::open_pack(pack, dedupData.data(), dedupData.size()) == ktxpp::PackSuccess, "deduplicated pack", "open failed");
+
+	if (failures == 0)
+	{
+		check_pack(pack, dedupNames, dedupFiles);
+
+		uint64_t storedSize = 0;
+
+		for (uint32_t i = 0; i < pack.header.entryCount; ++i)
+		{
+			storedSize += pack.entries[i].size;
+		}
+
+		check(storedSize < imageSize / 2 + 2 * names.size() * 4096, "deduplicated pack", "copies weren't shared");
+		printf("Deduplication stores %llu bytes for %llu bytes of images\n", (unsigned long long)storedSize, (unsigned long long)imageSize);
+	}
+
+	// Only a texture that shares an image is flagged, the others are stored as complete files
+	ktxpp::PackBuilder sharingBuilder;
+	sharingBuilder.deduplicate = true;
+	std::vector<unsigned char> unique[2];
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		unique[i] = make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 16, 16, 0, ktxpp::Texture2D, 5, 0, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			for (uint64_t j = 0; j < subresource.size; ++j)
+			{
+				unique[i][(size_t)(subresource.offset + j)] = (unsigned char)(j * 7 + i * 101 + subresource.mip * 13);
+			}
+		}
+	}
+
+	ktxpp::add_pack_texture(sharingBuilder, "first.ktx", unique[0].data(), unique[0].size());
+	ktxpp::add_pack_texture(sharingBuilder, "second.ktx", unique[1].data(), unique[1].size());
+	ktxpp::add_pack_texture(sharingBuilder, "copy.ktx", unique[0].data(), unique[0].size());
+
+	std::vector<unsigned char> sharingData;
+
+	if (ktxpp::build_pack(sharingBuilder, sharingData) == ktxpp::PackSuccess && ktxpp::open_pack(pack, sharingData.data(), sharingData.size()) == ktxpp::PackSuccess)
+	{
+		const ktxpp::PackEntry* first = ktxpp::find_pack_texture(pack, "first.ktx");
+		const ktxpp::PackEntry* second = ktxpp::find_pack_texture(pack, "second.ktx");
+		const ktxpp::PackEntry* copy = ktxpp::find_pack_texture(pack, "copy.ktx");
+		check(first->flags == 0 && second->flags == 0 && (copy->flags & ktxpp::PackEntryDeduplicated) != 0, "sharing pack", "wrong textures flagged as deduplicated");
+		check(second->size == unique[1].size() && memcmp(ktxpp::get_pack_texture_data(pack, *second), unique[1].data(), unique[1].size()) == 0, "sharing pack", "unshared texture isn't stored whole");
+	}
+	else
+	{
+		check(false, "sharing pack", "not built");
+	}
+
+	// Damage must be caught by open_pack rather than by readers
+	check(ktxpp::open_pack(pack, packData.data(), packData.size() - 1) == ktxpp::PackTruncated, "pack", "truncated pack accepted");
+
+	if (!names.empty())
+	{
+		std::vector<unsigned char> damaged = packData;
+		ktxpp::PackEntry* entry = reinterpret_cast<ktxpp::PackEntry*>(damaged.data() + sizeof(ktxpp::internal::PackHeader));
+		entry->size = packData.size();
+		check(ktxpp::open_pack(pack, damaged.data(), damaged.size()) == ktxpp::PackInvalidDirectory, "pack", "texture past the end accepted");
+		check(pack.data == nullptr && pack.header.entryCount == 0 && ktxpp::find_pack_texture(pack, names[0].c_str()) == nullptr, "pack", "rejected pack left open");
+
+		// Block sizes and pitches that disagree with the format, and images smaller than their rows
+		ktxpp::internal::PackHeader header;
+		memcpy(&header, packData.data(), sizeof(header));
+		size_t subresourcesOffset = sizeof(header) + header.entryCount * sizeof(ktxpp::PackEntry);
+
+		damaged = packData;
+		reinterpret_cast<ktxpp::PackEntry*>(damaged.data() + sizeof(header))->desc.blockWidth = 0;
+		check(ktxpp::open_pack(pack, damaged.data(), damaged.size()) == ktxpp::PackInvalidDirectory, "pack", "zero block width accepted");
+
+		damaged = packData;
+		reinterpret_cast<ktxpp::PackEntry*>(damaged.data() + sizeof(header))->desc.rowPitch++;
+		check(ktxpp::open_pack(pack, damaged.data(), damaged.size()) == ktxpp::PackInvalidDirectory, "pack", "wrong row pitch accepted");
+
+		damaged = packData;
+		reinterpret_cast<ktxpp::Subresource*>(damaged.data() + subresourcesOffset)->size--;
+		check(ktxpp::open_pack(pack, damaged.data(), damaged.size()) == ktxpp::PackInvalidDirectory, "pack", "subresource smaller than its rows accepted");
+
+		damaged = packData;
+		damaged[0] ^= 1;
+		check(ktxpp::open_pack(pack, damaged.data(), damaged.size()) == ktxpp::PackInvalidIdentifier, "pack", "bad identifier accepted");
+
+		check(ktxpp::add_pack_texture(builder, names[0].c_str(), files[0].data(), files[0].size()) == ktxpp::PackSuccess, names[0], "rejected by the builder");
+		check(ktxpp::build_pack(builder, packData) == ktxpp::PackDuplicateName, "pack", "duplicate name accepted");
+	}
+
+	printf("%zu textures packed\n", names.size());
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// Checks residency costs against the subresource layout, and the residency planner against budgets it should fill
+// exactly, budgets it can't meet, and priorities and floors on random sets of textures
+
+#include "../ktxpp_residency.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	// Formats whose rows are already a multiple of 4 bytes cost exactly what the file stores
+	void check_costs(const char* context, const ktxpp::Descriptor& desc, bool packedRows)
+	{
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout(desc, 0, layout.data());
+
+		ktxpp::ResidencyCosts costs;
+		ktxpp::compute_residency_costs(desc, costs);
+		check(costs.mipCount == ktxpp::get_mip_count(desc), context, "wrong mip count");
+
+		uint64_t tail = 0;
+		bool matches = true;
+
+		for (uint32_t mip = ktxpp::get_mip_count(desc); mip-- > 0;)
+		{
+			uint64_t stored = 0, packed = 0;
+
+			for (const ktxpp::Subresource& subresource : layout)
+			{
+				if (subresource.mip == mip)
+				{
+					uint32_t widthInBlocks, heightInBlocks;
+					ktxpp::get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+					stored += subresource.size;
+					packed += (uint64_t)widthInBlocks * desc.bitsPerPixelOrBlock / 8 * heightInBlocks * subresource.depth;
+					matches &= ktxpp::get_image_cost(desc, mip) * ktxpp::get_subresource_count(desc) / ktxpp::get_mip_count(desc) == ktxpp::get_mip_cost(desc, mip);
+				}
+			}
+
+			tail += ktxpp::get_mip_cost(desc, mip);
+			matches &= ktxpp::get_mip_cost(desc, mip) == packed && (!packedRows || packed == stored);
+			matches &= ktxpp::get_tail_cost(desc, mip) == tail && costs.tailCosts[mip] == tail;
+		}
+
+		check(matches, context, "costs differ from the layout");
+		check(costs.tailCosts[costs.mipCount] == 0 && costs.tailCosts[ktxpp::RESIDENCY_MAX_MIPS] == 0, context, "costs past the last mip");
+	}
+
+	void check_exact_budgets()
+	{
+		ktxpp::ResidencyCosts costs;
+		ktxpp::compute_residency_costs(make_descriptor(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 256, 256, 0, ktxpp::Texture2D, 9, 0), costs);
+
+		ktxpp::ResidencyRequest requests[3];
+		uint32_t topMips[3];
+		uint64_t residentBytes = 0;
+
+		for (ktxpp::ResidencyRequest& request : requests)
+		{
+			request.costs = &costs;
+		}
+
+		// Twice the priority keeps one more mip, four times two more
+		requests[0].priority = 1.0f;
+		requests[1].priority = 2.0f;
+		requests[2].priority = 4.0f;
+		uint64_t budget = costs.tailCosts[0] + costs.tailCosts[1] + costs.tailCosts[2];
+		check(ktxpp::plan_residency(requests, 3, budget, topMips, residentBytes) == ktxpp::ResidencySuccess, "exact", "not planned");
+		check(topMips[0] == 2 && topMips[1] == 1 && topMips[2] == 0 && residentBytes == budget, "exact", "priorities not one mip apart");
+
+		// Everything fits
+		check(ktxpp::plan_residency(requests, 3, costs.tailCosts[0] * 3, topMips, residentBytes) == ktxpp::ResidencySuccess, "exact", "not planned with room");
+		check(topMips[0] == 0 && topMips[1] == 0 && topMips[2] == 0 && residentBytes == costs.tailCosts[0] * 3, "exact", "mips dropped with room");
+
+		// Leftover budget goes to the texture next in line, not past it
+		check(ktxpp::plan_residency(requests, 3, budget + costs.tailCosts[1] - costs.tailCosts[2], topMips, residentBytes) == ktxpp::ResidencySuccess, "exact", "not planned");
+		check(topMips[0] == 1 && topMips[1] == 1 && topMips[2] == 0, "exact", "leftover not used");
+
+		// Wanted mips and floors bound the choice, priority 0 drops first
+		requests[0].wantedMip = 3;
+		requests[1].floorMip = 1;
+		requests[2].priority = 0.0f;
+		check(ktxpp::plan_residency(requests, 3, costs.tailCosts[4] + costs.tailCosts[1] + costs.tailCosts[8], topMips, residentBytes) == ktxpp::ResidencySuccess, "exact", "not planned");
+		check(topMips[0] == 4 && topMips[1] == 1 && topMips[2] == 8, "exact", "wanted mips or floors ignored");
+
+		check(ktxpp::plan_residency(requests, 3, costs.tailCosts[1], topMips, residentBytes) == ktxpp::ResidencyOverBudget, "exact", "budget below the floors met");
+		check(topMips[0] == 8 && topMips[1] == 1 && topMips[2] == 8 && residentBytes == costs.tailCosts[1] + costs.tailCosts[8] * 2, "exact", "not left at the floors");
+
+		requests[1].costs = nullptr;
+		check(ktxpp::plan_residency(requests, 3, budget, topMips, residentBytes) == ktxpp::ResidencyInvalidRequest && residentBytes == 0, "exact", "request without costs planned");
+	}
+
+	// Whatever the budget, the plan fits, stays between wanted mips and floors, and a texture never keeps less than one
+	// of lower priority with the same costs and wanted mip
+	void check_random_sets()
+	{
+		const uint32_t textureCount = 500;
+		ktxpp::ResidencyCosts costs[4];
+		ktxpp::compute_residency_costs(make_descriptor(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 512, 512, 0, ktxpp::Texture2D, 10, 0), costs[0]);
+		ktxpp::compute_residency_costs(make_descriptor(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 2048, 1024, 0, ktxpp::Cubemap, 12, 0), costs[1]);
+		ktxpp::compute_residency_costs(make_descriptor(ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, 100, 60, 30, ktxpp::Texture3D, 7, 0), costs[2]);
+		ktxpp::compute_residency_costs(make_descriptor(ktxpp::GL_COMPRESSED_RGBA_ASTC_6x6, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 300, 300, 0, ktxpp::Texture2D, 1, 4), costs[3]);
+
+		std::vector<ktxpp::ResidencyRequest> requests(textureCount);
+		std::vector<uint32_t> topMips(textureCount);
+		uint64_t wanted = 0, floors = 0;
+
+		for (uint32_t i = 0; i < textureCount; ++i)
+		{
+			uint32_t hash = (i + 1) * 2654435761u;
+			requests[i].costs = &costs[hash % 4];
+			requests[i].priority = (hash >> 8) % 7 == 0 ? 0.0f : (float)((hash >> 12) % 1000 + 1) / 100.0f;
+			requests[i].wantedMip = (hash >> 4) % 3;
+			requests[i].floorMip = 4 + (hash >> 20) % 8;
+
+			uint32_t floorMip = std::min(requests[i].floorMip, requests[i].costs->mipCount - 1);
+			wanted += requests[i].costs->tailCosts[std::min(requests[i].wantedMip, floorMip)];
+			floors += requests[i].costs->tailCosts[floorMip];
+		}
+
+		for (uint32_t step = 0; step <= 20; ++step)
+		{
+			uint64_t budget = step < 20 ? floors + (wanted - floors) / 20 * step : wanted;
+			uint64_t residentBytes = 0;
+			bool fits = ktxpp::plan_residency(requests.data(), textureCount, budget, topMips.data(), residentBytes) == ktxpp::ResidencySuccess;
+			uint64_t total = 0;
+
+			for (uint32_t i = 0; i < textureCount; ++i)
+			{
+				uint32_t floorMip = std::min(requests[i].floorMip, requests[i].costs->mipCount - 1);
+				fits &= topMips[i] >= std::min(requests[i].wantedMip, floorMip) && topMips[i] <= floorMip;
+				total += requests[i].costs->tailCosts[topMips[i]];
+			}
+
+			check(fits && total == residentBytes && total <= budget, "random", "plan over budget or out of bounds");
+			check(step < 20 || total == wanted, "random", "mips dropped with room for all");
+			check(step > 0 || total == floors, "random", "more than the floors kept at the floor budget");
+
+			bool ordered = true;
+
+			for (uint32_t i = 0; i < textureCount; ++i)
+			{
+				for (uint32_t j = 0; j < textureCount; ++j)
+				{
+					if (requests[i].costs == requests[j].costs && requests[i].wantedMip == requests[j].wantedMip && requests[i].floorMip == requests[j].floorMip && requests[i].priority > requests[j].priority)
+					{
+						ordered &= topMips[i] <= topMips[j];
+					}
+				}
+			}
+
+			check(ordered, "random", "lower priority keeps more");
+		}
+	}
+}
+
+int main()
+{
+	check_costs("rgba8 2D array", make_descriptor(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 37, 70, 0, ktxpp::Texture2D, 7, 3), true);
+	check_costs("rgb8 3D", make_descriptor(ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, 31, 9, 5, ktxpp::Texture3D, 5, 0), false);
+	check_costs("bc1 cubemap array", make_descriptor(ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 70, 70, 0, ktxpp::Cubemap, 7, 2), true);
+	check_costs("astc 10x6 one mip", make_descriptor(ktxpp::GL_COMPRESSED_RGBA_ASTC_10x6, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 23, 1500, 0, ktxpp::Texture2D, 0, 0), true);
+	check_exact_budgets();
+	check_random_sets();
+
+	return failures > 0 ? 1 : 0;
+}
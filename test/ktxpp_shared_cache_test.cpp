@@ -0,0 +1,389 @@
+// Exercises the shared texture cache through two mappings of one segment: round trips of synthetic and corpus
+// textures with and without their files and pages, duplicate keys, full segments and indexes, stores left behind
+// by dead or hung processes, and on POSIX child processes racing to store the same textures and segments whose
+// creator died
+
+#include "../ktxpp_shared_cache.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+#include <vector>
+
+#if !defined(_WIN32)
+	#include <sys/wait.h>
+#endif
+
+namespace
+{
+	std::vector<unsigned char> make_texture(uint32_t seed)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 8 + seed % 29, 5 + seed % 17, 0, ktxpp::Texture2D, 3, 1 + seed % 3, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			for (uint64_t i = 0; i < subresource.size; ++i)
+			{
+				file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 37 + seed * 11 + subresource.mip);
+			}
+		}
+
+		return file;
+	}
+
+	uint32_t get_process_id()
+	{
+#if defined(_WIN32)
+		return (uint32_t)GetCurrentProcessId();
+#else
+		return (uint32_t)getpid();
+#endif
+	}
+
+	ktxpp::Hash128 make_key(uint32_t seed)
+	{
+		return ktxpp::get_shared_cache_key("textures/synthetic.ktx", seed);
+	}
+
+	// The cached texture matches the file, and holds the same pages
+	bool matches(const ktxpp::SharedTexture& texture, const std::vector<unsigned char>& file, bool storedFile, const std::vector<ktxpp::SharedCachePage>& pages)
+	{
+		ktxpp::Descriptor desc;
+		memset(&desc, 0, sizeof(desc));
+
+		if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess || memcmp(&desc, &texture.desc, sizeof(desc)) != 0)
+		{
+			return false;
+		}
+
+		ktxpp::internal::HeaderKTX header;
+		memcpy(&header, file.data(), sizeof(header));
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), layout.data());
+
+		bool same = memcmp(layout.data(), texture.subresources, layout.size() * sizeof(ktxpp::Subresource)) == 0 && texture.fileSize == file.size();
+		same &= storedFile ? texture.file != nullptr && memcmp(texture.file, file.data(), file.size()) == 0 : texture.file == nullptr;
+		same &= texture.pageCount == pages.size();
+
+		for (uint32_t i = 0; i < texture.pageCount && same; ++i)
+		{
+			ktxpp::SharedCachePage page;
+			ktxpp::get_shared_texture_page(texture, i, page);
+			same &= page.size == pages[i].size && memcmp(page.data, pages[i].data, (size_t)page.size) == 0 && page.subresource == pages[i].subresource;
+			same &= page.format == pages[i].format && page.width == pages[i].width && page.height == pages[i].height && page.rowPitch == pages[i].rowPitch;
+			same &= (uintptr_t)page.data % 64 == 0;
+		}
+
+		return same;
+	}
+
+	void check_round_trips(ktxpp::SharedTextureCache& writer, ktxpp::SharedTextureCache& reader)
+	{
+		ktxpp::SharedTexture texture;
+
+		for (uint32_t seed = 0; seed < 20; ++seed)
+		{
+			std::vector<unsigned char> file = make_texture(seed);
+			ktxpp::Hash128 key = make_key(seed);
+			check(!ktxpp::find_shared_texture(reader, key, texture), "round trip", "hit before storing");
+
+			// Pages of made up decoded data for a few subresources
+			std::vector<std::vector<unsigned char>> pageData;
+			std::vector<ktxpp::SharedCachePage> pages;
+
+			for (uint32_t i = 0; i < seed % 4; ++i)
+			{
+				pageData.push_back(std::vector<unsigned char>(100 + seed * 13 + i, (unsigned char)(seed + i)));
+			}
+
+			for (uint32_t i = 0; i < pageData.size(); ++i)
+			{
+				ktxpp::SharedCachePage page = { pageData[i].data(), pageData[i].size(), i, ktxpp::GL_RGBA8, seed, i, seed * 4 };
+				pages.push_back(page);
+			}
+
+			bool storeFile = seed % 2 == 0;
+			check(ktxpp::store_shared_texture(writer, key, file.data(), file.size(), storeFile, pages.data(), (uint32_t)pages.size()) == ktxpp::SharedCacheSuccess, "round trip", "not stored");
+			check(ktxpp::find_shared_texture(reader, key, texture) && matches(texture, file, storeFile, pages), "round trip", "other mapping sees a different texture");
+			check(ktxpp::find_shared_texture(writer, key, texture) && matches(texture, file, storeFile, pages), "round trip", "storing mapping sees a different texture");
+			check(ktxpp::store_shared_texture(reader, key, file.data(), file.size(), true) == ktxpp::SharedCacheExists, "round trip", "stored twice");
+		}
+
+		// A page for a subresource the texture doesn't have, and a file that isn't one
+		std::vector<unsigned char> file = make_texture(100);
+		unsigned char byte = 0;
+		ktxpp::SharedCachePage page = { &byte, 1, 1000, 0, 0, 0, 0 };
+		check(ktxpp::store_shared_texture(writer, make_key(100), file.data(), file.size(), false, &page, 1) == ktxpp::SharedCacheInvalidTexture, "round trip", "page of a missing subresource stored");
+		check(ktxpp::store_shared_texture(writer, make_key(100), file.data(), 40, false) == ktxpp::SharedCacheInvalidTexture, "round trip", "truncated file stored");
+		check(!ktxpp::find_shared_texture(reader, make_key(100), texture), "round trip", "rejected texture found");
+
+		ktxpp::SharedCacheStats stats = ktxpp::get_shared_cache_stats(reader);
+		check(stats.stores == 20 && stats.hits == 40 && stats.misses == 21 && stats.bytesUsed > 0 && stats.bytesUsed <= stats.capacity, "round trip", "wrong statistics");
+	}
+
+	void check_corpus(ktxpp::SharedTextureCache& writer, ktxpp::SharedTextureCache& reader, int argc, char** argv)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::vector<unsigned char> file;
+
+			if (!read_file(argv[i], file))
+			{
+				check(false, argv[i], "could not read file");
+				continue;
+			}
+
+			ktxpp::Descriptor desc;
+
+			if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess)
+			{
+				continue;
+			}
+
+			ktxpp::Hash128 key = ktxpp::get_shared_cache_key(argv[i], 0);
+			ktxpp::SharedTexture texture;
+			ktxpp::SharedCacheResult result = ktxpp::store_shared_texture(writer, key, file.data(), file.size(), true);
+
+			if (result == ktxpp::SharedCacheFull)
+			{
+				continue;
+			}
+
+			check(result == ktxpp::SharedCacheSuccess, argv[i], "not stored");
+			check(ktxpp::find_shared_texture(reader, key, texture) && matches(texture, file, true, std::vector<ktxpp::SharedCachePage>()), argv[i], "cached texture differs");
+		}
+	}
+
+	void check_full(const char* name)
+	{
+		ktxpp::remove_shared_texture_cache(name);
+
+		// Entry sizes as laid out in the segment, to size it for 13 textures without their files and 2.5 with
+		std::vector<unsigned char> file = make_texture(28);
+		ktxpp::Descriptor desc;
+		ktxpp::validate_header(file.data(), file.size(), desc);
+		uint64_t tablesSize = ktxpp::internal::align_shared_offset(sizeof(ktxpp::internal::SharedCacheEntry) + ktxpp::get_subresource_count(desc) * sizeof(ktxpp::Subresource));
+		uint64_t fileEntrySize = tablesSize + ktxpp::internal::align_shared_offset(file.size());
+		uint64_t dataOffset = ktxpp::internal::align_shared_offset(sizeof(ktxpp::internal::SharedCacheHeader) + 16 * sizeof(ktxpp::internal::SharedCacheSlot));
+
+		ktxpp::SharedTextureCache cache;
+
+		if (!ktxpp::open_shared_texture_cache(cache, name, dataOffset + 13 * tablesSize + fileEntrySize * 5 / 2, 16))
+		{
+			check(false, name, "could not create");
+			return;
+		}
+
+		ktxpp::SharedTexture texture;
+
+		for (uint32_t seed = 0; seed < 13; ++seed)
+		{
+			check(ktxpp::store_shared_texture(cache, make_key(seed), file.data(), file.size(), false) == ktxpp::SharedCacheSuccess, name, "descriptor alone not stored");
+		}
+
+		check(ktxpp::store_shared_texture(cache, make_key(13), file.data(), file.size(), true) == ktxpp::SharedCacheSuccess, name, "file not stored");
+		check(ktxpp::store_shared_texture(cache, make_key(14), file.data(), file.size(), true) == ktxpp::SharedCacheSuccess, name, "file not stored");
+		check(ktxpp::store_shared_texture(cache, make_key(15), file.data(), file.size(), true) == ktxpp::SharedCacheFull, name, "stored past the end of the segment");
+		check(ktxpp::find_shared_texture(cache, make_key(0), texture) && ktxpp::find_shared_texture(cache, make_key(14), texture), name, "lookups fail once full");
+		check(!ktxpp::find_shared_texture(cache, make_key(15), texture), name, "texture that didn't fit found");
+
+		// There's still room for a descriptor, but not in the index
+		check(ktxpp::store_shared_texture(cache, make_key(16), file.data(), file.size(), false) == ktxpp::SharedCacheFull, name, "stored past a full index");
+		check(!ktxpp::find_shared_texture(cache, make_key(17), texture), name, "hit in a full index");
+
+		ktxpp::close_shared_texture_cache(cache);
+		ktxpp::remove_shared_texture_cache(name);
+	}
+
+	// Claims the key's slot as a store that never finishes, with the given lease
+	void claim_slot(ktxpp::SharedTextureCache& cache, const ktxpp::Hash128& key, uint64_t lease)
+	{
+		ktxpp::internal::SharedCacheSlot& slot = cache.slots[key.low & (cache.header->slotCount - 1)];
+		slot.tag.store(ktxpp::internal::get_shared_cache_tag(key));
+		slot.lease.store(lease);
+	}
+
+	void check_abandoned_stores(const char* name)
+	{
+		ktxpp::remove_shared_texture_cache(name);
+		ktxpp::SharedTextureCache cache;
+
+		if (!ktxpp::open_shared_texture_cache(cache, name, 1 << 20))
+		{
+			check(false, name, "could not create");
+			return;
+		}
+
+		std::vector<unsigned char> file = make_texture(3);
+		ktxpp::SharedTexture texture;
+		uint32_t now = ktxpp::internal::get_shared_cache_time();
+
+		// Running for longer than a store takes
+		claim_slot(cache, make_key(0), ktxpp::internal::make_shared_cache_lease(0, now - ktxpp::internal::SHARED_CACHE_STORE_TIMEOUT_S - 1));
+		check(ktxpp::store_shared_texture(cache, make_key(0), file.data(), file.size(), true) == ktxpp::SharedCacheSuccess, name, "hung store not taken over");
+		check(ktxpp::find_shared_texture(cache, make_key(0), texture) && matches(texture, file, true, std::vector<ktxpp::SharedCachePage>()), name, "texture stored past a hung store differs");
+
+		// Still running, and claimed without a lease yet, which starts the clock
+		claim_slot(cache, make_key(1), ktxpp::internal::make_shared_cache_lease(get_process_id(), now));
+		check(ktxpp::store_shared_texture(cache, make_key(1), file.data(), file.size(), true) == ktxpp::SharedCacheExists, name, "live store taken over");
+		claim_slot(cache, make_key(2), 0);
+		check(ktxpp::store_shared_texture(cache, make_key(2), file.data(), file.size(), true) == ktxpp::SharedCacheExists, name, "store without a lease taken over");
+		check(cache.slots[make_key(2).low & (cache.header->slotCount - 1)].lease.load() != 0, name, "clock not started for a store without a lease");
+
+#if !defined(_WIN32)
+		// The process that claimed it exited
+		pid_t pid = fork();
+
+		if (pid == 0)
+		{
+			_exit(0);
+		}
+
+		int status = 0;
+		waitpid(pid, &status, 0);
+		claim_slot(cache, make_key(3), ktxpp::internal::make_shared_cache_lease((uint32_t)pid, now));
+		check(ktxpp::store_shared_texture(cache, make_key(3), file.data(), file.size(), true) == ktxpp::SharedCacheSuccess, name, "store of a dead process not taken over");
+		check(ktxpp::find_shared_texture(cache, make_key(3), texture), name, "texture stored past a dead store not found");
+#endif
+
+		ktxpp::close_shared_texture_cache(cache);
+		ktxpp::remove_shared_texture_cache(name);
+	}
+
+#if !defined(_WIN32)
+	// Segments left by a creator that died before sizing them or before initializing them are created again
+	void check_abandoned_segments(const char* name)
+	{
+		std::string path = std::string("/") + name;
+
+		for (uint32_t sized = 0; sized < 2; ++sized)
+		{
+			ktxpp::remove_shared_texture_cache(name);
+			int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+			check(fd >= 0 && (!sized || ftruncate(fd, 1 << 16) == 0), name, "could not leave a segment behind");
+			close(fd);
+
+			ktxpp::SharedTextureCache cache;
+			check(ktxpp::open_shared_texture_cache(cache, name, 1 << 20), name, sized ? "uninitialized segment not recovered" : "unsized segment not recovered");
+			check(cache.size == 1 << 20, name, "abandoned segment opened instead of a new one");
+			ktxpp::close_shared_texture_cache(cache);
+		}
+
+		ktxpp::remove_shared_texture_cache(name);
+	}
+
+	// Children open the segment themselves and race to store the same textures, each checking every one it finds
+	void check_processes(const char* name)
+	{
+		const uint32_t childCount = 4, textureCount = 64;
+		std::vector<pid_t> children;
+
+		for (uint32_t child = 0; child < childCount; ++child)
+		{
+			pid_t pid = fork();
+
+			if (pid == 0)
+			{
+				ktxpp::SharedTextureCache cache;
+
+				if (!ktxpp::open_shared_texture_cache(cache, name, 1 << 22))
+				{
+					_exit(2);
+				}
+
+				bool valid = true;
+
+				for (uint32_t i = 0; i < textureCount * 4; ++i)
+				{
+					uint32_t seed = 1000 + (i * 7 + child * 13) % textureCount;
+					std::vector<unsigned char> file = make_texture(seed);
+					ktxpp::SharedTexture texture;
+
+					if (ktxpp::find_shared_texture(cache, make_key(seed), texture))
+					{
+						valid &= matches(texture, file, true, std::vector<ktxpp::SharedCachePage>());
+					}
+					else
+					{
+						ktxpp::SharedCacheResult result = ktxpp::store_shared_texture(cache, make_key(seed), file.data(), file.size(), true);
+						valid &= result == ktxpp::SharedCacheSuccess || result == ktxpp::SharedCacheExists;
+					}
+				}
+
+				ktxpp::close_shared_texture_cache(cache);
+				_exit(valid ? 0 : 1);
+			}
+
+			children.push_back(pid);
+		}
+
+		bool exited = true;
+
+		for (pid_t pid : children)
+		{
+			int status = 0;
+			exited &= pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+
+		check(exited, name, "a child process failed or saw a different texture");
+
+		ktxpp::SharedTextureCache cache;
+		check(ktxpp::open_shared_texture_cache(cache, name, 1 << 22), name, "could not reopen");
+
+		if (cache.base)
+		{
+			bool found = true;
+
+			for (uint32_t seed = 1000; seed < 1000 + textureCount; ++seed)
+			{
+				ktxpp::SharedTexture texture;
+				found &= ktxpp::find_shared_texture(cache, make_key(seed), texture) && matches(texture, make_texture(seed), true, std::vector<ktxpp::SharedCachePage>());
+			}
+
+			check(found, name, "a texture stored by a child is missing");
+			check(ktxpp::get_shared_cache_stats(cache).stores == 20 + textureCount, name, "a texture was stored more than once");
+			ktxpp::close_shared_texture_cache(cache);
+		}
+	}
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "ktxpp_shared_cache_test_%u", get_process_id());
+	ktxpp::remove_shared_texture_cache(name);
+
+	ktxpp::SharedTextureCache writer, reader;
+
+	if (!ktxpp::open_shared_texture_cache(writer, name, 1 << 22) || !ktxpp::open_shared_texture_cache(reader, name, 1 << 10))
+	{
+		fprintf(stderr, "could not open %s\n", name);
+		return 1;
+	}
+
+	check(writer.base != reader.base && reader.size == writer.size, name, "second open didn't map the same segment");
+	check_round_trips(writer, reader);
+
+#if !defined(_WIN32)
+	check_processes(name);
+#endif
+
+	check_corpus(writer, reader, argc, argv);
+	ktxpp::close_shared_texture_cache(reader);
+	ktxpp::close_shared_texture_cache(writer);
+	ktxpp::remove_shared_texture_cache(name);
+
+	snprintf(name, sizeof(name), "ktxpp_shared_cache_test_full_%u", get_process_id());
+	check_full(name);
+
+	snprintf(name, sizeof(name), "ktxpp_shared_cache_test_abandoned_%u", get_process_id());
+	check_abandoned_stores(name);
+
+#if !defined(_WIN32)
+	check_abandoned_segments(name);
+#endif
+
+	return failures > 0 ? 1 : 0;
+}
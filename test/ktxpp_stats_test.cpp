@@ -0,0 +1,264 @@
+// Checks the texture statistics against a straightforward count on synthetic images with known ranges, alpha and
+// constant blocks, that threading doesn't change them, and that every supported texture in the corpus is analyzed
+
+#include "../ktxpp_stats.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	// Flat 8x8 patches in one half, noise in the other, with alpha either fully used, 0 or 255, or opaque
+	std::vector<unsigned char> make_image(uint32_t width, uint32_t height, uint32_t depth, uint32_t channelCount, uint32_t bytesPerChannel, uint32_t rowPitch, ktxpp::AlphaUsage alpha)
+	{
+		std::vector<unsigned char> data((size_t)rowPitch * height * depth, 0xcd);
+		uint32_t maxValue = bytesPerChannel == 1 ? 255 : 65535;
+
+		for (uint32_t z = 0; z < depth; ++z)
+		{
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					uint32_t noise = ((x + y * 131 + z * 977) * 2654435761u) >> 11;
+					bool flat = x < width / 2;
+
+					for (uint32_t channel = 0; channel < channelCount; ++channel)
+					{
+						uint32_t value = flat ? (x / 8 * 40 + y / 8 * 13 + channel * 50 + z) % 200 + 10 : (noise >> (channel * 3)) % 180 + 20;
+
+						if (bytesPerChannel == 2)
+						{
+							value = value * 257 + (flat ? 0 : noise % 200);
+						}
+
+						if (channel == channelCount - 1 && alpha == ktxpp::AlphaOpaque)
+						{
+							value = maxValue;
+						}
+						else if (channel == channelCount - 1 && alpha == ktxpp::AlphaBinary)
+						{
+							value = (x / 8 + y / 8) % 2 ? maxValue : 0;
+						}
+
+						unsigned char* destination = data.data() + ((size_t)z * height + y) * rowPitch + ((size_t)x * channelCount + channel) * bytesPerChannel;
+						memcpy(destination, &value, bytesPerChannel);
+					}
+				}
+			}
+		}
+
+		return data;
+	}
+
+	// The same statistics by brute force
+	void count_stats(const ktxpp::ImageView& image, const ktxpp::StatsOptions& options, ktxpp::ImageStats& stats, bool& binaryAlpha)
+	{
+		uint64_t sums[4] = {};
+		stats.channelCount = image.channelCount;
+		binaryAlpha = true;
+
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			stats.channels[channel].minimum = 0xffffffffu;
+			stats.channels[channel].maximum = 0;
+		}
+
+		uint32_t maxValue = image.bytesPerChannel == 1 ? 255 : 65535;
+
+		for (uint32_t z = 0; z < image.depth; ++z)
+		{
+			for (uint32_t y = 0; y < image.height; ++y)
+			{
+				for (uint32_t x = 0; x < image.width; ++x)
+				{
+					for (uint32_t channel = 0; channel < image.channelCount; ++channel)
+					{
+						const unsigned char* source = image.data + ((size_t)z * image.height + y) * image.rowPitch + ((size_t)x * image.channelCount + channel) * image.bytesPerChannel;
+						uint32_t value = ktxpp::internal::read_channel(source, image.bytesPerChannel);
+						sums[channel] += value;
+						stats.channels[channel].minimum = std::min(stats.channels[channel].minimum, value);
+						stats.channels[channel].maximum = std::max(stats.channels[channel].maximum, value);
+
+						if (channel == image.channelCount - 1)
+						{
+							binaryAlpha &= value == 0 || value == maxValue;
+						}
+					}
+				}
+			}
+		}
+
+		for (uint32_t channel = 0; channel < image.channelCount; ++channel)
+		{
+			stats.channels[channel].mean = (double)sums[channel] / ((double)image.width * image.height * image.depth);
+		}
+
+		size_t pixelBytes = (size_t)image.channelCount * image.bytesPerChannel;
+		uint32_t widthInBlocks = (image.width + options.blockWidth - 1) / options.blockWidth;
+		uint32_t heightInBlocks = (image.height + options.blockHeight - 1) / options.blockHeight;
+		stats.blockCount = (uint64_t)widthInBlocks * heightInBlocks * image.depth;
+		stats.constantBlockCount = 0;
+		stats.constantBlocks.assign((size_t)stats.blockCount, 0);
+
+		for (uint64_t block = 0; block < stats.blockCount; ++block)
+		{
+			uint32_t z = (uint32_t)(block / widthInBlocks / heightInBlocks);
+			uint32_t blockY = (uint32_t)(block / widthInBlocks % heightInBlocks) * options.blockHeight;
+			uint32_t blockX = (uint32_t)(block % widthInBlocks) * options.blockWidth;
+			const unsigned char* first = image.data + ((size_t)z * image.height + blockY) * image.rowPitch + blockX * pixelBytes;
+			bool constant = true;
+
+			for (uint32_t y = blockY; y < std::min(blockY + options.blockHeight, image.height); ++y)
+			{
+				for (uint32_t x = blockX; x < std::min(blockX + options.blockWidth, image.width); ++x)
+				{
+					constant &= memcmp(first, image.data + ((size_t)z * image.height + y) * image.rowPitch + x * pixelBytes, pixelBytes) == 0;
+				}
+			}
+
+			stats.constantBlocks[(size_t)block] = constant;
+			stats.constantBlockCount += constant;
+		}
+	}
+
+	void check_image(const char* context, uint32_t width, uint32_t height, uint32_t depth, uint32_t channelCount, uint32_t bytesPerChannel, uint32_t padding, ktxpp::AlphaUsage alpha, uint32_t blockWidth, uint32_t blockHeight)
+	{
+		uint32_t rowPitch = width * channelCount * bytesPerChannel + padding;
+		std::vector<unsigned char> data = make_image(width, height, depth, channelCount, bytesPerChannel, rowPitch, alpha);
+		ktxpp::ImageView image = { data.data(), width, height, depth, rowPitch, channelCount, bytesPerChannel };
+
+		ktxpp::StatsOptions options;
+		options.blockWidth = blockWidth;
+		options.blockHeight = blockHeight;
+		options.blockMask = true;
+
+		ktxpp::ImageStats expected, stats, threaded;
+		bool binaryAlpha;
+		count_stats(image, options, expected, binaryAlpha);
+
+		int alphaChannel = alpha == ktxpp::AlphaNone ? -1 : (int)channelCount - 1;
+		check(ktxpp::analyze_image(image, alphaChannel, options, stats) == ktxpp::StatsSuccess, context, "not analyzed");
+		options.threadCount = 4;
+		check(ktxpp::analyze_image(image, alphaChannel, options, threaded) == ktxpp::StatsSuccess, context, "not analyzed on threads");
+
+		bool ranges = stats.channelCount == channelCount;
+
+		for (uint32_t channel = 0; channel < channelCount; ++channel)
+		{
+			const ktxpp::ChannelStats& channelStats = stats.channels[channel];
+			const ktxpp::ChannelStats& expectedStats = expected.channels[channel];
+			ranges &= channelStats.minimum == expectedStats.minimum && channelStats.maximum == expectedStats.maximum;
+			ranges &= std::fabs(channelStats.mean - expectedStats.mean) < 1e-9 && channelStats.constant == (expectedStats.minimum == expectedStats.maximum);
+			ranges &= channelStats.minimum == threaded.channels[channel].minimum && channelStats.mean == threaded.channels[channel].mean;
+		}
+
+		check(ranges, context, "wrong channel statistics");
+		check(stats.alpha == alpha && threaded.alpha == alpha, context, "wrong alpha usage");
+		check(alpha != ktxpp::AlphaBinary || binaryAlpha, context, "alpha not binary");
+		check(stats.blockCount == expected.blockCount && stats.constantBlockCount == expected.constantBlockCount, context, "wrong constant block count");
+		check(stats.constantBlocks == expected.constantBlocks && threaded.constantBlocks == expected.constantBlocks, context, "wrong constant block mask");
+		check(expected.constantBlockCount > 0 && expected.constantBlockCount < expected.blockCount, context, "image has no mix of constant blocks");
+	}
+
+	void check_errors()
+	{
+		unsigned char pixel[4] = {};
+		ktxpp::ImageView image = { pixel, 1, 1, 1, 4, 4, 1 };
+		ktxpp::StatsOptions options;
+		ktxpp::ImageStats stats;
+
+		check(ktxpp::analyze_image(image, 3, options, stats) == ktxpp::StatsSuccess && stats.alpha == ktxpp::AlphaBinary, "errors", "black pixel not binary alpha");
+		check(stats.blockCount == 1 && stats.constantBlockCount == 1 && stats.constantBlocks.empty(), "errors", "single pixel not one constant block");
+
+		options.blockWidth = 0;
+		check(ktxpp::analyze_image(image, 3, options, stats) == ktxpp::StatsUnsupportedFormat, "errors", "block width of 0 accepted");
+
+		options.blockWidth = 4;
+		image.bytesPerChannel = 4;
+		check(ktxpp::analyze_image(image, 3, options, stats) == ktxpp::StatsUnsupportedFormat, "errors", "32-bit channels accepted");
+
+		std::vector<ktxpp::ImageStats> textureStats;
+		check(ktxpp::analyze_texture(pixel, sizeof(pixel), options, textureStats) == ktxpp::StatsInvalidTexture, "errors", "invalid texture accepted");
+	}
+
+	void check_corpus_file(const char* path)
+	{
+		std::vector<unsigned char> file;
+
+		if (!read_file(path, file))
+		{
+			check(false, path, "could not read file");
+			return;
+		}
+
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess)
+		{
+			return;
+		}
+
+		ktxpp::internal::HeaderKTX header;
+		memcpy(&header, file.data(), sizeof(header));
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), layout.data());
+
+		ktxpp::ImageView view;
+
+		if (!ktxpp::get_image_view(desc, file.data(), layout[0], view))
+		{
+			return;
+		}
+
+		ktxpp::StatsOptions options;
+		options.blockMask = true;
+		options.threadCount = 0;
+		std::vector<ktxpp::ImageStats> stats;
+
+		if (ktxpp::analyze_texture(file.data(), file.size(), options, stats) != ktxpp::StatsSuccess || stats.size() != layout.size())
+		{
+			check(false, path, "not analyzed");
+			return;
+		}
+
+		bool same = true;
+
+		for (size_t i = 0; i < layout.size(); ++i)
+		{
+			ktxpp::ImageStats expected;
+			bool binaryAlpha;
+			ktxpp::get_image_view(desc, file.data(), layout[i], view);
+			count_stats(view, options, expected, binaryAlpha);
+
+			for (uint32_t channel = 0; channel < view.channelCount; ++channel)
+			{
+				same &= stats[i].channels[channel].minimum == expected.channels[channel].minimum && stats[i].channels[channel].maximum == expected.channels[channel].maximum;
+			}
+
+			same &= stats[i].constantBlocks == expected.constantBlocks;
+			same &= (stats[i].alpha == ktxpp::AlphaNone) == (ktxpp::get_alpha_channel(desc) < 0);
+		}
+
+		check(same, path, "statistics differ from a plain count");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	check_image("rgba8 full alpha", 70, 45, 1, 4, 1, 0, ktxpp::AlphaFull, 4, 4);
+	check_image("rgba8 binary alpha padded", 67, 130, 1, 4, 1, 5, ktxpp::AlphaBinary, 4, 4);
+	check_image("rgba8 opaque astc 6x6", 100, 61, 1, 4, 1, 0, ktxpp::AlphaOpaque, 6, 6);
+	check_image("rgb8 3D", 33, 20, 3, 3, 1, 3, ktxpp::AlphaNone, 4, 4);
+	check_image("rg8", 200, 9, 1, 2, 1, 0, ktxpp::AlphaNone, 8, 8);
+	check_image("la16 binary alpha", 41, 70, 1, 2, 2, 2, ktxpp::AlphaBinary, 4, 4);
+	check_image("rgba16 opaque", 24, 24, 2, 4, 2, 0, ktxpp::AlphaOpaque, 5, 4);
+	check_errors();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		check_corpus_file(argv[i]);
+	}
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+// Compresses a mipmapped array with every scheme this build supports, then decompresses its subresources one at a
+// time, out of order and on several threads, into a file that has to match the original byte for byte
+
+#include "../ktxpp_supercompression.h"
+#include "ktxpp_test_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// Runs of repeated bytes so every codec has something to find, numbered per subresource so data decompressed
+	// into the wrong place shows up
+	void fill_texture(const std::vector<ktxpp::Subresource>& layout, std::vector<unsigned char>& file)
+	{
+		for (size_t index = 0; index < layout.size(); ++index)
+		{
+			for (uint64_t i = 0; i < layout[index].size; ++i)
+			{
+				file[(size_t)(layout[index].offset + i)] = (unsigned char)((i / 16) * 3 + index * 29);
+			}
+		}
+	}
+
+	bool decompress_in_order(ktxpp::SupercompressionScheme scheme, const std::vector<size_t>& order, const std::vector<ktxpp::SupercompressedRange>& ranges, const std::vector<unsigned char>& compressed,
+		const std::vector<ktxpp::Subresource>& layout, std::vector<unsigned char>& file)
+	{
+		bool success = true;
+
+		for (size_t index : order)
+		{
+			success &= ktxpp::decompress_subresource(scheme, ranges[index], compressed.data(), layout[index], file.data());
+		}
+
+		return success;
+	}
+
+	// Threads take the next subresource of the order as soon as they're done with one
+	bool decompress_on_threads(ktxpp::SupercompressionScheme scheme, const std::vector<size_t>& order, const std::vector<ktxpp::SupercompressedRange>& ranges, const std::vector<unsigned char>& compressed,
+		const std::vector<ktxpp::Subresource>& layout, std::vector<unsigned char>& file)
+	{
+		std::atomic<size_t> next(0);
+		std::atomic<uint32_t> errors(0);
+		std::vector<std::thread> threads;
+
+		for (uint32_t t = 0; t < 4; ++t)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				for (size_t i = next++; i < order.size(); i = next++)
+				{
+					errors += !ktxpp::decompress_subresource(scheme, ranges[order[i]], compressed.data(), layout[order[i]], file.data());
+				}
+			}));
+		}
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		return errors == 0;
+	}
+
+	void check_scheme(const char* context, ktxpp::SupercompressionScheme scheme)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		const std::vector<unsigned char> blank = make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 37, 21, 0, ktxpp::Texture2D, 6, 3, desc, layout);
+		std::vector<unsigned char> original = blank;
+		fill_texture(layout, original);
+
+		uint64_t bound = ktxpp::get_supercompression_bound(scheme, desc, layout.data());
+		std::vector<unsigned char> compressed((size_t)bound);
+		std::vector<ktxpp::SupercompressedRange> ranges(layout.size());
+		uint64_t compressedSize = ktxpp::supercompress_texture(scheme, 0, desc, layout.data(), original.data(), ranges.data(), compressed.data(), compressed.size());
+
+		check(compressedSize > 0 && compressedSize <= bound, context, "compressed size is outside the bound");
+
+		if (compressedSize == 0)
+		{
+			return;
+		}
+
+		uint64_t offset = 0;
+		uint64_t imageSize = 0;
+
+		for (size_t i = 0; i < layout.size(); ++i)
+		{
+			check(ranges[i].byteOffset == offset && ranges[i].uncompressedByteLength == layout[i].size, context, "ranges aren't back to back in subresource order");
+			offset += ranges[i].byteLength;
+			imageSize += layout[i].size;
+		}
+
+		check(offset == compressedSize, context, "ranges don't add up to the compressed size");
+		check(scheme != ktxpp::SupercompressionNone || compressedSize == imageSize, context, "stored size differs from the images");
+		check(scheme == ktxpp::SupercompressionNone || compressedSize < imageSize, context, "nothing was compressed");
+
+		// Back to front, one subresource at a time
+		std::vector<size_t> order(layout.size());
+
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = order.size() - 1 - i;
+		}
+
+		std::vector<unsigned char> file = blank;
+		check(decompress_in_order(scheme, order, ranges, compressed, layout, file), context, "reverse decompression failed");
+		check(file == original, context, "reverse decompression differs");
+
+		// Shuffled, then shuffled across threads
+		std::mt19937 random(1234);
+		std::shuffle(order.begin(), order.end(), random);
+
+		file = blank;
+		check(decompress_in_order(scheme, order, ranges, compressed, layout, file), context, "shuffled decompression failed");
+		check(file == original, context, "shuffled decompression differs");
+
+		for (uint32_t pass = 0; pass < 8; ++pass)
+		{
+			std::shuffle(order.begin(), order.end(), random);
+
+			file = blank;
+			check(decompress_on_threads(scheme, order, ranges, compressed, layout, file), context, "threaded decompression failed");
+			check(file == original, context, "threaded decompression differs");
+		}
+
+		// A range has to describe the subresource it's decompressed into, in full
+		ktxpp::SupercompressedRange range = ranges[0];
+		range.uncompressedByteLength--;
+		check(!ktxpp::decompress_subresource(scheme, range, compressed.data(), layout[0], file.data()), context, "a range of the wrong size was accepted");
+		check(!ktxpp::decompress_subresource(scheme, ranges.back(), compressed.data(), layout[0], file.data()), context, "the range of a smaller mip was accepted");
+
+		range = ranges[0];
+		range.byteLength--;
+		check(!ktxpp::decompress_subresource(scheme, range, compressed.data(), layout[0], file.data()), context, "truncated data was accepted");
+
+		// Too little room fails rather than writing past the end
+		check(ktxpp::supercompress_texture(scheme, 0, desc, layout.data(), original.data(), ranges.data(), compressed.data(), 16) == 0, context, "compression into too small a buffer succeeded");
+	}
+}
+
+int main()
+{
+	const struct
+	{
+		const char* name;
+		ktxpp::SupercompressionScheme scheme;
+	}
+	schemes[] =
+	{
+		{ "none", ktxpp::SupercompressionNone },
+		{ "zstd", ktxpp::SupercompressionZstd },
+		{ "zlib", ktxpp::SupercompressionZLIB },
+		{ "lz4",  ktxpp::SupercompressionLZ4 },
+	};
+
+	for (const auto& entry : schemes)
+	{
+		if (ktxpp::is_supercompression_supported(entry.scheme))
+		{
+			printf("Scheme %s\n", entry.name);
+			check_scheme(entry.name, entry.scheme);
+		}
+	}
+
+	// BasisLZ is a transcoder format, not a codec ktxpp can run
+	unsigned char data[4] = {};
+	unsigned char compressed[64];
+	check(!ktxpp::is_supercompression_supported(ktxpp::SupercompressionBasisLZ), "BasisLZ reported as supported");
+	check(ktxpp::supercompress(ktxpp::SupercompressionBasisLZ, 0, data, sizeof(data), compressed, sizeof(compressed)) == 0, "BasisLZ compression succeeded");
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+// Morton and tiled swizzles against a plain per-bit reference, round tripped through padded rows. Built twice, with
+// and without BMI2, so both the pdep/pext and the portable bit loops are covered
+
+#include "../ktxpp.h"
+#include "ktxpp_test_util.h"
+
+#if defined(ktxpp_bmi2)
+#include "../ktxpp_dispatch.h"
+#endif
+
+namespace
+{
+	const unsigned char Untouched = 0xEE;
+
+	// Bit i of x and y go to the next free bits of the index in turn, until the smaller dimension runs out of bits
+	uint32_t reference_morton(uint32_t x, uint32_t y, uint32_t widthInBlocks, uint32_t heightInBlocks)
+	{
+		uint32_t widthLog2 = 0, heightLog2 = 0;
+		while ((1u << widthLog2) < widthInBlocks) { widthLog2++; }
+		while ((1u << heightLog2) < heightInBlocks) { heightLog2++; }
+
+		uint32_t index = 0;
+		uint32_t bit = 0;
+
+		for (uint32_t i = 0; i < 32; ++i)
+		{
+			if (i < widthLog2)  { index |= ((x >> i) & 1) << bit++; }
+			if (i < heightLog2) { index |= ((y >> i) & 1) << bit++; }
+		}
+
+		return index;
+	}
+
+	uint64_t reference_tiled(uint32_t x, uint32_t y, uint32_t widthInBlocks, uint32_t tileWidth, uint32_t tileHeight)
+	{
+		uint32_t tilesX = (widthInBlocks + tileWidth - 1) / tileWidth;
+		uint64_t tile = (uint64_t)(y / tileHeight) * tilesX + x / tileWidth;
+		return tile * tileWidth * tileHeight + (y % tileHeight) * tileWidth + x % tileWidth;
+	}
+
+	// Every byte differs from its neighbours and from the marker left in padding
+	std::vector<unsigned char> make_linear(uint32_t rowPitch, uint32_t heightInBlocks)
+	{
+		std::vector<unsigned char> linear((size_t)rowPitch * heightInBlocks);
+
+		for (size_t i = 0; i < linear.size(); ++i)
+		{
+			linear[i] = (unsigned char)(i * 7 + 1) == Untouched ? 0 : (unsigned char)(i * 7 + 1);
+		}
+
+		return linear;
+	}
+
+	// Blocks must land where index says and nowhere else, and the way back must restore them without writing to
+	// the padding at the end of each row
+	template<typename Index>
+	void check_swizzled(const std::string& context, const std::vector<unsigned char>& linear, const std::vector<unsigned char>& swizzled, const std::vector<unsigned char>& roundTrip,
+		uint32_t rowPitch, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, Index index)
+	{
+		std::vector<bool> used(swizzled.size() / bytesPerBlock);
+		bool placed = true;
+
+		for (uint32_t y = 0; y < heightInBlocks; ++y)
+		{
+			for (uint32_t x = 0; x < widthInBlocks; ++x)
+			{
+				uint64_t block = index(x, y);
+				placed &= block < used.size() && memcmp(&swizzled[(size_t)(block * bytesPerBlock)], &linear[(size_t)y * rowPitch + x * bytesPerBlock], bytesPerBlock) == 0;
+
+				if (block < used.size())
+				{
+					used[(size_t)block] = true;
+				}
+			}
+		}
+
+		check(placed, context, "a block isn't where the reference puts it");
+
+		bool padding = true;
+
+		for (size_t block = 0; block < used.size(); ++block)
+		{
+			for (uint32_t i = 0; !used[block] && i < bytesPerBlock; ++i)
+			{
+				padding &= swizzled[block * bytesPerBlock + i] == Untouched;
+			}
+		}
+
+		check(padding, context, "padding of the swizzled image was written");
+
+		bool restored = true;
+		uint32_t rowSize = widthInBlocks * bytesPerBlock;
+
+		for (uint32_t y = 0; y < heightInBlocks; ++y)
+		{
+			restored &= memcmp(&roundTrip[(size_t)y * rowPitch], &linear[(size_t)y * rowPitch], rowSize) == 0;
+
+			for (uint32_t i = rowSize; i < rowPitch; ++i)
+			{
+				restored &= roundTrip[(size_t)y * rowPitch + i] == Untouched;
+			}
+		}
+
+		check(restored, context, "round trip differs");
+	}
+
+	void check_morton(uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock)
+	{
+		std::string context = "morton " + std::to_string(widthInBlocks) + "x" + std::to_string(heightInBlocks) + " " + std::to_string(bytesPerBlock) + " bytes";
+
+		// Codes cover exactly the padded power of two rectangle and decode back
+		uint64_t blockCount = ktxpp::get_morton_size(widthInBlocks, heightInBlocks, bytesPerBlock) / bytesPerBlock;
+		bool encoded = true;
+		bool decoded = true;
+
+		for (uint32_t y = 0; y < heightInBlocks; ++y)
+		{
+			for (uint32_t x = 0; x < widthInBlocks; ++x)
+			{
+				uint32_t index = ktxpp::morton_encode(x, y, widthInBlocks, heightInBlocks);
+				encoded &= index == reference_morton(x, y, widthInBlocks, heightInBlocks) && index < blockCount;
+
+				uint32_t decodedX = ~0u, decodedY = ~0u;
+				ktxpp::morton_decode(index, widthInBlocks, heightInBlocks, decodedX, decodedY);
+				decoded &= decodedX == x && decodedY == y;
+			}
+		}
+
+		check(encoded, context, "morton_encode differs from the reference");
+		check(decoded, context, "morton_decode doesn't invert morton_encode");
+
+		// Odd padding so rows are never aligned
+		uint32_t rowPitch = widthInBlocks * bytesPerBlock + 3;
+		std::vector<unsigned char> linear = make_linear(rowPitch, heightInBlocks);
+		std::vector<unsigned char> swizzled((size_t)blockCount * bytesPerBlock, Untouched);
+		std::vector<unsigned char> roundTrip(linear.size(), Untouched);
+
+		ktxpp::swizzle_morton(linear.data(), rowPitch, swizzled.data(), widthInBlocks, heightInBlocks, bytesPerBlock);
+		ktxpp::deswizzle_morton(swizzled.data(), roundTrip.data(), rowPitch, widthInBlocks, heightInBlocks, bytesPerBlock);
+
+		check_swizzled(context, linear, swizzled, roundTrip, rowPitch, widthInBlocks, heightInBlocks, bytesPerBlock, [&](uint32_t x, uint32_t y)
+		{
+			return (uint64_t)reference_morton(x, y, widthInBlocks, heightInBlocks);
+		});
+	}
+
+	void check_tiled(uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t bytesPerBlock, uint32_t tileWidth, uint32_t tileHeight)
+	{
+		std::string context = "tiled " + std::to_string(widthInBlocks) + "x" + std::to_string(heightInBlocks) + " " + std::to_string(bytesPerBlock) + " bytes in " +
+			std::to_string(tileWidth) + "x" + std::to_string(tileHeight) + " tiles";
+
+		uint32_t rowPitch = widthInBlocks * bytesPerBlock + 3;
+		std::vector<unsigned char> linear = make_linear(rowPitch, heightInBlocks);
+		std::vector<unsigned char> swizzled((size_t)ktxpp::get_tiled_size(widthInBlocks, heightInBlocks, bytesPerBlock, tileWidth, tileHeight), Untouched);
+		std::vector<unsigned char> roundTrip(linear.size(), Untouched);
+
+		ktxpp::swizzle_tiled(linear.data(), rowPitch, swizzled.data(), widthInBlocks, heightInBlocks, bytesPerBlock, tileWidth, tileHeight);
+		ktxpp::deswizzle_tiled(swizzled.data(), roundTrip.data(), rowPitch, widthInBlocks, heightInBlocks, bytesPerBlock, tileWidth, tileHeight);
+
+		check_swizzled(context, linear, swizzled, roundTrip, rowPitch, widthInBlocks, heightInBlocks, bytesPerBlock, [&](uint32_t x, uint32_t y)
+		{
+			return reference_tiled(x, y, widthInBlocks, tileWidth, tileHeight);
+		});
+	}
+}
+
+int main()
+{
+#if defined(ktxpp_bmi2)
+	// Built for BMI2 but running on a CPU without it
+	int registers[4];
+	ktxpp::internal::cpuid(7, 0, registers);
+
+	if ((registers[1] & (1 << 8)) == 0)
+	{
+		printf("Skipping, no BMI2\n");
+		return 77;
+	}
+
+	printf("Morton bits with pdep/pext\n");
+#else
+	printf("Morton bits with loops\n");
+#endif
+
+	// Known answers, x in the even bits and y in the odd ones while both have bits left
+	check(ktxpp::morton_encode(3, 5, 8, 8) == 39, "morton_encode(3, 5) of 8x8");
+	check(ktxpp::morton_encode(7, 1, 16, 2) == 15, "morton_encode(7, 1) of 16x2");
+	check(ktxpp::morton_encode(0, 3, 1, 4) == 3, "morton_encode(0, 3) of 1x4");
+
+	const uint32_t sizes[][2] = { { 1, 1 }, { 3, 5 }, { 17, 4 }, { 64, 2 } };
+	const uint32_t bytesPerBlock[] = { 1, 4, 8, 16 };
+	const uint32_t tiles[][2] = { { 1, 1 }, { 4, 4 }, { 3, 2 }, { 8, 1 }, { 5, 7 } };
+
+	for (const uint32_t* size : sizes)
+	{
+		for (uint32_t bytes : bytesPerBlock)
+		{
+			check_morton(size[0], size[1], bytes);
+
+			for (const uint32_t* tile : tiles)
+			{
+				check_tiled(size[0], size[1], bytes, tile[0], tile[1]);
+			}
+		}
+	}
+
+	return failures > 0 ? 1 : 0;
+}
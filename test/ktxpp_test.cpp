@@ -0,0 +1,157 @@
+// Checks a single KTX file from the corpus: validation, layout, truncation and a lossless round trip through KTX2.
+// Returns 0 on success, 1 on failure and 77 when ktxpp doesn't support the format yet so CTest reports it as skipped
+//
+// Usage: ktxpp_test file.ktx
+
+#include "../ktxpp_convert.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	// Compares every row of every subresource of a KTX 1.1 file with the same subresource in its KTX2 conversion
+	bool compare_images(const ktxpp::Descriptor& desc, const std::vector<unsigned char>& ktx1, const ktxpp::Subresource* layout1, const std::vector<unsigned char>& ktx2, ktxpp::SupercompressionScheme scheme)
+	{
+		ktxpp::Descriptor desc2;
+
+		if (ktxpp::validate_header_ktx2(ktx2.data(), ktx2.size(), desc2) != ktxpp::ValidationSuccess)
+		{
+			return false;
+		}
+
+		const ktxpp::internal::LevelIndexKTX2* levels = ktxpp::decode_header_ktx2(ktx2.data(), desc2);
+
+		if (desc2.vkFormat != desc.vkFormat || ktxpp::get_subresource_count(desc2) != ktxpp::get_subresource_count(desc))
+		{
+			return false;
+		}
+
+		bool supercompressed = scheme != ktxpp::SupercompressionNone;
+		std::vector<ktxpp::Subresource> layout2(ktxpp::get_subresource_count(desc2));
+		ktxpp::compute_subresource_layout_ktx2(desc2, levels, supercompressed, layout2.data());
+
+		for (uint32_t mip = 0; mip < ktxpp::get_mip_count(desc); ++mip)
+		{
+			ktxpp::internal::LevelIndexKTX2 level;
+			memcpy(&level, levels + mip, sizeof(level));
+
+			std::vector<unsigned char> decompressed;
+			const unsigned char* levelData = ktx2.data();
+
+			if (supercompressed)
+			{
+				decompressed.resize((size_t)level.uncompressedByteLength);
+
+				if (!ktxpp::decompress(scheme, ktx2.data() + level.byteOffset, level.byteLength, decompressed.data(), decompressed.size()))
+				{
+					return false;
+				}
+
+				levelData = decompressed.data();
+			}
+
+			uint32_t widthInBlocks, heightInBlocks;
+			ktxpp::get_mip_size_in_blocks(desc, mip, widthInBlocks, heightInBlocks);
+			uint32_t rowSize = widthInBlocks * desc.bitsPerPixelOrBlock / 8;
+
+			for (uint32_t i = 0; i < desc.arraySize * ktxpp::get_face_count(desc); ++i)
+			{
+				uint32_t index = ktxpp::get_subresource_index(desc, mip, 0, 0) + i;
+				const ktxpp::Subresource& subresource1 = layout1[index];
+				const ktxpp::Subresource& subresource2 = layout2[index];
+
+				for (uint32_t row = 0; row < heightInBlocks * subresource1.depth; ++row)
+				{
+					const unsigned char* row1 = ktx1.data() + subresource1.offset + (uint64_t)row * subresource1.rowPitch;
+					const unsigned char* row2 = levelData + subresource2.offset + (uint64_t)row * subresource2.rowPitch;
+
+					if (memcmp(row1, row2, rowSize) != 0)
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		printf("Usage: ktxpp_test file.ktx\n");
+		return 1;
+	}
+
+	const char* path = argv[1];
+	std::vector<unsigned char> file;
+
+	if (!read_file(path, file))
+	{
+		fprintf(stderr, "%s: could not read file\n", path);
+		return 1;
+	}
+
+	ktxpp::Descriptor desc;
+	ktxpp::ValidationResult result = ktxpp::validate_header(file.data(), file.size(), desc);
+
+	if (result == ktxpp::ValidationUnsupportedFormat)
+	{
+		printf("%s: format 0x%x not supported yet (validation result %d)\n", path, desc.glInternalFormat, result);
+		return 77;
+	}
+
+	check(result == ktxpp::ValidationSuccess, path, "validation failed");
+
+	if (failures > 0)
+	{
+		return 1;
+	}
+
+	// The layout must account for the whole file, allowing for missing padding after the last level
+	ktxpp::internal::HeaderKTX header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+	uint64_t layoutSize = ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), layout.data());
+	check(layoutSize >= file.size() && layoutSize <= file.size() + 3, path, "layout size doesn't match the file size");
+
+	// Any truncation that cuts into image data must be rejected
+	const ktxpp::Subresource& last = layout.back();
+	ktxpp::Descriptor truncatedDesc;
+	check(ktxpp::validate_header(file.data(), last.offset + last.size - 1, truncatedDesc) == ktxpp::ValidationTruncated, path, "truncated image data accepted");
+	check(ktxpp::validate_header(file.data(), sizeof(header) - 1, truncatedDesc) == ktxpp::ValidationTruncated, path, "truncated header accepted");
+
+	// Round trip through KTX2, with every supercompression scheme this build supports
+	const ktxpp::SupercompressionScheme schemes[] = { ktxpp::SupercompressionNone, ktxpp::SupercompressionZstd, ktxpp::SupercompressionZLIB };
+
+	for (ktxpp::SupercompressionScheme scheme : schemes)
+	{
+		if (!ktxpp::is_supercompression_supported(scheme))
+		{
+			continue;
+		}
+
+		ktxpp::ConvertOptions options;
+		options.supercompression = scheme;
+		options.threadCount = 0;
+
+		std::vector<unsigned char> converted;
+		ktxpp::ConvertResult convertResult = ktxpp::convert_ktx1_to_ktx2(file.data(), file.size(), options, converted);
+
+		if (convertResult == ktxpp::ConvertUnsupportedFormat)
+		{
+			printf("%s: no KTX2 equivalent, skipping round trip\n", path);
+			break;
+		}
+
+		check(convertResult == ktxpp::ConvertSuccess, path, "conversion to KTX2 failed");
+		check(convertResult != ktxpp::ConvertSuccess || ktxpp::validate_header_ktx2(converted.data(), converted.size() - 1, truncatedDesc) == ktxpp::ValidationTruncated, path, "truncated KTX2 accepted");
+		check(convertResult != ktxpp::ConvertSuccess || compare_images(desc, file, layout.data(), converted, scheme), path, "KTX2 images differ from the source");
+	}
+
+	return failures > 0 ? 1 : 0;
+}
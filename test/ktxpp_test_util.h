@@ -0,0 +1,83 @@
+#pragma once
+
+// Helpers shared by the tests of the feature headers: failure counting, and synthetic textures laid out by ktxpp
+// itself so they match what readers expect byte for byte
+
+#include "../ktxpp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// main returns 1 when this isn't 0
+	int failures = 0;
+
+	inline void check(bool condition, const char* context, const char* message)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", context, message);
+			failures++;
+		}
+	}
+
+	inline void check(bool condition, const std::string& context, const char* message)
+	{
+		check(condition, context.c_str(), message);
+	}
+
+	inline void check(bool condition, const char* message)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s\n", message);
+			failures++;
+		}
+	}
+
+	inline bool read_file(const char* path, std::vector<unsigned char>& data)
+	{
+		FILE* fh = fopen(path, "rb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		fseek(fh, 0, SEEK_END);
+		long size = ftell(fh);
+		rewind(fh);
+
+		data.resize(size > 0 ? (size_t)size : 0);
+		bool success = size > 0 && fread(data.data(), 1, data.size(), fh) == data.size();
+		fclose(fh);
+
+		return success;
+	}
+
+	inline ktxpp::Descriptor make_descriptor(ktxpp::GLInternalFormat format, ktxpp::GLType type, ktxpp::GLFormat glFormat, uint32_t width, uint32_t height, uint32_t depth, ktxpp::TextureType textureType, uint32_t mipCount, uint32_t arraySize)
+	{
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(format, type, glFormat, glFormat, width, height, depth, textureType, mipCount, arraySize, header);
+
+		ktxpp::Descriptor desc;
+		ktxpp::decode_header(header, desc);
+		return desc;
+	}
+
+	// A whole file with zeroed images. desc and layout receive its descriptor and subresource table
+	inline std::vector<unsigned char> make_texture(ktxpp::GLInternalFormat format, ktxpp::GLType type, ktxpp::GLFormat glFormat, uint32_t width, uint32_t height, uint32_t depth, ktxpp::TextureType textureType,
+		uint32_t mipCount, uint32_t arraySize, ktxpp::Descriptor& desc, std::vector<ktxpp::Subresource>& layout)
+	{
+		ktxpp::internal::HeaderKTX header;
+		ktxpp::encode_header(format, type, glFormat, glFormat, width, height, depth, textureType, mipCount, arraySize, header);
+
+		ktxpp::decode_header(header, desc);
+		layout.assign(ktxpp::get_subresource_count(desc), ktxpp::Subresource());
+		std::vector<unsigned char> file((size_t)ktxpp::prepare_texture(header, desc, layout.data()));
+		ktxpp::write_texture_layout(header, desc, layout.data(), file.data());
+		return file;
+	}
+}
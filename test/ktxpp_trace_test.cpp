@@ -0,0 +1,171 @@
+// Built with ktxpp_instrument. Loads every file given on the command line through the blocking and async paths,
+// converts it and runs it through a pack, then checks the counters and the trace that came out
+
+#if !defined(ktxpp_instrument)
+	#define ktxpp_instrument
+#endif
+
+#include "../ktxpp_async.h"
+#include "../ktxpp_cache.h"
+#include "../ktxpp_convert.h"
+#include "../ktxpp_pack.h"
+#include "../ktxpp_trace.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	void on_header(void* userData, ktxpp::AsyncTexture&, uint32_t, ktxpp::AsyncStatus)
+	{
+		(*static_cast<uint32_t*>(userData))++;
+	}
+
+	// Nothing else may report while a stage is measured, so count hook calls
+	void count_event(void* userData, const ktxpp::StageEvent& event)
+	{
+		uint32_t* counts = static_cast<uint32_t*>(userData);
+		counts[event.stage]++;
+	}
+
+	// Stands in for a stage that calls into itself, e.g. a conversion supercompressing
+	void parse_nested(uint32_t depth)
+	{
+		ktxpp_stage(StageParse, "parse_nested");
+		ktxpp_stage_work(10, 1);
+
+		if (depth > 0)
+		{
+			parse_nested(depth - 1);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ktxpp::reset_instrument_counters();
+
+	ktxpp::TraceRecorder recorder;
+	ktxpp::start_trace(recorder);
+
+	uint64_t fileBytes = 0;
+	uint32_t validated = 0, converted = 0, headersRead = 0;
+	std::vector<std::vector<unsigned char> > files(argc); // The pack builder only keeps pointers
+	ktxpp::PackBuilder builder;
+	ktxpp::AsyncLoader loader;
+	std::vector<ktxpp::AsyncTexture*> textures;
+	ktxpp::initialize_async_loader(loader);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		read_file(argv[i], files[i]);
+		const std::vector<unsigned char>& file = files[i];
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess)
+		{
+			continue;
+		}
+
+		validated++;
+		fileBytes += file.size();
+
+		ktxpp::ConvertOptions options;
+		options.threadCount = 2;
+		std::vector<unsigned char> ktx2;
+		converted += ktxpp::convert_ktx1_to_ktx2(file.data(), file.size(), options, ktx2) == ktxpp::ConvertSuccess ? 1 : 0;
+
+		ktxpp::add_pack_texture(builder, argv[i], file.data(), file.size());
+		textures.push_back(ktxpp::async_open_texture(loader, argv[i], on_header, &headersRead));
+	}
+
+	ktxpp::wait_async_loader(loader);
+
+	for (ktxpp::AsyncTexture* texture : textures)
+	{
+		ktxpp::async_close_texture(loader, texture);
+	}
+
+	ktxpp::release_async_loader(loader);
+
+	std::vector<unsigned char> packData;
+	ktxpp::Pack pack;
+	check(ktxpp::build_pack(builder, packData) == ktxpp::PackSuccess && ktxpp::open_pack(pack, packData.data(), packData.size()) == ktxpp::PackSuccess, "pack not built");
+
+	ktxpp::EncodeCache cache;
+	std::vector<unsigned char> loaded;
+	ktxpp::Hash128 key = ktxpp::hash_data(packData.data(), packData.size());
+
+	if (ktxpp::open_encode_cache(cache, "ktxpp_trace_test_cache", 1 << 20))
+	{
+		ktxpp::trim_encode_cache(cache, 0);
+		ktxpp::load_encode_cache(cache, key, loaded);
+		ktxpp::store_encode_cache(cache, key, "entry", 5);
+		ktxpp::load_encode_cache(cache, key, loaded);
+		ktxpp::trim_encode_cache(cache, 0);
+	}
+
+	ktxpp::stop_trace(recorder);
+
+	ktxpp::InstrumentCounters counters = ktxpp::get_instrument_counters();
+	check(counters.stages[ktxpp::StageParse].calls >= (uint64_t)(argc - 1) && counters.stages[ktxpp::StageParse].bytes > 0, "header parses not counted");
+	check(counters.stages[ktxpp::StageLayout].calls >= converted, "layouts not counted");
+	check(counters.stages[ktxpp::StageConvert].calls >= validated && counters.stages[ktxpp::StageConvert].bytes >= fileBytes, "conversions not counted");
+	check(counters.stages[ktxpp::StageIO].calls >= headersRead + 3 && counters.stages[ktxpp::StageIO].bytes >= headersRead * 64 + 5, "reads not counted");
+	check(counters.cacheHits == 1 && counters.cacheMisses == 1, "cache lookups not counted");
+	check(converted > 0 && headersRead == validated, "corpus not loaded");
+
+	// Every stage event landed in the recorder, and the trace is well formed enough to have them all
+	uint64_t calls = 0;
+
+	for (uint32_t stage = 0; stage < ktxpp::StageCount; ++stage)
+	{
+		calls += counters.stages[stage].calls;
+	}
+
+	check(recorder.events.size() == calls && recorder.droppedEvents == 0, "trace events missing");
+
+	std::string json;
+	ktxpp::write_chrome_trace(recorder, json);
+	size_t complete = 0, asyncBegin = 0, position = 0;
+
+	while ((position = json.find("\"ph\":\"X\"", position)) != std::string::npos) { complete++; position++; }
+	position = 0;
+	while ((position = json.find("\"ph\":\"b\"", position)) != std::string::npos) { asyncBegin++; position++; }
+
+	check(complete + asyncBegin == calls && asyncBegin == counters.stages[ktxpp::StageIO].calls, "trace JSON lacks events");
+	check(json.compare(0, 16, "{\"traceEvents\":[") == 0 && json.find(",\n]") == std::string::npos && json.find("\"cat\":\"parse\"") != std::string::npos, "trace JSON malformed");
+
+	// Hooks see nested stages too, and nothing once removed
+	uint32_t counts[ktxpp::StageCount] = {};
+	ktxpp::TraceHooks hooks = { counts, count_event };
+	std::vector<unsigned char> file;
+
+	if (argc > 1)
+	{
+		read_file(argv[argc - 1], file);
+	}
+	ktxpp::Descriptor desc;
+
+	ktxpp::set_trace_hooks(&hooks);
+	ktxpp::validate_header(file.data(), file.size(), desc);
+	ktxpp::set_trace_hooks(nullptr);
+	ktxpp::validate_header(file.data(), file.size(), desc);
+	check(counts[ktxpp::StageParse] == 1 && counts[ktxpp::StageIO] == 0, "hooks called wrongly");
+
+	ktxpp::reset_instrument_counters();
+	check(ktxpp::get_instrument_counters().stages[ktxpp::StageParse].calls == 0, "counters not reset");
+
+	// Scopes within the same stage are recorded once, for the outermost, with the work of all of them
+	counts[ktxpp::StageParse] = 0;
+	ktxpp::set_trace_hooks(&hooks);
+	parse_nested(2);
+	parse_nested(0);
+	ktxpp::set_trace_hooks(nullptr);
+	counters = ktxpp::get_instrument_counters();
+	check(counts[ktxpp::StageParse] == 2 && counters.stages[ktxpp::StageParse].calls == 2, "nested stage recorded twice");
+	check(counters.stages[ktxpp::StageParse].bytes == 40 && counters.stages[ktxpp::StageParse].texels == 4, "work of a nested stage lost");
+
+	return failures > 0 ? 1 : 0;
+}
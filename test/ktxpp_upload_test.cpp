@@ -0,0 +1,187 @@
+// Plans uploads for synthetic textures and the corpus under Vulkan and D3D12 style alignments, checks every region
+// against those constraints and against each other, and checks that the staging buffer holds the same rows as the file
+
+#include "../ktxpp_upload.h"
+#include "ktxpp_test_util.h"
+
+#include <cstdio>
+
+namespace
+{
+	// Every region aligned, inside the buffer, clear of the one before and holding exactly the rows of its subresource
+	void check_plan(const char* context, const ktxpp::Descriptor& desc, const ktxpp::Subresource* subresources, const unsigned char* fileData, const ktxpp::UploadAlignment& alignment)
+	{
+		ktxpp::UploadPlan plan;
+
+		if (ktxpp::plan_upload(desc, subresources, alignment, plan) != ktxpp::UploadSuccess)
+		{
+			check(false, context, "not planned");
+			return;
+		}
+
+		uint32_t bytesPerBlock = desc.bitsPerPixelOrBlock / 8;
+		uint32_t mipCount = ktxpp::get_mip_count(desc), faceCount = ktxpp::get_face_count(desc);
+		uint64_t end = 0;
+		bool aligned = true, packed = true, described = true;
+
+		check(plan.regions.size() == ktxpp::get_subresource_count(desc), context, "wrong number of regions");
+
+		for (const ktxpp::UploadRegion& region : plan.regions)
+		{
+			const ktxpp::Subresource& subresource = subresources[region.subresource];
+			uint32_t widthInBlocks, heightInBlocks;
+			ktxpp::get_mip_size_in_blocks(desc, subresource.mip, widthInBlocks, heightInBlocks);
+
+			aligned &= region.bufferOffset % alignment.offsetAlignment == 0 && region.bufferOffset % bytesPerBlock == 0 && region.bufferOffset % 4 == 0;
+			aligned &= region.rowPitch % alignment.rowPitchAlignment == 0 && region.rowPitch % bytesPerBlock == 0;
+			packed &= region.bufferOffset >= end && region.bufferOffset - end < (uint64_t)alignment.offsetAlignment * bytesPerBlock * 4;
+			packed &= region.rowPitch >= widthInBlocks * bytesPerBlock && region.rowPitch - widthInBlocks * bytesPerBlock < alignment.rowPitchAlignment * bytesPerBlock;
+			described &= region.bufferRowLength == region.rowPitch / bytesPerBlock * desc.blockWidth && region.bufferRowLength >= region.width;
+			described &= region.footprintWidth == widthInBlocks * desc.blockWidth && region.bufferImageHeight == heightInBlocks * desc.blockHeight;
+			described &= region.size == (uint64_t)region.rowPitch * heightInBlocks * region.depth;
+			described &= region.width == subresource.width && region.height == subresource.height && region.depth == subresource.depth;
+			described &= region.mip == subresource.mip && region.arrayLayer == subresource.layer * faceCount + subresource.face;
+			described &= region.d3d12Subresource == region.mip + region.arrayLayer * mipCount;
+			end = region.bufferOffset + region.size;
+		}
+
+		check(aligned, context, "region not aligned");
+		check(packed && plan.size == end, context, "regions overlap or are padded more than needed");
+		check(described, context, "region describes the wrong copy");
+
+		// Rows are compared at the positions the regions give, padding is filled beforehand to see it left alone
+		std::vector<unsigned char> staging((size_t)plan.size, 0xcd), threaded((size_t)plan.size, 0xcd);
+		ktxpp::fill_staging_buffer(plan, subresources, fileData, staging.data());
+		ktxpp::fill_staging_buffer(plan, subresources, fileData, threaded.data(), 4);
+		bool copied = staging == threaded, untouched = true;
+
+		for (const ktxpp::UploadRegion& region : plan.regions)
+		{
+			const ktxpp::Subresource& subresource = subresources[region.subresource];
+			uint32_t rowSize = region.footprintWidth / desc.blockWidth * bytesPerBlock;
+			uint32_t rowCount = region.bufferImageHeight / desc.blockHeight * region.depth;
+
+			for (uint32_t row = 0; row < rowCount; ++row)
+			{
+				const unsigned char* source = fileData + subresource.offset + (uint64_t)row * subresource.rowPitch;
+				const unsigned char* destination = staging.data() + region.bufferOffset + (uint64_t)row * region.rowPitch;
+				copied &= memcmp(source, destination, rowSize) == 0;
+
+				if (region.rowPitch != subresource.rowPitch && region.rowPitch > rowSize)
+				{
+					untouched &= destination[rowSize] == 0xcd;
+				}
+			}
+		}
+
+		check(copied, context, "staging rows differ from the file");
+		check(untouched, context, "row padding overwritten");
+	}
+
+	void check_synthetic(const char* context, ktxpp::GLInternalFormat format, ktxpp::GLType type, ktxpp::GLFormat glFormat, uint32_t width, uint32_t height, uint32_t depth, ktxpp::TextureType textureType, uint32_t arraySize)
+	{
+		// Full mip chains, so the smallest mips are narrower than a block
+		uint32_t mipCount = 1;
+
+		while ((std::max(width, std::max(height, depth)) >> mipCount) > 0)
+		{
+			mipCount++;
+		}
+
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		std::vector<unsigned char> file = make_texture(format, type, glFormat, width, height, depth, textureType, mipCount, arraySize, desc, layout);
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			for (uint64_t i = 0; i < subresource.size; ++i)
+			{
+				file[(size_t)(subresource.offset + i)] = (unsigned char)(i * 37 + subresource.mip * 11 + subresource.layer * 5 + subresource.face);
+			}
+		}
+
+		// imageSize covers one face of a cubemap that isn't an array, even one with a single layer, and the whole level
+		// otherwise
+		uint32_t imageSize;
+		const ktxpp::Subresource& first = layout[ktxpp::get_subresource_index(desc, 0, 0, 0)];
+		memcpy(&imageSize, file.data() + first.offset - sizeof(uint32_t), sizeof(imageSize));
+		check(imageSize == first.size * (textureType == ktxpp::Cubemap && arraySize == 0 ? 1 : desc.arraySize * ktxpp::get_face_count(desc)), context, "wrong imageSize");
+
+		ktxpp::Descriptor validated;
+		check(ktxpp::validate_header(file.data(), file.size(), validated) == ktxpp::ValidationSuccess, context, "file fails validation");
+
+		ktxpp::UploadAlignment vulkan;
+		check_plan(context, desc, layout.data(), file.data(), vulkan);
+		check_plan(context, desc, layout.data(), file.data(), ktxpp::get_d3d12_upload_alignment());
+	}
+
+	void check_errors()
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		make_texture(ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 8, 8, 4, ktxpp::Texture3D, 1, 2, desc, layout);
+
+		ktxpp::UploadPlan plan;
+		ktxpp::UploadAlignment alignment;
+		check(ktxpp::plan_upload(desc, layout.data(), alignment, plan) == ktxpp::UploadUnsupportedTexture, "errors", "3D array planned");
+
+		desc.arraySize = 1;
+		alignment.rowPitchAlignment = 12;
+		check(ktxpp::plan_upload(desc, layout.data(), alignment, plan) == ktxpp::UploadInvalidAlignment, "errors", "alignment of 12 accepted");
+
+		alignment.rowPitchAlignment = 1;
+		alignment.offsetAlignment = 0;
+		check(ktxpp::plan_upload(desc, layout.data(), alignment, plan) == ktxpp::UploadInvalidAlignment, "errors", "alignment of 0 accepted");
+
+		alignment.offsetAlignment = 16;
+		desc.bitsPerPixelOrBlock = 0;
+		check(ktxpp::plan_upload(desc, layout.data(), alignment, plan) == ktxpp::UploadUnsupportedFormat, "errors", "unknown format planned");
+	}
+
+	void check_corpus_file(const char* path)
+	{
+		std::vector<unsigned char> file;
+
+		if (!read_file(path, file))
+		{
+			check(false, path, "could not read file");
+			return;
+		}
+
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header(file.data(), file.size(), desc) != ktxpp::ValidationSuccess || desc.bitsPerPixelOrBlock % 8 != 0)
+		{
+			return;
+		}
+
+		ktxpp::internal::HeaderKTX header;
+		memcpy(&header, file.data(), sizeof(header));
+		std::vector<ktxpp::Subresource> layout(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), layout.data());
+
+		ktxpp::UploadAlignment vulkan;
+		vulkan.offsetAlignment = 64;
+		vulkan.rowPitchAlignment = 8;
+		check_plan(path, desc, layout.data(), file.data(), vulkan);
+		check_plan(path, desc, layout.data(), file.data(), ktxpp::get_d3d12_upload_alignment());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	check_synthetic("rgba8 2D array", ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 37, 70, 0, ktxpp::Texture2D, 3);
+	check_synthetic("rgb8 3D", ktxpp::GL_RGB8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGB, 31, 9, 5, ktxpp::Texture3D, 0);
+	check_synthetic("rgb32f cubemap", ktxpp::GL_RGB32F, ktxpp::GL_FLOAT, ktxpp::GL_RGB, 13, 13, 0, ktxpp::Cubemap, 0);
+	check_synthetic("rgba8 cubemap array of one", ktxpp::GL_RGBA8, ktxpp::GL_UNSIGNED_BYTE, ktxpp::GL_RGBA, 16, 16, 0, ktxpp::Cubemap, 1);
+	check_synthetic("bc1 cubemap array", ktxpp::GL_COMPRESSED_RGBA_S3TC_DXT1, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 70, 70, 0, ktxpp::Cubemap, 2);
+	check_synthetic("astc 10x6 tall", ktxpp::GL_COMPRESSED_RGBA_ASTC_10x6, (ktxpp::GLType)0, (ktxpp::GLFormat)0, 23, 1500, 0, ktxpp::Texture2D, 0);
+	check_errors();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		check_corpus_file(argv[i]);
+	}
+
+	return failures > 0 ? 1 : 0;
+}
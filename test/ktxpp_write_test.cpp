@@ -0,0 +1,151 @@
+// Builds cubemaps and arrays with odd sizes one subresource at a time, serially and from several threads in shuffled
+// order. Both files have to match byte for byte, carry every row with its padding cleared and pass validation
+
+#include "../ktxpp.h"
+#include "ktxpp_test_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace
+{
+	struct Image
+	{
+		std::vector<unsigned char> data;
+		uint32_t rowPitch;
+	};
+
+	// Rows are tight, longer than needed or exactly the file's pitch, so every path of write_subresource is taken.
+	// Bytes past the row are never zero so they show up if they're copied into the padding
+	Image make_image(const ktxpp::Subresource& subresource, uint32_t bytesPerPixel, size_t index)
+	{
+		uint32_t rowSize = subresource.width * bytesPerPixel;
+		uint32_t rowCount = subresource.height * subresource.depth;
+
+		Image image;
+		image.rowPitch = index % 3 == 0 ? rowSize : index % 3 == 1 ? rowSize + 5 : subresource.rowPitch;
+		image.data.assign((size_t)image.rowPitch * rowCount, 0x5A);
+
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			for (uint32_t i = 0; i < rowSize; ++i)
+			{
+				image.data[(size_t)row * image.rowPitch + i] = (unsigned char)((row * 31 + i * 7 + index * 101) | 1);
+			}
+
+			// A source as wide as the file's rows is copied whole, padding included
+			if (image.rowPitch == subresource.rowPitch)
+			{
+				memset(&image.data[(size_t)row * image.rowPitch + rowSize], 0, image.rowPitch - rowSize);
+			}
+		}
+
+		return image;
+	}
+
+	// Garbage where the images go, so rows and padding that aren't written show up
+	std::vector<unsigned char> make_destination(const std::vector<unsigned char>& blank, const std::vector<ktxpp::Subresource>& layout)
+	{
+		std::vector<unsigned char> file = blank;
+
+		for (const ktxpp::Subresource& subresource : layout)
+		{
+			memset(&file[(size_t)subresource.offset], 0xCD, (size_t)subresource.size);
+		}
+
+		return file;
+	}
+
+	void check_write(const char* context, ktxpp::GLInternalFormat format, ktxpp::GLFormat glFormat, uint32_t bytesPerPixel, uint32_t width, uint32_t height, ktxpp::TextureType textureType,
+		uint32_t mipCount, uint32_t arraySize)
+	{
+		ktxpp::Descriptor desc;
+		std::vector<ktxpp::Subresource> layout;
+		const std::vector<unsigned char> blank = make_texture(format, ktxpp::GL_UNSIGNED_BYTE, glFormat, width, height, 0, textureType, mipCount, arraySize, desc, layout);
+
+		std::vector<Image> images;
+
+		for (size_t i = 0; i < layout.size(); ++i)
+		{
+			images.push_back(make_image(layout[i], bytesPerPixel, i));
+		}
+
+		std::vector<unsigned char> serial = make_destination(blank, layout);
+
+		for (size_t i = 0; i < layout.size(); ++i)
+		{
+			ktxpp::write_subresource(desc, layout[i], images[i].data.data(), images[i].rowPitch, serial.data());
+		}
+
+		bool rows = true;
+
+		for (size_t i = 0; i < layout.size(); ++i)
+		{
+			uint32_t rowSize = layout[i].width * bytesPerPixel;
+
+			for (uint32_t row = 0; row < layout[i].height * layout[i].depth; ++row)
+			{
+				const unsigned char* written = &serial[(size_t)(layout[i].offset + (uint64_t)row * layout[i].rowPitch)];
+				rows &= memcmp(written, &images[i].data[(size_t)row * images[i].rowPitch], rowSize) == 0;
+				rows &= std::count(written + rowSize, written + layout[i].rowPitch, 0) == (std::ptrdiff_t)(layout[i].rowPitch - rowSize);
+			}
+		}
+
+		check(rows, context, "rows or their padding differ from the source");
+
+		ktxpp::Descriptor validated;
+		check(ktxpp::validate_header(serial.data(), serial.size(), validated) == ktxpp::ValidationSuccess, context, "serial build doesn't validate");
+
+		std::vector<size_t> order(layout.size());
+
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+
+		std::mt19937 random(42);
+
+		for (uint32_t pass = 0; pass < 16; ++pass)
+		{
+			std::shuffle(order.begin(), order.end(), random);
+
+			std::vector<unsigned char> file = make_destination(blank, layout);
+			std::atomic<size_t> next(0);
+			std::vector<std::thread> threads;
+
+			for (uint32_t t = 0; t < 4; ++t)
+			{
+				threads.push_back(std::thread([&]()
+				{
+					for (size_t i = next++; i < order.size(); i = next++)
+					{
+						ktxpp::write_subresource(desc, layout[order[i]], images[order[i]].data.data(), images[order[i]].rowPitch, file.data());
+					}
+				}));
+			}
+
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+
+			check(file == serial, context, "threaded build differs from the serial one");
+			check(ktxpp::validate_header(file.data(), file.size(), validated) == ktxpp::ValidationSuccess, context, "threaded build doesn't validate");
+		}
+
+		check(validated.type == textureType && validated.width == width && validated.height == height && ktxpp::get_subresource_count(validated) == layout.size(), context, "validated descriptor differs");
+	}
+}
+
+int main()
+{
+	// Rows of odd widths of RGB8 always need padding. Arrays of cubemaps pack faces back to back while lone cubemaps
+	// give imageSize per face, with cube padding that 4 byte aligned rows always leave empty
+	check_write("cubemap array", ktxpp::GL_RGB8, ktxpp::GL_RGB, 3, 13, 13, ktxpp::Cubemap, 4, 3);
+	check_write("cubemap", ktxpp::GL_RGB8, ktxpp::GL_RGB, 3, 13, 13, ktxpp::Cubemap, 4, 0);
+	check_write("2d array", ktxpp::GL_RG8, ktxpp::GL_RG, 2, 19, 7, ktxpp::Texture2D, 5, 5);
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+// Converts KTX 1.1 files to KTX2
+//
+// Usage: ktxpp_convert [-j threads] [--zstd level | --zlib level] [-o output_directory] [--cache directory [--cache-size megabytes]] input.ktx...
+//
+// Files are converted in parallel, one file per thread, so memory stays bounded by the number of threads times
+// the size of the largest file. A single file is converted using all threads across its levels instead.
+// Outputs are written next to the input (or in the output directory) with the .ktx2 extension. Supercompression
+// is available when built with ktxpp_zstd or ktxpp_zlib defined. With --cache, conversions are kept in an encode
+// cache shared by every run, so unchanged inputs are copied from the cache instead of being converted again
+
+#include "../ktxpp_cache.h"
+#include "../ktxpp_convert.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+namespace
+{
+	bool read_file(const std::string& path, std::vector<unsigned char>& data)
+	{
+		FILE* fh = fopen(path.c_str(), "rb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		fseek(fh, 0, SEEK_END);
+		long size = ftell(fh);
+		rewind(fh);
+
+		data.resize(size > 0 ? (size_t)size : 0);
+		bool success = size > 0 && fread(data.data(), 1, data.size(), fh) == data.size();
+		fclose(fh);
+
+		return success;
+	}
+
+	bool write_file(const std::string& path, const std::vector<unsigned char>& data)
+	{
+		FILE* fh = fopen(path.c_str(), "wb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		bool success = fwrite(data.data(), 1, data.size(), fh) == data.size();
+		return fclose(fh) == 0 && success;
+	}
+
+	std::string get_output_path(const std::string& input, const std::string& outputDirectory)
+	{
+		std::string name = input;
+
+		if (!outputDirectory.empty())
+		{
+			size_t slash = name.find_last_of("/\\");
+			name = outputDirectory + "/" + (slash == std::string::npos ? name : name.substr(slash + 1));
+		}
+
+		size_t dot = name.find_last_of('.');
+		size_t slash = name.find_last_of("/\\");
+
+		if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		{
+			name = name.substr(0, dot);
+		}
+
+		return name + ".ktx2";
+	}
+
+	// Bump when a change to ktxpp alters the files it converts, so cached conversions aren't reused
+	const uint32_t CONVERT_CACHE_VERSION = 1;
+
+	ktxpp::GLInternalFormat get_format(const std::vector<unsigned char>& source)
+	{
+		ktxpp::internal::HeaderKTX header;
+
+		if (source.size() < sizeof(header))
+		{
+			return ktxpp::UNKNOWN;
+		}
+
+		memcpy(&header, source.data(), sizeof(header));
+		return (ktxpp::GLInternalFormat)(header.glInternalFormat & 0xffff);
+	}
+
+	const char* get_result_string(ktxpp::ConvertResult result)
+	{
+		switch (result)
+		{
+			case ktxpp::ConvertSuccess:                      return "success";
+			case ktxpp::ConvertInvalidSource:                return "not a valid KTX 1.1 file";
+			case ktxpp::ConvertUnsupportedFormat:            return "format cannot be described in KTX2";
+			case ktxpp::ConvertUnsupportedSupercompression:  return "supercompression scheme not available";
+			case ktxpp::ConvertSupercompressionFailed:       return "supercompression failed";
+			default:                                         return "unknown error";
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ktxpp::ConvertOptions options;
+	uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::string outputDirectory;
+	std::string cacheDirectory;
+	uint64_t cacheSize = 1024;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "-j" && i + 1 < argc)
+		{
+			threadCount = std::max(1, atoi(argv[++i]));
+		}
+		else if (argument == "--zstd" && i + 1 < argc)
+		{
+			options.supercompression = ktxpp::SupercompressionZstd;
+			options.supercompressionLevel = atoi(argv[++i]);
+		}
+		else if (argument == "--zlib" && i + 1 < argc)
+		{
+			options.supercompression = ktxpp::SupercompressionZLIB;
+			options.supercompressionLevel = atoi(argv[++i]);
+		}
+		else if (argument == "-o" && i + 1 < argc)
+		{
+			outputDirectory = argv[++i];
+		}
+		else if (argument == "--cache" && i + 1 < argc)
+		{
+			cacheDirectory = argv[++i];
+		}
+		else if (argument == "--cache-size" && i + 1 < argc)
+		{
+			cacheSize = (uint64_t)std::max(1, atoi(argv[++i]));
+		}
+		else
+		{
+			inputs.push_back(argument);
+		}
+	}
+
+	if (inputs.empty())
+	{
+		printf("Usage: ktxpp_convert [-j threads] [--zstd level | --zlib level] [-o output_directory] [--cache directory [--cache-size megabytes]] input.ktx...\n");
+		return 1;
+	}
+
+	ktxpp::EncodeCache cache;
+
+	if (!cacheDirectory.empty() && !ktxpp::open_encode_cache(cache, cacheDirectory.c_str(), cacheSize << 20))
+	{
+		fprintf(stderr, "%s: could not create cache directory\n", cacheDirectory.c_str());
+		return 1;
+	}
+
+	// Everything besides the source that changes the output
+	const uint32_t cacheSettings[] = { CONVERT_CACHE_VERSION, (uint32_t)options.supercompression, (uint32_t)options.supercompressionLevel };
+
+	// Throughput is best with one file per thread, but a lone file can still spread its levels across threads
+	options.threadCount = inputs.size() == 1 ? threadCount : 1;
+
+	std::atomic<uint32_t> failures(0);
+	std::mutex printMutex;
+
+	ktxpp::internal::parallel_for((uint32_t)inputs.size(), threadCount, [&](uint32_t i)
+	{
+		std::vector<unsigned char> source;
+		std::vector<unsigned char> destination;
+		const char* error = nullptr;
+
+		if (!read_file(inputs[i], source))
+		{
+			error = "could not read input";
+		}
+		else
+		{
+			ktxpp::Hash128 key = ktxpp::get_encode_cache_key(source.data(), source.size(), get_format(source), cacheSettings, sizeof(cacheSettings));
+			bool cached = !cacheDirectory.empty() && ktxpp::load_encode_cache(cache, key, destination);
+			ktxpp::ConvertResult result = cached ? ktxpp::ConvertSuccess : ktxpp::convert_ktx1_to_ktx2(source.data(), source.size(), options, destination);
+
+			if (result != ktxpp::ConvertSuccess)
+			{
+				error = get_result_string(result);
+			}
+			else if (!write_file(get_output_path(inputs[i], outputDirectory), destination))
+			{
+				error = "could not write output";
+			}
+			else if (!cached && !cacheDirectory.empty())
+			{
+				ktxpp::store_encode_cache(cache, key, destination.data(), destination.size());
+			}
+		}
+
+		if (error)
+		{
+			failures++;
+			std::lock_guard<std::mutex> lock(printMutex);
+			fprintf(stderr, "%s: %s\n", inputs[i].c_str(), error);
+		}
+	});
+
+	if (!cacheDirectory.empty())
+	{
+		printf("%llu of %zu files from the cache\n", (unsigned long long)cache.hits.load(), inputs.size());
+	}
+
+	return failures > 0 ? 1 : 0;
+}
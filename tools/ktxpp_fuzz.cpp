@@ -0,0 +1,72 @@
+// libFuzzer target for the KTX 1.1 and KTX2 parsers
+//
+// Build: clang++ -std=c++11 -g -O1 -fsanitize=fuzzer,address,undefined tools/ktxpp_fuzz.cpp -o ktxpp_fuzz
+// Run:   ./ktxpp_fuzz -max_len=65536 corpus_directory test
+//
+// Anything validate_header accepts must be safe to walk, so accepted inputs are pushed through the layout, every
+// key/value entry and a full conversion to KTX2, which touches every byte of image data. Whatever validate_header_ktx2
+// accepts must have every subresource of an uncompressed file inside the input
+
+#include "../ktxpp_convert.h"
+
+namespace
+{
+	void fuzz_ktx2(const uint8_t* data, size_t size)
+	{
+		ktxpp::Descriptor desc;
+
+		if (ktxpp::validate_header_ktx2(data, size, desc) != ktxpp::ValidationSuccess)
+		{
+			return;
+		}
+
+		ktxpp::internal::HeaderKTX2 header;
+		memcpy(&header, data, sizeof(header));
+
+		std::vector<ktxpp::Subresource> subresources(ktxpp::get_subresource_count(desc));
+		ktxpp::compute_subresource_layout_ktx2(desc, ktxpp::decode_header_ktx2(data, desc), header.supercompressionScheme != 0, subresources.data());
+
+		for (const ktxpp::Subresource& subresource : subresources)
+		{
+			if (header.supercompressionScheme == 0 && (subresource.offset > size || subresource.size > size - subresource.offset))
+			{
+				__builtin_trap();
+			}
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	fuzz_ktx2(data, size);
+
+	ktxpp::Descriptor desc;
+
+	if (ktxpp::validate_header(data, size, desc) != ktxpp::ValidationSuccess)
+	{
+		return 0;
+	}
+
+	ktxpp::internal::HeaderKTX header;
+	memcpy(&header, data, sizeof(header));
+
+	std::vector<ktxpp::Subresource> subresources(ktxpp::get_subresource_count(desc));
+	uint64_t fileSize = ktxpp::compute_subresource_layout(desc, ktxpp::get_image_data_offset(header), subresources.data());
+
+	// The last level may be missing its mipPadding
+	if (fileSize > size + 3)
+	{
+		__builtin_trap();
+	}
+
+	const unsigned char* cursor = data + sizeof(header);
+	const unsigned char* keyValueEnd = cursor + header.bytesOfKeyValueData;
+	ktxpp::KeyValue keyValue;
+
+	while (ktxpp::next_key_value(cursor, keyValueEnd, keyValue)) {}
+
+	std::vector<unsigned char> converted;
+	ktxpp::convert_ktx1_to_ktx2(data, size, ktxpp::ConvertOptions(), converted);
+
+	return 0;
+}
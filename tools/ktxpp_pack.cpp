@@ -0,0 +1,143 @@
+// Packs KTX 1.1 files into a single ktxpp pack
+//
+// Usage: ktxpp_pack [-p page_size] [-d] [-l] -o output.pak input.ktx...
+//        ktxpp_pack -l input.pak
+//
+// Textures are named by their path as given on the command line and stored in the same order, so list them in
+// the order they are usually loaded. -d stores identical images once and -l lists the contents of a pack
+
+#include "../ktxpp_pack.h"
+
+#include <cstdlib>
+
+namespace
+{
+	bool read_file(const std::string& path, std::vector<unsigned char>& data)
+	{
+		FILE* fh = fopen(path.c_str(), "rb");
+
+		if (!fh)
+		{
+			return false;
+		}
+
+		fseek(fh, 0, SEEK_END);
+		long size = ftell(fh);
+		rewind(fh);
+
+		data.resize(size > 0 ? (size_t)size : 0);
+		bool success = size > 0 && fread(data.data(), 1, data.size(), fh) == data.size();
+		fclose(fh);
+
+		return success;
+	}
+
+	const char* get_result_string(ktxpp::PackResult result)
+	{
+		switch (result)
+		{
+			case ktxpp::PackSuccess:                return "success";
+			case ktxpp::PackInvalidTexture:         return "not a valid KTX 1.1 file";
+			case ktxpp::PackDuplicateName:          return "two textures have the same name";
+			case ktxpp::PackOpenFailed:             return "could not open file";
+			case ktxpp::PackWriteFailed:            return "could not write file";
+			case ktxpp::PackTruncated:              return "pack is truncated";
+			case ktxpp::PackInvalidIdentifier:      return "not a ktxpp pack";
+			case ktxpp::PackUnsupportedEndianness:  return "pack was built on a machine of a different byte order";
+			case ktxpp::PackUnsupportedVersion:     return "unsupported pack version";
+			case ktxpp::PackMisaligned:             return "pack data is misaligned";
+			case ktxpp::PackInvalidDirectory:       return "pack directory is corrupt";
+			default:                                return "unknown error";
+		}
+	}
+
+	int list_pack(const char* path)
+	{
+		ktxpp::PackFile file;
+		ktxpp::PackResult result = ktxpp::open_pack_file(file, path);
+
+		if (result != ktxpp::PackSuccess)
+		{
+			fprintf(stderr, "%s: %s\n", path, get_result_string(result));
+			return 1;
+		}
+
+		for (uint32_t i = 0; i < file.pack.header.entryCount; ++i)
+		{
+			const ktxpp::PackEntry& entry = file.pack.entries[i];
+			printf("%12llu %10llu  %ux%u  %u mips  %s\n", (unsigned long long)entry.offset, (unsigned long long)entry.size, entry.desc.width, entry.desc.height, ktxpp::get_mip_count(entry.desc), ktxpp::get_pack_texture_name(file.pack, entry).c_str());
+		}
+
+		ktxpp::close_pack_file(file);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ktxpp::PackBuilder builder;
+	std::string output;
+	std::vector<std::string> inputs;
+	bool list = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "-p" && i + 1 < argc)
+		{
+			builder.pageSize = (uint32_t)std::max(16, atoi(argv[++i]));
+		}
+		else if (argument == "-o" && i + 1 < argc)
+		{
+			output = argv[++i];
+		}
+		else if (argument == "-d")
+		{
+			builder.deduplicate = true;
+		}
+		else if (argument == "-l")
+		{
+			list = true;
+		}
+		else
+		{
+			inputs.push_back(argument);
+		}
+	}
+
+	if (list && output.empty() && inputs.size() == 1)
+	{
+		return list_pack(inputs[0].c_str());
+	}
+
+	if (output.empty() || inputs.empty())
+	{
+		printf("Usage: ktxpp_pack [-p page_size] [-d] [-l] -o output.pak input.ktx...\n       ktxpp_pack -l input.pak\n");
+		return 1;
+	}
+
+	// The builder references the sources until the pack is written
+	std::vector<std::vector<unsigned char> > sources(inputs.size());
+
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		ktxpp::PackResult result = read_file(inputs[i], sources[i]) ? ktxpp::add_pack_texture(builder, inputs[i].c_str(), sources[i].data(), sources[i].size()) : ktxpp::PackOpenFailed;
+
+		if (result != ktxpp::PackSuccess)
+		{
+			fprintf(stderr, "%s: %s\n", inputs[i].c_str(), get_result_string(result));
+			return 1;
+		}
+	}
+
+	ktxpp::PackResult result = ktxpp::write_pack(builder, output.c_str());
+
+	if (result != ktxpp::PackSuccess)
+	{
+		fprintf(stderr, "%s: %s\n", output.c_str(), get_result_string(result));
+		return 1;
+	}
+
+	return list ? list_pack(output.c_str()) : 0;
+}